@@ -596,6 +596,30 @@ typedef PVDREGIONLIST *PPVDREGIONLIST;
 #define VD_REGION_LIST_F_VALID               (VD_REGION_LIST_F_LOC_SIZE_BLOCKS)
 /** @} */
 
+/**
+ * Read-ahead statistics of a HDD container.
+ */
+typedef struct VDREADAHEADSTATS
+{
+    /** Number of read requests recognized as part of a sequential stream. */
+    uint64_t                 cSeqReads;
+    /** Number of read requests starting in a read-ahead buffer. */
+    uint64_t                 cHits;
+    /** Number of sequential read requests which missed the read-ahead buffers
+     * after read-ahead kicked in. */
+    uint64_t                 cMisses;
+    /** Number of bytes copied from the read-ahead buffers. */
+    uint64_t                 cbHit;
+    /** Number of read-ahead requests issued. */
+    uint64_t                 cReadAheads;
+    /** Number of bytes requested by read-ahead requests. */
+    uint64_t                 cbReadAhead;
+    /** Number of buffered ranges dropped because of overlapping writes or discards. */
+    uint64_t                 cInvalidated;
+} VDREADAHEADSTATS;
+/** Pointer to read-ahead statistics. */
+typedef VDREADAHEADSTATS *PVDREADAHEADSTATS;
+
 /**
  * VBox HDD Container main structure.
  */
@@ -1422,6 +1446,36 @@ VBOXDDU_DECL(int) VDSetParentUuid(PVBOXHDD pDisk, unsigned nImage, PCRTUUID pUui
 VBOXDDU_DECL(void) VDDumpImages(PVBOXHDD pDisk);
 
 
+/**
+ * Configures read-ahead for sequential read streams of the HDD container.
+ *
+ * Once the given number of consecutive sequential read requests was seen the
+ * container starts reading up to two windows of data ahead of the stream into
+ * internal buffers. The data is read through the attached cache and the whole
+ * differencing image chain like any other read.
+ *
+ * @return  VBox status code.
+ * @param   pDisk           Pointer to HDD container.
+ * @param   cbWindow        Number of bytes to read ahead with one request,
+ *                          0 disables read-ahead. Must be a multiple of 512.
+ * @param   cSeqThreshold   Number of consecutive sequential read requests before
+ *                          read-ahead kicks in.
+ *
+ * @note Must not be called with I/O requests in flight.
+ */
+VBOXDDU_DECL(int) VDSetReadAhead(PVBOXHDD pDisk, size_t cbWindow, uint32_t cSeqThreshold);
+
+/**
+ * Queries the read-ahead statistics of the HDD container.
+ *
+ * @return  VBox status code.
+ * @retval  VERR_NOT_SUPPORTED if read-ahead is not enabled.
+ * @param   pDisk           Pointer to HDD container.
+ * @param   pStats          Where to store the statistics.
+ */
+VBOXDDU_DECL(int) VDGetReadAheadStats(PVBOXHDD pDisk, PVDREADAHEADSTATS pStats);
+
+
 /**
  * Discards unused ranges given as a list.
  *
@@ -27,6 +27,7 @@
 #define ___VBox_vmm_stam_h
 
 #include <VBox/types.h>
+#include <iprt/assert.h>
 #include <iprt/stdarg.h>
 #ifdef _MSC_VER
 # if _MSC_VER >= 1400
@@ -161,6 +162,10 @@ typedef enum STAMTYPE
     STAMTYPE_BOOL,
     /** Generic boolean value. Reset to false. */
     STAMTYPE_BOOL_RESET,
+    /** Per-CPU counter (STAMCOUNTERPERCPU), presented as STAMTYPE_COUNTER. */
+    STAMTYPE_COUNTER_PERCPU,
+    /** Per-CPU profile (STAMPROFILEPERCPU), presented as STAMTYPE_PROFILE. */
+    STAMTYPE_PROFILE_PERCPU,
     /** The end (exclusive). */
     STAMTYPE_END
 } STAMTYPE;
@@ -1100,6 +1105,208 @@ typedef STAMRATIOU32 *PSTAMRATIOU32;
 typedef const STAMRATIOU32 *PCSTAMRATIOU32;
 
 
+/** @def STAM_PERCPU_SLOTS
+ * The number of slots in the per-CPU samples (STAMCOUNTERPERCPU and
+ * STAMPROFILEPERCPU).  Power of two.  Virtual CPUs with IDs beyond this share
+ * slots (modulo), which only reintroduces the line sharing for those. */
+#define STAM_PERCPU_SLOTS       8
+
+/** @def STAM_PERCPU_SLOT
+ * Calculates the slot index for a virtual CPU.
+ *
+ * @param   idCpu       The virtual CPU ID (VMCPU::idCpu).
+ */
+#define STAM_PERCPU_SLOT(idCpu) ((uint32_t)(idCpu) & (STAM_PERCPU_SLOTS - 1))
+
+/** @def STAM_PERCPU_SLOT_ALIGN
+ * Aligns the slots of the per-CPU samples on a cache line. */
+#ifdef _MSC_VER
+# define STAM_PERCPU_SLOT_ALIGN __declspec(align(64))
+#else
+# define STAM_PERCPU_SLOT_ALIGN __attribute__((aligned(64)))
+#endif
+
+/**
+ * Per-CPU counter sample - STAMTYPE_COUNTER_PERCPU.
+ *
+ * Each virtual CPU updates its own cache line, so there is no line bouncing
+ * when a counter is hit from several EMTs at once.  STAM sums up the slots and
+ * presents the result as a STAMTYPE_COUNTER sample to readers.
+ *
+ * @remarks The sample must be 64 byte aligned, STAMR3Register asserts this.
+ */
+typedef struct STAMCOUNTERPERCPU
+{
+    struct STAM_PERCPU_SLOT_ALIGN
+    {
+        /** The count for this slot. */
+        volatile uint64_t   c;
+        /** Padding the slot to a cache line. */
+        uint64_t            au64Padding[7];
+    } aSlots[STAM_PERCPU_SLOTS];
+} STAMCOUNTERPERCPU;
+AssertCompileSize(STAMCOUNTERPERCPU, STAM_PERCPU_SLOTS * 64);
+/** Pointer to a per-CPU counter. */
+typedef STAMCOUNTERPERCPU *PSTAMCOUNTERPERCPU;
+/** Pointer to a const per-CPU counter. */
+typedef const STAMCOUNTERPERCPU *PCSTAMCOUNTERPERCPU;
+
+
+/** @def STAM_REL_COUNTER_PERCPU_INC
+ * Increments a per-CPU counter sample by one.
+ *
+ * @param   pCounter    Pointer to the STAMCOUNTERPERCPU structure to operate on.
+ * @param   idCpu       The ID of the calling virtual CPU.
+ */
+#ifndef VBOX_WITHOUT_RELEASE_STATISTICS
+# define STAM_REL_COUNTER_PERCPU_INC(pCounter, idCpu) \
+    do { (pCounter)->aSlots[STAM_PERCPU_SLOT(idCpu)].c++; } while (0)
+#else
+# define STAM_REL_COUNTER_PERCPU_INC(pCounter, idCpu) do { } while (0)
+#endif
+/** @def STAM_COUNTER_PERCPU_INC
+ * Increments a per-CPU counter sample by one.
+ *
+ * @param   pCounter    Pointer to the STAMCOUNTERPERCPU structure to operate on.
+ * @param   idCpu       The ID of the calling virtual CPU.
+ */
+#ifdef VBOX_WITH_STATISTICS
+# define STAM_COUNTER_PERCPU_INC(pCounter, idCpu) STAM_REL_COUNTER_PERCPU_INC(pCounter, idCpu)
+#else
+# define STAM_COUNTER_PERCPU_INC(pCounter, idCpu) do { } while (0)
+#endif
+
+
+/** @def STAM_REL_COUNTER_PERCPU_ADD
+ * Increments a per-CPU counter sample by a value.
+ *
+ * @param   pCounter    Pointer to the STAMCOUNTERPERCPU structure to operate on.
+ * @param   idCpu       The ID of the calling virtual CPU.
+ * @param   Addend      The value to add to the counter.
+ */
+#ifndef VBOX_WITHOUT_RELEASE_STATISTICS
+# define STAM_REL_COUNTER_PERCPU_ADD(pCounter, idCpu, Addend) \
+    do { (pCounter)->aSlots[STAM_PERCPU_SLOT(idCpu)].c += (Addend); } while (0)
+#else
+# define STAM_REL_COUNTER_PERCPU_ADD(pCounter, idCpu, Addend) do { } while (0)
+#endif
+/** @def STAM_COUNTER_PERCPU_ADD
+ * Increments a per-CPU counter sample by a value.
+ *
+ * @param   pCounter    Pointer to the STAMCOUNTERPERCPU structure to operate on.
+ * @param   idCpu       The ID of the calling virtual CPU.
+ * @param   Addend      The value to add to the counter.
+ */
+#ifdef VBOX_WITH_STATISTICS
+# define STAM_COUNTER_PERCPU_ADD(pCounter, idCpu, Addend) STAM_REL_COUNTER_PERCPU_ADD(pCounter, idCpu, Addend)
+#else
+# define STAM_COUNTER_PERCPU_ADD(pCounter, idCpu, Addend) do { } while (0)
+#endif
+
+
+/**
+ * Per-CPU profiling sample - STAMTYPE_PROFILE_PERCPU.
+ *
+ * Same as STAMCOUNTERPERCPU, only with a STAMPROFILE per slot.  Readers get a
+ * STAMTYPE_PROFILE sample with the periods and ticks summed up and the min/max
+ * values taken across all slots.
+ *
+ * @remarks The sample must be 64 byte aligned, STAMR3Register asserts this.
+ */
+typedef struct STAMPROFILEPERCPU
+{
+    struct STAM_PERCPU_SLOT_ALIGN
+    {
+        /** The profile data for this slot. */
+        STAMPROFILE         Profile;
+        /** Padding the slot to a cache line. */
+        uint64_t            au64Padding[4];
+    } aSlots[STAM_PERCPU_SLOTS];
+} STAMPROFILEPERCPU;
+AssertCompileSize(STAMPROFILEPERCPU, STAM_PERCPU_SLOTS * 64);
+/** Pointer to a per-CPU profile sample. */
+typedef STAMPROFILEPERCPU *PSTAMPROFILEPERCPU;
+/** Pointer to a const per-CPU profile sample. */
+typedef const STAMPROFILEPERCPU *PCSTAMPROFILEPERCPU;
+
+
+/** @def STAM_REL_PROFILE_PERCPU_ADD_PERIOD
+ * Adds a period to a per-CPU profile sample.
+ *
+ * @param   pProfile        Pointer to the STAMPROFILEPERCPU structure to operate on.
+ * @param   idCpu           The ID of the calling virtual CPU.
+ * @param   cTicksInPeriod  The number of tick (or whatever) of the period
+ *                          being added.  This is only referenced once.
+ */
+#ifndef VBOX_WITHOUT_RELEASE_STATISTICS
+# define STAM_REL_PROFILE_PERCPU_ADD_PERIOD(pProfile, idCpu, cTicksInPeriod) \
+    STAM_REL_PROFILE_ADD_PERIOD(&(pProfile)->aSlots[STAM_PERCPU_SLOT(idCpu)].Profile, cTicksInPeriod)
+#else
+# define STAM_REL_PROFILE_PERCPU_ADD_PERIOD(pProfile, idCpu, cTicksInPeriod) do { } while (0)
+#endif
+/** @def STAM_PROFILE_PERCPU_ADD_PERIOD
+ * Adds a period to a per-CPU profile sample.
+ *
+ * @param   pProfile        Pointer to the STAMPROFILEPERCPU structure to operate on.
+ * @param   idCpu           The ID of the calling virtual CPU.
+ * @param   cTicksInPeriod  The number of tick (or whatever) of the period
+ *                          being added.  This is only referenced once.
+ */
+#ifdef VBOX_WITH_STATISTICS
+# define STAM_PROFILE_PERCPU_ADD_PERIOD(pProfile, idCpu, cTicksInPeriod) \
+    STAM_REL_PROFILE_PERCPU_ADD_PERIOD(pProfile, idCpu, cTicksInPeriod)
+#else
+# define STAM_PROFILE_PERCPU_ADD_PERIOD(pProfile, idCpu, cTicksInPeriod) do { } while (0)
+#endif
+
+
+/** @def STAM_REL_PROFILE_PERCPU_START
+ * Samples the start time of a per-CPU profiling period.
+ *
+ * @param   pProfile    Pointer to the STAMPROFILEPERCPU structure to operate on.
+ * @param   Prefix      Identifier prefix used to internal variables.
+ *
+ * @remarks Declears a stack variable that will be used by related macros.
+ */
+#define STAM_REL_PROFILE_PERCPU_START(pProfile, Prefix)  STAM_REL_PROFILE_START(pProfile, Prefix)
+/** @def STAM_PROFILE_PERCPU_START
+ * Samples the start time of a per-CPU profiling period.
+ *
+ * @param   pProfile    Pointer to the STAMPROFILEPERCPU structure to operate on.
+ * @param   Prefix      Identifier prefix used to internal variables.
+ *
+ * @remarks Declears a stack variable that will be used by related macros.
+ */
+#define STAM_PROFILE_PERCPU_START(pProfile, Prefix)      STAM_PROFILE_START(pProfile, Prefix)
+
+
+/** @def STAM_REL_PROFILE_PERCPU_STOP
+ * Samples the stop time of a per-CPU profiling period and updates the sample.
+ *
+ * @param   pProfile    Pointer to the STAMPROFILEPERCPU structure to operate on.
+ * @param   idCpu       The ID of the calling virtual CPU.
+ * @param   Prefix      Identifier prefix used to internal variables.
+ */
+#ifndef VBOX_WITHOUT_RELEASE_STATISTICS
+# define STAM_REL_PROFILE_PERCPU_STOP(pProfile, idCpu, Prefix) \
+    STAM_REL_PROFILE_STOP(&(pProfile)->aSlots[STAM_PERCPU_SLOT(idCpu)].Profile, Prefix)
+#else
+# define STAM_REL_PROFILE_PERCPU_STOP(pProfile, idCpu, Prefix) do { } while (0)
+#endif
+/** @def STAM_PROFILE_PERCPU_STOP
+ * Samples the stop time of a per-CPU profiling period and updates the sample.
+ *
+ * @param   pProfile    Pointer to the STAMPROFILEPERCPU structure to operate on.
+ * @param   idCpu       The ID of the calling virtual CPU.
+ * @param   Prefix      Identifier prefix used to internal variables.
+ */
+#ifdef VBOX_WITH_STATISTICS
+# define STAM_PROFILE_PERCPU_STOP(pProfile, idCpu, Prefix) STAM_REL_PROFILE_PERCPU_STOP(pProfile, idCpu, Prefix)
+#else
+# define STAM_PROFILE_PERCPU_STOP(pProfile, idCpu, Prefix) do { } while (0)
+#endif
+
+
 
 
 /** @defgroup grp_stam_r3   The STAM Host Context Ring 3 API
@@ -1213,6 +1420,14 @@ VMMR3DECL(int)  STAMR3DeregisterByAddr(PUVM pUVM, void *pvSample);
 VMMR3DECL(int)  STAMR3Reset(PUVM pUVM, const char *pszPat);
 VMMR3DECL(int)  STAMR3Snapshot(PUVM pUVM, const char *pszPat, char **ppszSnapshot, size_t *pcchSnapshot, bool fWithDesc);
 VMMR3DECL(int)  STAMR3SnapshotFree(PUVM pUVM, char *pszSnapshot);
+
+/** Pointer to a delta snapshot handle (opaque). */
+typedef struct STAMR3DELTA *PSTAMR3DELTA;
+VMMR3DECL(int)  STAMR3DeltaCreate(PUVM pUVM, const char *pszPat, PSTAMR3DELTA *phDelta);
+VMMR3DECL(int)  STAMR3DeltaSnapshot(PUVM pUVM, PSTAMR3DELTA hDelta, bool fFull, char **ppszSnapshot, size_t *pcchSnapshot,
+                                    uint32_t *pcChanged);
+VMMR3DECL(int)  STAMR3DeltaDestroy(PUVM pUVM, PSTAMR3DELTA hDelta);
+
 VMMR3DECL(int)  STAMR3Dump(PUVM pUVM, const char *pszPat);
 VMMR3DECL(int)  STAMR3DumpToReleaseLog(PUVM pUVM, const char *pszPat);
 VMMR3DECL(int)  STAMR3Print(PUVM pUVM, const char *pszPat);
@@ -41,6 +41,11 @@
 #endif
 #include <iprt/mem.h>
 #include <iprt/string.h> /* For RT_BZERO. */
+#ifdef RT_ARCH_AMD64
+/* SSE2 is part of the AMD64 base architecture, so no CPUID checking needed. */
+# define AUDIOMIXBUF_WITH_SSE2
+# include <emmintrin.h>
+#endif
 
 #ifdef VBOX_AUDIO_TESTCASE
 # define LOG_ENABLED
@@ -137,6 +142,11 @@ AssertCompile(AUDIOMIXBUF_VOL_0DB == 0x40000000);   /* For now -- when only atte
 static uint64_t s_cSamplesMixedTotal = 0;
 #endif
 
+#ifdef AUDIOMIXBUF_WITH_SSE2
+/** Whether to use the SSE2 conversion routines (only cleared by testcases). */
+static bool s_fAudioMixBufSse2 = true;
+#endif
+
 
 /**
  * Peeks for audio samples without any conversion done.
@@ -548,6 +558,223 @@ AUDMIXBUF_CONVERT(U32 /* Name */, uint32_t, 0         /* Min */, UINT32_MAX /* M
 
 #undef AUDMIXBUF_CONVERT
 
+#ifdef AUDIOMIXBUF_WITH_SSE2
+/*
+ * SSE2 variants of the signed 16-bit and 32-bit stereo conversion routines,
+ * which is what nearly all devices and backends use.
+ *
+ * The internal samples are 64-bit and the volume is applied as a 32x32->64 bit
+ * signed multiplication followed by an arithmetic right shift.  SSE2 has neither,
+ * so the multiplication is done unsigned (pmuludq) and fixed up for negative
+ * inputs, and the shift is done logically on the sign-flipped value.  Both give
+ * the exact same results as the scalar code, which the testcase verifies.
+ */
+
+/**
+ * Applies the volume to two 32-bit samples in lanes 0 and 2.
+ *
+ * @returns The two 64-bit results (ASMMult2xS32RetS64(x, vol) >> AUDIOMIXBUF_VOL_SHIFT).
+ * @param   uSamples    The samples in lanes 0 and 2; lanes 1 and 3 must be
+ *                      copies of those (for the sign mask).
+ * @param   uVol        The volume in lanes 0 and 2, zero in lanes 1 and 3.
+ * @param   uVolHi      The volume shifted left by 32 (as 64-bit lanes).
+ */
+DECLINLINE(__m128i) audioMixBufSse2ApplyVol(__m128i uSamples, __m128i uVol, __m128i uVolHi)
+{
+    __m128i const uSignBit = _mm_set_epi32(INT32_MIN, 0, INT32_MIN, 0);
+    __m128i const uBias    = _mm_set_epi32(1 << (31 - AUDIOMIXBUF_VOL_SHIFT), 0, 1 << (31 - AUDIOMIXBUF_VOL_SHIFT), 0); /* 2^(63-shift) */
+
+    /* Signed multiplication: unsigned product minus (vol << 32) for negative samples. */
+    __m128i uProd = _mm_mul_epu32(uSamples, uVol);
+    uProd = _mm_sub_epi64(uProd, _mm_and_si128(_mm_srai_epi32(uSamples, 31), uVolHi));
+
+    /* Arithmetic shift right: flip the sign bit, shift logically and subtract the bias. */
+    uProd = _mm_srli_epi64(_mm_xor_si128(uProd, uSignBit), AUDIOMIXBUF_VOL_SHIFT);
+    return _mm_sub_epi64(uProd, uBias);
+}
+
+/**
+ * Calculates the pmaddwd factors and the 0dB mask for one channel, see
+ * audioMixBufConvFromS16StereoSse2.
+ */
+DECLINLINE(void) audioMixBufSse2S16VolFactors(uint32_t uVol, int16_t *pi16Mul1, int16_t *pi16Mul2, int32_t *pfIs0dB)
+{
+    uint32_t const uFactor = uVol >> (AUDIOMIXBUF_VOL_SHIFT - 16);
+    if (uFactor >= 0x10000)
+    {
+        *pi16Mul1 = 0;
+        *pi16Mul2 = 0;
+        *pfIs0dB  = -1;
+    }
+    else
+    {
+        Assert(uFactor < 0xffff);
+        *pi16Mul1 = (int16_t)(uFactor / 2);
+        *pi16Mul2 = (int16_t)(uFactor - uFactor / 2);
+        *pfIs0dB  = 0;
+    }
+}
+
+/** SSE2 version of audioMixBufConvFromS16Stereo. */
+static DECLCALLBACK(uint32_t) audioMixBufConvFromS16StereoSse2(PPDMAUDIOSAMPLE paDst, const void *pvSrc, uint32_t cbSrc,
+                                                                PCPDMAUDMIXBUFCONVOPTS pOpts)
+{
+    int16_t const *pSrc = (int16_t const *)pvSrc;
+    uint32_t const cSamples = RT_MIN(pOpts->cSamples, cbSrc / sizeof(int16_t));
+    uint32_t const uVolL    = pOpts->From.Volume.uLeft;
+    uint32_t const uVolR    = pOpts->From.Volume.uRight;
+    __m128i  const uZero    = _mm_setzero_si128();
+    uint32_t       i        = 0;
+
+    if (   !((uVolL | uVolR) & ((AUDIOMIXBUF_VOL_0DB >> 16) - 1))
+        && (uVolL <= AUDIOMIXBUF_VOL_0DB - (AUDIOMIXBUF_VOL_0DB >> 15) || uVolL == AUDIOMIXBUF_VOL_0DB)
+        && (uVolR <= AUDIOMIXBUF_VOL_0DB - (AUDIOMIXBUF_VOL_0DB >> 15) || uVolR == AUDIOMIXBUF_VOL_0DB))
+    {
+        /*
+         * Fast path for the volumes audioMixBufConvVol produces, which are the
+         * 17-bit table values shifted left by 14.  This makes the result simply
+         * sample * factor, which always fits into 32 bits.  The factor is split
+         * into two halves of at most 0x7fff for pmaddwd, so 0xffff can't be done
+         * here.  For 0dB (0x10000) we use (sample << 16) instead.
+         */
+        int16_t i16MulL1, i16MulL2, i16MulR1, i16MulR2;
+        int32_t fIs0dBL, fIs0dBR;
+        audioMixBufSse2S16VolFactors(uVolL, &i16MulL1, &i16MulL2, &fIs0dBL);
+        audioMixBufSse2S16VolFactors(uVolR, &i16MulR1, &i16MulR2, &fIs0dBR);
+        __m128i const uMul    = _mm_set_epi16(i16MulR2, i16MulR1, i16MulL2, i16MulL1, i16MulR2, i16MulR1, i16MulL2, i16MulL1);
+        __m128i const fMask0dB = _mm_set_epi32(fIs0dBR, fIs0dBL, fIs0dBR, fIs0dBL);
+
+        for (; i + 4 <= cSamples; i += 4, pSrc += 8, paDst += 4)
+        {
+            __m128i const uSrc = _mm_loadu_si128((__m128i const *)pSrc);
+
+            /* Samples 0 and 1. */
+            __m128i u32 = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(uSrc, uSrc), uMul),
+                                        _mm_and_si128(_mm_unpacklo_epi16(uZero, uSrc), fMask0dB));
+            __m128i uSign = _mm_srai_epi32(u32, 31);
+            _mm_storeu_si128((__m128i *)&paDst[0], _mm_unpacklo_epi32(u32, uSign));
+            _mm_storeu_si128((__m128i *)&paDst[1], _mm_unpackhi_epi32(u32, uSign));
+
+            /* Samples 2 and 3. */
+            u32   = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(uSrc, uSrc), uMul),
+                                  _mm_and_si128(_mm_unpackhi_epi16(uZero, uSrc), fMask0dB));
+            uSign = _mm_srai_epi32(u32, 31);
+            _mm_storeu_si128((__m128i *)&paDst[2], _mm_unpacklo_epi32(u32, uSign));
+            _mm_storeu_si128((__m128i *)&paDst[3], _mm_unpackhi_epi32(u32, uSign));
+        }
+    }
+    else
+    {
+        __m128i const uVol   = _mm_set_epi32(0, (int32_t)uVolR, 0, (int32_t)uVolL);
+        __m128i const uVolHi = _mm_slli_epi64(uVol, 32);
+        for (; i + 2 <= cSamples; i += 2, pSrc += 4, paDst += 2)
+        {
+            /* Interleave with zero words, giving the 32-bit (sample << 16) values audioMixBufClipFromS16 returns. */
+            __m128i const u32 = _mm_unpacklo_epi16(uZero, _mm_loadl_epi64((__m128i const *)pSrc));
+            _mm_storeu_si128((__m128i *)&paDst[0],
+                             audioMixBufSse2ApplyVol(_mm_shuffle_epi32(u32, _MM_SHUFFLE(1, 1, 0, 0)), uVol, uVolHi));
+            _mm_storeu_si128((__m128i *)&paDst[1],
+                             audioMixBufSse2ApplyVol(_mm_shuffle_epi32(u32, _MM_SHUFFLE(3, 3, 2, 2)), uVol, uVolHi));
+        }
+    }
+
+    for (; i < cSamples; i++, pSrc += 2, paDst++)
+    {
+        paDst->i64LSample = ASMMult2xS32RetS64((int32_t)audioMixBufClipFromS16(pSrc[0]), uVolL) >> AUDIOMIXBUF_VOL_SHIFT;
+        paDst->i64RSample = ASMMult2xS32RetS64((int32_t)audioMixBufClipFromS16(pSrc[1]), uVolR) >> AUDIOMIXBUF_VOL_SHIFT;
+    }
+
+    return cSamples;
+}
+
+/** SSE2 version of audioMixBufConvFromS32Stereo. */
+static DECLCALLBACK(uint32_t) audioMixBufConvFromS32StereoSse2(PPDMAUDIOSAMPLE paDst, const void *pvSrc, uint32_t cbSrc,
+                                                                PCPDMAUDMIXBUFCONVOPTS pOpts)
+{
+    int32_t const *pSrc = (int32_t const *)pvSrc;
+    uint32_t const cSamples = RT_MIN(pOpts->cSamples, cbSrc / sizeof(int32_t));
+
+    __m128i const uVol   = _mm_set_epi32(0, (int32_t)pOpts->From.Volume.uRight, 0, (int32_t)pOpts->From.Volume.uLeft);
+    __m128i const uVolHi = _mm_slli_epi64(uVol, 32);
+
+    uint32_t i = 0;
+    for (; i + 2 <= cSamples; i += 2, pSrc += 4, paDst += 2)
+    {
+        __m128i const u32 = _mm_loadu_si128((__m128i const *)pSrc);
+        _mm_storeu_si128((__m128i *)&paDst[0],
+                         audioMixBufSse2ApplyVol(_mm_shuffle_epi32(u32, _MM_SHUFFLE(1, 1, 0, 0)), uVol, uVolHi));
+        _mm_storeu_si128((__m128i *)&paDst[1],
+                         audioMixBufSse2ApplyVol(_mm_shuffle_epi32(u32, _MM_SHUFFLE(3, 3, 2, 2)), uVol, uVolHi));
+    }
+    if (i < cSamples)
+    {
+        paDst->i64LSample = ASMMult2xS32RetS64((int32_t)audioMixBufClipFromS32(pSrc[0]), pOpts->From.Volume.uLeft ) >> AUDIOMIXBUF_VOL_SHIFT;
+        paDst->i64RSample = ASMMult2xS32RetS64((int32_t)audioMixBufClipFromS32(pSrc[1]), pOpts->From.Volume.uRight) >> AUDIOMIXBUF_VOL_SHIFT;
+    }
+
+    return cSamples;
+}
+
+/**
+ * Clips two stereo samples to 32-bit values.
+ *
+ * @returns The four clipped values in the order L0, R0, L1, R1, shifted right
+ *          by @a cShift; i.e. what audioMixBufClipToS16 (cShift=16, iMax=INT16_MAX)
+ *          or audioMixBufClipToS32 (cShift=0, iMax=INT32_MAX) return.
+ * @param   paSrc       The two stereo samples.
+ * @param   cShift      The right shift.
+ * @param   iMax        The maximum value.
+ */
+DECLINLINE(__m128i) audioMixBufSse2ClipTo(PCPDMAUDIOSAMPLE paSrc, unsigned cShift, int32_t iMax)
+{
+    __m128  const rA  = _mm_castsi128_ps(_mm_loadu_si128((__m128i const *)&paSrc[0]));
+    __m128  const rB  = _mm_castsi128_ps(_mm_loadu_si128((__m128i const *)&paSrc[1]));
+    __m128i const uLo = _mm_castps_si128(_mm_shuffle_ps(rA, rB, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i const uHi = _mm_castps_si128(_mm_shuffle_ps(rA, rB, _MM_SHUFFLE(3, 1, 3, 1)));
+
+    /* The value fits into 32 bits if the high dword is the sign extension of
+       the low one, otherwise the sign of the high dword selects min or max. */
+    __m128i const fInRange = _mm_cmpeq_epi32(uHi, _mm_srai_epi32(uLo, 31));
+    __m128i const uSat     = _mm_xor_si128(_mm_srai_epi32(uHi, 31), _mm_set1_epi32(iMax));
+    return _mm_or_si128(_mm_and_si128(fInRange, _mm_srai_epi32(uLo, cShift)),
+                        _mm_andnot_si128(fInRange, uSat));
+}
+
+/** SSE2 version of audioMixBufConvToS16Stereo. */
+static DECLCALLBACK(void) audioMixBufConvToS16StereoSse2(void *pvDst, PCPDMAUDIOSAMPLE paSrc, PCPDMAUDMIXBUFCONVOPTS pOpts)
+{
+    PCPDMAUDIOSAMPLE pSrc = paSrc;
+    int16_t *pDst = (int16_t *)pvDst;
+    uint32_t cSamples = pOpts->cSamples;
+    for (; cSamples >= 2; cSamples -= 2, pSrc += 2, pDst += 4)
+    {
+        __m128i const u32 = audioMixBufSse2ClipTo(pSrc, 16, INT16_MAX);
+        _mm_storel_epi64((__m128i *)pDst, _mm_packs_epi32(u32, u32));
+    }
+    if (cSamples)
+    {
+        pDst[0] = audioMixBufClipToS16(pSrc->i64LSample);
+        pDst[1] = audioMixBufClipToS16(pSrc->i64RSample);
+    }
+}
+
+/** SSE2 version of audioMixBufConvToS32Stereo. */
+static DECLCALLBACK(void) audioMixBufConvToS32StereoSse2(void *pvDst, PCPDMAUDIOSAMPLE paSrc, PCPDMAUDMIXBUFCONVOPTS pOpts)
+{
+    PCPDMAUDIOSAMPLE pSrc = paSrc;
+    int32_t *pDst = (int32_t *)pvDst;
+    uint32_t cSamples = pOpts->cSamples;
+    for (; cSamples >= 2; cSamples -= 2, pSrc += 2, pDst += 4)
+        _mm_storeu_si128((__m128i *)pDst, audioMixBufSse2ClipTo(pSrc, 0, INT32_MAX));
+    if (cSamples)
+    {
+        pDst[0] = audioMixBufClipToS32(pSrc->i64LSample);
+        pDst[1] = audioMixBufClipToS32(pSrc->i64RSample);
+    }
+}
+
+#endif /* AUDIOMIXBUF_WITH_SSE2 */
+
 #define AUDMIXBUF_MIXOP(_aName, _aOp) \
     static void audioMixBufOp##_aName(PPDMAUDIOSAMPLE paDst, uint32_t cDstSamples, \
                                       PPDMAUDIOSAMPLE paSrc, uint32_t cSrcSamples, \
@@ -679,8 +906,18 @@ static PFNPDMAUDIOMIXBUFCONVFROM audioMixBufConvFromLookup(PDMAUDIOMIXBUFFMT enm
             switch (AUDMIXBUF_FMT_BITS_PER_SAMPLE(enmFmt))
             {
                 case 8:  return audioMixBufConvFromS8Stereo;
-                case 16: return audioMixBufConvFromS16Stereo;
-                case 32: return audioMixBufConvFromS32Stereo;
+                case 16:
+#ifdef AUDIOMIXBUF_WITH_SSE2
+                    if (s_fAudioMixBufSse2)
+                        return audioMixBufConvFromS16StereoSse2;
+#endif
+                    return audioMixBufConvFromS16Stereo;
+                case 32:
+#ifdef AUDIOMIXBUF_WITH_SSE2
+                    if (s_fAudioMixBufSse2)
+                        return audioMixBufConvFromS32StereoSse2;
+#endif
+                    return audioMixBufConvFromS32Stereo;
                 default: return NULL;
             }
         }
@@ -739,8 +976,18 @@ static PFNPDMAUDIOMIXBUFCONVTO audioMixBufConvToLookup(PDMAUDIOMIXBUFFMT enmFmt)
             switch (AUDMIXBUF_FMT_BITS_PER_SAMPLE(enmFmt))
             {
                 case 8:  return audioMixBufConvToS8Stereo;
-                case 16: return audioMixBufConvToS16Stereo;
-                case 32: return audioMixBufConvToS32Stereo;
+                case 16:
+#ifdef AUDIOMIXBUF_WITH_SSE2
+                    if (s_fAudioMixBufSse2)
+                        return audioMixBufConvToS16StereoSse2;
+#endif
+                    return audioMixBufConvToS16Stereo;
+                case 32:
+#ifdef AUDIOMIXBUF_WITH_SSE2
+                    if (s_fAudioMixBufSse2)
+                        return audioMixBufConvToS32StereoSse2;
+#endif
+                    return audioMixBufConvToS32Stereo;
                 default: return NULL;
             }
         }
@@ -1604,6 +1851,28 @@ void AudioMixBufSetVolume(PPDMAUDIOMIXBUF pMixBuf, PPDMAUDIOVOLUME pVol)
     AssertRC(rc2);
 }
 
+#ifdef TESTCASE
+/**
+ * Enables or disables the SIMD conversion routines.
+ *
+ * Only for testcases comparing them against the generic code.  Takes effect for
+ * mixing buffers initialized afterwards.
+ *
+ * @returns @c true if SIMD routines are available on this host, @c false if not.
+ * @param   fEnable                 Whether to use them.
+ */
+bool AudioMixBufSetSimd(bool fEnable)
+{
+# ifdef AUDIOMIXBUF_WITH_SSE2
+    s_fAudioMixBufSse2 = fEnable;
+    return true;
+# else
+    RT_NOREF(fEnable);
+    return false;
+# endif
+}
+#endif
+
 /**
  * Returns the maximum amount of audio samples this buffer can hold.
  *
@@ -571,6 +571,102 @@ static int tstVolume(RTTEST hTest)
     return RTTestSubErrorCount(hTest) ? VERR_GENERAL_FAILURE : VINF_SUCCESS;
 }
 
+/* Test that the SIMD conversion routines produce the same results as the generic ones. */
+static int tstSimd(RTTEST hTest)
+{
+    RTTestSubF(hTest, "SIMD conversion");
+
+    if (!AudioMixBufSetSimd(true))
+    {
+        RTTestSkipped(hTest, "No SIMD conversion routines on this host");
+        return VINF_SUCCESS;
+    }
+
+    /* Mixing buffer volumes (0x40000000 is 0dB), including ones audioMixBufConvVol never produces. */
+    static const uint32_t s_aVolumes[][2] =
+    {
+        { 0x40000000, 0x40000000 }, /* 0dB */
+        { 0x3fffc000, 0x3fffc000 }, /* Just below 0dB, the largest 16-bit factor. */
+        { 0x3fff8000, 0x40000000 },
+        { 0x10000000, 0x2d414000 },
+        { 0x40000000, 0x00004000 },
+        { 0x00000000, 0x3d494000 },
+        { 0x12345678, 0x3fffffff }  /* Not a multiple of the 16-bit factor. */
+    };
+    static const uint8_t s_acBits[]      = { 16, 32 };
+
+    const uint32_t cSamples = 509; /* Odd, to exercise the tail handling. */
+    uint8_t *pbSrc  = (uint8_t *)RTMemAlloc(cSamples * 2 * sizeof(int32_t));
+    uint8_t *pbOut1 = (uint8_t *)RTMemAlloc(cSamples * 2 * sizeof(int32_t));
+    uint8_t *pbOut2 = (uint8_t *)RTMemAlloc(cSamples * 2 * sizeof(int32_t));
+    RTTESTI_CHECK_RET(pbSrc && pbOut1 && pbOut2, VERR_NO_MEMORY);
+
+    for (unsigned iBits = 0; iBits < RT_ELEMENTS(s_acBits); iBits++)
+    {
+        PDMAUDIOPCMPROPS cfg =
+        {
+            s_acBits[iBits],                                                              /* Bits */
+            true,                                                                         /* Signed */
+            PDMAUDIOPCMPROPS_MAKE_SHIFT_PARMS(s_acBits[iBits] /* Bits */, 2 /* Channels */), /* Shift */
+            2,                                                                            /* Channels */
+            44100,                                                                        /* Hz */
+            false                                                                         /* Swap Endian */
+        };
+        RTTESTI_CHECK(DrvAudioHlpPCMPropsAreValid(&cfg));
+
+        for (unsigned iVol = 0; iVol < RT_ELEMENTS(s_aVolumes); iVol++)
+        {
+            PDMAUDMIXBUFVOL const vol = { false, s_aVolumes[iVol][0], s_aVolumes[iVol][1] };
+
+            PDMAUDIOMIXBUF mbGeneric;
+            AudioMixBufSetSimd(false);
+            RTTESTI_CHECK_RC_OK_BREAK(AudioMixBufInit(&mbGeneric, "Generic", &cfg, cSamples));
+            mbGeneric.Volume = vol;
+
+            PDMAUDIOMIXBUF mbSimd;
+            AudioMixBufSetSimd(true);
+            RTTESTI_CHECK_RC_OK_BREAK(AudioMixBufInit(&mbSimd, "SIMD", &cfg, cSamples));
+            mbSimd.Volume = vol;
+
+            /* Random samples, with the extremes sprinkled in. */
+            uint32_t const cbBuf = AUDIOMIXBUF_S2B(&mbGeneric, cSamples);
+            RTRandBytes(pbSrc, cbBuf);
+            for (uint32_t i = 0; i < cSamples * 2; i += 7)
+            {
+                if (s_acBits[iBits] == 16)
+                    ((int16_t *)pbSrc)[i] = i & 8 ? INT16_MAX : INT16_MIN;
+                else
+                    ((int32_t *)pbSrc)[i] = i & 8 ? INT32_MAX : INT32_MIN;
+            }
+
+            uint32_t cWritten1 = 0, cWritten2 = 0;
+            RTTESTI_CHECK_RC_OK(AudioMixBufWriteAt(&mbGeneric, 0, pbSrc, cbBuf, &cWritten1));
+            RTTESTI_CHECK_RC_OK(AudioMixBufWriteAt(&mbSimd,    0, pbSrc, cbBuf, &cWritten2));
+            RTTESTI_CHECK(cWritten1 == cSamples && cWritten2 == cSamples);
+            RTTESTI_CHECK_MSG(!memcmp(mbGeneric.pSamples, mbSimd.pSamples, cSamples * sizeof(PDMAUDIOSAMPLE)),
+                              ("%u bits, volume %#x/%#x: internal samples differ\n", s_acBits[iBits], vol.uLeft, vol.uRight));
+
+            uint32_t cRead1 = 0, cRead2 = 0;
+            RT_BZERO(pbOut1, cbBuf);
+            RT_BZERO(pbOut2, cbBuf);
+            RTTESTI_CHECK_RC_OK(AudioMixBufReadAt(&mbGeneric, 0, pbOut1, cbBuf, &cRead1));
+            RTTESTI_CHECK_RC_OK(AudioMixBufReadAt(&mbSimd,    0, pbOut2, cbBuf, &cRead2));
+            RTTESTI_CHECK(cRead1 == cRead2);
+            RTTESTI_CHECK_MSG(!memcmp(pbOut1, pbOut2, cbBuf),
+                              ("%u bits, volume %#x/%#x: output samples differ\n", s_acBits[iBits], vol.uLeft, vol.uRight));
+
+            AudioMixBufDestroy(&mbGeneric);
+            AudioMixBufDestroy(&mbSimd);
+        }
+    }
+
+    RTMemFree(pbSrc);
+    RTMemFree(pbOut1);
+    RTMemFree(pbOut2);
+
+    return RTTestSubErrorCount(hTest) ? VERR_GENERAL_FAILURE : VINF_SUCCESS;
+}
+
 int main(int argc, char **argv)
 {
     RTR3InitExe(argc, &argv, 0);
@@ -593,6 +689,8 @@ int main(int argc, char **argv)
         rc = tstConversion16(hTest);
     if (RT_SUCCESS(rc))
         rc = tstVolume(hTest);
+    if (RT_SUCCESS(rc))
+        rc = tstSimd(hTest);
 
     /*
      * Summary
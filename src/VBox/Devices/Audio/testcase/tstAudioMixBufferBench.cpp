@@ -0,0 +1,132 @@
+/* $Id$ */
+/** @file
+ * Audio testcase - Mixing buffer conversion benchmark.
+ */
+
+/*
+ * Copyright (C) 2014-2017 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/err.h>
+#include <iprt/initterm.h>
+#include <iprt/mem.h>
+#include <iprt/rand.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/time.h>
+
+
+#include "../AudioMixBuffer.h"
+#include "../DrvAudio.h"
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Number of audio frames per conversion call (~20ms at 48kHz). */
+#define TST_FRAMES      960
+/** Number of conversion calls per measurement. */
+#define TST_ITERATIONS  20000
+
+
+/**
+ * Times converting to and from the internal sample format for one PCM format.
+ */
+static void tstBenchOne(RTTEST hTest, uint8_t cBits, uint8_t uVol, bool fSimd, uint8_t *pbBuf)
+{
+    PDMAUDIOPCMPROPS cfg =
+    {
+        cBits,                                                              /* Bits */
+        true,                                                               /* Signed */
+        PDMAUDIOPCMPROPS_MAKE_SHIFT_PARMS(cBits /* Bits */, 2 /* Channels */), /* Shift */
+        2,                                                                  /* Channels */
+        48000,                                                              /* Hz */
+        false                                                               /* Swap Endian */
+    };
+
+    AudioMixBufSetSimd(fSimd);
+
+    PDMAUDIOMIXBUF mb;
+    int rc = AudioMixBufInit(&mb, "Bench", &cfg, TST_FRAMES);
+    RTTESTI_CHECK_RC_OK_RETV(rc);
+
+    PDMAUDIOVOLUME vol = { false, uVol, uVol };
+    AudioMixBufSetVolume(&mb, &vol);
+
+    uint32_t const cbBuf = AUDIOMIXBUF_S2B(&mb, TST_FRAMES);
+    RTRandBytes(pbBuf, cbBuf);
+
+    uint32_t cFrames = 0;
+    uint64_t nsStart = RTTimeNanoTS();
+    for (unsigned i = 0; i < TST_ITERATIONS; i++)
+        AudioMixBufWriteAt(&mb, 0, pbBuf, cbBuf, &cFrames);
+    uint64_t const cNsFrom = RTTimeNanoTS() - nsStart;
+
+    nsStart = RTTimeNanoTS();
+    for (unsigned i = 0; i < TST_ITERATIONS; i++)
+        AudioMixBufReadAt(&mb, 0, pbBuf, cbBuf, &cFrames);
+    uint64_t const cNsTo = RTTimeNanoTS() - nsStart;
+
+    AudioMixBufDestroy(&mb);
+
+    uint64_t const cTotalFrames = (uint64_t)TST_FRAMES * TST_ITERATIONS;
+    RTTestValueF(hTest, cTotalFrames * RT_NS_1SEC / RT_MAX(cNsFrom, 1), RTTESTUNIT_FRAMES_PER_SEC, "S%u %s, volume %3u: from",
+                 cBits, fSimd ? "SIMD   " : "generic", uVol);
+    RTTestValueF(hTest, cTotalFrames * RT_NS_1SEC / RT_MAX(cNsTo, 1),   RTTESTUNIT_FRAMES_PER_SEC, "S%u %s, volume %3u: to",
+                 cBits, fSimd ? "SIMD   " : "generic", uVol);
+}
+
+
+int main(int argc, char **argv)
+{
+    RTR3InitExe(argc, &argv, 0);
+
+    /*
+     * Initialize IPRT and create the test.
+     */
+    RTTEST hTest;
+    int rc = RTTestInitAndCreate("tstAudioMixBufferBench", &hTest);
+    if (rc)
+        return rc;
+    RTTestBanner(hTest);
+
+    uint8_t *pbBuf = (uint8_t *)RTMemAlloc(TST_FRAMES * 2 * sizeof(int32_t));
+    if (pbBuf)
+    {
+        bool const fHaveSimd = AudioMixBufSetSimd(true);
+        if (!fHaveSimd)
+            RTTestPrintf(hTest, RTTESTLVL_ALWAYS, "No SIMD conversion routines on this host, timing the generic ones only.\n");
+
+        static const uint8_t s_acBits[] = { 16, 32 };
+        static const uint8_t s_auVol[]  = { 255, 200 };
+        for (unsigned iBits = 0; iBits < RT_ELEMENTS(s_acBits); iBits++)
+            for (unsigned iVol = 0; iVol < RT_ELEMENTS(s_auVol); iVol++)
+            {
+                RTTestSubF(hTest, "S%u stereo, volume %u", s_acBits[iBits], s_auVol[iVol]);
+                tstBenchOne(hTest, s_acBits[iBits], s_auVol[iVol], false /*fSimd*/, pbBuf);
+                if (fHaveSimd)
+                    tstBenchOne(hTest, s_acBits[iBits], s_auVol[iVol], true /*fSimd*/, pbBuf);
+            }
+
+        RTMemFree(pbBuf);
+    }
+    else
+        RTTestFailed(hTest, "Out of memory");
+
+    /*
+     * Summary
+     */
+    return RTTestSummaryAndDestroy(hTest);
+}
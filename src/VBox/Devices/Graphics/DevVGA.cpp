@@ -348,6 +348,75 @@ DECLINLINE(void) vga_reset_dirty(PVGASTATE pThis, RTGCPHYS offVRAMStart, RTGCPHY
     Assert(offVRAMStart < offVRAMEnd);
     ASMBitClearRange(&pThis->au32DirtyBitmap[0], offVRAMStart >> PAGE_SHIFT, offVRAMEnd >> PAGE_SHIFT);
 }
+
+/**
+ * Finds the first dirty VRAM page in a range.
+ *
+ * Scans the dirty bitmap a 32-bit word at a time, so clean ranges are skipped
+ * quickly no matter how many pages they span.
+ *
+ * @returns VRAM offset of the first dirty page overlapping the range, UINT32_MAX if all clean.
+ * @param   pThis           VGA instance data.
+ * @param   offVRAMStart    Offset into the VRAM buffer where the range starts.
+ * @param   offVRAMEnd      Offset into the VRAM buffer where the range ends - exclusive.
+ */
+static uint32_t vga_find_dirty(PVGASTATE pThis, uint32_t offVRAMStart, uint32_t offVRAMEnd)
+{
+    offVRAMEnd = RT_MIN(offVRAMEnd, pThis->vram_size);
+    if (offVRAMStart >= offVRAMEnd)
+        return UINT32_MAX;
+
+    uint32_t const iPageEnd = (offVRAMEnd + PAGE_OFFSET_MASK) >> PAGE_SHIFT;
+    uint32_t       iPage    = offVRAMStart >> PAGE_SHIFT;
+    uint32_t       iWord    = iPage / 32;
+    uint32_t       u32      = pThis->au32DirtyBitmap[iWord] & (UINT32_MAX << (iPage & 31));
+    for (;;)
+    {
+        if (u32)
+        {
+            iPage = iWord * 32 + ASMBitFirstSetU32(u32) - 1;
+            return iPage < iPageEnd ? iPage << PAGE_SHIFT : UINT32_MAX;
+        }
+        if (++iWord * 32 >= iPageEnd)
+            return UINT32_MAX;
+        u32 = pThis->au32DirtyBitmap[iWord];
+    }
+}
+
+/**
+ * Tests if any VRAM page in a range is dirty.
+ *
+ * @returns true if dirty.
+ * @returns false if clean.
+ * @param   pThis           VGA instance data.
+ * @param   offVRAMStart    Offset into the VRAM buffer where the range starts.
+ * @param   offVRAMEnd      Offset into the VRAM buffer where the range ends - exclusive.
+ */
+DECLINLINE(bool) vga_is_dirty_range(PVGASTATE pThis, uint32_t offVRAMStart, uint32_t offVRAMEnd)
+{
+    return vga_find_dirty(pThis, offVRAMStart, offVRAMEnd) != UINT32_MAX;
+}
+
+/**
+ * Finds the next scanline which was explicitly invalidated (hardware cursor).
+ *
+ * @returns The invalidated scanline, cy if there is none.
+ * @param   pThis           VGA instance data.
+ * @param   y               The scanline to start looking at.
+ * @param   cy              The number of scanlines.
+ */
+static uint32_t vga_find_invalidated_line(PVGASTATE pThis, uint32_t y, uint32_t cy)
+{
+    cy = RT_MIN(cy, VGA_MAX_HEIGHT);
+    while (y < cy)
+    {
+        uint32_t const u32 = pThis->invalidated_y_table[y >> 5] >> (y & 31);
+        if (u32)
+            return RT_MIN(y + ASMBitFirstSetU32(u32) - 1, cy);
+        y = (y | 31) + 1;
+    }
+    return cy;
+}
 #endif /* IN_RING3 */
 
 #ifdef _MSC_VER
@@ -2307,13 +2376,25 @@ static int vmsvga_draw_graphic(PVGASTATE pThis, bool fFullUpdate, bool fFailOnRe
     uint32_t    y;
     for (y = 0; y < cy; y++)
     {
+        /* The framebuffer is linear, so outside an update run jump straight to
+           the first scanline which is either dirty or explicitly invalidated. */
+        if (!fFullUpdate && yUpdateRectTop == UINT32_MAX)
+        {
+            uint32_t const offDirty = vga_find_dirty(pThis, offSrcStart + y * cbScanline, offSrcStart + cy * cbScanline);
+            uint32_t yNext = cy;
+            if (offDirty != UINT32_MAX)
+                yNext = offDirty <= offSrcStart + y * cbScanline ? y : (offDirty - offSrcStart) / cbScanline;
+            yNext = RT_MIN(yNext, vga_find_invalidated_line(pThis, y, yNext));
+            if (yNext >= cy)
+                break;
+            pbDst += (yNext - y) * cbDstScanline;
+            y = yNext;
+        }
+
         uint32_t offSrcLine = offSrcStart + y * cbScanline;
         uint32_t offPage0   = offSrcLine & ~PAGE_OFFSET_MASK;
         uint32_t offPage1   = (offSrcLine + cbScanline - 1) & ~PAGE_OFFSET_MASK;
-        bool     fUpdate    = fFullUpdate | vga_is_dirty(pThis, offPage0) | vga_is_dirty(pThis, offPage1);
-        if (offPage1 - offPage0 > PAGE_SIZE)
-            /* if wide line, can use another page */
-            fUpdate |= vga_is_dirty(pThis, offPage0 + PAGE_SIZE);
+        bool     fUpdate    = fFullUpdate || vga_is_dirty_range(pThis, offSrcLine, offSrcLine + cbScanline);
         /* explicit invalidation for the hardware cursor */
         fUpdate |= (pThis->invalidated_y_table[y >> 5] >> (y & 0x1f)) & 1;
         if (fUpdate)
@@ -2472,12 +2553,24 @@ static int vga_draw_graphic(PVGASTATE pThis, bool full_update, bool fFailOnResiz
         pThis->cursor_invalidate(pThis);
 
     line_offset = pThis->line_offset;
+    addr1 = (pThis->start_addr * 4);
+    bwidth = (width * bits + 7) / 8;    /* The visible width of a scanline. */
+
+    /* Nothing to do if the area scanned below is clean and no scanline has been
+       invalidated. The common case of a linear framebuffer (no CGA/MDA addressing
+       and no line compare split) covers at most the VRAM range checked here. */
+    if (   !full_update
+        && (pThis->cr[0x17] & 3) == 3
+        && pThis->line_compare >= (uint32_t)height
+        && line_offset >= 0
+        && vga_find_invalidated_line(pThis, 0, height) >= (uint32_t)height
+        && !vga_is_dirty_range(pThis, addr1, addr1 + (uint32_t)(height - 1) * line_offset + bwidth))
+        return VINF_SUCCESS;
+
 #if 0
     Log(("w=%d h=%d v=%d line_offset=%d cr[0x09]=0x%02x cr[0x17]=0x%02x linecmp=%d sr[0x01]=0x%02x\n",
            width, height, v, line_offset, pThis->cr[9], pThis->cr[0x17], pThis->line_compare, pThis->sr[0x01]));
 #endif
-    addr1 = (pThis->start_addr * 4);
-    bwidth = (width * bits + 7) / 8;    /* The visible width of a scanline. */
     y_start = -1;
     page_min = 0x7fffffff;
     page_max = -1;
@@ -2499,11 +2592,7 @@ static int vga_draw_graphic(PVGASTATE pThis, bool full_update, bool fFailOnResiz
         }
         page0 = addr & ~PAGE_OFFSET_MASK;
         page1 = (addr + bwidth - 1) & ~PAGE_OFFSET_MASK;
-        bool update = full_update | vga_is_dirty(pThis, page0) | vga_is_dirty(pThis, page1);
-        if (page1 - page0 > PAGE_SIZE) {
-            /* if wide line, can use another page */
-            update |= vga_is_dirty(pThis, page0 + PAGE_SIZE);
-        }
+        bool update = full_update || vga_is_dirty_range(pThis, addr, addr + bwidth);
         /* explicit invalidation for the hardware cursor */
         update |= (pThis->invalidated_y_table[y >> 5] >> (y & 0x1f)) & 1;
         if (update) {
@@ -29,6 +29,7 @@
 #include <iprt/asm.h>
 #include <iprt/net.h>
 #include <iprt/semaphore.h>
+#include <iprt/thread.h>
 #ifdef IN_RING3
 # include <iprt/mem.h>
 # include <iprt/uuid.h>
@@ -68,6 +69,10 @@
 #define VNET_MAX_FRAME_SIZE     65535 + 18  /**< Max IP packet size + Ethernet header with VLAN tag */
 #define VNET_MAC_FILTER_LEN     32
 #define VNET_MAX_VID            (1 << 12)
+/** The maximum number of RX/TX queue pairs (VNET_F_MQ). */
+#define VNET_MAX_QUEUE_PAIRS    ((VIRTIO_MAX_NQUEUES - 1) / 2)
+/** How long a TX worker waits before retrying a busy transmit session. */
+#define VNET_TX_RETRY_MS        1
 
 /** @name Virtio net features
  * @{  */
@@ -88,6 +93,7 @@
 #define VNET_F_CTRL_VQ    0x00020000  /**< Control channel available */
 #define VNET_F_CTRL_RX    0x00040000  /**< Control channel RX mode support */
 #define VNET_F_CTRL_VLAN  0x00080000  /**< Control channel VLAN filtering */
+#define VNET_F_MQ         0x00400000  /**< Multiple RX/TX queue pairs */
 /** @} */
 
 #define VNET_S_LINK_UP    1
@@ -104,8 +110,50 @@ struct __attribute__ ((__packed__)) VNetPCIConfig /** @todo r=bird: Use #pragma
 {
     RTMAC    mac;
     uint16_t uStatus;
+    uint16_t uMaxVirtqueuePairs;
 };
 AssertCompileMemberOffset(struct VNetPCIConfig, uStatus, 6);
+AssertCompileMemberOffset(struct VNetPCIConfig, uMaxVirtqueuePairs, 8);
+
+/**
+ * RX/TX queue pair.
+ *
+ * With VNET_F_MQ each pair gets its own TX worker thread, so transmission
+ * from different guest CPUs proceeds in parallel up to the attached driver.
+ */
+typedef struct VNETQUEUEPAIR
+{
+    /** @name Per-queue statistics
+     * @{ */
+    STAMCOUNTER                 StatReceivePackets;
+    STAMCOUNTER                 StatReceiveBytes;
+    STAMCOUNTER                 StatTransmitPackets;
+    STAMCOUNTER                 StatTransmitBytes;
+    STAMCOUNTER                 StatTransmitKicks;
+    STAMCOUNTER                 StatTransmitRetries;
+    /** @} */
+    R3PTRTYPE(PVQUEUE)          pRxQueue;
+    R3PTRTYPE(PVQUEUE)          pTxQueue;
+    /** The TX worker thread (multiqueue only). */
+    R3PTRTYPE(PPDMTHREAD)       pTxThread;
+    /** Signalled when the guest kicks the TX queue (multiqueue only). */
+    R3PTRTYPE(RTSEMEVENT)       hEventTx;
+    /** Back pointer to the device state. */
+    R3PTRTYPE(struct VNetState_st *) pThis;
+    /** Indicates transmission in progress -- only one thread is allowed. */
+    uint32_t volatile           uIsTransmitting;
+    /** Set when the TX queue needs to be looked at by the worker. */
+    bool volatile               fTxKicked;
+    bool                        afAlignment[1];
+    /** The index of this pair. */
+    uint16_t                    iPair;
+#if HC_ARCH_BITS == 32
+    uint32_t                    u32Alignment;
+#endif
+} VNETQUEUEPAIR;
+/** Pointer to a RX/TX queue pair. */
+typedef VNETQUEUEPAIR *PVNETQUEUEPAIR;
+AssertCompileSizeAlignment(VNETQUEUEPAIR, 8);
 
 /**
  * Device state structure. Holds the current state of device.
@@ -155,8 +203,10 @@ typedef struct VNetState_st
     uint64_t                u64NanoTS;
 #endif /* VNET_TX_DELAY */
 
-    /** Indicates transmission in progress -- only one thread is allowed. */
-    uint32_t                uIsTransmitting;
+    /** The number of queue pairs configured, more than one enables VNET_F_MQ. */
+    uint16_t                cMaxQueuePairs;
+    /** The number of queue pairs the guest uses, set via the control queue. */
+    uint16_t volatile       cActiveQueuePairs;
 
     /** PCI config area holding MAC address as well as TBD. */
     struct VNetPCIConfig    config;
@@ -189,6 +239,13 @@ typedef struct VNetState_st
     R3PTRTYPE(PVQUEUE)      pRxQueue;
     R3PTRTYPE(PVQUEUE)      pTxQueue;
     R3PTRTYPE(PVQUEUE)      pCtlQueue;
+
+    /** Signalled when a transmit slot is released while fTxIdleWaiter is set. */
+    R3PTRTYPE(RTSEMEVENT)   hEventTxIdle;
+    /** Set while vnetIoCb_Reset waits for the TX queues to become idle. */
+    bool volatile           fTxIdleWaiter;
+    bool                    afPadding[7];
+
     /* Receive-blocking-related fields ***************************************/
 
     /** EMT: Gets signalled when more RX descriptors become available. */
@@ -211,6 +268,9 @@ typedef struct VNetState_st
     STAMCOUNTER             StatRxOverflowWakeup;
 #endif /* VBOX_WITH_STATISTICS */
     /** @}  */
+
+    /** The RX/TX queue pairs, pRxQueue and pTxQueue refer to the first one. */
+    VNETQUEUEPAIR           aQueuePairs[VNET_MAX_QUEUE_PAIRS];
 } VNETSTATE;
 /** Pointer to a virtual I/O network device state. */
 typedef VNETSTATE *PVNETSTATE;
@@ -248,6 +308,7 @@ typedef VNETHDRMRX *PVNETHDRMRX;
 AssertCompileSize(VNETHDRMRX, 12);
 
 AssertCompileMemberOffset(VNETSTATE, VPCI, 0);
+AssertCompileMemberAlignment(VNETSTATE, aQueuePairs, 8);
 
 #define VNET_OK                    0
 #define VNET_ERROR                 1
@@ -264,6 +325,9 @@ typedef uint8_t VNETCTLACK;
 #define VNET_CTRL_CMD_VLAN_ADD         0
 #define VNET_CTRL_CMD_VLAN_DEL         1
 
+#define VNET_CTRL_CLS_MQ               4
+#define VNET_CTRL_CMD_MQ_VQ_PAIRS_SET  0
+
 
 struct VNetCtlHdr
 {
@@ -368,7 +432,8 @@ DECLINLINE(void) vnetPrintFeatures(PVNETSTATE pThis, uint32_t fFeatures, const c
         { VNET_F_STATUS,     "virtio_net_config.status available" },
         { VNET_F_CTRL_VQ,    "control channel available" },
         { VNET_F_CTRL_RX,    "control channel RX mode support" },
-        { VNET_F_CTRL_VLAN,  "control channel VLAN filtering" }
+        { VNET_F_CTRL_VLAN,  "control channel VLAN filtering" },
+        { VNET_F_MQ,         "multiple RX/TX queue pairs" }
     };
 
     Log3(("%s %s:\n", INSTANCE(pThis), pcszText));
@@ -384,7 +449,7 @@ DECLINLINE(void) vnetPrintFeatures(PVNETSTATE pThis, uint32_t fFeatures, const c
 
 static DECLCALLBACK(uint32_t) vnetIoCb_GetHostFeatures(void *pvState)
 {
-    RT_NOREF_PV(pvState);
+    PVNETSTATE pThis = (PVNETSTATE)pvState;
 
     /* We support:
      * - Host-provided MAC address
@@ -393,8 +458,10 @@ static DECLCALLBACK(uint32_t) vnetIoCb_GetHostFeatures(void *pvState)
      * - RX mode setting
      * - MAC filter table
      * - VLAN filter
+     * - Multiple queue pairs, if configured
      */
-    return VNET_F_MAC
+    return (pThis->cMaxQueuePairs > 1 ? VNET_F_MQ : 0)
+        | VNET_F_MAC
         | VNET_F_STATUS
         | VNET_F_CTRL_VQ
         | VNET_F_CTRL_RX
@@ -466,13 +533,34 @@ static DECLCALLBACK(int) vnetIoCb_Reset(void *pvState)
     PVNETSTATE pThis = (PVNETSTATE)pvState;
     Log(("%s Reset triggered\n", INSTANCE(pThis)));
 
+#ifndef IN_RING3
+    /* The TX workers must be kept out while the queues are reset, do it in ring-3. */
+    if (pThis->cMaxQueuePairs > 1)
+        return VINF_IOM_R3_IOPORT_WRITE;
+#else
+    /*
+     * Claim all transmit slots so that no TX worker touches the queues.  This is
+     * done before taking the RX lock, the transmit path may need it to finish.
+     */
+    ASMAtomicWriteBool(&pThis->fTxIdleWaiter, true);
+    for (unsigned i = 0; i < pThis->cMaxQueuePairs; i++)
+        while (!ASMAtomicCmpXchgU32(&pThis->aQueuePairs[i].uIsTransmitting, 1, 0))
+            RTSemEventWait(pThis->hEventTxIdle, RT_INDEFINITE_WAIT);
+    ASMAtomicWriteBool(&pThis->fTxIdleWaiter, false);
+#endif
+
     int rc = vnetCsRxEnter(pThis, VERR_SEM_BUSY);
     if (RT_UNLIKELY(rc != VINF_SUCCESS))
     {
         LogRel(("vnetIoCb_Reset failed to enter RX critical section!\n"));
+#ifdef IN_RING3
+        for (unsigned i = 0; i < pThis->cMaxQueuePairs; i++)
+            ASMAtomicWriteU32(&pThis->aQueuePairs[i].uIsTransmitting, 0);
+#endif
         return rc;
     }
     vpciReset(&pThis->VPCI);
+    pThis->cActiveQueuePairs = 1;
     vnetCsRxLeave(pThis);
 
     /// @todo Implement reset
@@ -491,7 +579,8 @@ static DECLCALLBACK(int) vnetIoCb_Reset(void *pvState)
     pThis->nMacFilterEntries = 0;
     memset(pThis->aMacFilter,  0, VNET_MAC_FILTER_LEN * sizeof(RTMAC));
     memset(pThis->aVlanFilter, 0, sizeof(pThis->aVlanFilter));
-    pThis->uIsTransmitting   = 0;
+    for (unsigned i = 0; i < pThis->cMaxQueuePairs; i++)
+        ASMAtomicWriteU32(&pThis->aQueuePairs[i].uIsTransmitting, 0);
 #ifndef IN_RING3
     return VINF_IOM_R3_IOPORT_WRITE;
 #else
@@ -635,6 +724,9 @@ PDMBOTHCBDECL(int) vnetIOPortOut(PPDMDEVINS pDevIns, void *pvUser, RTIOPORT port
  * Check if the device can receive data now.
  * This must be called before the pfnRecieve() method is called.
  *
+ * With several active queue pairs it is enough for one of the RX queues to
+ * have buffers, vnetRxSelectPair() falls back to it if needed.
+ *
  * @remarks As a side effect this function enables queue notification
  *          if it cannot receive because the queue is empty.
  *          It disables notification if it can receive.
@@ -649,19 +741,23 @@ static int vnetCanReceive(PVNETSTATE pThis)
     AssertRCReturn(rc, rc);
 
     LogFlow(("%s vnetCanReceive\n", INSTANCE(pThis)));
-    if (!(pThis->VPCI.uStatus & VPCI_STATUS_DRV_OK))
-        rc = VERR_NET_NO_BUFFER_SPACE;
-    else if (!vqueueIsReady(&pThis->VPCI, pThis->pRxQueue))
-        rc = VERR_NET_NO_BUFFER_SPACE;
-    else if (vqueueIsEmpty(&pThis->VPCI, pThis->pRxQueue))
-    {
-        vringSetNotification(&pThis->VPCI, &pThis->pRxQueue->VRing, true);
-        rc = VERR_NET_NO_BUFFER_SPACE;
-    }
-    else
+    rc = VERR_NET_NO_BUFFER_SPACE;
+    if (pThis->VPCI.uStatus & VPCI_STATUS_DRV_OK)
     {
-        vringSetNotification(&pThis->VPCI, &pThis->pRxQueue->VRing, false);
-        rc = VINF_SUCCESS;
+        uint16_t const cPairs = ASMAtomicReadU16(&pThis->cActiveQueuePairs);
+        for (unsigned i = 0; i < cPairs; i++)
+        {
+            PVQUEUE pRxQueue = pThis->aQueuePairs[i].pRxQueue;
+            if (!vqueueIsReady(&pThis->VPCI, pRxQueue))
+                continue;
+            if (vqueueIsEmpty(&pThis->VPCI, pRxQueue))
+                vringSetNotification(&pThis->VPCI, &pRxQueue->VRing, true);
+            else
+            {
+                vringSetNotification(&pThis->VPCI, &pRxQueue->VRing, false);
+                rc = VINF_SUCCESS;
+            }
+        }
     }
 
     LogFlow(("%s vnetCanReceive -> %Rrc\n", INSTANCE(pThis), rc));
@@ -788,6 +884,93 @@ static bool vnetAddressFilter(PVNETSTATE pThis, const void *pvBuf, size_t cb)
     return false;
 }
 
+/**
+ * Computes a flow hash over the IP addresses and TCP/UDP ports of a frame.
+ *
+ * @returns The hash, 0 if the frame is neither IPv4 nor IPv6.
+ * @param   pbFrame         The ethernet frame.
+ * @param   cbFrame         The size of the frame.
+ */
+static uint32_t vnetRxFlowHash(const uint8_t *pbFrame, size_t cbFrame)
+{
+    size_t offL3 = sizeof(RTNETETHERHDR);
+    if (cbFrame < offL3)
+        return 0;
+    uint16_t uEtherType = RT_BE2H_U16(((PCRTNETETHERHDR)pbFrame)->EtherType);
+    if (uEtherType == RTNET_ETHERTYPE_VLAN && cbFrame >= offL3 + 4)
+    {
+        uEtherType = RT_MAKE_U16(pbFrame[offL3 + 3], pbFrame[offL3 + 2]);
+        offL3 += 4;
+    }
+
+    uint32_t uHash;
+    uint8_t  bProto;
+    size_t   offL4;
+    if (uEtherType == RTNET_ETHERTYPE_IPV4 && cbFrame >= offL3 + RTNETIPV4_MIN_LEN)
+    {
+        PCRTNETIPV4 pIpHdr = (PCRTNETIPV4)(pbFrame + offL3);
+        uHash  = pIpHdr->ip_src.u ^ pIpHdr->ip_dst.u;
+        bProto = pIpHdr->ip_p;
+        offL4  = offL3 + pIpHdr->ip_hl * 4;
+        /* Only the first fragment has the ports, keep all fragments together. */
+        if (RT_BE2H_U16(pIpHdr->ip_off) & (RTNETIPV4_FLAGS_MF | 0x1fff))
+            bProto = 0;
+    }
+    else if (uEtherType == RTNET_ETHERTYPE_IPV6 && cbFrame >= offL3 + sizeof(RTNETIPV6))
+    {
+        PCRTNETIPV6 pIpHdr = (PCRTNETIPV6)(pbFrame + offL3);
+        uHash = 0;
+        for (unsigned i = 0; i < RT_ELEMENTS(pIpHdr->ip6_src.au32); i++)
+            uHash ^= pIpHdr->ip6_src.au32[i] ^ pIpHdr->ip6_dst.au32[i];
+        bProto = pIpHdr->ip6_nxt;
+        offL4  = offL3 + sizeof(RTNETIPV6);
+    }
+    else
+        return 0;
+
+    if (   (bProto == RTNETIPV4_PROT_TCP || bProto == RTNETIPV4_PROT_UDP)
+        && cbFrame >= offL4 + 4)
+        uHash ^= RT_MAKE_U32_FROM_U8(pbFrame[offL4], pbFrame[offL4 + 1], pbFrame[offL4 + 2], pbFrame[offL4 + 3]);
+
+    /* Mix the bits so that the remainder is usable for steering. */
+    uHash ^= uHash >> 16;
+    uHash *= UINT32_C(0x85ebca6b);
+    uHash ^= uHash >> 13;
+    uHash *= UINT32_C(0xc2b2ae35);
+    uHash ^= uHash >> 16;
+    return uHash;
+}
+
+/**
+ * Picks the queue pair to deliver a received frame to.
+ *
+ * Frames of the same flow go to the same RX queue.  Should that queue be out
+ * of buffers the first active queue having some is used instead.
+ *
+ * @returns Pointer to the queue pair.
+ * @param   pThis           The device state structure.
+ * @param   pvBuf           The ethernet frame.
+ * @param   cb              The size of the frame.
+ * @thread  RX
+ */
+static PVNETQUEUEPAIR vnetRxSelectPair(PVNETSTATE pThis, const void *pvBuf, size_t cb)
+{
+    uint16_t const cPairs = ASMAtomicReadU16(&pThis->cActiveQueuePairs);
+    if (cPairs <= 1)
+        return &pThis->aQueuePairs[0];
+
+    PVNETQUEUEPAIR pPair = &pThis->aQueuePairs[vnetRxFlowHash((const uint8_t *)pvBuf, cb) % cPairs];
+    if (vqueueIsEmpty(&pThis->VPCI, pPair->pRxQueue))
+        for (unsigned i = 0; i < cPairs; i++)
+            if (   vqueueIsReady(&pThis->VPCI, pThis->aQueuePairs[i].pRxQueue)
+                && !vqueueIsEmpty(&pThis->VPCI, pThis->aQueuePairs[i].pRxQueue))
+            {
+                pPair = &pThis->aQueuePairs[i];
+                break;
+            }
+    return pPair;
+}
+
 /**
  * Pad and store received packet.
  *
@@ -796,13 +979,16 @@ static bool vnetAddressFilter(PVNETSTATE pThis, const void *pvBuf, size_t cb)
  *
  * @returns VBox status code.
  * @param   pThis          The device state structure.
+ * @param   pPair           The queue pair to use.
  * @param   pvBuf           The available data.
  * @param   cb              Number of bytes available in the buffer.
+ * @param   pGso            The GSO context, NULL if none.
  * @thread  RX
  */
-static int vnetHandleRxPacket(PVNETSTATE pThis, const void *pvBuf, size_t cb,
+static int vnetHandleRxPacket(PVNETSTATE pThis, PVNETQUEUEPAIR pPair, const void *pvBuf, size_t cb,
                               PCPDMNETWORKGSO pGso)
 {
+    PVQUEUE      pRxQueue = pPair->pRxQueue;
     VNETHDRMRX   Hdr;
     unsigned    uHdrLen;
     RTGCPHYS     addrHdrMrx = 0;
@@ -854,7 +1040,7 @@ static int vnetHandleRxPacket(PVNETSTATE pThis, const void *pvBuf, size_t cb,
         VQUEUEELEM elem;
         unsigned int nSeg = 0, uElemSize = 0, cbReserved = 0;
 
-        if (!vqueueGet(&pThis->VPCI, pThis->pRxQueue, &elem))
+        if (!vqueueGet(&pThis->VPCI, pRxQueue, &elem))
         {
             /*
              * @todo: It is possible to run out of RX buffers if only a few
@@ -898,7 +1084,7 @@ static int vnetHandleRxPacket(PVNETSTATE pThis, const void *pvBuf, size_t cb,
             uElemSize += uSize;
         }
         STAM_PROFILE_START(&pThis->StatReceiveStore, a);
-        vqueuePut(&pThis->VPCI, pThis->pRxQueue, &elem, uElemSize, cbReserved);
+        vqueuePut(&pThis->VPCI, pRxQueue, &elem, uElemSize, cbReserved);
         STAM_PROFILE_STOP(&pThis->StatReceiveStore, a);
         if (!vnetMergeableRxBuffers(pThis))
             break;
@@ -915,7 +1101,7 @@ static int vnetHandleRxPacket(PVNETSTATE pThis, const void *pvBuf, size_t cb,
             return rc;
         }
     }
-    vqueueSync(&pThis->VPCI, pThis->pRxQueue);
+    vqueueSync(&pThis->VPCI, pRxQueue);
     if (uOffset < cb)
     {
         Log(("%s vnetHandleRxPacket: Packet did not fit into RX queue (packet size=%u)!\n", INSTANCE(pThis), cb));
@@ -980,8 +1166,11 @@ static DECLCALLBACK(int) vnetNetworkDown_ReceiveGso(PPDMINETWORKDOWN pInterface,
         rc = vnetCsRxEnter(pThis, VERR_SEM_BUSY);
         if (RT_SUCCESS(rc))
         {
-            rc = vnetHandleRxPacket(pThis, pvBuf, cb, pGso);
+            PVNETQUEUEPAIR pPair = vnetRxSelectPair(pThis, pvBuf, cb);
+            rc = vnetHandleRxPacket(pThis, pPair, pvBuf, cb, pGso);
             STAM_REL_COUNTER_ADD(&pThis->StatReceiveBytes, cb);
+            STAM_REL_COUNTER_INC(&pPair->StatReceivePackets);
+            STAM_REL_COUNTER_ADD(&pPair->StatReceiveBytes, cb);
             vnetCsRxLeave(pThis);
         }
     }
@@ -1153,20 +1342,45 @@ DECLINLINE(void) vnetCompleteChecksum(uint8_t *pBuf, unsigned cbSize, uint16_t u
     *(uint16_t*)(pBuf + uStart + uOffset) = vnetCSum16(pBuf + uStart, cbSize - uStart);
 }
 
-static void vnetTransmitPendingPackets(PVNETSTATE pThis, PVQUEUE pQueue, bool fOnWorkerThread)
+/**
+ * Releases the transmit slot of a queue pair and wakes up a waiting reset.
+ *
+ * @param   pThis           The device state structure.
+ * @param   pPair           The queue pair.
+ */
+DECLINLINE(void) vnetTxRelease(PVNETSTATE pThis, PVNETQUEUEPAIR pPair)
+{
+    ASMAtomicWriteU32(&pPair->uIsTransmitting, 0);
+    if (ASMAtomicReadBool(&pThis->fTxIdleWaiter))
+        RTSemEventSignal(pThis->hEventTxIdle);
+}
+
+/**
+ * Transmits the frames pending in the TX queue of a queue pair.
+ *
+ * @returns VINF_SUCCESS if the queue was drained (or cannot be serviced),
+ *          VERR_TRY_AGAIN if the driver was busy or ran out of buffers.
+ * @param   pThis           The device state structure.
+ * @param   pPair           The queue pair.
+ * @param   fOnWorkerThread Whether this is called on a TX worker thread.
+ */
+static int vnetTransmitPendingPackets(PVNETSTATE pThis, PVNETQUEUEPAIR pPair, bool fOnWorkerThread)
 {
+    PVQUEUE pQueue = pPair->pTxQueue;
+
     /*
      * Only one thread is allowed to transmit at a time, others should skip
      * transmission as the packets will be picked up by the transmitting
      * thread.
      */
-    if (!ASMAtomicCmpXchgU32(&pThis->uIsTransmitting, 1, 0))
-        return;
+    if (!ASMAtomicCmpXchgU32(&pPair->uIsTransmitting, 1, 0))
+        return VINF_SUCCESS;
 
     if ((pThis->VPCI.uStatus & VPCI_STATUS_DRV_OK) == 0)
     {
         Log(("%s Ignoring transmit requests from non-existent driver (status=0x%x).\n", INSTANCE(pThis), pThis->VPCI.uStatus));
-        return;
+        vnetTxRelease(pThis, pPair);
+        return VINF_SUCCESS;
     }
 
     PPDMINETWORKUP pDrv = pThis->pDrv;
@@ -1176,8 +1390,8 @@ static void vnetTransmitPendingPackets(PVNETSTATE pThis, PVQUEUE pQueue, bool fO
         Assert(rc == VINF_SUCCESS || rc == VERR_TRY_AGAIN);
         if (rc == VERR_TRY_AGAIN)
         {
-            ASMAtomicWriteU32(&pThis->uIsTransmitting, 0);
-            return;
+            vnetTxRelease(pThis, pPair);
+            return VERR_TRY_AGAIN;
         }
     }
 
@@ -1188,10 +1402,11 @@ static void vnetTransmitPendingPackets(PVNETSTATE pThis, PVQUEUE pQueue, bool fO
         uHdrLen = sizeof(VNETHDR);
 
     Log3(("%s vnetTransmitPendingPackets: About to transmit %d pending packets\n",
-          INSTANCE(pThis), vringReadAvailIndex(&pThis->VPCI, &pThis->pTxQueue->VRing) - pThis->pTxQueue->uNextAvailIndex));
+          INSTANCE(pThis), vringReadAvailIndex(&pThis->VPCI, &pQueue->VRing) - pQueue->uNextAvailIndex));
 
     vpciSetWriteLed(&pThis->VPCI, true);
 
+    int rcRet = VINF_SUCCESS;
     VQUEUEELEM elem;
     /*
      * Do not remove descriptors from available ring yet, try to allocate the
@@ -1224,6 +1439,7 @@ static void vnetTransmitPendingPackets(PVNETSTATE pThis, PVQUEUE pQueue, bool fO
                                   &Hdr, sizeof(Hdr));
 
                 STAM_REL_COUNTER_INC(&pThis->StatTransmitPackets);
+                STAM_REL_COUNTER_INC(&pPair->StatTransmitPackets);
 
                 STAM_PROFILE_START(&pThis->StatTransmitSend, a);
 
@@ -1296,11 +1512,13 @@ static void vnetTransmitPendingPackets(PVNETSTATE pThis, PVQUEUE pQueue, bool fO
                     STAM_PROFILE_STOP(&pThis->StatTransmitSend, a);
                     STAM_PROFILE_ADV_STOP(&pThis->StatTransmit, a);
                     /* Stop trying to fetch TX descriptors until we get more bandwidth. */
+                    rcRet = VERR_TRY_AGAIN;
                     break;
                 }
 
                 STAM_PROFILE_STOP(&pThis->StatTransmitSend, a);
                 STAM_REL_COUNTER_ADD(&pThis->StatTransmitBytes, uOffset);
+                STAM_REL_COUNTER_ADD(&pPair->StatTransmitBytes, uOffset);
             }
         }
         /* Remove this descriptor chain from the available ring */
@@ -1313,7 +1531,33 @@ static void vnetTransmitPendingPackets(PVNETSTATE pThis, PVQUEUE pQueue, bool fO
 
     if (pDrv)
         pDrv->pfnEndXmit(pDrv);
-    ASMAtomicWriteU32(&pThis->uIsTransmitting, 0);
+    vnetTxRelease(pThis, pPair);
+    return rcRet;
+}
+
+/**
+ * Returns the queue pair a RX or TX queue belongs to.
+ *
+ * @param   pThis           The device state structure.
+ * @param   pQueue          The queue.
+ */
+DECLINLINE(PVNETQUEUEPAIR) vnetQueuePairFromQueue(PVNETSTATE pThis, PVQUEUE pQueue)
+{
+    /* Queues are laid out as RX0, TX0, RX1, TX1, ..., CTL as the spec requires. */
+    uintptr_t const iPair = (uintptr_t)(pQueue - &pThis->VPCI.Queues[0]) / 2;
+    Assert(iPair < pThis->cMaxQueuePairs);
+    return &pThis->aQueuePairs[iPair];
+}
+
+/**
+ * Wakes up the TX worker of a queue pair.
+ *
+ * @param   pPair           The queue pair.
+ */
+static void vnetTxKick(PVNETQUEUEPAIR pPair)
+{
+    ASMAtomicWriteBool(&pPair->fTxKicked, true);
+    RTSemEventSignal(pPair->hEventTx);
 }
 
 /**
@@ -1322,7 +1566,84 @@ static void vnetTransmitPendingPackets(PVNETSTATE pThis, PVQUEUE pQueue, bool fO
 static DECLCALLBACK(void) vnetNetworkDown_XmitPending(PPDMINETWORKDOWN pInterface)
 {
     PVNETSTATE pThis = RT_FROM_MEMBER(pInterface, VNETSTATE, INetworkDown);
-    vnetTransmitPendingPackets(pThis, pThis->pTxQueue, false /*fOnWorkerThread*/);
+    if (pThis->cMaxQueuePairs > 1)
+    {
+        uint16_t const cPairs = ASMAtomicReadU16(&pThis->cActiveQueuePairs);
+        for (unsigned i = 0; i < cPairs; i++)
+            vnetTxKick(&pThis->aQueuePairs[i]);
+    }
+    else
+        vnetTransmitPendingPackets(pThis, &pThis->aQueuePairs[0], false /*fOnWorkerThread*/);
+}
+
+/**
+ * Queue notification callback for TX queues when there are several queue
+ * pairs: hands the work over to the TX worker of the pair.
+ */
+static DECLCALLBACK(void) vnetQueueTransmitMq(void *pvState, PVQUEUE pQueue)
+{
+    PVNETSTATE     pThis = (PVNETSTATE)pvState;
+    PVNETQUEUEPAIR pPair = vnetQueuePairFromQueue(pThis, pQueue);
+
+    STAM_REL_COUNTER_INC(&pPair->StatTransmitKicks);
+    vnetTxKick(pPair);
+}
+
+/**
+ * @callback_method_impl{FNPDMTHREADDEV, TX worker of a queue pair.}
+ */
+static DECLCALLBACK(int) vnetTxThread(PPDMDEVINS pDevIns, PPDMTHREAD pThread)
+{
+    RT_NOREF(pDevIns);
+    PVNETQUEUEPAIR pPair = (PVNETQUEUEPAIR)pThread->pvUser;
+    PVNETSTATE     pThis = pPair->pThis;
+
+    if (pThread->enmState == PDMTHREADSTATE_INITIALIZING)
+        return VINF_SUCCESS;
+
+    while (pThread->enmState == PDMTHREADSTATE_RUNNING)
+    {
+        if (!ASMAtomicXchgBool(&pPair->fTxKicked, false))
+        {
+            int rc = RTSemEventWait(pPair->hEventTx, RT_INDEFINITE_WAIT);
+            AssertLogRelMsgReturn(RT_SUCCESS(rc) || rc == VERR_INTERRUPTED, ("%Rrc\n", rc), rc);
+            continue;
+        }
+
+        PVQUEUE pQueue = pPair->pTxQueue;
+        if (   !(pThis->VPCI.uStatus & VPCI_STATUS_DRV_OK)
+            || !vqueueIsReady(&pThis->VPCI, pQueue))
+            continue;
+
+        /* No need for guest kicks while we are draining the queue. */
+        vringSetNotification(&pThis->VPCI, &pQueue->VRing, false);
+        int rc = vnetTransmitPendingPackets(pThis, pPair, true /*fOnWorkerThread*/);
+        if (rc == VERR_TRY_AGAIN)
+        {
+            /* Another pair holds the transmit session or the driver is out of buffers. */
+            STAM_REL_COUNTER_INC(&pPair->StatTransmitRetries);
+            RTSemEventWait(pPair->hEventTx, VNET_TX_RETRY_MS);
+            ASMAtomicWriteBool(&pPair->fTxKicked, true);
+            continue;
+        }
+
+        /* Re-enable kicks and pick up whatever was queued before they took effect. */
+        vringSetNotification(&pThis->VPCI, &pQueue->VRing, true);
+        if (!vqueueIsEmpty(&pThis->VPCI, pQueue))
+            ASMAtomicWriteBool(&pPair->fTxKicked, true);
+    }
+
+    return VINF_SUCCESS;
+}
+
+/**
+ * @callback_method_impl{FNPDMTHREADWAKEUPDEV}
+ */
+static DECLCALLBACK(int) vnetTxThreadWakeUp(PPDMDEVINS pDevIns, PPDMTHREAD pThread)
+{
+    RT_NOREF(pDevIns);
+    PVNETQUEUEPAIR pPair = (PVNETQUEUEPAIR)pThread->pvUser;
+    return RTSemEventSignal(pPair->hEventTx);
 }
 
 #ifdef VNET_TX_DELAY
@@ -1335,7 +1656,7 @@ static DECLCALLBACK(void) vnetQueueTransmit(void *pvState, PVQUEUE pQueue)
     {
         TMTimerStop(pThis->CTX_SUFF(pTxTimer));
         Log3(("%s vnetQueueTransmit: Got kicked with notification disabled, re-enable notification and flush TX queue\n", INSTANCE(pThis)));
-        vnetTransmitPendingPackets(pThis, pQueue, false /*fOnWorkerThread*/);
+        vnetTransmitPendingPackets(pThis, vnetQueuePairFromQueue(pThis, pQueue), false /*fOnWorkerThread*/);
         if (RT_FAILURE(vnetCsEnter(pThis, VERR_SEM_BUSY)))
             LogRel(("vnetQueueTransmit: Failed to enter critical section!/n"));
         else
@@ -1377,7 +1698,7 @@ static DECLCALLBACK(void) vnetTxTimer(PPDMDEVINS pDevIns, PTMTIMER pTimer, void
           u32MicroDiff, pThis->u32AvgDiff, pThis->u32MinDiff, pThis->u32MaxDiff));
 
 //    Log3(("%s vnetTxTimer: Expired\n", INSTANCE(pThis)));
-    vnetTransmitPendingPackets(pThis, pThis->pTxQueue, false /*fOnWorkerThread*/);
+    vnetTransmitPendingPackets(pThis, &pThis->aQueuePairs[0], false /*fOnWorkerThread*/);
     if (RT_FAILURE(vnetCsEnter(pThis, VERR_SEM_BUSY)))
     {
         LogRel(("vnetTxTimer: Failed to enter critical section!/n"));
@@ -1393,7 +1714,7 @@ static DECLCALLBACK(void) vnetQueueTransmit(void *pvState, PVQUEUE pQueue)
 {
     PVNETSTATE pThis = (PVNETSTATE)pvState;
 
-    vnetTransmitPendingPackets(pThis, pQueue, false /*fOnWorkerThread*/);
+    vnetTransmitPendingPackets(pThis, vnetQueuePairFromQueue(pThis, pQueue), false /*fOnWorkerThread*/);
 }
 
 #endif /* !VNET_TX_DELAY */
@@ -1544,6 +1865,37 @@ static uint8_t vnetControlVlan(PVNETSTATE pThis, PVNETCTLHDR pCtlHdr, PVQUEUEELE
     return u8Ack;
 }
 
+static uint8_t vnetControlMq(PVNETSTATE pThis, PVNETCTLHDR pCtlHdr, PVQUEUEELEM pElem)
+{
+    uint16_t cPairs;
+
+    if (   !(pThis->VPCI.uGuestFeatures & VNET_F_MQ)
+        || pCtlHdr->u8Command != VNET_CTRL_CMD_MQ_VQ_PAIRS_SET
+        || pElem->nOut != 2
+        || pElem->aSegsOut[1].cb != sizeof(cPairs))
+    {
+        Log(("%s vnetControlMq: Segment layout is wrong (u8Command=%u nOut=%u cb=%u)\n",
+             INSTANCE(pThis), pCtlHdr->u8Command, pElem->nOut, pElem->aSegsOut[1].cb));
+        return VNET_ERROR;
+    }
+
+    PDMDevHlpPhysRead(pThis->VPCI.CTX_SUFF(pDevIns),
+                      pElem->aSegsOut[1].addr,
+                      &cPairs, sizeof(cPairs));
+
+    if (cPairs < 1 || cPairs > pThis->cMaxQueuePairs)
+    {
+        Log(("%s vnetControlMq: Number of queue pairs is out of range (%u)\n", INSTANCE(pThis), cPairs));
+        return VNET_ERROR;
+    }
+
+    Log(("%s vnetControlMq: Using %u queue pairs\n", INSTANCE(pThis), cPairs));
+    ASMAtomicWriteU16(&pThis->cActiveQueuePairs, cPairs);
+    /* The newly enabled RX queues may have buffers already. */
+    vnetWakeupReceive(pThis->VPCI.CTX_SUFF(pDevIns));
+    return VNET_OK;
+}
+
 
 static DECLCALLBACK(void) vnetQueueControl(void *pvState, PVQUEUE pQueue)
 {
@@ -1582,6 +1934,9 @@ static DECLCALLBACK(void) vnetQueueControl(void *pvState, PVQUEUE pQueue)
                 case VNET_CTRL_CLS_VLAN:
                     u8Ack = vnetControlVlan(pThis, &CtlHdr, &elem);
                     break;
+                case VNET_CTRL_CLS_MQ:
+                    u8Ack = vnetControlMq(pThis, &CtlHdr, &elem);
+                    break;
                 default:
                     u8Ack = VNET_ERROR;
             }
@@ -1665,6 +2020,8 @@ static DECLCALLBACK(int) vnetSaveExec(PPDMDEVINS pDevIns, PSSMHANDLE pSSM)
     AssertRCReturn(rc, rc);
     rc = SSMR3PutMem( pSSM, pThis->aVlanFilter, sizeof(pThis->aVlanFilter));
     AssertRCReturn(rc, rc);
+    rc = SSMR3PutU16( pSSM, pThis->cActiveQueuePairs);
+    AssertRCReturn(rc, rc);
     Log(("%s State has been saved\n", INSTANCE(pThis)));
     return VINF_SUCCESS;
 }
@@ -1704,7 +2061,8 @@ static DECLCALLBACK(int) vnetLoadExec(PPDMDEVINS pDevIns, PSSMHANDLE pSSM, uint3
         LogRel(("%s: The mac address differs: config=%RTmac saved=%RTmac\n", INSTANCE(pThis), &pThis->macConfigured, &macConfigured));
 
     rc = vpciLoadExec(&pThis->VPCI, pSSM, uVersion, uPass, VNET_N_QUEUES);
-    AssertRCReturn(rc, rc);
+    if (RT_FAILURE(rc)) /* A config mismatch, not an internal error. */
+        return rc;
 
     if (uPass == SSM_PASS_FINAL)
     {
@@ -1743,6 +2101,17 @@ static DECLCALLBACK(int) vnetLoadExec(PPDMDEVINS pDevIns, PSSMHANDLE pSSM, uint3
             if (pThis->pDrv)
                 pThis->pDrv->pfnSetPromiscuousMode(pThis->pDrv, true);
         }
+
+        uint16_t cActiveQueuePairs = 1;
+        if (uVersion > VIRTIO_SAVEDSTATE_VERSION_PRE_MQ)
+        {
+            rc = SSMR3GetU16(pSSM, &cActiveQueuePairs);
+            AssertRCReturn(rc, rc);
+            if (cActiveQueuePairs < 1 || cActiveQueuePairs > pThis->cMaxQueuePairs)
+                return SSMR3SetCfgError(pSSM, RT_SRC_POS, N_("The number of active queue pairs is invalid: config=%u saved=%u"),
+                                        pThis->cMaxQueuePairs, cActiveQueuePairs);
+        }
+        pThis->cActiveQueuePairs = cActiveQueuePairs;
     }
 
     return rc;
@@ -1952,6 +2321,17 @@ static DECLCALLBACK(int) vnetDestruct(PPDMDEVINS pDevIns)
         RTSemEventDestroy(pThis->hEventMoreRxDescAvail);
         pThis->hEventMoreRxDescAvail = NIL_RTSEMEVENT;
     }
+    if (pThis->hEventTxIdle != NIL_RTSEMEVENT)
+    {
+        RTSemEventDestroy(pThis->hEventTxIdle);
+        pThis->hEventTxIdle = NIL_RTSEMEVENT;
+    }
+    for (unsigned i = 0; i < RT_ELEMENTS(pThis->aQueuePairs); i++)
+        if (pThis->aQueuePairs[i].hEventTx != NIL_RTSEMEVENT)
+        {
+            RTSemEventDestroy(pThis->aQueuePairs[i].hEventTx);
+            pThis->aQueuePairs[i].hEventTx = NIL_RTSEMEVENT;
+        }
 
     // if (PDMCritSectIsInitialized(&pThis->csRx))
     //     PDMR3CritSectDelete(&pThis->csRx);
@@ -1971,18 +2351,46 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
 
     /* Initialize the instance data suffiencently for the destructor not to blow up. */
     pThis->hEventMoreRxDescAvail = NIL_RTSEMEVENT;
+    pThis->hEventTxIdle          = NIL_RTSEMEVENT;
+    for (unsigned i = 0; i < RT_ELEMENTS(pThis->aQueuePairs); i++)
+        pThis->aQueuePairs[i].hEventTx = NIL_RTSEMEVENT;
 
     /* Do our own locking. */
     rc = PDMDevHlpSetDeviceCritSect(pDevIns, PDMDevHlpCritSectGetNop(pDevIns));
     AssertRCReturn(rc, rc);
 
+    /** @cfgm{QueuePairs, uint16_t, 1}
+     * The number of RX/TX queue pairs offered to the guest.  More than one
+     * enables VNET_F_MQ with a TX worker thread per pair. */
+    uint16_t cQueuePairs;
+    rc = CFGMR3QueryU16Def(pCfg, "QueuePairs", &cQueuePairs, 1);
+    if (RT_FAILURE(rc))
+        return PDMDEV_SET_ERROR(pDevIns, rc,
+                                N_("Configuration error: Failed to get the value of 'QueuePairs'"));
+    if (cQueuePairs < 1 || cQueuePairs > VNET_MAX_QUEUE_PAIRS)
+        return PDMDevHlpVMSetError(pDevIns, VERR_OUT_OF_RANGE, RT_SRC_POS,
+                                   N_("Configuration error: 'QueuePairs' must be between 1 and %u"), VNET_MAX_QUEUE_PAIRS);
+    pThis->cMaxQueuePairs    = cQueuePairs;
+    pThis->cActiveQueuePairs = 1;
+
     /* Initialize PCI part. */
     pThis->VPCI.IBase.pfnQueryInterface    = vnetQueryInterface;
     rc = vpciConstruct(pDevIns, &pThis->VPCI, iInstance,
                        VNET_NAME_FMT, VIRTIO_NET_ID,
-                       VNET_PCI_CLASS, VNET_N_QUEUES);
-    pThis->pRxQueue  = vpciAddQueue(&pThis->VPCI, 256, vnetQueueReceive,  "RX ");
-    pThis->pTxQueue  = vpciAddQueue(&pThis->VPCI, 256, vnetQueueTransmit, "TX ");
+                       VNET_PCI_CLASS, 2 * cQueuePairs + 1);
+    static const char * const s_apszRxNames[VNET_MAX_QUEUE_PAIRS] = { "RX ", "RX1", "RX2", "RX3", "RX4", "RX5", "RX6", "RX7" };
+    static const char * const s_apszTxNames[VNET_MAX_QUEUE_PAIRS] = { "TX ", "TX1", "TX2", "TX3", "TX4", "TX5", "TX6", "TX7" };
+    for (unsigned i = 0; i < cQueuePairs; i++)
+    {
+        PVNETQUEUEPAIR pPair = &pThis->aQueuePairs[i];
+        pPair->pThis    = pThis;
+        pPair->iPair    = (uint16_t)i;
+        pPair->pRxQueue = vpciAddQueue(&pThis->VPCI, 256, vnetQueueReceive, s_apszRxNames[i]);
+        pPair->pTxQueue = vpciAddQueue(&pThis->VPCI, 256, cQueuePairs > 1 ? vnetQueueTransmitMq : vnetQueueTransmit,
+                                       s_apszTxNames[i]);
+    }
+    pThis->pRxQueue  = pThis->aQueuePairs[0].pRxQueue;
+    pThis->pTxQueue  = pThis->aQueuePairs[0].pTxQueue;
     pThis->pCtlQueue = vpciAddQueue(&pThis->VPCI, 16,  vnetQueueControl,  "CTL");
 
     Log(("%s Constructing new instance\n", INSTANCE(pThis)));
@@ -1990,7 +2398,7 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
     /*
      * Validate configuration.
      */
-    if (!CFGMR3AreValuesValid(pCfg, "MAC\0" "CableConnected\0" "LineSpeed\0" "LinkUpDelay\0"))
+    if (!CFGMR3AreValuesValid(pCfg, "MAC\0" "CableConnected\0" "LineSpeed\0" "LinkUpDelay\0" "QueuePairs\0"))
                     return PDMDEV_SET_ERROR(pDevIns, VERR_PDM_DEVINS_UNKNOWN_CFG_VALUES,
                                             N_("Invalid configuration for VirtioNet device"));
 
@@ -2023,6 +2431,7 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
     /* Initialize PCI config space */
     memcpy(pThis->config.mac.au8, pThis->macConfigured.au8, sizeof(pThis->config.mac.au8));
     pThis->config.uStatus = 0;
+    pThis->config.uMaxVirtqueuePairs = cQueuePairs;
 
     /* Initialize state structure */
     pThis->u32PktNo     = 1;
@@ -2111,9 +2520,28 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
         return PDMDEV_SET_ERROR(pDevIns, rc, N_("Failed to attach the network LUN"));
 
     rc = RTSemEventCreate(&pThis->hEventMoreRxDescAvail);
+    if (RT_FAILURE(rc))
+        return rc;
+    rc = RTSemEventCreate(&pThis->hEventTxIdle);
     if (RT_FAILURE(rc))
         return rc;
 
+    /* Create the TX workers, a single pair keeps transmitting on EMT. */
+    if (cQueuePairs > 1)
+        for (unsigned i = 0; i < cQueuePairs; i++)
+        {
+            PVNETQUEUEPAIR pPair = &pThis->aQueuePairs[i];
+            rc = RTSemEventCreate(&pPair->hEventTx);
+            if (RT_FAILURE(rc))
+                return rc;
+            char szName[16];
+            RTStrPrintf(szName, sizeof(szName), "VNet%uTx%u", iInstance, i);
+            rc = PDMDevHlpThreadCreate(pDevIns, &pPair->pTxThread, pPair, vnetTxThread, vnetTxThreadWakeUp,
+                                       0, RTTHREADTYPE_IO, szName);
+            if (RT_FAILURE(rc))
+                return PDMDEV_SET_ERROR(pDevIns, rc, N_("Failed to create the TX worker thread"));
+        }
+
     rc = vnetIoCb_Reset(pThis);
     AssertRC(rc);
 
@@ -2134,6 +2562,17 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatTransmit,           STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL, "Profiling transmits in HC",          "/Devices/VNet%d/Transmit/Total", iInstance);
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatTransmitSend,       STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL, "Profiling send transmit in HC",      "/Devices/VNet%d/Transmit/Send", iInstance);
 #endif /* VBOX_WITH_STATISTICS */
+    if (cQueuePairs > 1)
+        for (unsigned i = 0; i < cQueuePairs; i++)
+        {
+            PVNETQUEUEPAIR pPair = &pThis->aQueuePairs[i];
+            PDMDevHlpSTAMRegisterF(pDevIns, &pPair->StatReceivePackets,  STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,      "Number of received packets",         "/Devices/VNet%d/Queue%u/ReceivePackets", iInstance, i);
+            PDMDevHlpSTAMRegisterF(pDevIns, &pPair->StatReceiveBytes,    STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_BYTES,      "Amount of data received",            "/Devices/VNet%d/Queue%u/ReceiveBytes", iInstance, i);
+            PDMDevHlpSTAMRegisterF(pDevIns, &pPair->StatTransmitPackets, STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,      "Number of sent packets",             "/Devices/VNet%d/Queue%u/TransmitPackets", iInstance, i);
+            PDMDevHlpSTAMRegisterF(pDevIns, &pPair->StatTransmitBytes,   STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_BYTES,      "Amount of data transmitted",         "/Devices/VNet%d/Queue%u/TransmitBytes", iInstance, i);
+            PDMDevHlpSTAMRegisterF(pDevIns, &pPair->StatTransmitKicks,   STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES, "Number of TX queue notifications",   "/Devices/VNet%d/Queue%u/TransmitKicks", iInstance, i);
+            PDMDevHlpSTAMRegisterF(pDevIns, &pPair->StatTransmitRetries, STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES, "Number of busy transmit sessions",   "/Devices/VNet%d/Queue%u/TransmitRetries", iInstance, i);
+        }
 
     return VINF_SUCCESS;
 }
@@ -129,6 +129,12 @@ typedef struct DRVINTNET
     PSUPDRVSESSION                  pSupDrvSession;
     /** Scatter/gather descriptor cache. */
     RTMEMCACHE                      hSgCache;
+    /** The max number of frames to commit to the send ring before pushing them
+     * thru the switch (XmitBatchSize).  1 means push every frame right away. */
+    uint32_t                        cXmitBatchMax;
+    /** The number of committed frames not yet pushed thru the switch.
+     * Always accessed while owning the XmitLock. */
+    uint32_t                        cXmitPending;
     /** Set if the link is down.
      * When the link is down all incoming packets will be dropped. */
     bool volatile                   fLinkDown;
@@ -168,6 +174,8 @@ typedef struct DRVINTNET
     STAMCOUNTER                     StatXmitWakeupR3;
     /** The times the xmit thread has been told to process the ring. */
     STAMCOUNTER                     StatXmitProcessRing;
+    /** The number of frames which were held back for batched sending. */
+    STAMCOUNTER                     StatXmitBatched;
 #ifdef VBOX_WITH_STATISTICS
     /** Profiling packet transmit runs. */
     STAMPROFILE                     StatTransmit;
@@ -292,6 +300,7 @@ DECLINLINE(int) drvR0IntNetSignalXmit(PDRVINTNET pThis)
 DECLINLINE(int) drvIntNetProcessXmit(PDRVINTNET pThis)
 {
     Assert(PDMCritSectIsOwner(&pThis->XmitLock));
+    pThis->cXmitPending = 0;
 
 #ifdef IN_RING3
     INTNETIFSENDREQ SendReq;
@@ -503,11 +512,16 @@ PDMBOTHCBDECL(int) drvIntNetUp_SendBuf(PPDMINETWORKUP pInterface, PPDMSCATTERGAT
     PDMDrvHlpFTSetCheckpoint(pThis->CTX_SUFF(pDrvIns), FTMCHECKPOINTTYPE_NETWORK);
 
     /*
-     * Commit the frame and push it thru the switch.
+     * Commit the frame and push it thru the switch.  When batching, the push
+     * is deferred till the batch is full or the device calls pfnEndXmit.
      */
     PINTNETHDR pHdr = (PINTNETHDR)pSgBuf->pvAllocator;
     IntNetRingCommitFrameEx(&pThis->CTX_SUFF(pBuf)->Send, pHdr, pSgBuf->cbUsed);
-    int rc = drvIntNetProcessXmit(pThis);
+    int rc = VINF_SUCCESS;
+    if (++pThis->cXmitPending < pThis->cXmitBatchMax)
+        STAM_REL_COUNTER_INC(&pThis->StatXmitBatched);
+    else
+        rc = drvIntNetProcessXmit(pThis);
     STAM_PROFILE_STOP(&pThis->StatTransmit, a);
 
     /*
@@ -529,6 +543,8 @@ PDMBOTHCBDECL(int) drvIntNetUp_SendBuf(PPDMINETWORKUP pInterface, PPDMSCATTERGAT
 PDMBOTHCBDECL(void) drvIntNetUp_EndXmit(PPDMINETWORKUP pInterface)
 {
     PDRVINTNET pThis = RT_FROM_MEMBER(pInterface, DRVINTNET, CTX_SUFF(INetworkUp));
+    if (pThis->cXmitPending)
+        drvIntNetProcessXmit(pThis);
     ASMAtomicUoWriteBool(&pThis->fXmitOnXmitThread, false);
     PDMCritSectLeave(&pThis->XmitLock);
 }
@@ -1243,6 +1259,7 @@ static DECLCALLBACK(void) drvR3IntNetDestruct(PPDMDRVINS pDrvIns)
         PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitWakeupR0);
         PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitWakeupR3);
         PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitProcessRing);
+        PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitBatched);
     }
 
     /*
@@ -1398,6 +1415,7 @@ static DECLCALLBACK(int) drvR3IntNetConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg
                                   "|TrunkType"
                                   "|ReceiveBufferSize"
                                   "|SendBufferSize"
+                                  "|XmitBatchSize"
                                   "|SharedMacOnWire"
                                   "|RestrictAccess"
                                   "|RequireExactPolicyMatch"
@@ -1657,6 +1675,21 @@ static DECLCALLBACK(int) drvR3IntNetConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg
     if (OpenReq.cbSend < VBOX_MAX_GSO_SIZE * 3)
         LogRel(("DrvIntNet: Warning! SendBufferSize=%u, Recommended minimum size %u butes.\n", OpenReq.cbSend, VBOX_MAX_GSO_SIZE * 4));
 
+    /** @cfgm{XmitBatchSize, uint32_t, 1}
+     * The max number of frames the device may queue up in the send ring before
+     * they are pushed thru the switch with a single ring-0 call.  Pending
+     * frames are always pushed when the device ends the transmit run
+     * (pfnEndXmit), so this only affects devices sending bursts of frames.
+     */
+    rc = CFGMR3QueryU32Def(pCfg, "XmitBatchSize", &pThis->cXmitBatchMax, 1);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc,
+                                N_("Configuration error: Failed to get the \"XmitBatchSize\" value"));
+    if (pThis->cXmitBatchMax < 1 || pThis->cXmitBatchMax > 256)
+        return PDMDrvHlpVMSetError(pDrvIns, VERR_OUT_OF_RANGE, RT_SRC_POS,
+                                   N_("Configuration error: The \"XmitBatchSize\" value %u is out of range (1..256)"),
+                                   pThis->cXmitBatchMax);
+
     /** @cfgm{IsService, boolean, true}
      * This alterns the way the thread is suspended and resumed. When it's being used by
      * a service such as LWIP/iSCSI it shouldn't suspend immediately like for a NIC.
@@ -1820,6 +1853,7 @@ static DECLCALLBACK(int) drvR3IntNetConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg
     PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatXmitWakeupR0,           "XmitWakeup-R0",        "Xmit thread wakeups from ring-0.");
     PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatXmitWakeupR3,           "XmitWakeup-R3",        "Xmit thread wakeups from ring-3.");
     PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatXmitProcessRing,        "XmitProcessRing",      "Time xmit thread was told to process the ring.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatXmitBatched,            "XmitBatched",          "Frames held back for batched sending.");
 
     /*
      * Create the async I/O threads.
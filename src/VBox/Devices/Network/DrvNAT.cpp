@@ -71,6 +71,12 @@ extern "C" {
 
 #define DRVNAT_MAXFRAMESIZE (16 * 1024)
 
+#ifdef VBOX_WITH_NAT_EPOLL
+/** The max number of events fetched per epoll_wait call.  Anything beyond
+ * this is reported by the next call (level triggered). */
+# define DRVNAT_EPOLL_MAX_EVENTS 64
+#endif
+
 /**
  * @todo: This is a bad hack to prevent freezing the guest during high network
  *        activity. Windows host only. This needs to be fixed properly.
@@ -806,7 +812,48 @@ static DECLCALLBACK(int) drvNATAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
         /*
          * To prevent concurrent execution of sending/receiving threads
          */
-#ifndef RT_OS_WINDOWS
+#if defined(VBOX_WITH_NAT_EPOLL)
+        /*
+         * The sockets stay registered with the epoll set between rounds,
+         * slirp_select_fill only updates the ones whose interest changed.
+         */
+        struct epoll_event aEvents[DRVNAT_EPOLL_MAX_EVENTS];
+        slirp_select_fill(pThis->pNATState, &nFDs);
+
+        int cEvents = epoll_wait(slirp_get_epoll_fd(pThis->pNATState), aEvents, RT_ELEMENTS(aEvents),
+                                 slirp_get_timeout_ms(pThis->pNATState));
+        if (cEvents < 0)
+        {
+            if (errno == EINTR)
+            {
+                Log2(("NAT: signal was caught while sleep on epoll_wait\n"));
+                /* No error, just process all outstanding requests but don't wait */
+                cEvents = 0;
+            }
+            else if (cPollNegRet++ > 128)
+            {
+                LogRel(("NAT: epoll_wait returns (%s) suppressed %d\n", strerror(errno), cPollNegRet));
+                cPollNegRet = 0;
+            }
+        }
+
+        if (cEvents >= 0)
+        {
+            slirp_select_poll(pThis->pNATState, aEvents, cEvents);
+            for (int i = 0; i < cEvents; i++)
+                if (aEvents[i].data.ptr == NULL)
+                {
+                    /* drain the pipe, see the poll() variant below. */
+                    char ch;
+                    size_t cbRead;
+                    RTPipeRead(pThis->hPipeRead, &ch, 1, &cbRead);
+                    break;
+                }
+        }
+        /* process _all_ outstanding requests but don't wait */
+        RTReqQueueProcess(pThis->hSlirpReqQueue, 0);
+
+#elif !defined(RT_OS_WINDOWS)
         nFDs = slirp_get_nsock(pThis->pNATState);
         /* allocation for all sockets + Management pipe */
         struct pollfd *polls = (struct pollfd *)RTMemAlloc((1 + nFDs) * sizeof(struct pollfd) + sizeof(uint32_t));
@@ -1750,6 +1797,16 @@ static DECLCALLBACK(int) drvNATConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
              */
             rc = RTPipeCreate(&pThis->hPipeRead, &pThis->hPipeWrite, 0 /*fFlags*/);
             AssertRCReturn(rc, rc);
+# ifdef VBOX_WITH_NAT_EPOLL
+            /* The pipe is the only descriptor in the set without a socket (data.ptr == NULL). */
+            struct epoll_event Event;
+            RT_ZERO(Event);
+            Event.events   = EPOLLIN | EPOLLPRI;
+            Event.data.ptr = NULL;
+            if (epoll_ctl(slirp_get_epoll_fd(pThis->pNATState), EPOLL_CTL_ADD, RTPipeToNative(pThis->hPipeRead), &Event) != 0)
+                return PDMDrvHlpVMSetError(pDrvIns, RTErrConvertFromErrno(errno), RT_SRC_POS,
+                                           N_("NAT#%d: Failed to add the control pipe to the epoll set"), pDrvIns->iInstance);
+# endif
 #else
             pThis->hWakeupEvent = CreateEvent(NULL, FALSE, FALSE, NULL); /* auto-reset event */
             slirp_register_external_event(pThis->pNATState, pThis->hWakeupEvent,
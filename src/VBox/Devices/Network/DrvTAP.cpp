@@ -61,15 +61,88 @@
 #else
 # include <sys/fcntl.h>
 #endif
+#ifdef RT_OS_LINUX
+# include <sys/uio.h>
+# include <net/if.h>
+# include <linux/if_tun.h>
+#endif
 #include <errno.h>
 #include <unistd.h>
 
 #include "VBoxDD.h"
 
 
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+#ifdef RT_OS_LINUX
+/* Older kernel headers may lack some of the tun offloading bits. */
+# ifndef IFF_VNET_HDR
+#  define IFF_VNET_HDR                  0x4000
+# endif
+# ifndef TUNGETIFF
+#  define TUNGETIFF                     _IOR('T', 210, unsigned int)
+# endif
+# ifndef TUNSETOFFLOAD
+#  define TUNSETOFFLOAD                 _IOW('T', 208, unsigned int)
+# endif
+# ifndef TUN_F_CSUM
+#  define TUN_F_CSUM                    0x01
+# endif
+# ifndef TUN_F_TSO4
+#  define TUN_F_TSO4                    0x02
+# endif
+# ifndef TUN_F_TSO6
+#  define TUN_F_TSO6                    0x04
+# endif
+
+/** @name DRVTAPVNETHDR::u8Flags
+ * @{ */
+# define DRVTAP_VNETHDR_F_NEEDS_CSUM    0x01
+/** @} */
+
+/** @name DRVTAPVNETHDR::u8GsoType
+ * @{ */
+# define DRVTAP_VNETHDR_GSO_NONE        0
+# define DRVTAP_VNETHDR_GSO_TCPV4       1
+# define DRVTAP_VNETHDR_GSO_UDP         3
+# define DRVTAP_VNETHDR_GSO_TCPV6       4
+# define DRVTAP_VNETHDR_GSO_ECN         0x80
+/** @} */
+#endif /* RT_OS_LINUX */
+
+/** The receive buffer size when the kernel hands us plain frames only. */
+#define DRVTAP_RECV_BUF_SIZE            _16K
+/** The receive buffer size when the kernel may hand us TSO super-frames. */
+#define DRVTAP_RECV_BUF_SIZE_GSO        (_64K + _1K)
+
+
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
+#ifdef RT_OS_LINUX
+/**
+ * The header prefixed to each frame by the Linux tun driver when the
+ * descriptor is in IFF_VNET_HDR mode (struct virtio_net_hdr, host endian).
+ */
+#pragma pack(1)
+typedef struct DRVTAPVNETHDR
+{
+    uint8_t                 u8Flags;
+    uint8_t                 u8GsoType;
+    uint16_t                u16HdrLen;
+    uint16_t                u16GsoSize;
+    uint16_t                u16CSumStart;
+    uint16_t                u16CSumOffset;
+} DRVTAPVNETHDR;
+#pragma pack()
+AssertCompileSize(DRVTAPVNETHDR, 10);
+/** Pointer to a vnet header. */
+typedef DRVTAPVNETHDR *PDRVTAPVNETHDR;
+/** Pointer to a const vnet header. */
+typedef DRVTAPVNETHDR const *PCDRVTAPVNETHDR;
+#endif /* RT_OS_LINUX */
+
 /**
  * TAP driver instance data.
  *
@@ -103,6 +176,18 @@ typedef struct DRVTAP
     RTPIPE                  hPipeRead;
     /** Reader thread. */
     PPDMTHREAD              pThread;
+    /** The receive buffer (owned by the reader thread). */
+    uint8_t                *pbRecvBuf;
+    /** The size of the receive buffer. */
+    size_t                  cbRecvBuf;
+#ifdef RT_OS_LINUX
+    /** Set if the descriptor is in IFF_VNET_HDR mode, i.e. each frame is
+     * prefixed by a DRVTAPVNETHDR in both directions. */
+    bool                    fVnetHdr;
+    /** Set if the kernel was told (TUNSETOFFLOAD) that it may hand us TSO
+     * super-frames and frames with partial checksums. */
+    bool                    fOffload;
+#endif
 
     /** @todo The transmit thread. */
     /** Transmit lock used by drvTAPNetworkUp_BeginXmit. */
@@ -121,6 +206,10 @@ typedef struct DRVTAP
     STAMPROFILE             StatTransmit;
     /** Profiling packet receive runs. */
     STAMPROFILEADV          StatReceive;
+    /** Number of GSO super-frames passed to the kernel as such. */
+    STAMCOUNTER             StatPktSentGso;
+    /** Number of GSO super-frames received from the kernel. */
+    STAMCOUNTER             StatPktRecvGso;
 #endif /* VBOX_WITH_STATISTICS */
 
 #ifdef LOG_ENABLED
@@ -144,6 +233,156 @@ static int              SolarisTAPAttach(PDRVTAP pThis);
 #endif
 
 
+#ifdef RT_OS_LINUX
+/**
+ * Writes a frame prefixed by a vnet header to the tap descriptor.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The instance data.
+ * @param   pHdr            The vnet header.
+ * @param   pvFrame         The frame.
+ * @param   cbFrame         The frame size.
+ */
+static int drvTAPWriteVnetFrame(PDRVTAP pThis, PCDRVTAPVNETHDR pHdr, void const *pvFrame, size_t cbFrame)
+{
+    struct iovec aIov[2];
+    aIov[0].iov_base = (void *)pHdr;
+    aIov[0].iov_len  = sizeof(*pHdr);
+    aIov[1].iov_base = (void *)pvFrame;
+    aIov[1].iov_len  = cbFrame;
+    ssize_t cbWritten = writev(RTFileToNative(pThis->hFileDevice), &aIov[0], RT_ELEMENTS(aIov));
+    if (cbWritten >= 0)
+        return VINF_SUCCESS;
+    return RTErrConvertFromErrno(errno);
+}
+
+
+/**
+ * Translates a GSO context into a vnet header the kernel can segment.
+ *
+ * Only plain TCP over IPv4/IPv6 is handed to the kernel; UDP fragmentation
+ * offload is not reliably accepted by all kernels and the tunneled types have
+ * no vnet equivalent, so those are carved in user space.
+ *
+ * @returns true if translated, false if the frame must be carved by us.
+ * @param   pGso            The GSO context.
+ * @param   pHdr            Where to return the vnet header.
+ */
+static bool drvTAPGsoToVnetHdr(PCPDMNETWORKGSO pGso, PDRVTAPVNETHDR pHdr)
+{
+    switch ((PDMNETWORKGSOTYPE)pGso->u8Type)
+    {
+        case PDMNETWORKGSOTYPE_IPV4_TCP:
+            pHdr->u8GsoType = DRVTAP_VNETHDR_GSO_TCPV4;
+            break;
+        case PDMNETWORKGSOTYPE_IPV6_TCP:
+            pHdr->u8GsoType = DRVTAP_VNETHDR_GSO_TCPV6;
+            break;
+        default:
+            return false;
+    }
+    pHdr->u8Flags       = DRVTAP_VNETHDR_F_NEEDS_CSUM;
+    pHdr->u16HdrLen     = pGso->cbHdrsTotal;
+    pHdr->u16GsoSize    = pGso->cbMaxSeg;
+    pHdr->u16CSumStart  = pGso->offHdr2;
+    pHdr->u16CSumOffset = RT_OFFSETOF(RTNETTCP, th_sum);
+    return true;
+}
+
+
+/**
+ * Translates the vnet header of a received super-frame into a GSO context.
+ *
+ * The header offsets are taken from the frame itself rather than from
+ * u16HdrLen, which the kernel sets to the linear part of the skb.
+ *
+ * @returns true if valid, false if the frame should be dropped.
+ * @param   pHdr            The vnet header.
+ * @param   pbFrame         The frame following the header.
+ * @param   cbFrame         The frame size.
+ * @param   pGso            Where to return the GSO context.
+ */
+static bool drvTAPVnetHdrToGso(PCDRVTAPVNETHDR pHdr, uint8_t const *pbFrame, size_t cbFrame, PPDMNETWORKGSO pGso)
+{
+    uint32_t const offHdr1 = sizeof(RTNETETHERHDR);
+    if (cbFrame < offHdr1 + RTNETIPV6_MIN_LEN + RTNETTCP_MIN_LEN)
+        return false;
+    uint16_t const uEtherType = RT_N2H_U16(((PCRTNETETHERHDR)pbFrame)->EtherType);
+
+    uint32_t offHdr2;
+    switch (pHdr->u8GsoType & ~DRVTAP_VNETHDR_GSO_ECN)
+    {
+        case DRVTAP_VNETHDR_GSO_TCPV4:
+        {
+            PCRTNETIPV4 pIpHdr = (PCRTNETIPV4)&pbFrame[offHdr1];
+            if (   uEtherType != RTNET_ETHERTYPE_IPV4
+                || pIpHdr->ip_p != RTNETIPV4_PROT_TCP)
+                return false;
+            pGso->u8Type = PDMNETWORKGSOTYPE_IPV4_TCP;
+            offHdr2 = offHdr1 + pIpHdr->ip_hl * 4;
+            break;
+        }
+        case DRVTAP_VNETHDR_GSO_TCPV6:
+        {
+            PCRTNETIPV6 pIpHdr = (PCRTNETIPV6)&pbFrame[offHdr1];
+            if (   uEtherType != RTNET_ETHERTYPE_IPV6
+                || pIpHdr->ip6_nxt != RTNETIPV4_PROT_TCP)
+                return false;
+            pGso->u8Type = PDMNETWORKGSOTYPE_IPV6_TCP;
+            offHdr2 = offHdr1 + RTNETIPV6_MIN_LEN;
+            break;
+        }
+        default:
+            return false;
+    }
+    if (offHdr2 + RTNETTCP_MIN_LEN > cbFrame)
+        return false;
+
+    uint32_t const cbHdrsTotal = offHdr2 + ((PCRTNETTCP)&pbFrame[offHdr2])->th_off * 4;
+    if (cbHdrsTotal > UINT8_MAX)
+        return false;
+
+    pGso->offHdr1     = (uint8_t)offHdr1;
+    pGso->offHdr2     = (uint8_t)offHdr2;
+    pGso->cbHdrsTotal = (uint8_t)cbHdrsTotal;
+    pGso->cbHdrsSeg   = (uint8_t)cbHdrsTotal;
+    pGso->cbMaxSeg    = pHdr->u16GsoSize;
+    return PDMNetGsoIsValid(pGso, sizeof(*pGso), cbFrame);
+}
+
+
+/**
+ * Completes a partial checksum the kernel left for us to fill in.
+ *
+ * @param   pbFrame         The frame.
+ * @param   cbFrame         The frame size.
+ * @param   offStart        Where to start summing.
+ * @param   offField        The offset of the checksum field relative to
+ *                          @a offStart.
+ */
+static void drvTAPCompleteChecksum(uint8_t *pbFrame, size_t cbFrame, uint32_t offStart, uint32_t offField)
+{
+    if (   offStart >= cbFrame
+        || offField + sizeof(uint16_t) > cbFrame - offStart)
+        return;
+
+    uint32_t        u32Sum = 0;
+    uint16_t const *pu16   = (uint16_t const *)&pbFrame[offStart];
+    size_t          cb     = cbFrame - offStart;
+    while (cb > 1)
+    {
+        u32Sum += *pu16++;
+        cb -= 2;
+    }
+    if (cb)
+        u32Sum += *(uint8_t const *)pu16;
+    while (u32Sum >> 16)
+        u32Sum = (u32Sum >> 16) + (u32Sum & 0xffff);
+    *(uint16_t *)&pbFrame[offStart + offField] = (uint16_t)~u32Sum;
+}
+#endif /* RT_OS_LINUX */
+
+
 
 /**
  * @interface_method_impl{PDMINETWORKUP,pfnBeginXmit}
@@ -263,23 +502,55 @@ static DECLCALLBACK(int) drvTAPNetworkUp_SendBuf(PPDMINETWORKUP pInterface, PPDM
               "%.*Rhxd\n",
               pSgBuf->aSegs[0].pvSeg, pSgBuf->cbUsed, pSgBuf->cbUsed, pSgBuf->aSegs[0].pvSeg));
 
-        rc = RTFileWrite(pThis->hFileDevice, pSgBuf->aSegs[0].pvSeg, pSgBuf->cbUsed, NULL);
+#ifdef RT_OS_LINUX
+        if (pThis->fVnetHdr)
+        {
+            DRVTAPVNETHDR Hdr;
+            RT_ZERO(Hdr);
+            rc = drvTAPWriteVnetFrame(pThis, &Hdr, pSgBuf->aSegs[0].pvSeg, pSgBuf->cbUsed);
+        }
+        else
+#endif
+            rc = RTFileWrite(pThis->hFileDevice, pSgBuf->aSegs[0].pvSeg, pSgBuf->cbUsed, NULL);
     }
     else
     {
-        uint8_t         abHdrScratch[256];
-        uint8_t const  *pbFrame = (uint8_t const *)pSgBuf->aSegs[0].pvSeg;
+        uint8_t        *pbFrame = (uint8_t *)pSgBuf->aSegs[0].pvSeg;
         PCPDMNETWORKGSO pGso    = (PCPDMNETWORKGSO)pSgBuf->pvUser;
-        uint32_t const  cSegs   = PDMNetGsoCalcSegmentCount(pGso, pSgBuf->cbUsed);  Assert(cSegs > 1);
-        rc = VINF_SUCCESS;
-        for (size_t iSeg = 0; iSeg < cSegs; iSeg++)
+#ifdef RT_OS_LINUX
+        DRVTAPVNETHDR   Hdr;
+        RT_ZERO(Hdr);
+        if (   pThis->fVnetHdr
+            && drvTAPGsoToVnetHdr(pGso, &Hdr))
         {
-            uint32_t cbSegFrame;
-            void *pvSegFrame = PDMNetGsoCarveSegmentQD(pGso, (uint8_t *)pbFrame, pSgBuf->cbUsed, abHdrScratch,
-                                                       iSeg, cSegs, &cbSegFrame);
-            rc = RTFileWrite(pThis->hFileDevice, pvSegFrame, cbSegFrame, NULL);
-            if (RT_FAILURE(rc))
-                break;
+            /*
+             * Let the kernel segment the super-frame; it only wants the
+             * pseudo header checksum, just like a virtio-net host would.
+             */
+            STAM_COUNTER_INC(&pThis->StatPktSentGso);
+            PDMNetGsoPrepForDirectUse(pGso, pbFrame, pSgBuf->cbUsed, PDMNETCSUMTYPE_PSEUDO);
+            rc = drvTAPWriteVnetFrame(pThis, &Hdr, pbFrame, pSgBuf->cbUsed);
+        }
+        else
+#endif
+        {
+            uint8_t         abHdrScratch[256];
+            uint32_t const  cSegs   = PDMNetGsoCalcSegmentCount(pGso, pSgBuf->cbUsed);  Assert(cSegs > 1);
+            rc = VINF_SUCCESS;
+            for (size_t iSeg = 0; iSeg < cSegs; iSeg++)
+            {
+                uint32_t cbSegFrame;
+                void *pvSegFrame = PDMNetGsoCarveSegmentQD(pGso, pbFrame, pSgBuf->cbUsed, abHdrScratch,
+                                                           iSeg, cSegs, &cbSegFrame);
+#ifdef RT_OS_LINUX
+                if (pThis->fVnetHdr)
+                    rc = drvTAPWriteVnetFrame(pThis, &Hdr, pvSegFrame, cbSegFrame);
+                else
+#endif
+                    rc = RTFileWrite(pThis->hFileDevice, pvSegFrame, cbSegFrame, NULL);
+                if (RT_FAILURE(rc))
+                    break;
+            }
         }
     }
 
@@ -378,14 +649,44 @@ static DECLCALLBACK(int) drvTAPAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
             /*
              * Read the frame.
              */
-            char achBuf[16384];
             size_t cbRead = 0;
             /** @note At least on Linux we will never receive more than one network packet
              *        after poll() returned successfully. I don't know why but a second
              *        RTFileRead() operation will return with VERR_TRY_AGAIN in any case. */
-            rc = RTFileRead(pThis->hFileDevice, achBuf, sizeof(achBuf), &cbRead);
+            rc = RTFileRead(pThis->hFileDevice, pThis->pbRecvBuf, pThis->cbRecvBuf, &cbRead);
             if (RT_SUCCESS(rc))
             {
+                uint8_t        *pbFrame = pThis->pbRecvBuf;
+                PDMNETWORKGSO   Gso;
+                bool            fGso    = false;
+#ifdef RT_OS_LINUX
+                if (pThis->fVnetHdr)
+                {
+                    /*
+                     * Strip the vnet header and either pick up the super-frame
+                     * description or complete a partial checksum.
+                     */
+                    if (cbRead < sizeof(DRVTAPVNETHDR))
+                        continue;
+                    DRVTAPVNETHDR const Hdr = *(PCDRVTAPVNETHDR)pbFrame;
+                    pbFrame += sizeof(DRVTAPVNETHDR);
+                    cbRead  -= sizeof(DRVTAPVNETHDR);
+                    if (Hdr.u8GsoType != DRVTAP_VNETHDR_GSO_NONE)
+                    {
+                        if (!drvTAPVnetHdrToGso(&Hdr, pbFrame, cbRead, &Gso))
+                        {
+                            Log(("drvTAPAsyncIoThread: Dropping bad GSO frame: type=%#x gso=%#x start=%#x cb=%#zx\n",
+                                 Hdr.u8GsoType, Hdr.u16GsoSize, Hdr.u16CSumStart, cbRead));
+                            continue;
+                        }
+                        PDMNetGsoPrepForDirectUse(&Gso, pbFrame, cbRead, PDMNETCSUMTYPE_PSEUDO);
+                        fGso = true;
+                    }
+                    else if (Hdr.u8Flags & DRVTAP_VNETHDR_F_NEEDS_CSUM)
+                        drvTAPCompleteChecksum(pbFrame, cbRead, Hdr.u16CSumStart, Hdr.u16CSumOffset);
+                }
+#endif
+
                 /*
                  * Wait for the device to have space for this frame.
                  * Most guests use frame-sized receive buffers, hence non-zero cbMax
@@ -419,11 +720,43 @@ static DECLCALLBACK(int) drvTAPAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
                          cbRead, u64Now, u64Now - pThis->u64LastReceiveTS, u64Now - pThis->u64LastTransferTS));
                 pThis->u64LastReceiveTS = u64Now;
 #endif
-                Log2(("drvTAPAsyncIoThread: cbRead=%#x\n" "%.*Rhxd\n", cbRead, cbRead, achBuf));
+                Log2(("drvTAPAsyncIoThread: cbRead=%#x\n" "%.*Rhxd\n", cbRead, cbRead, pbFrame));
                 STAM_COUNTER_INC(&pThis->StatPktRecv);
                 STAM_COUNTER_ADD(&pThis->StatPktRecvBytes, cbRead);
-                rc1 = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, achBuf, cbRead);
-                AssertRC(rc1);
+                if (!fGso)
+                {
+                    rc1 = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, pbFrame, cbRead);
+                    AssertRC(rc1);
+                }
+                else
+                {
+                    STAM_COUNTER_INC(&pThis->StatPktRecvGso);
+                    if (   !pThis->pIAboveNet->pfnReceiveGso
+                        || RT_FAILURE(pThis->pIAboveNet->pfnReceiveGso(pThis->pIAboveNet, pbFrame, cbRead, &Gso)))
+                    {
+                        /*
+                         * The device cannot take the super-frame, carve it up.
+                         */
+                        uint8_t         abHdrScratch[256];
+                        uint32_t const  cSegs = PDMNetGsoCalcSegmentCount(&Gso, cbRead);
+                        for (uint32_t iSeg = 0; iSeg < cSegs; iSeg++)
+                        {
+                            uint32_t cbSegFrame;
+                            void    *pvSegFrame = PDMNetGsoCarveSegmentQD(&Gso, pbFrame, cbRead, abHdrScratch,
+                                                                          iSeg, cSegs, &cbSegFrame);
+                            if (iSeg > 0)
+                            {
+                                STAM_PROFILE_ADV_STOP(&pThis->StatReceive, a);
+                                rc1 = pThis->pIAboveNet->pfnWaitReceiveAvail(pThis->pIAboveNet, RT_INDEFINITE_WAIT);
+                                STAM_PROFILE_ADV_START(&pThis->StatReceive, a);
+                                if (RT_FAILURE(rc1))
+                                    break; /* drop the rest */
+                            }
+                            rc1 = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, pvSegFrame, cbSegFrame);
+                            AssertRC(rc1);
+                        }
+                    }
+                }
             }
             else
             {
@@ -833,6 +1166,12 @@ static DECLCALLBACK(void) drvTAPDestruct(PPDMDRVINS pDrvIns)
     if (RTCritSectIsInitialized(&pThis->XmitLock))
         RTCritSectDelete(&pThis->XmitLock);
 
+    if (pThis->pbRecvBuf)
+    {
+        RTMemFree(pThis->pbRecvBuf);
+        pThis->pbRecvBuf = NULL;
+    }
+
 #ifdef VBOX_WITH_STATISTICS
     /*
      * Deregister statistics.
@@ -843,6 +1182,8 @@ static DECLCALLBACK(void) drvTAPDestruct(PPDMDRVINS pDrvIns)
     PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatPktRecvBytes);
     PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatTransmit);
     PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatReceive);
+    PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatPktSentGso);
+    PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatPktRecvGso);
 #endif /* VBOX_WITH_STATISTICS */
 }
 
@@ -872,6 +1213,8 @@ static DECLCALLBACK(int) drvTAPConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
 #endif
     pThis->pszSetupApplication          = NULL;
     pThis->pszTerminateApplication      = NULL;
+    pThis->pbRecvBuf                    = NULL;
+    pThis->cbRecvBuf                    = DRVTAP_RECV_BUF_SIZE;
 
     /* IBase */
     pDrvIns->IBase.pfnQueryInterface    = drvTAPQueryInterface;
@@ -894,12 +1237,14 @@ static DECLCALLBACK(int) drvTAPConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
     PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatPktRecvBytes,  STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_BYTES,             "Number of received bytes.",        "/Drivers/TAP%d/Bytes/Received", pDrvIns->iInstance);
     PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatTransmit,      STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL,    "Profiling packet transmit runs.",  "/Drivers/TAP%d/Transmit", pDrvIns->iInstance);
     PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatReceive,       STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL,    "Profiling packet receive runs.",   "/Drivers/TAP%d/Receive", pDrvIns->iInstance);
+    PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatPktSentGso,    STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,        "Number of GSO frames passed to the host.",   "/Drivers/TAP%d/Packets/SentGso", pDrvIns->iInstance);
+    PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatPktRecvGso,    STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,        "Number of GSO frames received from the host.", "/Drivers/TAP%d/Packets/ReceivedGso", pDrvIns->iInstance);
 #endif /* VBOX_WITH_STATISTICS */
 
     /*
      * Validate the config.
      */
-    if (!CFGMR3AreValuesValid(pCfg, "Device\0InitProg\0TermProg\0FileHandle\0TAPSetupApplication\0TAPTerminateApplication\0MAC"))
+    if (!CFGMR3AreValuesValid(pCfg, "Device\0InitProg\0TermProg\0FileHandle\0TAPSetupApplication\0TAPTerminateApplication\0MAC\0VnetHdrOffload"))
         return PDMDRV_SET_ERROR(pDrvIns, VERR_PDM_DRVINS_UNKNOWN_CFG_VALUES, "");
 
     /*
@@ -994,6 +1339,45 @@ static DECLCALLBACK(int) drvTAPConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
     Log(("drvTAPContruct: %d (from fd)\n", (intptr_t)pThis->hFileDevice));
     rc = VINF_SUCCESS;
 
+#ifdef RT_OS_LINUX
+    /*
+     * Check whether the descriptor was opened with IFF_VNET_HDR.  If so, every
+     * frame carries a vnet header and we can pass TSO super-frames straight
+     * to the kernel.  Receiving super-frames is only worth it if the device
+     * above can take them without us carving them up again.
+     */
+    bool fVnetHdrOffload;
+    rc = CFGMR3QueryBoolDef(pCfg, "VnetHdrOffload", &fVnetHdrOffload, true);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"VnetHdrOffload\" value"));
+
+    struct ifreq IfReq;
+    RT_ZERO(IfReq);
+    if (   ioctl(RTFileToNative(pThis->hFileDevice), TUNGETIFF, &IfReq) == 0
+        && (IfReq.ifr_flags & IFF_VNET_HDR))
+    {
+        pThis->fVnetHdr = true;
+        if (   fVnetHdrOffload
+            && pThis->pIAboveNet->pfnReceiveGso)
+        {
+            unsigned long uOffload = TUN_F_CSUM | TUN_F_TSO4 | TUN_F_TSO6;
+            if (ioctl(RTFileToNative(pThis->hFileDevice), TUNSETOFFLOAD, uOffload) == 0)
+            {
+                pThis->fOffload  = true;
+                pThis->cbRecvBuf = DRVTAP_RECV_BUF_SIZE_GSO;
+            }
+            else
+                LogRel(("TAP#%d: TUNSETOFFLOAD failed, errno=%d. Receiving plain frames only.\n", pDrvIns->iInstance, errno));
+        }
+        LogRel(("TAP#%d: Using vnet headers (offload=%RTbool)\n", pDrvIns->iInstance, pThis->fOffload));
+    }
+    pThis->cbRecvBuf += pThis->fVnetHdr ? sizeof(DRVTAPVNETHDR) : 0;
+#endif
+
+    pThis->pbRecvBuf = (uint8_t *)RTMemAlloc(pThis->cbRecvBuf);
+    if (!pThis->pbRecvBuf)
+        return VERR_NO_MEMORY;
+
     /*
      * Create the control pipe.
      */
@@ -65,6 +65,17 @@
 /** The wakeup bit in the INTNETIF::cBusy and INTNETRUNKIF::cBusy counters. */
 #define INTNET_BUSY_WAKEUP_MASK     RT_BIT_32(30)
 
+/** The max number of receivers an interface defers wakeups for while
+ * processing its send ring (INTNETIF::apDeferredWakeups). */
+#define INTNET_MAX_DEFERRED_WAKEUPS 16
+
+/** The number of hash buckets in the MAC address lookup table.
+ * Must be a power of two. */
+#define INTNET_MACTAB_HASH_SIZE     256
+/** The end of list marker for INTNETMACTABENTRY::iHashNext and
+ * INTNETMACTABENTRY::iSpecialNext. */
+#define INTNET_MACTAB_NIL           UINT32_MAX
+
 
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
@@ -85,6 +96,12 @@ typedef struct INTNETMACTABENTRY
      * to this interface onto the trunk.  The reasoning for this is that this could
      * be the interface of a VM that just has been teleported to a different host. */
     bool                    fActive;
+    /** The index of the next entry in the same hash bucket,
+     * INTNET_MACTAB_NIL if last. */
+    uint32_t                iHashNext;
+    /** The index of the next entry on the special list (promiscuous or dummy
+     * MAC address), INTNET_MACTAB_NIL if last. */
+    uint32_t                iSpecialNext;
     /** Pointer to the network interface. */
     struct INTNETIF        *pIf;
 } INTNETMACTABENTRY;
@@ -106,6 +123,14 @@ typedef struct INTNETMACTAB
     /** Table entries. */
     PINTNETMACTABENTRY      paEntries;
 
+    /** The head of the special entry list (promiscuous or dummy MAC address).
+     * These entries may receive frames not addressed to them and must always
+     * be considered when switching.  INTNET_MACTAB_NIL if empty. */
+    uint32_t                iSpecialHead;
+    /** MAC address hash buckets (indexes into paEntries, INTNET_MACTAB_NIL if
+     * empty).  See intnetR0MacTabHash and intnetR0MacTabRehash. */
+    uint32_t                aiHashHeads[INTNET_MACTAB_HASH_SIZE];
+
     /** The number of interface entries currently in promicuous mode. */
     uint32_t                cPromiscuousEntries;
     /** The number of interface entries currently in promicuous mode that
@@ -270,6 +295,15 @@ typedef struct INTNETIF
     PINTNETDSTTAB volatile  pDstTab;
     /** Pointer to the trunk's per interface data.  Can be NULL. */
     void                   *pvIfData;
+    /** Set while IntNetR0IfSend is processing the send ring and receiver
+     * wakeups should be deferred till the end of the batch.  Only accessed by
+     * the thread owning pDstTab. */
+    bool                    fDeferWakeups;
+    /** Number of entries in apDeferredWakeups. */
+    uint32_t                cDeferredWakeups;
+    /** Receivers that got frames from us during the current send batch and
+     * need signalling.  Each entry holds a busy reference. */
+    struct INTNETIF        *apDeferredWakeups[INTNET_MAX_DEFERRED_WAKEUPS];
     /** Header buffer for when we're carving GSO frames. */
     uint8_t                 abGsoHdrs[256];
 } INTNETIF;
@@ -1655,6 +1689,100 @@ DECL_FORCE_INLINE(bool) intnetR0AreMacAddrsEqual(PCRTMAC pDstAddr1, PCRTMAC pDst
 }
 
 
+/**
+ * Calculates the MAC address lookup table hash bucket for a MAC address.
+ *
+ * @returns Bucket index (less than INTNET_MACTAB_HASH_SIZE).
+ * @param   pMacAddr            The MAC address.
+ */
+DECL_FORCE_INLINE(uint32_t) intnetR0MacTabHash(PCRTMAC pMacAddr)
+{
+    /* The OUI is usually shared by most interfaces, so weight the NIC specific
+       tail bytes. */
+    uint32_t uHash = pMacAddr->au8[5]
+                   ^ ((uint32_t)pMacAddr->au8[4] << 3)
+                   ^ ((uint32_t)pMacAddr->au8[3] << 5)
+                   ^ pMacAddr->au8[2];
+    return (uHash ^ (uHash >> 8)) & (INTNET_MACTAB_HASH_SIZE - 1);
+}
+
+
+/**
+ * Checks whether a MAC address lookup table entry belongs on the special list.
+ *
+ * Special entries may receive frames which aren't addressed to them, so the
+ * switching code has to consider them regardless of the destination address.
+ *
+ * @returns true if special, false if not.
+ * @param   pEntry              The entry.
+ */
+DECL_FORCE_INLINE(bool) intnetR0MacTabIsSpecialEntry(PINTNETMACTABENTRY pEntry)
+{
+    return pEntry->fPromiscuousEff
+        || pEntry->fPromiscuousSeeTrunk
+        || intnetR0IsMacAddrDummy(&pEntry->MacAddr);
+}
+
+
+/**
+ * Rebuilds the hash buckets and the special list of the MAC address table.
+ *
+ * This is called whenever entries are added or removed, or when the address or
+ * promiscuous setting of an entry changes.  These are all rare events compared
+ * to switching frames, so we simply redo the lot.  The chains are built so
+ * that they are ordered by descending entry index, same as the switching code
+ * traditionally walked the table.
+ *
+ * @param   pTab                The MAC address table.  The caller must own the
+ *                              network address spinlock.
+ */
+static void intnetR0MacTabRehash(PINTNETMACTAB pTab)
+{
+    for (uint32_t i = 0; i < RT_ELEMENTS(pTab->aiHashHeads); i++)
+        pTab->aiHashHeads[i] = INTNET_MACTAB_NIL;
+    pTab->iSpecialHead = INTNET_MACTAB_NIL;
+
+    for (uint32_t iIfMac = 0; iIfMac < pTab->cEntries; iIfMac++)
+    {
+        PINTNETMACTABENTRY pEntry = &pTab->paEntries[iIfMac];
+        uint32_t const     iHash  = intnetR0MacTabHash(&pEntry->MacAddr);
+        pEntry->iHashNext         = pTab->aiHashHeads[iHash];
+        pTab->aiHashHeads[iHash]  = iIfMac;
+
+        if (intnetR0MacTabIsSpecialEntry(pEntry))
+        {
+            pEntry->iSpecialNext = pTab->iSpecialHead;
+            pTab->iSpecialHead   = iIfMac;
+        }
+        else
+            pEntry->iSpecialNext = INTNET_MACTAB_NIL;
+    }
+}
+
+
+/**
+ * Finds the highest indexed active entry with the given MAC address.
+ *
+ * @returns Entry index, INTNET_MACTAB_NIL if not found.
+ * @param   pTab                The MAC address table.  The caller must own the
+ *                              network address spinlock.
+ * @param   pMacAddr            The MAC address to look for.
+ */
+DECLINLINE(uint32_t) intnetR0MacTabLookupActive(PINTNETMACTAB pTab, PCRTMAC pMacAddr)
+{
+    uint32_t iIfMac = pTab->aiHashHeads[intnetR0MacTabHash(pMacAddr)];
+    while (iIfMac != INTNET_MACTAB_NIL)
+    {
+        PINTNETMACTABENTRY pEntry = &pTab->paEntries[iIfMac];
+        if (   pEntry->fActive
+            && intnetR0AreMacAddrsEqual(&pEntry->MacAddr, pMacAddr))
+            break;
+        iIfMac = pEntry->iHashNext;
+    }
+    return iIfMac;
+}
+
+
 /**
  * Switch a unicast frame based on the network layer address (OSI level 3) and
  * return a destination table.
@@ -1787,31 +1915,30 @@ static INTNETSWDECISION intnetR0NetworkPreSwitchUnicast(PINTNETNETWORK pNetwork,
     PINTNETMACTAB       pTab            = &pNetwork->MacTab;
     RTSpinlockAcquire(pNetwork->hAddrSpinlock);
 
-    /* Iterate the internal network interfaces and look for matching source and
-       destination addresses. */
-    uint32_t iIfMac = pTab->cEntries;
-    while (iIfMac-- > 0)
+    /* Look for matching source and destination addresses.  The first active
+       entry (in descending index order) which is either the destination, the
+       source or has an unknown address decides. */
+    uint32_t const iIfDst = intnetR0MacTabLookupActive(pTab, pDstAddr);
+    if (iIfDst != INTNET_MACTAB_NIL)
     {
-        if (pTab->paEntries[iIfMac].fActive)
-        {
-            /* Unknown interface address? */
-            if (intnetR0IsMacAddrDummy(&pTab->paEntries[iIfMac].MacAddr))
-                break;
+        /* Paranoia - the source shouldn't be here, right? */
+        uint32_t iIfStop = pSrcAddr ? intnetR0MacTabLookupActive(pTab, pSrcAddr) : INTNET_MACTAB_NIL;
 
-            /* Paranoia - this shouldn't happen, right? */
-            if (    pSrcAddr
-                &&  intnetR0AreMacAddrsEqual(&pTab->paEntries[iIfMac].MacAddr, pSrcAddr))
-                break;
-
-            /* Exact match? */
-            if (intnetR0AreMacAddrsEqual(&pTab->paEntries[iIfMac].MacAddr, pDstAddr))
+        /* Unknown interface address? */
+        for (uint32_t iIfMac = pTab->iSpecialHead; iIfMac != INTNET_MACTAB_NIL; iIfMac = pTab->paEntries[iIfMac].iSpecialNext)
+            if (   pTab->paEntries[iIfMac].fActive
+                && intnetR0IsMacAddrDummy(&pTab->paEntries[iIfMac].MacAddr))
             {
-                enmSwDecision = pTab->fHostPromiscuousEff && fSrc == INTNETTRUNKDIR_WIRE
-                              ? INTNETSWDECISION_BROADCAST
-                              : INTNETSWDECISION_INTNET;
+                if (iIfStop == INTNET_MACTAB_NIL || iIfMac > iIfStop)
+                    iIfStop = iIfMac;
                 break;
             }
-        }
+
+        /* Exact match? */
+        if (iIfStop == INTNET_MACTAB_NIL || iIfDst > iIfStop)
+            enmSwDecision = pTab->fHostPromiscuousEff && fSrc == INTNETTRUNKDIR_WIRE
+                          ? INTNETSWDECISION_BROADCAST
+                          : INTNETSWDECISION_INTNET;
     }
 
     RTSpinlockRelease(pNetwork->hAddrSpinlock);
@@ -1847,30 +1974,46 @@ static INTNETSWDECISION intnetR0NetworkSwitchUnicast(PINTNETNETWORK pNetwork, ui
     pDstTab->pTrunk     = 0;
     pDstTab->cIfs       = 0;
 
-    /* Find exactly matching or promiscuous interfaces. */
+    /* Find exactly matching interfaces. */
     uint32_t cExactHits = 0;
-    uint32_t iIfMac     = pTab->cEntries;
-    while (iIfMac-- > 0)
+    uint32_t iIfMac     = pTab->aiHashHeads[intnetR0MacTabHash(pDstAddr)];
+    while (iIfMac != INTNET_MACTAB_NIL)
     {
-        if (pTab->paEntries[iIfMac].fActive)
+        if (   pTab->paEntries[iIfMac].fActive
+            && intnetR0AreMacAddrsEqual(&pTab->paEntries[iIfMac].MacAddr, pDstAddr))
         {
-            bool fExact = intnetR0AreMacAddrsEqual(&pTab->paEntries[iIfMac].MacAddr, pDstAddr);
-            if (   fExact
-                || intnetR0IsMacAddrDummy(&pTab->paEntries[iIfMac].MacAddr)
-                || (   pTab->paEntries[iIfMac].fPromiscuousSeeTrunk
-                    || (!fSrc && pTab->paEntries[iIfMac].fPromiscuousEff) )
-               )
+            cExactHits++;
+
+            PINTNETIF pIf = pTab->paEntries[iIfMac].pIf;            AssertPtr(pIf); Assert(pIf->pNetwork == pNetwork);
+            if (RT_LIKELY(pIf != pIfSender)) /* paranoia */
             {
-                cExactHits += fExact;
+                uint32_t iIfDst = pDstTab->cIfs++;
+                pDstTab->aIfs[iIfDst].pIf            = pIf;
+                pDstTab->aIfs[iIfDst].fReplaceDstMac = false;
+                intnetR0BusyIncIf(pIf);
+            }
+        }
+        iIfMac = pTab->paEntries[iIfMac].iHashNext;
+    }
 
-                PINTNETIF pIf = pTab->paEntries[iIfMac].pIf;        AssertPtr(pIf); Assert(pIf->pNetwork == pNetwork);
-                if (RT_LIKELY(pIf != pIfSender)) /* paranoia */
-                {
-                    uint32_t iIfDst = pDstTab->cIfs++;
-                    pDstTab->aIfs[iIfDst].pIf            = pIf;
-                    pDstTab->aIfs[iIfDst].fReplaceDstMac = false;
-                    intnetR0BusyIncIf(pIf);
-                }
+    /* Find promiscuous interfaces and interfaces with unknown addresses.  Only
+       the special list needs checking here, exact matches were taken above. */
+    for (iIfMac = pTab->iSpecialHead; iIfMac != INTNET_MACTAB_NIL; iIfMac = pTab->paEntries[iIfMac].iSpecialNext)
+    {
+        if (   pTab->paEntries[iIfMac].fActive
+            && !intnetR0AreMacAddrsEqual(&pTab->paEntries[iIfMac].MacAddr, pDstAddr)
+            && (   intnetR0IsMacAddrDummy(&pTab->paEntries[iIfMac].MacAddr)
+                || pTab->paEntries[iIfMac].fPromiscuousSeeTrunk
+                || (!fSrc && pTab->paEntries[iIfMac].fPromiscuousEff) )
+           )
+        {
+            PINTNETIF pIf = pTab->paEntries[iIfMac].pIf;            AssertPtr(pIf); Assert(pIf->pNetwork == pNetwork);
+            if (RT_LIKELY(pIf != pIfSender)) /* paranoia */
+            {
+                uint32_t iIfDst = pDstTab->cIfs++;
+                pDstTab->aIfs[iIfDst].pIf            = pIf;
+                pDstTab->aIfs[iIfDst].fReplaceDstMac = false;
+                intnetR0BusyIncIf(pIf);
             }
         }
     }
@@ -1880,8 +2023,7 @@ static INTNETSWDECISION intnetR0NetworkSwitchUnicast(PINTNETNETWORK pNetwork, ui
         && fSrc
         && pNetwork->MacTab.cPromiscuousNoTrunkEntries)
     {
-        iIfMac = pTab->cEntries;
-        while (iIfMac-- > 0)
+        for (iIfMac = pTab->iSpecialHead; iIfMac != INTNET_MACTAB_NIL; iIfMac = pTab->paEntries[iIfMac].iSpecialNext)
         {
             if (   pTab->paEntries[iIfMac].fPromiscuousEff
                 && !pTab->paEntries[iIfMac].fPromiscuousSeeTrunk
@@ -2816,6 +2958,55 @@ static int intnetR0RingWriteFrame(PINTNETRINGBUF pRingBuf, PCINTNETSG pSG, PCRTM
 }
 
 
+/**
+ * Signals the receiver of a frame, deferring it when the sender is processing
+ * a batch of frames.
+ *
+ * @param   pIf             The receiving interface.
+ * @param   pIfSender       The interface sending the frame. This is NULL if it's the trunk.
+ */
+static void intnetR0IfSignalRecv(PINTNETIF pIf, PINTNETIF pIfSender)
+{
+    if (   pIfSender
+        && pIfSender->fDeferWakeups)
+    {
+        uint32_t i = pIfSender->cDeferredWakeups;
+        while (i-- > 0)
+            if (pIfSender->apDeferredWakeups[i] == pIf)
+                return;
+
+        i = pIfSender->cDeferredWakeups;
+        if (i < RT_ELEMENTS(pIfSender->apDeferredWakeups))
+        {
+            intnetR0BusyIncIf(pIf);
+            pIfSender->apDeferredWakeups[i] = pIf;
+            pIfSender->cDeferredWakeups     = i + 1;
+            return;
+        }
+    }
+    RTSemEventSignal(pIf->hRecvEvent);
+}
+
+
+/**
+ * Signals the receivers whose wakeups were deferred by intnetR0IfSignalRecv.
+ *
+ * @param   pIfSender       The sending interface.
+ */
+static void intnetR0IfFlushDeferredWakeups(PINTNETIF pIfSender)
+{
+    uint32_t const cWakeups = pIfSender->cDeferredWakeups;
+    for (uint32_t i = 0; i < cWakeups; i++)
+    {
+        PINTNETIF pIf = pIfSender->apDeferredWakeups[i];
+        pIfSender->apDeferredWakeups[i] = NULL;
+        RTSemEventSignal(pIf->hRecvEvent);
+        intnetR0BusyDecIf(pIf);
+    }
+    pIfSender->cDeferredWakeups = 0;
+}
+
+
 /**
  * Sends a frame to a specific interface.
  *
@@ -2835,7 +3026,7 @@ static void intnetR0IfSend(PINTNETIF pIf, PINTNETIF pIfSender, PINTNETSG pSG, PC
     if (RT_SUCCESS(rc))
     {
         pIf->cYields = 0;
-        RTSemEventSignal(pIf->hRecvEvent);
+        intnetR0IfSignalRecv(pIf, pIfSender);
         return;
     }
 
@@ -3971,7 +4162,10 @@ static INTNETSWDECISION intnetR0NetworkSend(PINTNETNETWORK pNetwork, PINTNETIF p
 
         PINTNETMACTABENTRY pIfEntry = intnetR0NetworkFindMacAddrEntry(pNetwork, pIfSender);
         if (pIfEntry)
+        {
             pIfEntry->MacAddr = EthHdr.SrcMac;
+            intnetR0MacTabRehash(&pNetwork->MacTab);
+        }
         pIfSender->MacAddr    = EthHdr.SrcMac;
 
         RTSpinlockRelease(pNetwork->hAddrSpinlock);
@@ -4065,8 +4259,11 @@ INTNETR0DECL(int) IntNetR0IfSend(INTNETIFHANDLE hIf, PSUPDRVSESSION pSession)
         if (RT_LIKELY(pDstTab))
         {
             /*
-             * Process the send buffer.
+             * Process the send buffer.  Receiver wakeups are deferred till
+             * we're done so a burst of frames only costs one wakeup per
+             * destination.
              */
+            pIf->fDeferWakeups = true;
             INTNETSWDECISION    enmSwDecision = INTNETSWDECISION_BROADCAST;
             INTNETSG            Sg; /** @todo this will have to be changed if we're going to use async sending
                                      * with buffer sharing for some OS or service. Darwin copies everything so
@@ -4120,6 +4317,9 @@ INTNETR0DECL(int) IntNetR0IfSend(INTNETIFHANDLE hIf, PSUPDRVSESSION pSession)
                 IntNetRingSkipFrame(&pIf->pIntBuf->Send);
             }
 
+            pIf->fDeferWakeups = false;
+            intnetR0IfFlushDeferredWakeups(pIf);
+
             /*
              * Put back the destination table.
              */
@@ -4342,6 +4542,8 @@ INTNETR0DECL(int) IntNetR0IfSetPromiscuousMode(INTNETIFHANDLE hIf, PSUPDRVSESSIO
                 }
                 Assert(pNetwork->MacTab.cPromiscuousEntries        <= pNetwork->MacTab.cEntries);
                 Assert(pNetwork->MacTab.cPromiscuousNoTrunkEntries <= pNetwork->MacTab.cEntries);
+
+                intnetR0MacTabRehash(&pNetwork->MacTab);
             }
         }
 
@@ -4419,7 +4621,10 @@ INTNETR0DECL(int) IntNetR0IfSetMacAddress(INTNETIFHANDLE hIf, PSUPDRVSESSION pSe
             /* Update the two copies. */
             PINTNETMACTABENTRY pEntry = intnetR0NetworkFindMacAddrEntry(pNetwork, pIf); Assert(pEntry);
             if (RT_LIKELY(pEntry))
+            {
                 pEntry->MacAddr = *pMac;
+                intnetR0MacTabRehash(&pNetwork->MacTab);
+            }
             pIf->MacAddr        = *pMac;
             pIf->fMacSet        = true;
 
@@ -4944,6 +5149,7 @@ static DECLCALLBACK(void) intnetR0IfDestruct(void *pvObj, void *pvUser1, void *p
                             &pNetwork->MacTab.paEntries[iIf + 1],
                             (pNetwork->MacTab.cEntries - iIf - 1) * sizeof(pNetwork->MacTab.paEntries[0]));
                 pNetwork->MacTab.cEntries--;
+                intnetR0MacTabRehash(&pNetwork->MacTab);
                 break;
             }
 
@@ -5128,6 +5334,8 @@ static int intnetR0NetworkCreateIf(PINTNETNETWORK pNetwork, PSUPDRVSESSION pSess
     pIf->cBusy              = 0;
     //pIf->pDstTab          = NULL;
     //pIf->pvIfData         = NULL;
+    //pIf->fDeferWakeups    = false;
+    //pIf->cDeferredWakeups = 0;
 
     for (int i = kIntNetAddrType_Invalid + 1; i < kIntNetAddrType_End && RT_SUCCESS(rc); i++)
         rc = intnetR0IfAddrCacheInit(&pIf->aAddrCache[i], (INTNETADDRTYPE)i,
@@ -5182,6 +5390,7 @@ static int intnetR0NetworkCreateIf(PINTNETNETWORK pNetwork, PSUPDRVSESSION pSess
                     pNetwork->MacTab.paEntries[iIf].pIf                  = pIf;
 
                     pNetwork->MacTab.cEntries = iIf + 1;
+                    intnetR0MacTabRehash(&pNetwork->MacTab);
                     pIf->pNetwork = pNetwork;
 
                     /*
@@ -5968,6 +6177,7 @@ static DECLCALLBACK(void) intnetR0NetworkDestruct(void *pvObj, void *pvUser1, vo
         {
             pIf->pNetwork = NULL;
             pNetwork->MacTab.cEntries--;
+            intnetR0MacTabRehash(&pNetwork->MacTab);
         }
     }
 
@@ -6169,6 +6379,8 @@ static int intnetR0AdaptOpenNetworkFlags(PINTNETNETWORK pNetwork, uint32_t fFlag
                     }
                 }
             }
+
+            intnetR0MacTabRehash(&pNetwork->MacTab);
         }
 
         RTSpinlockRelease(pNetwork->hAddrSpinlock);
@@ -6362,6 +6574,7 @@ static int intnetR0CreateNetwork(PINTNET pIntNet, PSUPDRVSESSION pSession, const
     pNetwork->MacTab.fWirePromiscuousEff    = false;
     pNetwork->MacTab.fWireActive            = false;
     pNetwork->MacTab.pTrunk                 = NULL;
+    intnetR0MacTabRehash(&pNetwork->MacTab);
     pNetwork->hEvtBusyIf                    = NIL_RTSEMEVENT;
     pNetwork->pIntNet                       = pIntNet;
     //pNetwork->pvObj                       = NULL;
@@ -34,6 +34,9 @@ int inet_aton(const char *cp, struct in_addr *ia);
 # include <sys/select.h>
 # include <poll.h>
 # include <arpa/inet.h>
+# ifdef VBOX_WITH_NAT_EPOLL
+#  include <sys/epoll.h>
+# endif
 #endif
 
 #include <VBox/types.h>
@@ -57,10 +60,14 @@ void slirp_link_down(PNATState);
 void slirp_select_fill(PNATState pData, int *pndfs);
 
 void slirp_select_poll(PNATState pData, int fTimeout);
-#else /* RT_OS_WINDOWS */
+#elif defined(VBOX_WITH_NAT_EPOLL)
+void slirp_select_fill(PNATState pData, int *pnfds);
+void slirp_select_poll(PNATState pData, struct epoll_event *paEvents, int cEvents);
+int slirp_get_epoll_fd(PNATState pData);
+#else /* !RT_OS_WINDOWS && !VBOX_WITH_NAT_EPOLL */
 void slirp_select_fill(PNATState pData, int *pnfds, struct pollfd *polls);
 void slirp_select_poll(PNATState pData, struct pollfd *polls, int ndfs);
-#endif /* !RT_OS_WINDOWS */
+#endif /* !RT_OS_WINDOWS && !VBOX_WITH_NAT_EPOLL */
 
 void slirp_input(PNATState pData, struct mbuf *m, size_t cbBuf);
 
@@ -71,7 +71,37 @@
 # include "resolv_conf_parser.h"
 #endif
 
-#ifndef RT_OS_WINDOWS
+#ifdef VBOX_WITH_NAT_EPOLL
+/*
+ * With epoll the fill pass only collects the wanted events per socket,
+ * slirpEpollSync pushes changes to the kernel.  The poll pass checks the
+ * events epoll_wait reported for the socket in the current round.
+ */
+# define DO_ENGAGE_EVENT1(so, fdset, label)                        \
+   do {                                                            \
+       (so)->so_poll_events |= N_(fdset ## _poll);                 \
+   } while (0)
+
+# define DO_ENGAGE_EVENT2(so, fdset1, fdset2, label)               \
+   do {                                                            \
+       (so)->so_poll_events |=                                     \
+           N_(fdset1 ## _poll) | N_(fdset2 ## _poll);              \
+   } while (0)
+
+# define DO_POLL_EVENTS(rc, error, so, events, label) do {} while (0)
+
+#  define DO_CHECK_FD_SET(so, events, fdset)                        \
+      (   ((so)->so_poll_gen == pData->uPollGen)                    \
+       && ((so)->so_poll_revents & N_(fdset ## _poll)))
+
+  /* specific for Windows Winsock API */
+# define DO_WIN_CHECK_FD_SET(so, events, fdset) 0
+
+/* epoll uses the poll event values on Linux, so the _poll names below serve both. */
+AssertCompile(EPOLLIN == POLLIN && EPOLLOUT == POLLOUT && EPOLLPRI == POLLPRI);
+AssertCompile(EPOLLERR == POLLERR && EPOLLHUP == POLLHUP);
+
+#elif !defined(RT_OS_WINDOWS)
 # define DO_ENGAGE_EVENT1(so, fdset, label)                        \
    do {                                                            \
        if (   so->so_poll_index != -1                              \
@@ -124,7 +154,9 @@
 
   /* specific for Windows Winsock API */
 # define DO_WIN_CHECK_FD_SET(so, events, fdset) 0
+#endif /* !RT_OS_WINDOWS && !VBOX_WITH_NAT_EPOLL */
 
+#ifndef RT_OS_WINDOWS
 # ifndef RT_OS_LINUX
 #  define readfds_poll   (POLLRDNORM)
 #  define writefds_poll  (POLLWRNORM)
@@ -295,6 +327,69 @@ static int slirpVerifyAndFreeSocket(PNATState pData, struct socket *pSocket)
     return 0;
 }
 
+#ifdef VBOX_WITH_NAT_EPOLL
+/**
+ * Brings the epoll registration of a socket in line with the events
+ * slirp_select_fill collected for it.  Only talks to the kernel when the
+ * wanted events changed.
+ * @returns 1 if the socket is registered for some events, 0 if not.
+ */
+static int slirpEpollSync(PNATState pData, struct socket *so)
+{
+    uint32_t fWanted = so->s != -1 ? so->so_poll_events : 0;
+    struct epoll_event Event;
+    int op;
+
+    /* The descriptor got closed (and dropped from the epoll set by the kernel). */
+    if (so->so_poll_registered && so->so_poll_fd != so->s)
+        so->so_poll_registered = 0;
+
+    if (fWanted == so->so_poll_registered)
+        return fWanted != 0;
+
+    RT_ZERO(Event);
+    Event.events = fWanted;
+    Event.data.ptr = so;
+    if (!so->so_poll_registered)
+        op = EPOLL_CTL_ADD;
+    else if (fWanted)
+        op = EPOLL_CTL_MOD;
+    else
+        op = EPOLL_CTL_DEL;
+
+    if (   epoll_ctl(pData->iEpollFd, op, so->s, &Event) == 0
+        || (   op == EPOLL_CTL_ADD
+            && errno == EEXIST
+            && epoll_ctl(pData->iEpollFd, EPOLL_CTL_MOD, so->s, &Event) == 0))
+    {
+        so->so_poll_registered = fWanted;
+        so->so_poll_fd = so->s;
+    }
+    else
+    {
+        Log(("NAT: epoll_ctl(%d) failed for %R[natsock]: %s\n", op, so, strerror(errno)));
+        so->so_poll_registered = 0;
+    }
+    return so->so_poll_registered != 0;
+}
+
+/**
+ * Drops the epoll registration of a socket which is about to be freed, so
+ * epoll_wait never hands out a pointer to it.
+ */
+void slirpEpollRemove(PNATState pData, struct socket *so)
+{
+    if (   so->so_poll_registered
+        && so->so_poll_fd == so->s)
+    {
+        struct epoll_event Event;
+        RT_ZERO(Event);
+        epoll_ctl(pData->iEpollFd, EPOLL_CTL_DEL, so->s, &Event); /* fails harmlessly if already closed */
+    }
+    so->so_poll_registered = 0;
+}
+#endif /* VBOX_WITH_NAT_EPOLL */
+
 int slirp_init(PNATState *ppData, uint32_t u32NetAddr, uint32_t u32Netmask,
                bool fPassDomain, bool fUseHostResolver, int i32AliasMode,
                int iIcmpCacheLimit, void *pvUser)
@@ -352,6 +447,17 @@ int slirp_init(PNATState *ppData, uint32_t u32NetAddr, uint32_t u32Netmask,
     }
     pData->phEvents[VBOX_SOCKET_EVENT_INDEX] = CreateEvent(NULL, FALSE, FALSE, NULL);
 #endif
+#ifdef VBOX_WITH_NAT_EPOLL
+    pData->iEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (pData->iEpollFd == -1)
+    {
+        rc = RTErrConvertFromErrno(errno);
+        LogRel(("NAT: epoll_create1 failed: %Rrc\n", rc));
+        RTMemFree(pData);
+        *ppData = NULL;
+        return rc;
+    }
+#endif
 
     rc = bootp_dhcp_init(pData);
     if (RT_FAILURE(rc))
@@ -573,6 +679,9 @@ void slirp_term(PNATState pData)
 #ifdef RT_OS_WINDOWS
     WSACleanup();
 #endif
+#ifdef VBOX_WITH_NAT_EPOLL
+    close(pData->iEpollFd);
+#endif
 #ifdef LOG_ENABLED
     Log(("\n"
          "NAT statistics\n"
@@ -618,11 +727,11 @@ static void updtime(PNATState pData)
 #endif
 }
 
-#ifdef RT_OS_WINDOWS
+#if defined(RT_OS_WINDOWS) || defined(VBOX_WITH_NAT_EPOLL)
 void slirp_select_fill(PNATState pData, int *pnfds)
-#else /* RT_OS_WINDOWS */
+#else /* !RT_OS_WINDOWS && !VBOX_WITH_NAT_EPOLL */
 void slirp_select_fill(PNATState pData, int *pnfds, struct pollfd *polls)
-#endif /* !RT_OS_WINDOWS */
+#endif /* !RT_OS_WINDOWS && !VBOX_WITH_NAT_EPOLL */
 {
     struct socket *so, *so_next;
     int nfds;
@@ -667,6 +776,9 @@ void slirp_select_fill(PNATState pData, int *pnfds, struct pollfd *polls)
     /* always add the ICMP socket */
 #ifndef RT_OS_WINDOWS
     pData->icmp_socket.so_poll_index = -1;
+#endif
+#ifdef VBOX_WITH_NAT_EPOLL
+    pData->icmp_socket.so_poll_events = 0;
 #endif
     ICMP_ENGAGE_EVENT(&pData->icmp_socket, readfds);
 
@@ -678,6 +790,9 @@ void slirp_select_fill(PNATState pData, int *pnfds, struct pollfd *polls)
         Assert(so->so_type == IPPROTO_TCP);
 #if !defined(RT_OS_WINDOWS)
         so->so_poll_index = -1;
+#endif
+#ifdef VBOX_WITH_NAT_EPOLL
+        so->so_poll_events = 0;
 #endif
         STAM_COUNTER_INC(&pData->StatTCP);
 #ifdef VBOX_WITH_NAT_UDP_SOCKET_CLONE
@@ -767,6 +882,9 @@ void slirp_select_fill(PNATState pData, int *pnfds, struct pollfd *polls)
 #if !defined(RT_OS_WINDOWS)
         so->so_poll_index = -1;
 #endif
+#ifdef VBOX_WITH_NAT_EPOLL
+        so->so_poll_events = 0;
+#endif
 
         /*
          * See if it's timed out
@@ -818,7 +936,35 @@ done:
 
 #if defined(RT_OS_WINDOWS)
     *pnfds = VBOX_EVENT_COUNT;
-#else /* RT_OS_WINDOWS */
+#elif defined(VBOX_WITH_NAT_EPOLL)
+    /*
+     * Push the changed interest to the kernel.  Sockets which were skipped
+     * above (or everything when the link is down) have no wanted events and
+     * get dropped from the epoll set.
+     */
+    NOREF(nfds);
+    if (!link_up)
+        pData->icmp_socket.so_poll_events = 0;
+    if (pData->icmp_socket.s != -1)
+        poll_index += slirpEpollSync(pData, &pData->icmp_socket);
+    for (so = tcb.so_next; so != &tcb; so = so->so_next)
+    {
+        if (!link_up)
+            so->so_poll_events = 0;
+        poll_index += slirpEpollSync(pData, so);
+    }
+    for (so = udb.so_next; so != &udb; so = so->so_next)
+    {
+        if (!link_up)
+            so->so_poll_events = 0;
+# ifdef VBOX_WITH_NAT_UDP_SOCKET_CLONE
+        if (so->so_cloneOf)
+            continue;   /* shares the descriptor of its master */
+# endif
+        poll_index += slirpEpollSync(pData, so);
+    }
+    *pnfds = poll_index;
+#else /* !RT_OS_WINDOWS && !VBOX_WITH_NAT_EPOLL */
     AssertRelease(poll_index <= *pnfds);
     *pnfds = poll_index;
 #endif /* !RT_OS_WINDOWS */
@@ -897,9 +1043,11 @@ static bool slirpConnectOrWrite(PNATState pData, struct socket *so, bool fConnec
 
 #if defined(RT_OS_WINDOWS)
 void slirp_select_poll(PNATState pData, int fTimeout)
-#else /* RT_OS_WINDOWS */
+#elif defined(VBOX_WITH_NAT_EPOLL)
+void slirp_select_poll(PNATState pData, struct epoll_event *paEvents, int cEvents)
+#else /* !RT_OS_WINDOWS && !VBOX_WITH_NAT_EPOLL */
 void slirp_select_poll(PNATState pData, struct pollfd *polls, int ndfs)
-#endif /* !RT_OS_WINDOWS */
+#endif /* !RT_OS_WINDOWS && !VBOX_WITH_NAT_EPOLL */
 {
     struct socket *so, *so_next;
     int ret;
@@ -911,6 +1059,26 @@ void slirp_select_poll(PNATState pData, struct pollfd *polls, int ndfs)
 
     STAM_PROFILE_START(&pData->StatPoll, a);
 
+#ifdef VBOX_WITH_NAT_EPOLL
+    /*
+     * Hand the reported events to their sockets before anything gets a
+     * chance to free a socket.  Entries without a socket belong to the caller.
+     */
+    pData->uPollGen++;
+    {
+        int i;
+        for (i = 0; i < cEvents; i++)
+        {
+            struct socket *pSo = (struct socket *)paEvents[i].data.ptr;
+            if (pSo)
+            {
+                pSo->so_poll_revents = paEvents[i].events;
+                pSo->so_poll_gen     = pData->uPollGen;
+            }
+        }
+    }
+#endif
+
     /* Update time */
     updtime(pData);
 
@@ -1659,6 +1827,17 @@ int slirp_get_nsock(PNATState pData)
 {
     return pData->nsock;
 }
+
+#ifdef VBOX_WITH_NAT_EPOLL
+/**
+ * Returns the epoll descriptor the caller should wait on.  The caller may add
+ * its own descriptors to it as long as data.ptr is NULL for them.
+ */
+int slirp_get_epoll_fd(PNATState pData)
+{
+    return pData->iEpollFd;
+}
+#endif
 #endif
 
 /*
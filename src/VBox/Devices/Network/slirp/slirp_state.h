@@ -196,6 +196,12 @@ typedef struct NATState
 #  define NSOCK_DEC_EX(ex) do {} while (0)
 # endif
 
+# ifdef VBOX_WITH_NAT_EPOLL
+    /* The epoll instance the sockets are registered with */
+    int iEpollFd;
+    /* Incremented for every epoll_wait round, see socket::so_poll_gen */
+    uint32_t uPollGen;
+# endif
     struct socket icmp_socket;
 # if !defined(RT_OS_WINDOWS)
     struct icmp_storage icmp_msg_head;
@@ -226,6 +226,9 @@ sofree(PNATState pData, struct socket *so)
         NSOCK_DEC();
     }
 
+#ifdef VBOX_WITH_NAT_EPOLL
+    slirpEpollRemove(pData, so);
+#endif
     RTMemFree(so);
     LogFlowFuncLeave();
 }
@@ -89,6 +89,18 @@ struct socket
 #ifndef RT_OS_WINDOWS
     int so_poll_index;
 #endif /* !RT_OS_WINDOWS */
+#ifdef VBOX_WITH_NAT_EPOLL
+    /* Events wanted for this socket, collected by slirp_select_fill */
+    uint32_t so_poll_events;
+    /* Events currently registered with the epoll instance, 0 if not registered */
+    uint32_t so_poll_registered;
+    /* The descriptor so_poll_registered applies to */
+    int so_poll_fd;
+    /* Events reported by the last epoll_wait, valid if so_poll_gen matches */
+    uint32_t so_poll_revents;
+    /* NATState::uPollGen value of the so_poll_revents report */
+    uint32_t so_poll_gen;
+#endif /* VBOX_WITH_NAT_EPOLL */
     /*
      * FD_CLOSE/POLLHUP event has been occurred on socket
      */
@@ -170,6 +182,9 @@ void so_init (void);
 struct socket * solookup (struct socket *, struct in_addr, u_int, struct in_addr, u_int);
 struct socket * socreate (void);
 void sofree (PNATState, struct socket *);
+#ifdef VBOX_WITH_NAT_EPOLL
+void slirpEpollRemove (PNATState, struct socket *);
+#endif
 int soread (PNATState, struct socket *);
 void sorecvoob (PNATState, struct socket *);
 int sosendoob (struct socket *);
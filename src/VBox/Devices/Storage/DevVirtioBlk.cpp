@@ -0,0 +1,1568 @@
+/* $Id$ */
+/** @file
+ * DevVirtioBlk - Virtio Block Device
+ */
+
+/*
+ * Copyright (C) 2009-2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#define LOG_GROUP LOG_GROUP_DEV_VIRTIO_BLK
+#include <VBox/vmm/pdmdev.h>
+#include <VBox/vmm/pdmstorageifs.h>
+#include <iprt/asm.h>
+#include <iprt/assert.h>
+#include <iprt/mem.h>
+#include <iprt/sg.h>
+#include <iprt/string.h>
+#include <iprt/uuid.h>
+#include "VBoxDD.h"
+#include "../VirtIO/Virtio.h"
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+#define INSTANCE(pThis) pThis->VPCI.szInstance
+
+#define VBLK_PCI_CLASS              0x0180
+#define VBLK_NAME_FMT               "VBlk%d"
+
+/** The maximum number of request queues (VBLK_F_MQ). */
+#define VBLK_MAX_QUEUES             16
+AssertCompile(VBLK_MAX_QUEUES <= VIRTIO_MAX_NQUEUES);
+/** The number of descriptors in each request queue. */
+#define VBLK_QUEUE_SIZE             256
+/** The maximum number of data segments per request, the header and the
+ * status byte take a descriptor each. */
+#define VBLK_SEG_MAX                (VBLK_QUEUE_SIZE - 2)
+/** The maximum number of ranges in a single discard request. */
+#define VBLK_DISCARD_SEG_MAX        64
+/** Requests are always addressed in 512 byte units, whatever the block size. */
+#define VBLK_SECTOR_SHIFT           9
+/** Length of the identification string returned by VBLK_T_GET_ID. */
+#define VBLK_ID_BYTES               20
+
+/** The current saved state version of the device. */
+#define VBLK_SAVEDSTATE_VERSION     2
+/** Saved state version 1, didn't store the virtio core version. */
+#define VBLK_SAVEDSTATE_VERSION_NO_CORE_VERSION 1
+/** The virtio core saved state version written by VBLK_SAVEDSTATE_VERSION_NO_CORE_VERSION. */
+#define VBLK_SAVEDSTATE_CORE_VERSION_V1 3
+/** Data segments kept in the request itself, longer chains use the heap. */
+#define VBLK_REQ_SEGS_INLINE        16
+
+/** @name Virtio block features
+ * @{  */
+#define VBLK_F_SIZE_MAX   0x00000002  /**< Maximum size of any single segment is in size_max */
+#define VBLK_F_SEG_MAX    0x00000004  /**< Maximum number of segments in a request is in seg_max */
+#define VBLK_F_GEOMETRY   0x00000010  /**< Disk-style geometry specified in geometry */
+#define VBLK_F_RO         0x00000020  /**< Device is read-only */
+#define VBLK_F_BLK_SIZE   0x00000040  /**< Block size of disk is in blk_size */
+#define VBLK_F_FLUSH      0x00000200  /**< Cache flush command support */
+#define VBLK_F_MQ         0x00001000  /**< Support more than one request queue */
+#define VBLK_F_DISCARD    0x00002000  /**< Discard command support */
+/** @} */
+
+/** @name Request types
+ * @{  */
+#define VBLK_T_IN         0
+#define VBLK_T_OUT        1
+#define VBLK_T_FLUSH      4
+#define VBLK_T_GET_ID     8
+#define VBLK_T_DISCARD    11
+/** @} */
+
+/** @name Request status
+ * @{  */
+#define VBLK_S_OK         0
+#define VBLK_S_IOERR      1
+#define VBLK_S_UNSUPP     2
+/** @} */
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+#pragma pack(1)
+struct VBlkPCIConfig
+{
+    uint64_t  uCapacity;                /**< Size in 512 byte sectors. */
+    uint32_t  uSizeMax;
+    uint32_t  uSegMax;
+    struct
+    {
+        uint16_t uCylinders;
+        uint8_t  uHeads;
+        uint8_t  uSectors;
+    } Geometry;
+    uint32_t  uBlkSize;
+    struct
+    {
+        uint8_t  uPhysicalBlockExp;
+        uint8_t  uAlignmentOffset;
+        uint16_t uMinIoSize;
+        uint32_t uOptIoSize;
+    } Topology;
+    uint8_t   uWriteback;
+    uint8_t   uUnused0;
+    uint16_t  uNumQueues;
+    uint32_t  uMaxDiscardSectors;
+    uint32_t  uMaxDiscardSeg;
+    uint32_t  uDiscardSectorAlignment;
+    uint32_t  uMaxWriteZeroesSectors;
+    uint32_t  uMaxWriteZeroesSeg;
+    uint8_t   uWriteZeroesMayUnmap;
+    uint8_t   abUnused1[3];
+};
+#pragma pack()
+AssertCompileSize(struct VBlkPCIConfig, 60);
+typedef struct VBlkPCIConfig VBLKPCICONFIG;
+typedef VBLKPCICONFIG *PVBLKPCICONFIG;
+
+/**
+ * The header leading every request.
+ */
+typedef struct VBlkReqHdr
+{
+    uint32_t u32Type;
+    uint32_t u32IoPrio;
+    uint64_t u64Sector;
+} VBLKREQHDR;
+AssertCompileSize(VBLKREQHDR, 16);
+
+/**
+ * A range in a discard request.
+ */
+typedef struct VBlkDiscardSeg
+{
+    uint64_t u64Sector;
+    uint32_t u32NumSectors;
+    uint32_t u32Flags;
+} VBLKDISCARDSEG;
+AssertCompileSize(VBLKDISCARDSEG, 16);
+
+/**
+ * A request queue.
+ */
+typedef struct VBLKQUEUE
+{
+    /** Serializes taking requests off and putting them back on the queue. */
+    PDMCRITSECT                 CritSect;
+    /** The virtqueue. */
+    R3PTRTYPE(PVQUEUE)          pQueue;
+    /** The queue index. */
+    uint16_t                    iQueue;
+    uint16_t                    au16Padding[3];
+
+    STAMCOUNTER                 StatRequests;
+} VBLKQUEUE;
+/** Pointer to a request queue. */
+typedef VBLKQUEUE *PVBLKQUEUE;
+
+/**
+ * Device state structure. Holds the current state of device.
+ *
+ * @extends     VPCISTATE
+ * @implements  PDMIMEDIAPORT
+ * @implements  PDMIMEDIAEXPORT
+ */
+typedef struct VBLKSTATE
+{
+    /* VPCISTATE must be the first member! */
+    VPCISTATE               VPCI;
+
+    /** The media port interface. */
+    PDMIMEDIAPORT           IPort;
+    /** The extended media port interface. */
+    PDMIMEDIAEXPORT         IMediaExPort;
+
+    /** Pointer to the attached driver's base interface. */
+    R3PTRTYPE(PPDMIBASE)    pDrvBase;
+    /** Pointer to the attached driver's media interface. */
+    R3PTRTYPE(PPDMIMEDIA)   pDrvMedia;
+    /** Pointer to the attached driver's extended media interface. */
+    R3PTRTYPE(PPDMIMEDIAEX) pDrvMediaEx;
+
+    /** The PCI config area holding the disk parameters. */
+    VBLKPCICONFIG           config;
+
+    /** The number of request queues. */
+    uint16_t                cQueues;
+    /** Whether the medium is read-only. */
+    bool                    fReadOnly;
+    /** Whether the driver below supports discarding. */
+    bool                    fDiscard;
+    /** Set when the device should notify PDM once the last request completed. */
+    bool volatile           fSignalIdle;
+    bool                    afPadding[3];
+    /** The number of requests being processed by the driver. */
+    uint32_t volatile       cReqsActive;
+    /** Incremented on every reset so that requests from before it are dropped. */
+    uint32_t volatile       uResetGen;
+    /** The identification string returned for VBLK_T_GET_ID. */
+    char                    szId[VBLK_ID_BYTES + 4];
+
+    /** Requests saved while suspended, resubmitted on resume (queue index
+     *  in the high, head descriptor index in the low word). */
+    R3PTRTYPE(uint32_t *)   pau32Redo;
+    /** Number of entries in pau32Redo. */
+    uint32_t                cRedo;
+    uint32_t                u32Padding;
+
+    STAMCOUNTER             StatReads;
+    STAMCOUNTER             StatWrites;
+    STAMCOUNTER             StatFlushes;
+    STAMCOUNTER             StatDiscards;
+    STAMCOUNTER             StatBytesRead;
+    STAMCOUNTER             StatBytesWritten;
+    STAMCOUNTER             StatReqsFailed;
+
+    /** The request queues. */
+    VBLKQUEUE               aQueues[VBLK_MAX_QUEUES];
+} VBLKSTATE;
+/** Pointer to a virtual block device state. */
+typedef VBLKSTATE *PVBLKSTATE;
+AssertCompileMemberAlignment(VBLKSTATE, aQueues, 8);
+
+/**
+ * The per request data, allocated by the driver along with its I/O request.
+ */
+typedef struct VBLKREQ
+{
+    /** The I/O request handle. */
+    PDMMEDIAEXIOREQ         hIoReq;
+    /** The queue the request came from. */
+    PVBLKQUEUE              pQueue;
+    /** Reset generation the request was submitted in. */
+    uint32_t                uResetGen;
+    /** Index of the head descriptor. */
+    uint16_t                uHeadIndex;
+    /** VBLK_T_XXX. */
+    uint32_t                u32Type;
+    /** The first sector. */
+    uint64_t                u64Sector;
+    /** Guest address of the status byte. */
+    RTGCPHYS                GCPhysStatus;
+    /** Number of data bytes described by paSegs. */
+    size_t                  cbData;
+    /** Number of bytes written to the guest, not counting the status byte. */
+    uint32_t                cbWritten;
+    /** Number of data segments. */
+    uint32_t                cSegs;
+    /** The data segments, either aSegsInline or allocated from the heap. */
+    VQUEUESEG              *paSegs;
+    /** Storage for short segment lists. */
+    VQUEUESEG               aSegsInline[VBLK_REQ_SEGS_INLINE];
+} VBLKREQ;
+/** Pointer to a request. */
+typedef VBLKREQ *PVBLKREQ;
+
+
+#ifndef VBOX_DEVICE_STRUCT_TESTCASE
+
+static DECLCALLBACK(uint32_t) vblkIoCb_GetHostFeatures(void *pvState)
+{
+    PVBLKSTATE pThis = (PVBLKSTATE)pvState;
+
+    /* We support:
+     * - Segment count limit
+     * - Disk geometry and block size reporting
+     * - Cache flushes
+     * - Read-only media
+     * - Discarding, if the medium supports it
+     * - Multiple request queues, if configured
+     */
+    return VBLK_F_SEG_MAX
+        | VBLK_F_GEOMETRY
+        | VBLK_F_BLK_SIZE
+        | VBLK_F_FLUSH
+        | (pThis->fReadOnly   ? VBLK_F_RO : 0)
+        | (pThis->fDiscard    ? VBLK_F_DISCARD : 0)
+        | (pThis->cQueues > 1 ? VBLK_F_MQ : 0);
+}
+
+static DECLCALLBACK(uint32_t) vblkIoCb_GetHostMinimalFeatures(void *pvState)
+{
+    RT_NOREF_PV(pvState);
+    return 0;
+}
+
+static DECLCALLBACK(void) vblkIoCb_SetHostFeatures(void *pvState, uint32_t fFeatures)
+{
+    PVBLKSTATE pThis = (PVBLKSTATE)pvState;
+    LogFlow(("%s vblkIoCb_SetHostFeatures: uFeatures=%x\n", INSTANCE(pThis), fFeatures));
+    RT_NOREF2(pThis, fFeatures);
+}
+
+static DECLCALLBACK(int) vblkIoCb_GetConfig(void *pvState, uint32_t offCfg, uint32_t cb, void *data)
+{
+    PVBLKSTATE pThis = (PVBLKSTATE)pvState;
+    if (offCfg + cb > sizeof(struct VBlkPCIConfig))
+    {
+        Log(("%s vblkIoCb_GetConfig: Read beyond the config structure is attempted (offCfg=%#x cb=%x).\n", INSTANCE(pThis), offCfg, cb));
+        return VERR_IOM_IOPORT_UNUSED;
+    }
+    memcpy(data, (uint8_t *)&pThis->config + offCfg, cb);
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(int) vblkIoCb_SetConfig(void *pvState, uint32_t offCfg, uint32_t cb, void *data)
+{
+    /* Nothing in the config space is writable without VIRTIO_BLK_F_CONFIG_WCE. */
+    PVBLKSTATE pThis = (PVBLKSTATE)pvState;
+    Log(("%s vblkIoCb_SetConfig: Ignoring write to the config structure (offCfg=%#x cb=%x).\n", INSTANCE(pThis), offCfg, cb));
+    RT_NOREF3(pThis, data, cb);
+    return VINF_SUCCESS;
+}
+
+/**
+ * Hardware reset. Revert all registers to initial values.
+ *
+ * Requests still being processed by the driver are cancelled, completions
+ * arriving afterwards are dropped as they refer to the old queues.
+ *
+ * @param   pThis      The device state structure.
+ */
+static DECLCALLBACK(int) vblkIoCb_Reset(void *pvState)
+{
+    PVBLKSTATE pThis = (PVBLKSTATE)pvState;
+    Log(("%s Reset triggered\n", INSTANCE(pThis)));
+
+    for (unsigned i = 0; i < pThis->cQueues; i++)
+        PDMCritSectEnter(&pThis->aQueues[i].CritSect, VERR_IGNORED);
+
+    ASMAtomicIncU32(&pThis->uResetGen);
+    vpciReset(&pThis->VPCI);
+
+    for (unsigned i = 0; i < pThis->cQueues; i++)
+        PDMCritSectLeave(&pThis->aQueues[i].CritSect);
+
+    if (pThis->pDrvMediaEx)
+        pThis->pDrvMediaEx->pfnIoReqCancelAll(pThis->pDrvMediaEx);
+
+    if (pThis->pau32Redo)
+    {
+        RTMemFree(pThis->pau32Redo);
+        pThis->pau32Redo = NULL;
+        pThis->cRedo     = 0;
+    }
+    return VINF_SUCCESS;
+}
+
+/**
+ * This function is called when the driver becomes ready.
+ *
+ * @param   pThis      The device state structure.
+ */
+static DECLCALLBACK(void) vblkIoCb_Ready(void *pvState)
+{
+    PVBLKSTATE pThis = (PVBLKSTATE)pvState;
+    Log(("%s Driver became ready\n", INSTANCE(pThis)));
+    RT_NOREF(pThis);
+}
+
+
+/**
+ * I/O port callbacks.
+ */
+static const VPCIIOCALLBACKS g_IOCallbacks =
+{
+     vblkIoCb_GetHostFeatures,
+     vblkIoCb_GetHostMinimalFeatures,
+     vblkIoCb_SetHostFeatures,
+     vblkIoCb_GetConfig,
+     vblkIoCb_SetConfig,
+     vblkIoCb_Reset,
+     vblkIoCb_Ready,
+};
+
+
+/**
+ * @callback_method_impl{FNIOMIOPORTIN}
+ */
+static DECLCALLBACK(int) vblkIOPortIn(PPDMDEVINS pDevIns, void *pvUser, RTIOPORT port, uint32_t *pu32, unsigned cb)
+{
+    return vpciIOPortIn(pDevIns, pvUser, port, pu32, cb, &g_IOCallbacks);
+}
+
+
+/**
+ * @callback_method_impl{FNIOMIOPORTOUT}
+ */
+static DECLCALLBACK(int) vblkIOPortOut(PPDMDEVINS pDevIns, void *pvUser, RTIOPORT port, uint32_t u32, unsigned cb)
+{
+    return vpciIOPortOut(pDevIns, pvUser, port, u32, cb, &g_IOCallbacks);
+}
+
+
+/* -=-=-=-=- Request processing -=-=-=-=- */
+
+/**
+ * Copies between the data segments of a request and an S/G buffer.
+ *
+ * @returns Number of bytes copied.
+ * @param   pThis       The device state structure.
+ * @param   pReq        The request.
+ * @param   off         Offset into the request data to start at.
+ * @param   pSgBuf      The S/G buffer to copy from or to.
+ * @param   cbCopy      Number of bytes to copy.
+ * @param   fToGuest    Whether to copy into guest memory.
+ */
+static size_t vblkR3ReqCopySgBuf(PVBLKSTATE pThis, PVBLKREQ pReq, size_t off, PRTSGBUF pSgBuf,
+                                 size_t cbCopy, bool fToGuest)
+{
+    PPDMDEVINS pDevIns = pThis->VPCI.CTX_SUFF(pDevIns);
+    size_t     cbLeft  = cbCopy;
+
+    for (uint32_t i = 0; i < pReq->cSegs && cbLeft; i++)
+    {
+        VQUEUESEG *pSeg = &pReq->paSegs[i];
+        if (off >= pSeg->cb)
+        {
+            off -= pSeg->cb;
+            continue;
+        }
+
+        RTGCPHYS GCPhys = pSeg->addr + off;
+        size_t   cbSeg  = RT_MIN(pSeg->cb - off, cbLeft);
+        off     = 0;
+        cbLeft -= cbSeg;
+        while (cbSeg)
+        {
+            size_t cbBuf = cbSeg;
+            void  *pvBuf = RTSgBufGetNextSegment(pSgBuf, &cbBuf);
+            if (RT_UNLIKELY(!pvBuf))
+                return cbCopy - cbLeft - cbSeg;
+
+            if (fToGuest)
+                PDMDevHlpPCIPhysWrite(pDevIns, GCPhys, pvBuf, cbBuf);
+            else
+                PDMDevHlpPCIPhysRead(pDevIns, GCPhys, pvBuf, cbBuf);
+            GCPhys += cbBuf;
+            cbSeg  -= cbBuf;
+        }
+    }
+
+    return cbCopy - cbLeft;
+}
+
+/**
+ * Copies @a cb bytes from guest memory described by a segment list.
+ *
+ * @returns Number of bytes copied.
+ * @param   pThis       The device state structure.
+ * @param   paSegs      The segments.
+ * @param   cSegs       Number of segments.
+ * @param   pv          Where to store the data.
+ * @param   cb          Number of bytes to copy.
+ */
+static size_t vblkR3SegsRead(PVBLKSTATE pThis, VQUEUESEG const *paSegs, uint32_t cSegs, void *pv, size_t cb)
+{
+    uint8_t *pb    = (uint8_t *)pv;
+    size_t   cbRead = 0;
+    for (uint32_t i = 0; i < cSegs && cbRead < cb; i++)
+    {
+        size_t cbThis = RT_MIN(paSegs[i].cb, cb - cbRead);
+        PDMDevHlpPhysRead(pThis->VPCI.CTX_SUFF(pDevIns), paSegs[i].addr, pb + cbRead, cbThis);
+        cbRead += cbThis;
+    }
+    return cbRead;
+}
+
+/**
+ * Hands a request's descriptor chain back to the guest.
+ *
+ * @param   pThis       The device state structure.
+ * @param   pQueue      The queue the chain came from.
+ * @param   uHeadIndex  Index of the head descriptor.
+ * @param   GCPhysStatus Guest address of the status byte, NIL_RTGCPHYS if
+ *                      the chain has none.
+ * @param   u8Status    The status to report.
+ * @param   cbWritten   Number of data bytes written to the guest.
+ * @param   uResetGen   Reset generation the chain was taken off the queue in.
+ */
+static void vblkR3CompleteChain(PVBLKSTATE pThis, PVBLKQUEUE pQueue, uint16_t uHeadIndex, RTGCPHYS GCPhysStatus,
+                                uint8_t u8Status, uint32_t cbWritten, uint32_t uResetGen)
+{
+    PDMCritSectEnter(&pQueue->CritSect, VERR_IGNORED);
+    if (uResetGen == ASMAtomicReadU32(&pThis->uResetGen))
+    {
+        uint32_t cbUsed = 0;
+        if (GCPhysStatus != NIL_RTGCPHYS)
+        {
+            PDMDevHlpPCIPhysWrite(pThis->VPCI.CTX_SUFF(pDevIns), GCPhysStatus, &u8Status, sizeof(u8Status));
+            cbUsed = cbWritten + sizeof(u8Status);
+        }
+        vqueuePutIndex(&pThis->VPCI, pQueue->pQueue, uHeadIndex, cbUsed);
+        vqueueSync(&pThis->VPCI, pQueue->pQueue);
+    }
+    else
+        Log(("%s vblkR3CompleteChain: Dropping request %u completed after a reset\n", INSTANCE(pThis), uHeadIndex));
+    PDMCritSectLeave(&pQueue->CritSect);
+
+    if (u8Status != VBLK_S_OK)
+        STAM_REL_COUNTER_INC(&pThis->StatReqsFailed);
+}
+
+/**
+ * Completes a request and frees it.
+ *
+ * @param   pThis       The device state structure.
+ * @param   pReq        The request.
+ * @param   u8Status    The status to report, VBLK_S_XXX.
+ */
+static void vblkR3ReqComplete(PVBLKSTATE pThis, PVBLKREQ pReq, uint8_t u8Status)
+{
+    Log2(("%s vblkR3ReqComplete: type=%u sector=%llu cb=%zu status=%u\n", INSTANCE(pThis),
+          pReq->u32Type, pReq->u64Sector, pReq->cbData, u8Status));
+
+    if (pReq->u32Type == VBLK_T_IN)
+    {
+        vpciSetReadLed(&pThis->VPCI, false);
+        if (u8Status == VBLK_S_OK)
+        {
+            pReq->cbWritten = (uint32_t)pReq->cbData;
+            STAM_REL_COUNTER_ADD(&pThis->StatBytesRead, pReq->cbData);
+        }
+    }
+    else if (pReq->u32Type == VBLK_T_OUT)
+    {
+        vpciSetWriteLed(&pThis->VPCI, false);
+        if (u8Status == VBLK_S_OK)
+            STAM_REL_COUNTER_ADD(&pThis->StatBytesWritten, pReq->cbData);
+    }
+    if (u8Status != VBLK_S_OK)
+        pReq->cbWritten = 0;
+
+    vblkR3CompleteChain(pThis, pReq->pQueue, pReq->uHeadIndex, pReq->GCPhysStatus,
+                        u8Status, pReq->cbWritten, pReq->uResetGen);
+
+    if (pReq->paSegs != &pReq->aSegsInline[0])
+        RTMemFree(pReq->paSegs);
+    pReq->paSegs = NULL;
+
+    int rc = pThis->pDrvMediaEx->pfnIoReqFree(pThis->pDrvMediaEx, pReq->hIoReq);
+    AssertRC(rc);
+
+    uint32_t cReqsActive = ASMAtomicDecU32(&pThis->cReqsActive);
+    if (!cReqsActive && pThis->fSignalIdle)
+        PDMDevHlpAsyncNotificationCompleted(pThis->VPCI.CTX_SUFF(pDevIns));
+}
+
+/**
+ * Parses the descriptor chain of a request into the request structure.
+ *
+ * The header is taken from the start of the device-readable part, the status
+ * byte from the end of the device-writable part. Whatever is in between
+ * makes up the data segments of the request.
+ *
+ * @returns VBLK_S_OK if the request can be processed, the status to report
+ *          otherwise.
+ * @param   pThis       The device state structure.
+ * @param   pReq        The request, pReq->GCPhysStatus is set to NIL_RTGCPHYS
+ *                      if there is no room for a status byte.
+ * @param   pElem       The descriptor chain.
+ */
+static uint8_t vblkR3ReqParse(PVBLKSTATE pThis, PVBLKREQ pReq, PVQUEUEELEM pElem)
+{
+    pReq->GCPhysStatus = NIL_RTGCPHYS;
+    pReq->cbData       = 0;
+    pReq->cbWritten    = 0;
+    pReq->cSegs        = 0;
+    pReq->paSegs       = &pReq->aSegsInline[0];
+    pReq->u32Type      = UINT32_MAX;
+    pReq->u64Sector    = 0;
+
+    if (!pElem->nIn || !pElem->aSegsIn[pElem->nIn - 1].cb)
+    {
+        Log(("%s vblkR3ReqParse: Request %u has no room for the status\n", INSTANCE(pThis), pElem->uIndex));
+        return VBLK_S_IOERR;
+    }
+    VQUEUESEG *pSegStatus = &pElem->aSegsIn[pElem->nIn - 1];
+    pReq->GCPhysStatus = pSegStatus->addr + pSegStatus->cb - 1;
+
+    VBLKREQHDR Hdr;
+    if (vblkR3SegsRead(pThis, pElem->aSegsOut, pElem->nOut, &Hdr, sizeof(Hdr)) != sizeof(Hdr))
+    {
+        Log(("%s vblkR3ReqParse: Request %u has a truncated header\n", INSTANCE(pThis), pElem->uIndex));
+        return VBLK_S_IOERR;
+    }
+    pReq->u32Type   = Hdr.u32Type;
+    pReq->u64Sector = Hdr.u64Sector;
+
+    /* Pick the data segments, device-readable ones minus the header for requests
+       carrying data to the device, device-writable ones minus the status for the rest. */
+    VQUEUESEG *paSrc;
+    uint32_t   cSrc;
+    uint32_t   offSkip = 0;
+    uint32_t   cbTrim  = 0;
+    if (   Hdr.u32Type == VBLK_T_OUT
+        || Hdr.u32Type == VBLK_T_DISCARD)
+    {
+        paSrc   = pElem->aSegsOut;
+        cSrc    = pElem->nOut;
+        offSkip = sizeof(Hdr);
+    }
+    else
+    {
+        paSrc   = pElem->aSegsIn;
+        cSrc    = pElem->nIn;
+        cbTrim  = 1;
+    }
+
+    if (cSrc > VBLK_REQ_SEGS_INLINE)
+    {
+        pReq->paSegs = (VQUEUESEG *)RTMemAlloc(cSrc * sizeof(VQUEUESEG));
+        if (!pReq->paSegs)
+        {
+            pReq->paSegs = &pReq->aSegsInline[0];
+            return VBLK_S_IOERR;
+        }
+    }
+
+    for (uint32_t i = 0; i < cSrc; i++)
+    {
+        RTGCPHYS GCPhys = paSrc[i].addr;
+        uint32_t cb     = paSrc[i].cb;
+        if (offSkip)
+        {
+            uint32_t cbSkip = RT_MIN(offSkip, cb);
+            GCPhys  += cbSkip;
+            cb      -= cbSkip;
+            offSkip -= cbSkip;
+        }
+        if (cbTrim && i == cSrc - 1)
+            cb -= cbTrim;
+        if (!cb)
+            continue;
+
+        VQUEUESEG *pSeg = &pReq->paSegs[pReq->cSegs++];
+        pSeg->addr = GCPhys;
+        pSeg->cb   = cb;
+        pSeg->pv   = NULL;
+        pReq->cbData += cb;
+    }
+
+    return VBLK_S_OK;
+}
+
+/**
+ * Processes a request taken off a queue.
+ *
+ * @param   pThis       The device state structure.
+ * @param   pQueue      The queue the request came from.
+ * @param   pElem       The descriptor chain of the request.
+ * @param   uResetGen   Reset generation the chain was taken off the queue in.
+ */
+static void vblkR3ReqSubmit(PVBLKSTATE pThis, PVBLKQUEUE pQueue, PVQUEUEELEM pElem, uint32_t uResetGen)
+{
+    PDMMEDIAEXIOREQ hIoReq = NULL;
+    PVBLKREQ        pReq   = NULL;
+    int rc = pThis->pDrvMediaEx->pfnIoReqAlloc(pThis->pDrvMediaEx, &hIoReq, (void **)&pReq,
+                                               RT_MAKE_U32(pElem->uIndex, pQueue->iQueue),
+                                               PDMIMEDIAEX_F_SUSPEND_ON_RECOVERABLE_ERR);
+    if (RT_FAILURE(rc))
+    {
+        /* Fail the request right away, the status byte ends the device-writable part. */
+        LogRel(("%s: Failed to allocate an I/O request (%Rrc)\n", INSTANCE(pThis), rc));
+        RTGCPHYS GCPhysStatus = NIL_RTGCPHYS;
+        if (pElem->nIn && pElem->aSegsIn[pElem->nIn - 1].cb)
+            GCPhysStatus = pElem->aSegsIn[pElem->nIn - 1].addr + pElem->aSegsIn[pElem->nIn - 1].cb - 1;
+        vblkR3CompleteChain(pThis, pQueue, pElem->uIndex, GCPhysStatus, VBLK_S_IOERR, 0, uResetGen);
+        return;
+    }
+
+    ASMAtomicIncU32(&pThis->cReqsActive);
+    STAM_REL_COUNTER_INC(&pQueue->StatRequests);
+
+    pReq->hIoReq     = hIoReq;
+    pReq->pQueue     = pQueue;
+    pReq->uHeadIndex = pElem->uIndex;
+    pReq->uResetGen  = uResetGen;
+
+    uint8_t u8Status = vblkR3ReqParse(pThis, pReq, pElem);
+    if (u8Status == VBLK_S_OK)
+    {
+        uint64_t const off        = pReq->u64Sector << VBLK_SECTOR_SHIFT;
+        uint64_t const cSectors   = pThis->config.uCapacity;
+        bool const     fInRange   =    !(pReq->cbData & ((1 << VBLK_SECTOR_SHIFT) - 1))
+                                    && pReq->u64Sector <= cSectors
+                                    && (pReq->cbData >> VBLK_SECTOR_SHIFT) <= cSectors - pReq->u64Sector;
+
+        Log2(("%s vblkR3ReqSubmit: %s type=%u sector=%llu cb=%zu segs=%u\n", INSTANCE(pThis),
+              QUEUENAME(&pThis->VPCI, pQueue->pQueue), pReq->u32Type, pReq->u64Sector, pReq->cbData, pReq->cSegs));
+
+        rc = VERR_NOT_SUPPORTED;
+        switch (pReq->u32Type)
+        {
+            case VBLK_T_IN:
+                STAM_REL_COUNTER_INC(&pThis->StatReads);
+                if (!fInRange)
+                {
+                    rc = VERR_OUT_OF_RANGE;
+                    break;
+                }
+                vpciSetReadLed(&pThis->VPCI, true);
+                rc = pThis->pDrvMediaEx->pfnIoReqRead(pThis->pDrvMediaEx, hIoReq, off, pReq->cbData);
+                break;
+            case VBLK_T_OUT:
+                STAM_REL_COUNTER_INC(&pThis->StatWrites);
+                if (!fInRange || pThis->fReadOnly)
+                {
+                    rc = pThis->fReadOnly ? VERR_WRITE_PROTECT : VERR_OUT_OF_RANGE;
+                    break;
+                }
+                vpciSetWriteLed(&pThis->VPCI, true);
+                rc = pThis->pDrvMediaEx->pfnIoReqWrite(pThis->pDrvMediaEx, hIoReq, off, pReq->cbData);
+                break;
+            case VBLK_T_FLUSH:
+                STAM_REL_COUNTER_INC(&pThis->StatFlushes);
+                rc = pThis->pDrvMediaEx->pfnIoReqFlush(pThis->pDrvMediaEx, hIoReq);
+                break;
+            case VBLK_T_DISCARD:
+            {
+                STAM_REL_COUNTER_INC(&pThis->StatDiscards);
+                uint32_t const cRanges = (uint32_t)(pReq->cbData / sizeof(VBLKDISCARDSEG));
+                if (!pThis->fDiscard || pThis->fReadOnly)
+                    u8Status = VBLK_S_UNSUPP;
+                else if (   !cRanges
+                         || cRanges > VBLK_DISCARD_SEG_MAX
+                         || pReq->cbData % sizeof(VBLKDISCARDSEG))
+                    rc = VERR_INVALID_PARAMETER;
+                else
+                    rc = pThis->pDrvMediaEx->pfnIoReqDiscard(pThis->pDrvMediaEx, hIoReq, cRanges);
+                break;
+            }
+            case VBLK_T_GET_ID:
+            {
+                RTSGSEG Seg;
+                RTSGBUF SgBuf;
+                Seg.pvSeg = pThis->szId;
+                Seg.cbSeg = RT_MIN(pReq->cbData, VBLK_ID_BYTES);
+                RTSgBufInit(&SgBuf, &Seg, 1);
+                pReq->cbWritten = (uint32_t)vblkR3ReqCopySgBuf(pThis, pReq, 0, &SgBuf, Seg.cbSeg, true /*fToGuest*/);
+                rc = VINF_SUCCESS;
+                break;
+            }
+            default:
+                Log(("%s vblkR3ReqSubmit: Unsupported request type %u\n", INSTANCE(pThis), pReq->u32Type));
+                u8Status = VBLK_S_UNSUPP;
+                break;
+        }
+
+        if (rc == VINF_PDM_MEDIAEX_IOREQ_IN_PROGRESS)
+            return;
+        if (u8Status == VBLK_S_OK && RT_FAILURE(rc))
+        {
+            Log(("%s vblkR3ReqSubmit: Request %u failed with %Rrc\n", INSTANCE(pThis), pReq->uHeadIndex, rc));
+            u8Status = VBLK_S_IOERR;
+        }
+    }
+
+    vblkR3ReqComplete(pThis, pReq, u8Status);
+}
+
+/**
+ * Takes all available requests off a queue and hands them to the driver.
+ *
+ * @param   pThis       The device state structure.
+ * @param   pQueue      The request queue.
+ */
+static void vblkR3ProcessQueue(PVBLKSTATE pThis, PVBLKQUEUE pQueue)
+{
+    VQUEUEELEM elem;
+
+    for (;;)
+    {
+        PDMCritSectEnter(&pQueue->CritSect, VERR_IGNORED);
+        uint32_t const uResetGen = ASMAtomicReadU32(&pThis->uResetGen);
+        bool const     fGot      = vqueueGet(&pThis->VPCI, pQueue->pQueue, &elem);
+        PDMCritSectLeave(&pQueue->CritSect);
+        if (!fGot)
+            break;
+
+        vblkR3ReqSubmit(pThis, pQueue, &elem, uResetGen);
+    }
+}
+
+/**
+ * Queue notification callback, the guest made new requests available.
+ *
+ * @param   pvState     The device state structure.
+ * @param   pQueue      The virtqueue.
+ * @thread  EMT
+ */
+static DECLCALLBACK(void) vblkR3QueueNotify(void *pvState, PVQUEUE pQueue)
+{
+    PVBLKSTATE pThis  = (PVBLKSTATE)pvState;
+    uint32_t   iQueue = (uint32_t)(pQueue - &pThis->VPCI.Queues[0]);
+    AssertReturnVoid(iQueue < pThis->cQueues);
+
+    vblkR3ProcessQueue(pThis, &pThis->aQueues[iQueue]);
+}
+
+/**
+ * Resubmits the requests which were suspended when the state was saved.
+ *
+ * @param   pThis       The device state structure.
+ */
+static void vblkR3RedoRequests(PVBLKSTATE pThis)
+{
+    uint32_t *pau32Redo = pThis->pau32Redo;
+    uint32_t  cRedo     = pThis->cRedo;
+    pThis->pau32Redo = NULL;
+    pThis->cRedo     = 0;
+
+    VQUEUEELEM elem;
+    for (uint32_t i = 0; i < cRedo; i++)
+    {
+        PVBLKQUEUE pQueue = &pThis->aQueues[RT_HI_U16(pau32Redo[i])];
+        vqueueReadChain(&pThis->VPCI, pQueue->pQueue, RT_LO_U16(pau32Redo[i]), &elem);
+        vblkR3ReqSubmit(pThis, pQueue, &elem, ASMAtomicReadU32(&pThis->uResetGen));
+    }
+    RTMemFree(pau32Redo);
+
+    /* Pick up whatever the guest queued meanwhile. */
+    for (unsigned i = 0; i < pThis->cQueues; i++)
+        if (vqueueIsReady(&pThis->VPCI, pThis->aQueues[i].pQueue))
+            vblkR3ProcessQueue(pThis, &pThis->aQueues[i]);
+}
+
+
+/* -=-=-=-=- PDMIMEDIAPORT / PDMIMEDIAEXPORT -=-=-=-=- */
+
+/**
+ * @interface_method_impl{PDMIMEDIAPORT,pfnQueryDeviceLocation}
+ */
+static DECLCALLBACK(int) vblkR3QueryDeviceLocation(PPDMIMEDIAPORT pInterface, const char **ppcszController,
+                                                   uint32_t *piInstance, uint32_t *piLUN)
+{
+    PVBLKSTATE pThis   = RT_FROM_MEMBER(pInterface, VBLKSTATE, IPort);
+    PPDMDEVINS pDevIns = pThis->VPCI.CTX_SUFF(pDevIns);
+
+    AssertPtrReturn(ppcszController, VERR_INVALID_POINTER);
+    AssertPtrReturn(piInstance, VERR_INVALID_POINTER);
+    AssertPtrReturn(piLUN, VERR_INVALID_POINTER);
+
+    *ppcszController = pDevIns->pReg->szName;
+    *piInstance      = pDevIns->iInstance;
+    *piLUN           = 0;
+
+    return VINF_SUCCESS;
+}
+
+/**
+ * @interface_method_impl{PDMIMEDIAEXPORT,pfnIoReqCopyFromBuf}
+ */
+static DECLCALLBACK(int) vblkR3IoReqCopyFromBuf(PPDMIMEDIAEXPORT pInterface, PDMMEDIAEXIOREQ hIoReq,
+                                                void *pvIoReqAlloc, uint32_t offDst, PRTSGBUF pSgBuf,
+                                                size_t cbCopy)
+{
+    RT_NOREF1(hIoReq);
+    PVBLKSTATE pThis = RT_FROM_MEMBER(pInterface, VBLKSTATE, IMediaExPort);
+    PVBLKREQ   pReq  = (PVBLKREQ)pvIoReqAlloc;
+
+    size_t cbCopied = vblkR3ReqCopySgBuf(pThis, pReq, offDst, pSgBuf, cbCopy, true /*fToGuest*/);
+    return cbCopied == cbCopy ? VINF_SUCCESS : VERR_PDM_MEDIAEX_IOBUF_OVERFLOW;
+}
+
+/**
+ * @interface_method_impl{PDMIMEDIAEXPORT,pfnIoReqCopyToBuf}
+ */
+static DECLCALLBACK(int) vblkR3IoReqCopyToBuf(PPDMIMEDIAEXPORT pInterface, PDMMEDIAEXIOREQ hIoReq,
+                                              void *pvIoReqAlloc, uint32_t offSrc, PRTSGBUF pSgBuf,
+                                              size_t cbCopy)
+{
+    RT_NOREF1(hIoReq);
+    PVBLKSTATE pThis = RT_FROM_MEMBER(pInterface, VBLKSTATE, IMediaExPort);
+    PVBLKREQ   pReq  = (PVBLKREQ)pvIoReqAlloc;
+
+    size_t cbCopied = vblkR3ReqCopySgBuf(pThis, pReq, offSrc, pSgBuf, cbCopy, false /*fToGuest*/);
+    return cbCopied == cbCopy ? VINF_SUCCESS : VERR_PDM_MEDIAEX_IOBUF_UNDERRUN;
+}
+
+/**
+ * @interface_method_impl{PDMIMEDIAEXPORT,pfnIoReqQueryDiscardRanges}
+ */
+static DECLCALLBACK(int) vblkR3IoReqQueryDiscardRanges(PPDMIMEDIAEXPORT pInterface, PDMMEDIAEXIOREQ hIoReq,
+                                                       void *pvIoReqAlloc, uint32_t idxRangeStart,
+                                                       uint32_t cRanges, PRTRANGE paRanges,
+                                                       uint32_t *pcRanges)
+{
+    RT_NOREF1(hIoReq);
+    PVBLKSTATE     pThis        = RT_FROM_MEMBER(pInterface, VBLKSTATE, IMediaExPort);
+    PVBLKREQ       pReq         = (PVBLKREQ)pvIoReqAlloc;
+    uint32_t const cRangesTotal = (uint32_t)(pReq->cbData / sizeof(VBLKDISCARDSEG));
+
+    uint32_t i;
+    for (i = 0; i < cRanges && idxRangeStart + i < cRangesTotal; i++)
+    {
+        VBLKDISCARDSEG Seg;
+        RTSGSEG        SgSeg;
+        RTSGBUF        SgBuf;
+        SgSeg.pvSeg = &Seg;
+        SgSeg.cbSeg = sizeof(Seg);
+        RTSgBufInit(&SgBuf, &SgSeg, 1);
+        if (vblkR3ReqCopySgBuf(pThis, pReq, (idxRangeStart + i) * sizeof(Seg), &SgBuf, sizeof(Seg),
+                               false /*fToGuest*/) != sizeof(Seg))
+            return VERR_PDM_MEDIAEX_IOBUF_UNDERRUN;
+
+        if (   Seg.u64Sector > pThis->config.uCapacity
+            || Seg.u32NumSectors > pThis->config.uCapacity - Seg.u64Sector)
+            return VERR_OUT_OF_RANGE;
+
+        paRanges[i].offStart = Seg.u64Sector << VBLK_SECTOR_SHIFT;
+        paRanges[i].cbRange  = (size_t)Seg.u32NumSectors << VBLK_SECTOR_SHIFT;
+    }
+
+    *pcRanges = i;
+    return VINF_SUCCESS;
+}
+
+/**
+ * @interface_method_impl{PDMIMEDIAEXPORT,pfnIoReqCompleteNotify}
+ */
+static DECLCALLBACK(int) vblkR3IoReqCompleteNotify(PPDMIMEDIAEXPORT pInterface, PDMMEDIAEXIOREQ hIoReq,
+                                                   void *pvIoReqAlloc, int rcReq)
+{
+    RT_NOREF(hIoReq);
+    PVBLKSTATE pThis = RT_FROM_MEMBER(pInterface, VBLKSTATE, IMediaExPort);
+    PVBLKREQ   pReq  = (PVBLKREQ)pvIoReqAlloc;
+
+    if (RT_FAILURE(rcReq))
+        Log(("%s vblkR3IoReqCompleteNotify: Request %u failed with %Rrc\n", INSTANCE(pThis), pReq->uHeadIndex, rcReq));
+    vblkR3ReqComplete(pThis, pReq, RT_SUCCESS(rcReq) ? VBLK_S_OK : VBLK_S_IOERR);
+    return VINF_SUCCESS;
+}
+
+/**
+ * @interface_method_impl{PDMIMEDIAEXPORT,pfnIoReqStateChanged}
+ */
+static DECLCALLBACK(void) vblkR3IoReqStateChanged(PPDMIMEDIAEXPORT pInterface, PDMMEDIAEXIOREQ hIoReq,
+                                                  void *pvIoReqAlloc, PDMMEDIAEXIOREQSTATE enmState)
+{
+    RT_NOREF2(hIoReq, pvIoReqAlloc);
+    PVBLKSTATE pThis = RT_FROM_MEMBER(pInterface, VBLKSTATE, IMediaExPort);
+
+    switch (enmState)
+    {
+        case PDMMEDIAEXIOREQSTATE_SUSPENDED:
+        {
+            /* Make sure the request is not accounted for so the VM can suspend successfully. */
+            uint32_t cReqsActive = ASMAtomicDecU32(&pThis->cReqsActive);
+            if (!cReqsActive && pThis->fSignalIdle)
+                PDMDevHlpAsyncNotificationCompleted(pThis->VPCI.CTX_SUFF(pDevIns));
+            break;
+        }
+        case PDMMEDIAEXIOREQSTATE_ACTIVE:
+            /* Make sure the request is accounted for so the VM suspends only when the request is complete. */
+            ASMAtomicIncU32(&pThis->cReqsActive);
+            break;
+        default:
+            AssertMsgFailed(("Invalid request state given %u\n", enmState));
+    }
+}
+
+/**
+ * @interface_method_impl{PDMIMEDIAEXPORT,pfnMediumEjected}
+ */
+static DECLCALLBACK(void) vblkR3MediumEjected(PPDMIMEDIAEXPORT pInterface)
+{
+    /* Hard disks cannot be ejected. */
+    RT_NOREF(pInterface);
+}
+
+/**
+ * @interface_method_impl{PDMIBASE,pfnQueryInterface}
+ */
+static DECLCALLBACK(void *) vblkQueryInterface(struct PDMIBASE *pInterface, const char *pszIID)
+{
+    PVBLKSTATE pThis = RT_FROM_MEMBER(pInterface, VBLKSTATE, VPCI.IBase);
+    Assert(&pThis->VPCI.IBase == pInterface);
+
+    PDMIBASE_RETURN_INTERFACE(pszIID, PDMIMEDIAPORT, &pThis->IPort);
+    PDMIBASE_RETURN_INTERFACE(pszIID, PDMIMEDIAEXPORT, &pThis->IMediaExPort);
+    return vpciQueryInterface(pInterface, pszIID);
+}
+
+
+/* -=-=-=-=- Saved state -=-=-=-=- */
+
+/**
+ * Saves the configuration.
+ *
+ * @param   pThis      The VBLK state.
+ * @param   pSSM       The handle to the saved state.
+ */
+static void vblkR3SaveConfig(PVBLKSTATE pThis, PSSMHANDLE pSSM)
+{
+    SSMR3PutU16(pSSM, pThis->cQueues);
+    SSMR3PutU64(pSSM, pThis->config.uCapacity);
+}
+
+
+/**
+ * @callback_method_impl{FNSSMDEVLIVEEXEC}
+ */
+static DECLCALLBACK(int) vblkR3LiveExec(PPDMDEVINS pDevIns, PSSMHANDLE pSSM, uint32_t uPass)
+{
+    RT_NOREF(uPass);
+    PVBLKSTATE pThis = PDMINS_2_DATA(pDevIns, PVBLKSTATE);
+    vblkR3SaveConfig(pThis, pSSM);
+    return VINF_SSM_DONT_CALL_AGAIN;
+}
+
+
+/**
+ * @callback_method_impl{FNSSMDEVSAVEEXEC}
+ */
+static DECLCALLBACK(int) vblkR3SaveExec(PPDMDEVINS pDevIns, PSSMHANDLE pSSM)
+{
+    PVBLKSTATE pThis = PDMINS_2_DATA(pDevIns, PVBLKSTATE);
+
+    /* Save config first */
+    vblkR3SaveConfig(pThis, pSSM);
+
+    /* Save the common part, tagged with its own version which moves independently of ours. */
+    SSMR3PutU32(pSSM, VIRTIO_SAVEDSTATE_VERSION);
+    int rc = vpciSaveExec(&pThis->VPCI, pSSM);
+    AssertRCReturn(rc, rc);
+
+    /*
+     * Save the requests the driver suspended because of a recoverable error,
+     * they are resubmitted when the VM resumes.
+     */
+    AssertMsg(!pThis->cReqsActive, ("There are still outstanding requests on this device\n"));
+    uint32_t cReqsRedo = pThis->pDrvMediaEx->pfnIoReqGetSuspendedCount(pThis->pDrvMediaEx);
+    SSMR3PutU32(pSSM, cReqsRedo + pThis->cRedo);
+    if (cReqsRedo)
+    {
+        PDMMEDIAEXIOREQ hIoReq;
+        PVBLKREQ        pReq;
+        rc = pThis->pDrvMediaEx->pfnIoReqQuerySuspendedStart(pThis->pDrvMediaEx, &hIoReq, (void **)&pReq);
+        AssertRCReturn(rc, rc);
+
+        for (;;)
+        {
+            SSMR3PutU32(pSSM, RT_MAKE_U32(pReq->uHeadIndex, pReq->pQueue->iQueue));
+
+            cReqsRedo--;
+            if (!cReqsRedo)
+                break;
+
+            rc = pThis->pDrvMediaEx->pfnIoReqQuerySuspendedNext(pThis->pDrvMediaEx, hIoReq, &hIoReq, (void **)&pReq);
+            AssertRCReturn(rc, rc);
+        }
+    }
+    /* Requests loaded from an earlier state which were not resubmitted yet. */
+    for (uint32_t i = 0; i < pThis->cRedo; i++)
+        SSMR3PutU32(pSSM, pThis->pau32Redo[i]);
+
+    Log(("%s State has been saved\n", INSTANCE(pThis)));
+    return SSMR3PutU32(pSSM, UINT32_MAX); /* sanity/terminator */
+}
+
+
+/**
+ * @callback_method_impl{FNSSMDEVLOADEXEC}
+ */
+static DECLCALLBACK(int) vblkR3LoadExec(PPDMDEVINS pDevIns, PSSMHANDLE pSSM, uint32_t uVersion, uint32_t uPass)
+{
+    PVBLKSTATE pThis = PDMINS_2_DATA(pDevIns, PVBLKSTATE);
+    int        rc;
+
+    if (   uVersion != VBLK_SAVEDSTATE_VERSION
+        && uVersion != VBLK_SAVEDSTATE_VERSION_NO_CORE_VERSION)
+        return VERR_SSM_UNSUPPORTED_DATA_UNIT_VERSION;
+
+    /* config checks */
+    uint16_t cQueues;
+    rc = SSMR3GetU16(pSSM, &cQueues);
+    AssertRCReturn(rc, rc);
+    if (cQueues != pThis->cQueues)
+        return SSMR3SetCfgError(pSSM, RT_SRC_POS, N_("The number of request queues differs: config=%u saved=%u"),
+                                pThis->cQueues, cQueues);
+    uint64_t uCapacity;
+    rc = SSMR3GetU64(pSSM, &uCapacity);
+    AssertRCReturn(rc, rc);
+    if (uCapacity != pThis->config.uCapacity)
+        return SSMR3SetCfgError(pSSM, RT_SRC_POS, N_("The disk size differs: config=%llu saved=%llu sectors"),
+                                pThis->config.uCapacity, uCapacity);
+
+    if (uPass == SSM_PASS_FINAL)
+    {
+        /* Restore the common part using the virtio core version it was saved with. */
+        uint32_t uCoreVersion = VBLK_SAVEDSTATE_CORE_VERSION_V1;
+        if (uVersion > VBLK_SAVEDSTATE_VERSION_NO_CORE_VERSION)
+        {
+            rc = SSMR3GetU32(pSSM, &uCoreVersion);
+            AssertRCReturn(rc, rc);
+            if (   uCoreVersion < VBLK_SAVEDSTATE_CORE_VERSION_V1
+                || uCoreVersion > VIRTIO_SAVEDSTATE_VERSION)
+                return SSMR3SetLoadError(pSSM, VERR_SSM_UNSUPPORTED_DATA_UNIT_VERSION, RT_SRC_POS,
+                                         N_("Unsupported virtio core saved state version %u"), uCoreVersion);
+        }
+        rc = vpciLoadExec(&pThis->VPCI, pSSM, uCoreVersion, uPass, pThis->cQueues);
+        if (RT_FAILURE(rc))
+            return rc;
+
+        uint32_t cRedo;
+        rc = SSMR3GetU32(pSSM, &cRedo);
+        AssertRCReturn(rc, rc);
+        AssertLogRelMsgReturn(cRedo <= pThis->cQueues * VBLK_QUEUE_SIZE, ("cRedo=%u\n", cRedo),
+                              VERR_SSM_DATA_UNIT_FORMAT_CHANGED);
+
+        RTMemFree(pThis->pau32Redo);
+        pThis->pau32Redo = NULL;
+        pThis->cRedo     = 0;
+        if (cRedo)
+        {
+            pThis->pau32Redo = (uint32_t *)RTMemAllocZ(cRedo * sizeof(uint32_t));
+            if (!pThis->pau32Redo)
+                return VERR_NO_MEMORY;
+            for (uint32_t i = 0; i < cRedo; i++)
+            {
+                rc = SSMR3GetU32(pSSM, &pThis->pau32Redo[i]);
+                AssertRCReturn(rc, rc);
+                AssertLogRelMsgReturn(RT_HI_U16(pThis->pau32Redo[i]) < pThis->cQueues,
+                                      ("Invalid queue %u\n", RT_HI_U16(pThis->pau32Redo[i])),
+                                      VERR_SSM_DATA_UNIT_FORMAT_CHANGED);
+            }
+            pThis->cRedo = cRedo;
+        }
+
+        uint32_t u32;
+        rc = SSMR3GetU32(pSSM, &u32);
+        AssertRCReturn(rc, rc);
+        AssertMsgReturn(u32 == UINT32_MAX, ("%#x\n", u32), VERR_SSM_DATA_UNIT_FORMAT_CHANGED);
+    }
+
+    return VINF_SUCCESS;
+}
+
+
+/* -=-=-=-=- PCI Device -=-=-=-=- */
+
+/**
+ * @callback_method_impl{FNPCIIOREGIONMAP}
+ */
+static DECLCALLBACK(int) vblkR3Map(PPDMDEVINS pDevIns, PPDMPCIDEV pPciDev, uint32_t iRegion,
+                                   RTGCPHYS GCPhysAddress, RTGCPHYS cb, PCIADDRESSSPACE enmType)
+{
+    RT_NOREF(pPciDev, iRegion);
+    PVBLKSTATE pThis = PDMINS_2_DATA(pDevIns, PVBLKSTATE);
+
+    if (enmType != PCI_ADDRESS_SPACE_IO)
+    {
+        /* We should never get here */
+        AssertMsgFailed(("Invalid PCI address space param in map callback"));
+        return VERR_INTERNAL_ERROR;
+    }
+
+    pThis->VPCI.IOPortBase = (RTIOPORT)GCPhysAddress;
+    int rc = PDMDevHlpIOPortRegister(pDevIns, pThis->VPCI.IOPortBase,
+                                     cb, 0, vblkIOPortOut, vblkIOPortIn,
+                                     NULL, NULL, "VirtioBlk");
+    AssertRC(rc);
+    return rc;
+}
+
+
+/* -=-=-=-=- PDMDEVREG -=-=-=-=- */
+
+/**
+ * Checks whether the driver is done with all requests.
+ *
+ * @returns true if no request is being processed, false otherwise.
+ * @param   pThis       The device state structure.
+ */
+DECLINLINE(bool) vblkR3AllAsyncIOIsFinished(PVBLKSTATE pThis)
+{
+    return ASMAtomicReadU32(&pThis->cReqsActive) == 0;
+}
+
+/**
+ * @callback_method_impl{FNPDMDEVASYNCNOTIFY,
+ * Callback employed by vblkR3Suspend and vblkR3PowerOff.}
+ */
+static DECLCALLBACK(bool) vblkR3IsAsyncSuspendOrPowerOffDone(PPDMDEVINS pDevIns)
+{
+    PVBLKSTATE pThis = PDMINS_2_DATA(pDevIns, PVBLKSTATE);
+    if (!vblkR3AllAsyncIOIsFinished(pThis))
+        return false;
+
+    ASMAtomicWriteBool(&pThis->fSignalIdle, false);
+    return true;
+}
+
+/**
+ * Common worker for vblkR3Suspend and vblkR3PowerOff.
+ */
+static void vblkR3SuspendOrPowerOff(PPDMDEVINS pDevIns)
+{
+    PVBLKSTATE pThis = PDMINS_2_DATA(pDevIns, PVBLKSTATE);
+
+    ASMAtomicWriteBool(&pThis->fSignalIdle, true);
+    if (!vblkR3AllAsyncIOIsFinished(pThis))
+        PDMDevHlpSetAsyncNotification(pDevIns, vblkR3IsAsyncSuspendOrPowerOffDone);
+    else
+        ASMAtomicWriteBool(&pThis->fSignalIdle, false);
+}
+
+/**
+ * @interface_method_impl{PDMDEVREG,pfnSuspend}
+ */
+static DECLCALLBACK(void) vblkR3Suspend(PPDMDEVINS pDevIns)
+{
+    Log(("%s:\n", __FUNCTION__));
+    vblkR3SuspendOrPowerOff(pDevIns);
+}
+
+/**
+ * @interface_method_impl{PDMDEVREG,pfnPowerOff}
+ */
+static DECLCALLBACK(void) vblkR3PowerOff(PPDMDEVINS pDevIns)
+{
+    Log(("%s:\n", __FUNCTION__));
+    vblkR3SuspendOrPowerOff(pDevIns);
+}
+
+/**
+ * @interface_method_impl{PDMDEVREG,pfnResume}
+ */
+static DECLCALLBACK(void) vblkR3Resume(PPDMDEVINS pDevIns)
+{
+    PVBLKSTATE pThis = PDMINS_2_DATA(pDevIns, PVBLKSTATE);
+
+    if (pThis->cRedo)
+        vblkR3RedoRequests(pThis);
+
+    Log(("%s:\n", __FUNCTION__));
+}
+
+/**
+ * @callback_method_impl{FNPDMDEVASYNCNOTIFY,
+ * Callback employed by vblkR3Reset.}
+ */
+static DECLCALLBACK(bool) vblkR3IsAsyncResetDone(PPDMDEVINS pDevIns)
+{
+    PVBLKSTATE pThis = PDMINS_2_DATA(pDevIns, PVBLKSTATE);
+    if (!vblkR3AllAsyncIOIsFinished(pThis))
+        return false;
+
+    ASMAtomicWriteBool(&pThis->fSignalIdle, false);
+    vblkIoCb_Reset(pThis);
+    return true;
+}
+
+/**
+ * @interface_method_impl{PDMDEVREG,pfnReset}
+ */
+static DECLCALLBACK(void) vblkR3Reset(PPDMDEVINS pDevIns)
+{
+    PVBLKSTATE pThis = PDMINS_2_DATA(pDevIns, PVBLKSTATE);
+
+    ASMAtomicWriteBool(&pThis->fSignalIdle, true);
+    if (!vblkR3AllAsyncIOIsFinished(pThis))
+        PDMDevHlpSetAsyncNotification(pDevIns, vblkR3IsAsyncResetDone);
+    else
+    {
+        ASMAtomicWriteBool(&pThis->fSignalIdle, false);
+        vblkIoCb_Reset(pThis);
+    }
+}
+
+/**
+ * @interface_method_impl{PDMDEVREG,pfnDestruct}
+ */
+static DECLCALLBACK(int) vblkR3Destruct(PPDMDEVINS pDevIns)
+{
+    PVBLKSTATE pThis = PDMINS_2_DATA(pDevIns, PVBLKSTATE);
+    PDMDEV_CHECK_VERSIONS_RETURN_QUIET(pDevIns);
+
+    Log(("%s Destroying instance\n", INSTANCE(pThis)));
+    for (unsigned i = 0; i < RT_ELEMENTS(pThis->aQueues); i++)
+        if (PDMCritSectIsInitialized(&pThis->aQueues[i].CritSect))
+            PDMR3CritSectDelete(&pThis->aQueues[i].CritSect);
+
+    if (pThis->pau32Redo)
+    {
+        RTMemFree(pThis->pau32Redo);
+        pThis->pau32Redo = NULL;
+    }
+
+    return vpciDestruct(&pThis->VPCI);
+}
+
+/**
+ * Configures the attached disk and fills in the config area from it.
+ *
+ * @returns VBox status code.
+ * @param   pDevIns     The device instance.
+ * @param   pThis       The device state structure.
+ * @param   pCfg        The device configuration node.
+ */
+static int vblkR3ConfigureDisk(PPDMDEVINS pDevIns, PVBLKSTATE pThis, PCFGMNODE pCfg)
+{
+    pThis->pDrvMedia = PDMIBASE_QUERY_INTERFACE(pThis->pDrvBase, PDMIMEDIA);
+    AssertMsgReturn(VALID_PTR(pThis->pDrvMedia),
+                    ("VirtioBlk configuration error: the disk misses the basic media interface!\n"),
+                    VERR_PDM_MISSING_INTERFACE);
+    pThis->pDrvMediaEx = PDMIBASE_QUERY_INTERFACE(pThis->pDrvBase, PDMIMEDIAEX);
+    AssertMsgReturn(VALID_PTR(pThis->pDrvMediaEx),
+                    ("VirtioBlk configuration error: the disk misses the extended media interface!\n"),
+                    VERR_PDM_MISSING_INTERFACE);
+
+    PDMMEDIATYPE enmType = pThis->pDrvMedia->pfnGetType(pThis->pDrvMedia);
+    if (enmType != PDMMEDIATYPE_HARD_DISK)
+        return PDMDevHlpVMSetError(pDevIns, VERR_PDM_UNSUPPORTED_BLOCK_TYPE, RT_SRC_POS,
+                                   N_("VirtioBlk configuration error: the attached medium is not a hard disk"));
+
+    int rc = pThis->pDrvMediaEx->pfnIoReqAllocSizeSet(pThis->pDrvMediaEx, sizeof(VBLKREQ));
+    if (RT_FAILURE(rc))
+        return PDMDevHlpVMSetError(pDevIns, rc, RT_SRC_POS,
+                                   N_("VirtioBlk configuration error: Failed to set I/O request size!"));
+
+    uint32_t fFeatures = 0;
+    rc = pThis->pDrvMediaEx->pfnQueryFeatures(pThis->pDrvMediaEx, &fFeatures);
+    if (RT_FAILURE(rc))
+        return PDMDevHlpVMSetError(pDevIns, rc, RT_SRC_POS,
+                                   N_("VirtioBlk configuration error: Failed to query features of device"));
+    pThis->fDiscard  = RT_BOOL(fFeatures & PDMIMEDIAEX_FEATURE_F_DISCARD);
+    pThis->fReadOnly = pThis->pDrvMedia->pfnIsReadOnly(pThis->pDrvMedia);
+
+    uint32_t cbSector = pThis->pDrvMedia->pfnGetSectorSize(pThis->pDrvMedia);
+    if (!cbSector || (cbSector & ((1 << VBLK_SECTOR_SHIFT) - 1)))
+        cbSector = 1 << VBLK_SECTOR_SHIFT;
+    uint64_t cSectors = pThis->pDrvMedia->pfnGetSize(pThis->pDrvMedia) >> VBLK_SECTOR_SHIFT;
+
+    PDMMEDIAGEOMETRY PCHSGeometry;
+    rc = pThis->pDrvMedia->pfnBiosGetPCHSGeometry(pThis->pDrvMedia, &PCHSGeometry);
+    if (   RT_FAILURE(rc)
+        || PCHSGeometry.cCylinders == 0
+        || PCHSGeometry.cHeads == 0
+        || PCHSGeometry.cSectors == 0)
+    {
+        uint64_t cCylinders = cSectors / (16 * 63);
+        PCHSGeometry.cCylinders = (uint32_t)RT_MAX(RT_MIN(cCylinders, 16383), 1);
+        PCHSGeometry.cHeads     = 16;
+        PCHSGeometry.cSectors   = 63;
+    }
+
+    pThis->config.uCapacity           = cSectors;
+    pThis->config.uSegMax             = VBLK_SEG_MAX;
+    pThis->config.Geometry.uCylinders = (uint16_t)RT_MIN(PCHSGeometry.cCylinders, UINT16_MAX);
+    pThis->config.Geometry.uHeads     = (uint8_t)PCHSGeometry.cHeads;
+    pThis->config.Geometry.uSectors   = (uint8_t)PCHSGeometry.cSectors;
+    pThis->config.uBlkSize            = cbSector;
+    pThis->config.uNumQueues          = pThis->cQueues;
+    if (pThis->fDiscard)
+    {
+        pThis->config.uMaxDiscardSectors      = UINT32_MAX;
+        pThis->config.uMaxDiscardSeg          = VBLK_DISCARD_SEG_MAX;
+        pThis->config.uDiscardSectorAlignment = cbSector >> VBLK_SECTOR_SHIFT;
+    }
+
+    /** @cfgm{SerialNumber, string, VB<uuid bits>}
+     * The identification string returned to the guest, at most 20 characters. */
+    RTUUID Uuid;
+    rc = pThis->pDrvMedia->pfnGetUuid(pThis->pDrvMedia, &Uuid);
+    if (RT_FAILURE(rc))
+        RTUuidClear(&Uuid);
+    char szDefSerial[VBLK_ID_BYTES + 1];
+    RTStrPrintf(szDefSerial, sizeof(szDefSerial), "VB%08x-%08x", Uuid.au32[0], Uuid.au32[3]);
+    rc = CFGMR3QueryStringDef(pCfg, "SerialNumber", pThis->szId, sizeof(pThis->szId), szDefSerial);
+    if (RT_FAILURE(rc))
+        return PDMDEV_SET_ERROR(pDevIns, rc,
+                                N_("Configuration error: Failed to get the value of 'SerialNumber'"));
+
+    LogRel(("%s: disk, PCHS=%u/%u/%u, total number of sectors %llu, block size %u%s%s\n",
+            INSTANCE(pThis), PCHSGeometry.cCylinders, PCHSGeometry.cHeads, PCHSGeometry.cSectors,
+            cSectors, cbSector, pThis->fReadOnly ? ", read-only" : "", pThis->fDiscard ? ", discard" : ""));
+    return VINF_SUCCESS;
+}
+
+/**
+ * @interface_method_impl{PDMDEVREG,pfnConstruct}
+ */
+static DECLCALLBACK(int) vblkR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGMNODE pCfg)
+{
+    PVBLKSTATE pThis = PDMINS_2_DATA(pDevIns, PVBLKSTATE);
+    int        rc;
+    PDMDEV_CHECK_VERSIONS_RETURN(pDevIns);
+
+    /*
+     * Validate configuration.
+     */
+    if (!CFGMR3AreValuesValid(pCfg, "NumQueues\0" "SerialNumber\0"))
+        return PDMDEV_SET_ERROR(pDevIns, VERR_PDM_DEVINS_UNKNOWN_CFG_VALUES,
+                                N_("Invalid configuration for VirtioBlk device"));
+
+    /* Do our own locking, each request queue has its own critical section. */
+    rc = PDMDevHlpSetDeviceCritSect(pDevIns, PDMDevHlpCritSectGetNop(pDevIns));
+    AssertRCReturn(rc, rc);
+
+    /** @cfgm{NumQueues, uint16_t, 1}
+     * The number of request queues offered to the guest.  More than one
+     * enables VBLK_F_MQ. */
+    uint16_t cQueues;
+    rc = CFGMR3QueryU16Def(pCfg, "NumQueues", &cQueues, 1);
+    if (RT_FAILURE(rc))
+        return PDMDEV_SET_ERROR(pDevIns, rc,
+                                N_("Configuration error: Failed to get the value of 'NumQueues'"));
+    if (cQueues < 1 || cQueues > VBLK_MAX_QUEUES)
+        return PDMDevHlpVMSetError(pDevIns, VERR_OUT_OF_RANGE, RT_SRC_POS,
+                                   N_("Configuration error: 'NumQueues' must be between 1 and %u"), VBLK_MAX_QUEUES);
+    pThis->cQueues = cQueues;
+
+    /* Initialize PCI part. */
+    pThis->VPCI.IBase.pfnQueryInterface = vblkQueryInterface;
+    rc = vpciConstruct(pDevIns, &pThis->VPCI, iInstance,
+                       VBLK_NAME_FMT, VIRTIO_BLK_ID,
+                       VBLK_PCI_CLASS, cQueues);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    static const char * const s_apszQueueNames[VBLK_MAX_QUEUES] =
+    {
+        "RQ0", "RQ1", "RQ2",  "RQ3",  "RQ4",  "RQ5",  "RQ6",  "RQ7",
+        "RQ8", "RQ9", "RQ10", "RQ11", "RQ12", "RQ13", "RQ14", "RQ15"
+    };
+    for (unsigned i = 0; i < cQueues; i++)
+    {
+        PVBLKQUEUE pQueue = &pThis->aQueues[i];
+        pQueue->iQueue = (uint16_t)i;
+        pQueue->pQueue = vpciAddQueue(&pThis->VPCI, VBLK_QUEUE_SIZE, vblkR3QueueNotify, s_apszQueueNames[i]);
+        rc = PDMDevHlpCritSectInit(pDevIns, &pQueue->CritSect, RT_SRC_POS, "VBlk%uQ%u", iInstance, i);
+        if (RT_FAILURE(rc))
+            return rc;
+    }
+
+    Log(("%s Constructing new instance\n", INSTANCE(pThis)));
+
+    /* Interfaces */
+    pThis->IPort.pfnQueryDeviceLocation                = vblkR3QueryDeviceLocation;
+    pThis->IMediaExPort.pfnIoReqCompleteNotify         = vblkR3IoReqCompleteNotify;
+    pThis->IMediaExPort.pfnIoReqCopyFromBuf            = vblkR3IoReqCopyFromBuf;
+    pThis->IMediaExPort.pfnIoReqCopyToBuf              = vblkR3IoReqCopyToBuf;
+    pThis->IMediaExPort.pfnIoReqQueryBuf               = NULL;
+    pThis->IMediaExPort.pfnIoReqQueryDiscardRanges     = vblkR3IoReqQueryDiscardRanges;
+    pThis->IMediaExPort.pfnIoReqStateChanged           = vblkR3IoReqStateChanged;
+    pThis->IMediaExPort.pfnMediumEjected               = vblkR3MediumEjected;
+
+    /* Attach the disk. */
+    rc = PDMDevHlpDriverAttach(pDevIns, 0, &pThis->VPCI.IBase, &pThis->pDrvBase, "Disk");
+    if (rc == VERR_PDM_NO_ATTACHED_DRIVER)
+        return PDMDevHlpVMSetError(pDevIns, rc, RT_SRC_POS, N_("VirtioBlk: No disk is attached"));
+    if (RT_FAILURE(rc))
+        return PDMDEV_SET_ERROR(pDevIns, rc, N_("Failed to attach the disk LUN"));
+    rc = vblkR3ConfigureDisk(pDevIns, pThis, pCfg);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    /* Map our ports to IO space. */
+    rc = PDMDevHlpPCIIORegionRegister(pDevIns, 0,
+                                      VPCI_CONFIG + sizeof(VBLKPCICONFIG),
+                                      PCI_ADDRESS_SPACE_IO, vblkR3Map);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    /* Register save/restore state handlers. */
+    rc = PDMDevHlpSSMRegisterEx(pDevIns, VBLK_SAVEDSTATE_VERSION, sizeof(VBLKSTATE), NULL,
+                                NULL,           vblkR3LiveExec, NULL,
+                                NULL,           vblkR3SaveExec, NULL,
+                                NULL,           vblkR3LoadExec, NULL);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    rc = vblkIoCb_Reset(pThis);
+    AssertRC(rc);
+
+    PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatBytesRead,    STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_BYTES,      "Amount of data read",            "/Devices/VBlk%d/ReadBytes", iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatBytesWritten, STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_BYTES,      "Amount of data written",         "/Devices/VBlk%d/WrittenBytes", iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatReads,        STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES, "Number of read requests",        "/Devices/VBlk%d/Requests/Read", iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatWrites,       STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES, "Number of write requests",       "/Devices/VBlk%d/Requests/Write", iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatFlushes,      STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES, "Number of flush requests",       "/Devices/VBlk%d/Requests/Flush", iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatDiscards,     STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES, "Number of discard requests",     "/Devices/VBlk%d/Requests/Discard", iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatReqsFailed,   STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES, "Number of failed requests",      "/Devices/VBlk%d/Requests/Failed", iInstance);
+    for (unsigned i = 0; i < cQueues; i++)
+        PDMDevHlpSTAMRegisterF(pDevIns, &pThis->aQueues[i].StatRequests, STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES, "Number of requests taken off the queue", "/Devices/VBlk%d/Queue%u/Requests", iInstance, i);
+
+    return VINF_SUCCESS;
+}
+
+/**
+ * The device registration structure.
+ */
+const PDMDEVREG g_DeviceVirtioBlk =
+{
+    /* Structure version. PDM_DEVREG_VERSION defines the current version. */
+    PDM_DEVREG_VERSION,
+    /* Device name. */
+    "virtio-blk",
+    /* Name of guest context module (no path).
+     * Only evalutated if PDM_DEVREG_FLAGS_RC is set. */
+    "",
+    /* Name of ring-0 module (no path).
+     * Only evalutated if PDM_DEVREG_FLAGS_RC is set. */
+    "",
+    /* The description of the device. The UTF-8 string pointed to shall, like this structure,
+     * remain unchanged from registration till VM destruction. */
+    "Virtio Block Device.\n",
+
+    /* Flags, combination of the PDM_DEVREG_FLAGS_* \#defines. */
+    PDM_DEVREG_FLAGS_DEFAULT_BITS,
+    /* Device class(es), combination of the PDM_DEVREG_CLASS_* \#defines. */
+    PDM_DEVREG_CLASS_STORAGE,
+    /* Maximum number of instances (per VM). */
+    ~0U,
+    /* Size of the instance data. */
+    sizeof(VBLKSTATE),
+
+    /* pfnConstruct */
+    vblkR3Construct,
+    /* pfnDestruct */
+    vblkR3Destruct,
+    /* pfnRelocate */
+    NULL,
+    /* pfnMemSetup. */
+    NULL,
+    /* pfnPowerOn */
+    NULL,
+    /* pfnReset */
+    vblkR3Reset,
+    /* pfnSuspend */
+    vblkR3Suspend,
+    /* pfnResume */
+    vblkR3Resume,
+    /* pfnAttach */
+    NULL,
+    /* pfnDetach */
+    NULL,
+    /* pfnQueryInterface */
+    NULL,
+    /* pfnInitComplete */
+    NULL,
+    /* pfnPowerOff */
+    vblkR3PowerOff,
+    /* pfnSoftReset */
+    NULL,
+
+    /* u32VersionEnd */
+    PDM_DEVREG_VERSION
+};
+
+#endif /* !VBOX_DEVICE_STRUCT_TESTCASE */
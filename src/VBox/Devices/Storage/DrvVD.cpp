@@ -101,6 +101,10 @@ extern bool DevINIPConfigured(void);
 #define DRVVD_IOREQ_SAVED_STATE_VERSION UINT32_C(1)
 /** Maximum number of request errors in the release log before muting. */
 #define DRVVD_MAX_LOG_REL_ERRORS        100
+/** Maximum number of bytes merged into a single coalesced host write. */
+#define DRVVD_WRITE_COALESCE_MAX_BYTES  _1M
+/** Maximum number of segments of a single coalesced host write. */
+#define DRVVD_WRITE_COALESCE_MAX_SEGS   128
 
 /** Forward declaration for the dis kcontainer. */
 typedef struct VBOXDISK *PVBOXDISK;
@@ -238,6 +242,21 @@ typedef struct PDMMEDIAEXIOREQINT
 /** Pointer to a VD I/O request. */
 typedef PDMMEDIAEXIOREQINT *PPDMMEDIAEXIOREQINT;
 
+/**
+ * Host write combining several adjacent queued write requests.
+ */
+typedef struct DRVVDWRITEBATCH
+{
+    /** List of merged write requests - PDMMEDIAEXIOREQINT::NdLstWait. */
+    RTLISTANCHOR                  LstIoReqs;
+    /** S/G buffer covering all merged requests. */
+    RTSGBUF                       SgBuf;
+    /** Segments of the S/G buffer - variable size. */
+    RTSGSEG                       aSegs[1];
+} DRVVDWRITEBATCH;
+/** Pointer to a host write batch. */
+typedef DRVVDWRITEBATCH *PDRVVDWRITEBATCH;
+
 /**
  * Structure for holding a list of allocated requests.
  */
@@ -316,6 +335,11 @@ typedef struct VBOXDISK
     size_t                   cbDataValid;
     /** The disk buffer. */
     uint8_t                 *pbData;
+
+    /** Size of the read-ahead window in bytes, 0 if read-ahead is disabled. */
+    uint32_t                 cbReadAhead;
+    /** Number of sequential reads before read-ahead kicks in. */
+    uint32_t                 cReadAheadThreshold;
     /** Bandwidth group the disk is assigned to. */
     char                    *pszBwGroup;
     /** Flag whether async I/O using the host cache is enabled. */
@@ -411,6 +435,27 @@ typedef struct VBOXDISK
     unsigned                 cErrors;
     /** @} */
 
+    /** @name Write coalescing and flush batching.
+     * @{ */
+    /** Maximum number of host writes in flight before further writes are queued
+     * and merged with adjacent ones, 0 if write coalescing is disabled. */
+    uint32_t                 cWritesCoalesceDepth;
+    /** Number of coalescing host writes in flight. */
+    uint32_t                 cWritesInFlight;
+    /** List of queued write requests - PDMMEDIAEXIOREQINT::NdLstWait. */
+    RTLISTANCHOR             LstIoReqWriteWait;
+    /** Flag whether concurrent flush requests are served by a single host flush. */
+    bool                     fFlushCoalesce;
+    /** Flag whether a coalescing host flush is in flight. */
+    bool                     fFlushInFlight;
+    /** Flush requests completed by the host flush in flight - PDMMEDIAEXIOREQINT::NdLstWait. */
+    RTLISTANCHOR             LstIoReqFlushActive;
+    /** Flush requests which arrived while a host flush was in flight - PDMMEDIAEXIOREQINT::NdLstWait. */
+    RTLISTANCHOR             LstIoReqFlushWait;
+    /** Critical section protecting the coalescing state. */
+    RTCRITSECT               CritSectCoalesce;
+    /** @} */
+
     /** @name Statistics.
      * @{ */
     /** How many attempts were made to query a direct buffer pointer from the
@@ -438,6 +483,12 @@ typedef struct VBOXDISK
     STAMCOUNTER              StatReqsDiscard;
     /** Release statistics: Number of I/O requests processed per second. */
     STAMCOUNTER              StatReqsPerSec;
+    /** Release statistics: Number of write requests merged into a larger host write. */
+    STAMCOUNTER              StatWritesCoalesced;
+    /** Release statistics: Number of host writes made up of merged write requests. */
+    STAMCOUNTER              StatWriteBatches;
+    /** Release statistics: Number of flush requests which didn't need a host flush of their own. */
+    STAMCOUNTER              StatFlushesCoalesced;
     /** @} */
 } VBOXDISK;
 
@@ -451,6 +502,8 @@ static void drvvdPowerOffOrDestructOrUnmount(PPDMDRVINS pDrvIns);
 DECLINLINE(void) drvvdMediaExIoReqBufFree(PVBOXDISK pThis, PPDMMEDIAEXIOREQINT pIoReq);
 static int drvvdMediaExIoReqCompleteWorker(PVBOXDISK pThis, PPDMMEDIAEXIOREQINT pIoReq, int rcReq, bool fUpNotify);
 static int drvvdMediaExIoReqReadWriteProcess(PVBOXDISK pThis, PPDMMEDIAEXIOREQINT pIoReq, bool fUpNotify);
+static void drvvdMediaExIoReqWriteQueueKick(PVBOXDISK pThis, bool fRelease);
+static DECLCALLBACK(void) drvvdMediaExIoReqFlushCoalescedComplete(void *pvUser1, void *pvUser2, int rcReq);
 
 /**
  * Internal: allocate new image descriptor and put it in the list
@@ -3107,6 +3160,247 @@ static int drvvdMediaExIoReqReadWrapper(PVBOXDISK pThis, PPDMMEDIAEXIOREQINT pIo
     return rc;
 }
 
+/**
+ * Returns whether the given request can take part in write coalescing or flush batching,
+ * which is only done for requests going straight to the async VD interface.
+ *
+ * @returns Flag whether coalescing can be used for the request.
+ * @param   pThis     VBox disk container instance data.
+ * @param   pIoReq    The I/O request.
+ */
+DECLINLINE(bool) drvvdMediaExIoReqCanCoalesce(PVBOXDISK pThis, PPDMMEDIAEXIOREQINT pIoReq)
+{
+    return    pThis->fAsyncIOSupported
+           && !pThis->pBlkCache
+           && !(pIoReq->fFlags & PDMIMEDIAEX_F_SYNC);
+}
+
+/**
+ * Completes all write requests of a host write batch and frees the batch.
+ *
+ * @returns nothing.
+ * @param   pThis     VBox disk container instance data.
+ * @param   pBatch    The batch to complete.
+ * @param   rcReq     The status code the host write completed with.
+ */
+static void drvvdMediaExIoReqWriteBatchFinish(PVBOXDISK pThis, PDRVVDWRITEBATCH pBatch, int rcReq)
+{
+    PPDMMEDIAEXIOREQINT pIoReqCur, pIoReqNext;
+    RTListForEachSafe(&pBatch->LstIoReqs, pIoReqCur, pIoReqNext, PDMMEDIAEXIOREQINT, NdLstWait)
+    {
+        RTListNodeRemove(&pIoReqCur->NdLstWait);
+        drvvdMediaExIoReqCompleteWorker(pThis, pIoReqCur, rcReq, true /* fUpNotify */);
+    }
+    RTMemFree(pBatch);
+}
+
+/**
+ * @copydoc FNVDASYNCTRANSFERCOMPLETE
+ */
+static DECLCALLBACK(void) drvvdMediaExIoReqWriteCoalescedComplete(void *pvUser1, void *pvUser2, int rcReq)
+{
+    PVBOXDISK pThis = (PVBOXDISK)pvUser1;
+    PPDMMEDIAEXIOREQINT pIoReq = (PPDMMEDIAEXIOREQINT)pvUser2;
+
+    drvvdMediaExIoReqWriteQueueKick(pThis, true /* fRelease */);
+    drvvdMediaExIoReqCompleteWorker(pThis, pIoReq, rcReq, true /* fUpNotify */);
+}
+
+/**
+ * @copydoc FNVDASYNCTRANSFERCOMPLETE
+ */
+static DECLCALLBACK(void) drvvdMediaExIoReqWriteBatchComplete(void *pvUser1, void *pvUser2, int rcReq)
+{
+    PVBOXDISK pThis = (PVBOXDISK)pvUser1;
+    PDRVVDWRITEBATCH pBatch = (PDRVVDWRITEBATCH)pvUser2;
+
+    drvvdMediaExIoReqWriteQueueKick(pThis, true /* fRelease */);
+    drvvdMediaExIoReqWriteBatchFinish(pThis, pBatch, rcReq);
+}
+
+/**
+ * Submits a single queued write request to the VD layer.
+ *
+ * @returns nothing.
+ * @param   pThis     VBox disk container instance data.
+ * @param   pIoReq    The write request, accounted for in the in flight counter already.
+ */
+static void drvvdMediaExIoReqWriteQueuedSubmit(PVBOXDISK pThis, PPDMMEDIAEXIOREQINT pIoReq)
+{
+    int rc = VDAsyncWrite(pThis->pDisk, pIoReq->ReadWrite.offStart, pIoReq->ReadWrite.cbReqLeft,
+                          pIoReq->ReadWrite.pSgBuf, drvvdMediaExIoReqWriteCoalescedComplete, pThis, pIoReq);
+    if (rc != VERR_VD_ASYNC_IO_IN_PROGRESS)
+    {
+        RTCritSectEnter(&pThis->CritSectCoalesce);
+        pThis->cWritesInFlight--;
+        RTCritSectLeave(&pThis->CritSectCoalesce);
+
+        if (rc == VINF_VD_ASYNC_IO_FINISHED)
+            rc = VINF_SUCCESS;
+        drvvdMediaExIoReqCompleteWorker(pThis, pIoReq, rc, true /* fUpNotify */);
+    }
+}
+
+/**
+ * Merges the given list of adjacent write requests into one host write and submits it.
+ *
+ * @returns nothing.
+ * @param   pThis     VBox disk container instance data.
+ * @param   pLstBatch The list of write requests to merge, sorted by offset.
+ * @param   cIoReqs   Number of requests in the list.
+ * @param   cSegs     Upper bound of the number of segments required.
+ * @param   cbBatch   Number of bytes to write.
+ */
+static void drvvdMediaExIoReqWriteBatchSubmit(PVBOXDISK pThis, PRTLISTANCHOR pLstBatch, unsigned cIoReqs,
+                                              unsigned cSegs, size_t cbBatch)
+{
+    PPDMMEDIAEXIOREQINT pIoReqCur, pIoReqNext;
+    PDRVVDWRITEBATCH pBatch = NULL;
+
+    if (cIoReqs > 1)
+        pBatch = (PDRVVDWRITEBATCH)RTMemAlloc(RT_OFFSETOF(DRVVDWRITEBATCH, aSegs[cSegs]));
+    if (!pBatch)
+    {
+        /* Nothing to merge or out of memory, submit the requests one by one. */
+        RTCritSectEnter(&pThis->CritSectCoalesce);
+        pThis->cWritesInFlight += cIoReqs - 1;
+        RTCritSectLeave(&pThis->CritSectCoalesce);
+
+        RTListForEachSafe(pLstBatch, pIoReqCur, pIoReqNext, PDMMEDIAEXIOREQINT, NdLstWait)
+        {
+            RTListNodeRemove(&pIoReqCur->NdLstWait);
+            drvvdMediaExIoReqWriteQueuedSubmit(pThis, pIoReqCur);
+        }
+        return;
+    }
+
+    RTListInit(&pBatch->LstIoReqs);
+    RTListMove(&pBatch->LstIoReqs, pLstBatch);
+
+    unsigned iSeg = 0;
+    RTListForEach(&pBatch->LstIoReqs, pIoReqCur, PDMMEDIAEXIOREQINT, NdLstWait)
+    {
+        PCRTSGBUF pSgBuf = pIoReqCur->ReadWrite.pSgBuf;
+        size_t cbLeft = pIoReqCur->ReadWrite.cbReqLeft;
+
+        for (unsigned i = 0; i < pSgBuf->cSegs && cbLeft; i++)
+        {
+            size_t cbSeg = RT_MIN(pSgBuf->paSegs[i].cbSeg, cbLeft);
+
+            Assert(iSeg < cSegs);
+            pBatch->aSegs[iSeg].pvSeg = pSgBuf->paSegs[i].pvSeg;
+            pBatch->aSegs[iSeg].cbSeg = cbSeg;
+            iSeg++;
+            cbLeft -= cbSeg;
+        }
+    }
+    RTSgBufInit(&pBatch->SgBuf, &pBatch->aSegs[0], iSeg);
+
+    STAM_REL_COUNTER_INC(&pThis->StatWriteBatches);
+    STAM_REL_COUNTER_ADD(&pThis->StatWritesCoalesced, cIoReqs);
+
+    pIoReqCur = RTListGetFirst(&pBatch->LstIoReqs, PDMMEDIAEXIOREQINT, NdLstWait);
+    int rc = VDAsyncWrite(pThis->pDisk, pIoReqCur->ReadWrite.offStart, cbBatch, &pBatch->SgBuf,
+                          drvvdMediaExIoReqWriteBatchComplete, pThis, pBatch);
+    if (rc != VERR_VD_ASYNC_IO_IN_PROGRESS)
+    {
+        RTCritSectEnter(&pThis->CritSectCoalesce);
+        pThis->cWritesInFlight--;
+        RTCritSectLeave(&pThis->CritSectCoalesce);
+
+        if (rc == VINF_VD_ASYNC_IO_FINISHED)
+            rc = VINF_SUCCESS;
+        drvvdMediaExIoReqWriteBatchFinish(pThis, pBatch, rc);
+    }
+}
+
+/**
+ * Submits queued write requests as long as the host write depth permits, merging
+ * runs of adjacent requests into single host writes.
+ *
+ * @returns nothing.
+ * @param   pThis     VBox disk container instance data.
+ * @param   fRelease  Flag whether a host write in flight completed.
+ */
+static void drvvdMediaExIoReqWriteQueueKick(PVBOXDISK pThis, bool fRelease)
+{
+    RTCritSectEnter(&pThis->CritSectCoalesce);
+    if (fRelease)
+    {
+        Assert(pThis->cWritesInFlight > 0);
+        pThis->cWritesInFlight--;
+    }
+
+    while (   pThis->cWritesInFlight < pThis->cWritesCoalesceDepth
+           && !RTListIsEmpty(&pThis->LstIoReqWriteWait))
+    {
+        RTLISTANCHOR LstBatch;
+        RTListInit(&LstBatch);
+
+        /* Take the head of the queue and every request directly following it on the disk. */
+        PPDMMEDIAEXIOREQINT pIoReqCur = RTListGetFirst(&pThis->LstIoReqWriteWait, PDMMEDIAEXIOREQINT, NdLstWait);
+        PPDMMEDIAEXIOREQINT pIoReqNext;
+        uint64_t offEnd  = pIoReqCur->ReadWrite.offStart;
+        size_t   cbBatch = 0;
+        unsigned cSegs   = 0;
+        unsigned cIoReqs = 0;
+
+        RTListForEachSafe(&pThis->LstIoReqWriteWait, pIoReqCur, pIoReqNext, PDMMEDIAEXIOREQINT, NdLstWait)
+        {
+            if (   cIoReqs
+                && (   pIoReqCur->ReadWrite.offStart != offEnd
+                    || cbBatch + pIoReqCur->ReadWrite.cbReqLeft > DRVVD_WRITE_COALESCE_MAX_BYTES
+                    || cSegs + pIoReqCur->ReadWrite.pSgBuf->cSegs > DRVVD_WRITE_COALESCE_MAX_SEGS))
+                break;
+
+            RTListNodeRemove(&pIoReqCur->NdLstWait);
+            RTListAppend(&LstBatch, &pIoReqCur->NdLstWait);
+            offEnd  += pIoReqCur->ReadWrite.cbReqLeft;
+            cbBatch += pIoReqCur->ReadWrite.cbReqLeft;
+            cSegs   += pIoReqCur->ReadWrite.pSgBuf->cSegs;
+            cIoReqs++;
+        }
+
+        pThis->cWritesInFlight++;
+        RTCritSectLeave(&pThis->CritSectCoalesce);
+
+        drvvdMediaExIoReqWriteBatchSubmit(pThis, &LstBatch, cIoReqs, cSegs, cbBatch);
+
+        RTCritSectEnter(&pThis->CritSectCoalesce);
+    }
+
+    RTCritSectLeave(&pThis->CritSectCoalesce);
+}
+
+/**
+ * Writes the given request through the coalescing stage. The request is submitted
+ * right away if the configured number of host writes in flight is not reached,
+ * otherwise it is queued and merged with adjacent requests once a host write completes.
+ *
+ * @returns VBox status code.
+ * @param   pThis     VBox disk container instance data.
+ * @param   pIoReq    The write request, the complete remainder is written.
+ */
+static int drvvdMediaExIoReqWriteCoalesce(PVBOXDISK pThis, PPDMMEDIAEXIOREQINT pIoReq)
+{
+    RTCritSectEnter(&pThis->CritSectCoalesce);
+    if (pThis->cWritesInFlight >= pThis->cWritesCoalesceDepth)
+    {
+        RTListAppend(&pThis->LstIoReqWriteWait, &pIoReq->NdLstWait);
+        RTCritSectLeave(&pThis->CritSectCoalesce);
+        return VERR_VD_ASYNC_IO_IN_PROGRESS;
+    }
+    pThis->cWritesInFlight++;
+    RTCritSectLeave(&pThis->CritSectCoalesce);
+
+    int rc = VDAsyncWrite(pThis->pDisk, pIoReq->ReadWrite.offStart, pIoReq->ReadWrite.cbReqLeft,
+                          pIoReq->ReadWrite.pSgBuf, drvvdMediaExIoReqWriteCoalescedComplete, pThis, pIoReq);
+    if (rc != VERR_VD_ASYNC_IO_IN_PROGRESS)
+        drvvdMediaExIoReqWriteQueueKick(pThis, true /* fRelease */);
+
+    return rc;
+}
+
 /**
  * Wrapper around the various ways to write to the underlying medium (cache, async vs. sync).
  *
@@ -3136,6 +3430,9 @@ static int drvvdMediaExIoReqWriteWrapper(PVBOXDISK pThis, PPDMMEDIAEXIOREQINT pI
             else if (rc == VINF_AIO_TASK_PENDING)
                 rc = VERR_VD_ASYNC_IO_IN_PROGRESS;
         }
+        else if (   pThis->cWritesCoalesceDepth
+                 && cbReqIo == pIoReq->ReadWrite.cbReqLeft)
+            rc = drvvdMediaExIoReqWriteCoalesce(pThis, pIoReq);
         else
             rc = VDAsyncWrite(pThis->pDisk, pIoReq->ReadWrite.offStart, cbReqIo, pIoReq->ReadWrite.pSgBuf,
                               drvvdMediaExIoReqComplete, pThis, pIoReq);
@@ -3156,6 +3453,99 @@ static int drvvdMediaExIoReqWriteWrapper(PVBOXDISK pThis, PPDMMEDIAEXIOREQINT pI
     return rc;
 }
 
+/**
+ * Completes the flush requests served by the host flush which just finished and
+ * starts a single host flush for all flush requests which arrived meanwhile.
+ *
+ * @returns nothing.
+ * @param   pThis       VBox disk container instance data.
+ * @param   rcReq       The status code the host flush completed with.
+ * @param   pIoReqSkip  Request to skip because the caller completes it, optional.
+ */
+static void drvvdMediaExIoReqFlushBatchComplete(PVBOXDISK pThis, int rcReq, PPDMMEDIAEXIOREQINT pIoReqSkip)
+{
+    for (;;)
+    {
+        RTLISTANCHOR LstIoReqDone;
+        RTListInit(&LstIoReqDone);
+
+        RTCritSectEnter(&pThis->CritSectCoalesce);
+        RTListMove(&LstIoReqDone, &pThis->LstIoReqFlushActive);
+        RTListMove(&pThis->LstIoReqFlushActive, &pThis->LstIoReqFlushWait);
+        bool fNext = !RTListIsEmpty(&pThis->LstIoReqFlushActive);
+        pThis->fFlushInFlight = fNext;
+        RTCritSectLeave(&pThis->CritSectCoalesce);
+
+        PPDMMEDIAEXIOREQINT pIoReqCur, pIoReqNext;
+        RTListForEachSafe(&LstIoReqDone, pIoReqCur, pIoReqNext, PDMMEDIAEXIOREQINT, NdLstWait)
+        {
+            RTListNodeRemove(&pIoReqCur->NdLstWait);
+            if (pIoReqCur != pIoReqSkip)
+                drvvdMediaExIoReqCompleteWorker(pThis, pIoReqCur, rcReq, true /* fUpNotify */);
+        }
+
+        if (!fNext)
+            break;
+
+        /*
+         * The waiting requests arrived after the previous host flush was started,
+         * so they need a new one but can share it.
+         */
+        pIoReqSkip = NULL;
+        rcReq = VDAsyncFlush(pThis->pDisk, drvvdMediaExIoReqFlushCoalescedComplete, pThis, NULL);
+        if (rcReq == VERR_VD_ASYNC_IO_IN_PROGRESS)
+            break;
+        if (rcReq == VINF_VD_ASYNC_IO_FINISHED)
+            rcReq = VINF_SUCCESS;
+    }
+}
+
+/**
+ * @copydoc FNVDASYNCTRANSFERCOMPLETE
+ */
+static DECLCALLBACK(void) drvvdMediaExIoReqFlushCoalescedComplete(void *pvUser1, void *pvUser2, int rcReq)
+{
+    PVBOXDISK pThis = (PVBOXDISK)pvUser1;
+    RT_NOREF1(pvUser2);
+
+    drvvdMediaExIoReqFlushBatchComplete(pThis, rcReq, NULL);
+}
+
+/**
+ * Flushes through the batching stage. If a host flush is in flight already the
+ * request waits for it to complete and shares the next host flush with all other
+ * flush requests arriving in the meantime.
+ *
+ * @returns VBox status code.
+ * @param   pThis     VBox disk container instance data.
+ * @param   pIoReq    The flush request.
+ */
+static int drvvdMediaExIoReqFlushCoalesce(PVBOXDISK pThis, PPDMMEDIAEXIOREQINT pIoReq)
+{
+    RTCritSectEnter(&pThis->CritSectCoalesce);
+    if (pThis->fFlushInFlight)
+    {
+        /* Only the first waiting request gets a host flush, all others piggyback. */
+        if (!RTListIsEmpty(&pThis->LstIoReqFlushWait))
+            STAM_REL_COUNTER_INC(&pThis->StatFlushesCoalesced);
+        RTListAppend(&pThis->LstIoReqFlushWait, &pIoReq->NdLstWait);
+        RTCritSectLeave(&pThis->CritSectCoalesce);
+        return VERR_VD_ASYNC_IO_IN_PROGRESS;
+    }
+    pThis->fFlushInFlight = true;
+    RTListAppend(&pThis->LstIoReqFlushActive, &pIoReq->NdLstWait);
+    RTCritSectLeave(&pThis->CritSectCoalesce);
+
+    int rc = VDAsyncFlush(pThis->pDisk, drvvdMediaExIoReqFlushCoalescedComplete, pThis, NULL);
+    if (rc != VERR_VD_ASYNC_IO_IN_PROGRESS)
+    {
+        /* The caller completes this request, take care of the ones which queued up meanwhile. */
+        drvvdMediaExIoReqFlushBatchComplete(pThis, rc == VINF_VD_ASYNC_IO_FINISHED ? VINF_SUCCESS : rc, pIoReq);
+    }
+
+    return rc;
+}
+
 /**
  * Wrapper around the various ways to flush all data to the underlying medium (cache, async vs. sync).
  *
@@ -3876,7 +4266,12 @@ static DECLCALLBACK(int) drvvdIoReqFlush(PPDMIMEDIAEX pInterface, PDMMEDIAEXIORE
     }
 
     ASMAtomicIncU32(&pThis->cIoReqsActive);
-    int rc = drvvdMediaExIoReqFlushWrapper(pThis, pIoReq);
+    int rc;
+    if (   pThis->fFlushCoalesce
+        && drvvdMediaExIoReqCanCoalesce(pThis, pIoReq))
+        rc = drvvdMediaExIoReqFlushCoalesce(pThis, pIoReq);
+    else
+        rc = drvvdMediaExIoReqFlushWrapper(pThis, pIoReq);
     if (rc == VERR_VD_ASYNC_IO_IN_PROGRESS)
         rc = VINF_PDM_MEDIAEX_IOREQ_IN_PROGRESS;
     else if (rc == VINF_VD_ASYNC_IO_FINISHED)
@@ -4375,6 +4770,20 @@ static int drvvdStatsRegister(PVBOXDISK pThis)
                                    "Number of processed I/O requests per second.", "/Devices/%s%u/Port%u/ReqsPerSec",
                                    pszCtrlUpper, iInstance, iLUN);
 
+            if (pThis->cWritesCoalesceDepth)
+            {
+                PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatWritesCoalesced, STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_COUNT,
+                                       "Number of write I/O requests merged into a larger host write.",
+                                       "/Devices/%s%u/Port%u/WritesCoalesced", pszCtrlUpper, iInstance, iLUN);
+                PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatWriteBatches, STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_COUNT,
+                                       "Number of host writes made up of merged write I/O requests.",
+                                       "/Devices/%s%u/Port%u/WriteBatches", pszCtrlUpper, iInstance, iLUN);
+            }
+            if (pThis->fFlushCoalesce)
+                PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatFlushesCoalesced, STAMTYPE_COUNTER, STAMVISIBILITY_USED, STAMUNIT_COUNT,
+                                       "Number of flush I/O requests served by the host flush of another request.",
+                                       "/Devices/%s%u/Port%u/FlushesCoalesced", pszCtrlUpper, iInstance, iLUN);
+
             RTStrFree(pszCtrlUpper);
         }
         else
@@ -4407,6 +4816,9 @@ static void drvvdStatsDeregister(PVBOXDISK pThis)
     PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatReqsRead);
     PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatReqsDiscard);
     PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatReqsPerSec);
+    PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatWritesCoalesced);
+    PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatWriteBatches);
+    PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatFlushesCoalesced);
 }
 
 /*********************************************************************************************************************************
@@ -4499,6 +4911,16 @@ static void drvvdPowerOffOrDestructOrUnmount(PPDMDRVINS pDrvIns)
 
     if (RT_VALID_PTR(pThis->pDisk))
     {
+        if (pThis->cbReadAhead)
+        {
+            VDREADAHEADSTATS Stats;
+            int rc2 = VDGetReadAheadStats(pThis->pDisk, &Stats);
+            if (RT_SUCCESS(rc2))
+                LogRel(("VD#%u: Read-ahead: %llu sequential reads, %llu hits (%llu bytes), %llu misses, "
+                        "%llu prefetches (%llu bytes), %llu invalidated\n",
+                        pThis->pDrvIns->iInstance, Stats.cSeqReads, Stats.cHits, Stats.cbHit, Stats.cMisses,
+                        Stats.cReadAheads, Stats.cbReadAhead, Stats.cInvalidated));
+        }
         VDDestroy(pThis->pDisk);
         pThis->pDisk = NULL;
     }
@@ -4707,6 +5129,8 @@ static DECLCALLBACK(void) drvvdDestruct(PPDMDRVINS pDrvIns)
         RTCritSectDelete(&pThis->CritSectIoReqsIoBufWait);
     if (RTCritSectIsInitialized(&pThis->CritSectIoReqRedo))
         RTCritSectDelete(&pThis->CritSectIoReqRedo);
+    if (RTCritSectIsInitialized(&pThis->CritSectCoalesce))
+        RTCritSectDelete(&pThis->CritSectCoalesce);
     for (unsigned i = 0; i < RT_ELEMENTS(pThis->aIoReqAllocBins); i++)
         if (pThis->aIoReqAllocBins[i].hMtxLstIoReqAlloc != NIL_RTSEMFASTMUTEX)
             RTSemFastMutexDestroy(pThis->aIoReqAllocBins[i].hMtxLstIoReqAlloc);
@@ -4844,11 +5268,17 @@ static DECLCALLBACK(int) drvvdConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uint
         if (RT_SUCCESS(rc))
             rc = RTCritSectInit(&pThis->CritSectIoReqRedo);
 
+        if (RT_SUCCESS(rc))
+            rc = RTCritSectInit(&pThis->CritSectCoalesce);
+
         if (RT_FAILURE(rc))
             return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Creating Mutex failed"));
 
         RTListInit(&pThis->LstIoReqIoBufWait);
         RTListInit(&pThis->LstIoReqRedo);
+        RTListInit(&pThis->LstIoReqWriteWait);
+        RTListInit(&pThis->LstIoReqFlushActive);
+        RTListInit(&pThis->LstIoReqFlushWait);
     }
 
     /* Before we access any VD API load all given plugins. */
@@ -4885,9 +5315,10 @@ static DECLCALLBACK(int) drvvdConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uint
                                           "HostIPStack\0UseNewIo\0BootAcceleration\0BootAccelerationBuffer\0"
                                           "SetupMerge\0MergeSource\0MergeTarget\0BwGroup\0Type\0BlockCache\0"
                                           "CachePath\0CacheFormat\0Discard\0InformAboutZeroBlocks\0"
-                                          "SkipConsistencyChecks\0"
+                                          "SkipConsistencyChecks\0ReadAheadSize\0ReadAheadThreshold\0"
                                           "Locked\0BIOSVisible\0Cylinders\0Heads\0Sectors\0Mountable\0"
                                           "EmptyDrive\0IoBufMax\0NonRotationalMedium\0"
+                                          "WriteCoalesceDepth\0FlushCoalesce\0"
 #if defined(VBOX_PERIODIC_FLUSH) || defined(VBOX_IGNORE_FLUSH)
                                           "FlushInterval\0IgnoreFlush\0IgnoreFlushAsync\0"
 #endif /* !(VBOX_PERIODIC_FLUSH || VBOX_IGNORE_FLUSH) */
@@ -4997,6 +5428,34 @@ static DECLCALLBACK(int) drvvdConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uint
                                       N_("DrvVD: Configuration error: Querying \"BootAccelerationBuffer\" as integer failed"));
                 break;
             }
+            rc = CFGMR3QueryU32Def(pCurNode, "ReadAheadSize", &pThis->cbReadAhead, 0);
+            if (RT_FAILURE(rc))
+            {
+                rc = PDMDRV_SET_ERROR(pDrvIns, rc,
+                                      N_("DrvVD: Configuration error: Querying \"ReadAheadSize\" as integer failed"));
+                break;
+            }
+            rc = CFGMR3QueryU32Def(pCurNode, "ReadAheadThreshold", &pThis->cReadAheadThreshold, 2);
+            if (RT_FAILURE(rc))
+            {
+                rc = PDMDRV_SET_ERROR(pDrvIns, rc,
+                                      N_("DrvVD: Configuration error: Querying \"ReadAheadThreshold\" as integer failed"));
+                break;
+            }
+            rc = CFGMR3QueryU32Def(pCurNode, "WriteCoalesceDepth", &pThis->cWritesCoalesceDepth, 0);
+            if (RT_FAILURE(rc))
+            {
+                rc = PDMDRV_SET_ERROR(pDrvIns, rc,
+                                      N_("DrvVD: Configuration error: Querying \"WriteCoalesceDepth\" as integer failed"));
+                break;
+            }
+            rc = CFGMR3QueryBoolDef(pCurNode, "FlushCoalesce", &pThis->fFlushCoalesce, false);
+            if (RT_FAILURE(rc))
+            {
+                rc = PDMDRV_SET_ERROR(pDrvIns, rc,
+                                      N_("DrvVD: Configuration error: Querying \"FlushCoalesce\" as boolean failed"));
+                break;
+            }
             rc = CFGMR3QueryBoolDef(pCurNode, "BlockCache", &fUseBlockCache, false);
             if (RT_FAILURE(rc))
             {
@@ -5648,6 +6107,26 @@ static DECLCALLBACK(int) drvvdConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uint
                 LogRel(("VD: Boot acceleration, out of memory, disabled\n"));
         }
 
+        /* Setup read-ahead for sequential read streams if enabled. */
+        if (RT_SUCCESS(rc) && pThis->cbReadAhead)
+        {
+            rc = VDSetReadAhead(pThis->pDisk, pThis->cbReadAhead, pThis->cReadAheadThreshold);
+            if (RT_SUCCESS(rc))
+                LogRel(("VD#%u: Read-ahead enabled (window %u bytes, threshold %u)\n",
+                        pDrvIns->iInstance, pThis->cbReadAhead, pThis->cReadAheadThreshold));
+            else
+                rc = PDMDrvHlpVMSetError(pDrvIns, rc, RT_SRC_POS,
+                                         N_("DrvVD: Failed to enable read-ahead (window %u bytes, threshold %u)"),
+                                         pThis->cbReadAhead, pThis->cReadAheadThreshold);
+        }
+
+        if (   RT_SUCCESS(rc)
+            && pThis->pDrvMediaExPort
+            && (pThis->cWritesCoalesceDepth || pThis->fFlushCoalesce))
+            LogRel(("VD#%u: Write coalescing %s (depth %u), flush batching %s\n", pDrvIns->iInstance,
+                    pThis->cWritesCoalesceDepth ? "enabled" : "disabled", pThis->cWritesCoalesceDepth,
+                    pThis->fFlushCoalesce ? "enabled" : "disabled"));
+
         if (   RTUuidIsNull(&pThis->Uuid)
             && pThis->enmType == PDMMEDIATYPE_HARD_DISK)
             VDGetUuid(pThis->pDisk, 0, &pThis->Uuid);
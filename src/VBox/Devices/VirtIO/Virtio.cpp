@@ -21,6 +21,7 @@
 *********************************************************************************************************************************/
 #define LOG_GROUP LOG_GROUP_DEV_VIRTIO
 
+#include <iprt/asm.h>
 #include <iprt/param.h>
 #include <iprt/uuid.h>
 #include <VBox/vmm/pdmdev.h>
@@ -41,14 +42,35 @@
 //RT_C_DECLS_END
 
 
+/**
+ * Window of descriptors read from a descriptor table in one go.
+ */
+typedef struct VRINGDESCCACHE
+{
+    /** Guest physical address of the descriptor table. */
+    RTGCPHYS    GCPhysTable;
+    /** Number of descriptors in the table. */
+    uint32_t    cTable;
+    /** Table index of aDescs[0]. */
+    uint32_t    iFirst;
+    /** Number of valid entries in aDescs. */
+    uint32_t    cValid;
+    /** The cached descriptors. */
+    VRINGDESC   aDescs[VRING_DESC_CACHE_SIZE];
+} VRINGDESCCACHE;
+typedef VRINGDESCCACHE *PVRINGDESCCACHE;
+
+
 static void vqueueReset(PVQUEUE pQueue)
 {
     pQueue->VRing.addrDescriptors = 0;
     pQueue->VRing.addrAvail       = 0;
     pQueue->VRing.addrUsed        = 0;
+    pQueue->VRing.fNoNotify       = false;
     pQueue->uNextAvailIndex       = 0;
     pQueue->uNextUsedIndex        = 0;
     pQueue->uPageNumber           = 0;
+    pQueue->fSignalledUsedValid   = false;
 }
 
 static void vqueueInit(PVQUEUE pQueue, uint32_t uPageNumber)
@@ -56,11 +78,14 @@ static void vqueueInit(PVQUEUE pQueue, uint32_t uPageNumber)
     pQueue->VRing.addrDescriptors = (uint64_t)uPageNumber << PAGE_SHIFT;
     pQueue->VRing.addrAvail       = pQueue->VRing.addrDescriptors
         + sizeof(VRINGDESC) * pQueue->VRing.uSize;
+    /* The used ring must start from the next page, the guest always leaves room for used_event. */
     pQueue->VRing.addrUsed        = RT_ALIGN(
-        pQueue->VRing.addrAvail + RT_OFFSETOF(VRINGAVAIL, auRing[pQueue->VRing.uSize]),
-        PAGE_SIZE); /* The used ring must start from the next page. */
+        pQueue->VRing.addrAvail + RT_OFFSETOF(VRINGAVAIL, auRing[pQueue->VRing.uSize]) + sizeof(uint16_t),
+        PAGE_SIZE);
+    pQueue->VRing.fNoNotify       = false;
     pQueue->uNextAvailIndex       = 0;
     pQueue->uNextUsedIndex        = 0;
+    pQueue->fSignalledUsedValid   = false;
 }
 
 // void vqueueElemFree(PVQUEUEELEM pElem)
@@ -75,6 +100,42 @@ void vringReadDesc(PVPCISTATE pState, PVRING pVRing, uint32_t uIndex, PVRINGDESC
                       pDesc, sizeof(VRINGDESC));
 }
 
+/**
+ * Points a descriptor cache at a descriptor table, invalidating it.
+ */
+DECLINLINE(void) vringDescCacheInit(PVRINGDESCCACHE pCache, RTGCPHYS GCPhysTable, uint32_t cTable)
+{
+    pCache->GCPhysTable = GCPhysTable;
+    pCache->cTable      = cTable;
+    pCache->iFirst      = 0;
+    pCache->cValid      = 0;
+}
+
+/**
+ * Gets a descriptor via the cache.
+ *
+ * Chains are usually made of consecutive descriptors, so on a miss the
+ * following ones are fetched too and most chains cost a single read.
+ *
+ * @param   pState      The device state structure.
+ * @param   pCache      The descriptor cache.
+ * @param   uIndex      The table index, must be less than pCache->cTable.
+ * @param   pDesc       Where to store the descriptor.
+ */
+static void vringDescCacheGet(PVPCISTATE pState, PVRINGDESCCACHE pCache, uint32_t uIndex, PVRINGDESC pDesc)
+{
+    Assert(uIndex < pCache->cTable);
+    if (uIndex - pCache->iFirst >= pCache->cValid)
+    {
+        pCache->iFirst = uIndex;
+        pCache->cValid = RT_MIN(pCache->cTable - uIndex, VRING_DESC_CACHE_SIZE);
+        PDMDevHlpPhysRead(pState->CTX_SUFF(pDevIns),
+                          pCache->GCPhysTable + sizeof(VRINGDESC) * uIndex,
+                          pCache->aDescs, sizeof(VRINGDESC) * pCache->cValid);
+    }
+    *pDesc = pCache->aDescs[uIndex - pCache->iFirst];
+}
+
 uint16_t vringReadAvail(PVPCISTATE pState, PVRING pVRing, uint32_t uIndex)
 {
     uint16_t tmp;
@@ -95,10 +156,45 @@ uint16_t vringReadAvailFlags(PVPCISTATE pState, PVRING pVRing)
     return tmp;
 }
 
+/**
+ * Tells the guest the avail index it should notify us at (avail_event).
+ */
+DECLINLINE(void) vringWriteAvailEvent(PVPCISTATE pState, PVRING pVRing, uint16_t u16Value)
+{
+    PDMDevHlpPCIPhysWrite(pState->CTX_SUFF(pDevIns),
+                          pVRing->addrUsed + RT_OFFSETOF(VRINGUSED, aRing[pVRing->uSize]),
+                          &u16Value, sizeof(u16Value));
+}
+
+/**
+ * Reads the used index at which the guest wants an interrupt (used_event).
+ */
+DECLINLINE(uint16_t) vringReadUsedEvent(PVPCISTATE pState, PVRING pVRing)
+{
+    uint16_t tmp;
+    PDMDevHlpPhysRead(pState->CTX_SUFF(pDevIns),
+                      pVRing->addrAvail + RT_OFFSETOF(VRINGAVAIL, auRing[pVRing->uSize]),
+                      &tmp, sizeof(tmp));
+    return tmp;
+}
+
 void vringSetNotification(PVPCISTATE pState, PVRING pVRing, bool fEnabled)
 {
     uint16_t tmp;
 
+    pVRing->fNoNotify = !fEnabled;
+    if (pState->uGuestFeatures & VPCI_F_RING_EVENT_IDX)
+    {
+        /*
+         * The guest ignores the flags and notifies us when the avail index
+         * passes avail_event.  Leaving a stale avail_event is what disables
+         * notifications, so only enabling needs a write.
+         */
+        if (fEnabled)
+            vringWriteAvailEvent(pState, pVRing, vringReadAvailIndex(pState, pVRing));
+        return;
+    }
+
     PDMDevHlpPhysRead(pState->CTX_SUFF(pDevIns),
                       pVRing->addrUsed + RT_OFFSETOF(VRINGUSED, uFlags),
                       &tmp, sizeof(tmp));
@@ -124,21 +220,65 @@ bool vqueueSkip(PVPCISTATE pState, PVQUEUE pQueue)
     return true;
 }
 
-bool vqueueGet(PVPCISTATE pState, PVQUEUE pQueue, PVQUEUEELEM pElem, bool fRemove)
+/**
+ * Re-arms guest notifications for an empty queue when using event indexes.
+ *
+ * With VPCI_F_RING_EVENT_IDX the guest only notifies us when it moves the
+ * avail index past avail_event, so it has to follow our consumption.  The
+ * guest may have added buffers just before the update, hence the re-check.
+ *
+ * @returns true if the queue turned out to have buffers after all.
+ * @param   pState      The device state structure.
+ * @param   pQueue      The queue.
+ */
+static bool vqueueArmAvailEvent(PVPCISTATE pState, PVQUEUE pQueue)
 {
-    if (vqueueIsEmpty(pState, pQueue))
+    if (   !(pState->uGuestFeatures & VPCI_F_RING_EVENT_IDX)
+        || pQueue->VRing.fNoNotify)
         return false;
+    vringWriteAvailEvent(pState, &pQueue->VRing, pQueue->uNextAvailIndex);
+    ASMMemoryFence();
+    return !vqueueIsEmpty(pState, pQueue);
+}
 
-    pElem->nIn = pElem->nOut = 0;
+bool vqueueGet(PVPCISTATE pState, PVQUEUE pQueue, PVQUEUEELEM pElem, bool fRemove)
+{
+    if (   vqueueIsEmpty(pState, pQueue)
+        && !vqueueArmAvailEvent(pState, pQueue))
+        return false;
 
     Log2(("%s vqueueGet: %s avail_idx=%u\n", INSTANCE(pState),
           QUEUENAME(pState, pQueue), pQueue->uNextAvailIndex));
 
-    VRINGDESC desc;
-    uint16_t  idx = vringReadAvail(pState, &pQueue->VRing, pQueue->uNextAvailIndex);
+    uint16_t idx = vringReadAvail(pState, &pQueue->VRing, pQueue->uNextAvailIndex);
     if (fRemove)
         pQueue->uNextAvailIndex++;
+    vqueueReadChain(pState, pQueue, idx, pElem);
+    return true;
+}
+
+/**
+ * Collects the segments of the descriptor chain starting at the given head.
+ *
+ * Used by vqueueGet() and by devices that have to pick up requests again
+ * which were taken off the available ring before the VM state was saved.
+ *
+ * @param   pState      The device state structure.
+ * @param   pQueue      The queue the chain belongs to.
+ * @param   uHeadIndex  Index of the head descriptor.
+ * @param   pElem       Where to store the segments.
+ */
+void vqueueReadChain(PVPCISTATE pState, PVQUEUE pQueue, uint16_t uHeadIndex, PVQUEUEELEM pElem)
+{
+    pElem->nIn = pElem->nOut = 0;
+
+    VRINGDESC desc;
+    uint16_t  idx = uHeadIndex;
     pElem->uIndex = idx;
+
+    VRINGDESCCACHE Cache;
+    vringDescCacheInit(&Cache, pQueue->VRing.addrDescriptors, pQueue->VRing.uSize);
+    bool fIndirect = false;
     do
     {
         VQUEUESEG *pSeg;
@@ -165,16 +305,44 @@ bool vqueueGet(PVPCISTATE pState, PVQUEUE pQueue, PVQUEUEELEM pElem, bool fRemov
             break;
         }
 
-        vringReadDesc(pState, &pQueue->VRing, idx, &desc);
+        if (fIndirect && idx >= Cache.cTable)
+        {
+            Log(("%s vqueueReadChain: %s indirect descriptor index %u is out of bounds (%u)\n", INSTANCE(pState),
+                 QUEUENAME(pState, pQueue), idx, Cache.cTable));
+            break;
+        }
+        vringDescCacheGet(pState, &Cache, fIndirect ? idx : idx % pQueue->VRing.uSize, &desc);
+
+        if (desc.u16Flags & VRINGDESC_F_INDIRECT)
+        {
+            /* The descriptor refers to a table holding the actual chain, nesting is not allowed. */
+            if (   fIndirect
+                || !(pState->uGuestFeatures & VPCI_F_RING_INDIRECT_DESC)
+                || desc.uLen < sizeof(VRINGDESC)
+                || desc.uLen % sizeof(VRINGDESC))
+            {
+                Log(("%s vqueueReadChain: %s invalid indirect descriptor (len=%u flags=%x)\n", INSTANCE(pState),
+                     QUEUENAME(pState, pQueue), desc.uLen, desc.u16Flags));
+                break;
+            }
+            Log2(("%s vqueueReadChain: %s indirect table addr=%RGp entries=%u\n", INSTANCE(pState),
+                  QUEUENAME(pState, pQueue), desc.u64Addr, desc.uLen / sizeof(VRINGDESC)));
+            fIndirect = true;
+            vringDescCacheInit(&Cache, desc.u64Addr, RT_MIN(desc.uLen / sizeof(VRINGDESC), VRING_MAX_SIZE));
+            idx = 0;
+            desc.u16Flags = VRINGDESC_F_NEXT;
+            continue;
+        }
+
         if (desc.u16Flags & VRINGDESC_F_WRITE)
         {
-            Log2(("%s vqueueGet: %s IN  seg=%u desc_idx=%u addr=%p cb=%u\n", INSTANCE(pState),
+            Log2(("%s vqueueReadChain: %s IN  seg=%u desc_idx=%u addr=%p cb=%u\n", INSTANCE(pState),
                   QUEUENAME(pState, pQueue), pElem->nIn, idx, desc.u64Addr, desc.uLen));
             pSeg = &pElem->aSegsIn[pElem->nIn++];
         }
         else
         {
-            Log2(("%s vqueueGet: %s OUT seg=%u desc_idx=%u addr=%p cb=%u\n", INSTANCE(pState),
+            Log2(("%s vqueueReadChain: %s OUT seg=%u desc_idx=%u addr=%p cb=%u\n", INSTANCE(pState),
                   QUEUENAME(pState, pQueue), pElem->nOut, idx, desc.u64Addr, desc.uLen));
             pSeg = &pElem->aSegsOut[pElem->nOut++];
         }
@@ -186,9 +354,8 @@ bool vqueueGet(PVPCISTATE pState, PVQUEUE pQueue, PVQUEUEELEM pElem, bool fRemov
         idx = desc.u16Next;
     } while (desc.u16Flags & VRINGDESC_F_NEXT);
 
-    Log2(("%s vqueueGet: %s head_desc_idx=%u nIn=%u nOut=%u\n", INSTANCE(pState),
+    Log2(("%s vqueueReadChain: %s head_desc_idx=%u nIn=%u nOut=%u\n", INSTANCE(pState),
           QUEUENAME(pState, pQueue), pElem->uIndex, pElem->nIn, pElem->nOut));
-    return true;
 }
 
 uint16_t vringReadUsedIndex(PVPCISTATE pState, PVRING pVRing)
@@ -278,6 +445,23 @@ void vqueuePut(PVPCISTATE pState, PVQUEUE pQueue,
                        pElem->uIndex, uTotalLen);
 }
 
+/**
+ * Puts a descriptor chain on the used ring without touching its buffers.
+ *
+ * For devices which fill the guest buffers themselves, e.g. from an
+ * asynchronous I/O completion, and only need to hand the chain back.
+ *
+ * @param   pState      The device state structure.
+ * @param   pQueue      The queue the chain was taken from.
+ * @param   uIndex      Index of the head descriptor of the chain.
+ * @param   uTotalLen   The number of bytes written into the chain.
+ */
+void vqueuePutIndex(PVPCISTATE pState, PVQUEUE pQueue, uint16_t uIndex, uint32_t uTotalLen)
+{
+    Log2(("%s vqueuePutIndex: %s used_idx=%u id=%u len=%u\n", INSTANCE(pState),
+          QUEUENAME(pState, pQueue), pQueue->uNextUsedIndex, uIndex, uTotalLen));
+    vringWriteUsedElem(pState, &pQueue->VRing, pQueue->uNextUsedIndex++, uIndex, uTotalLen);
+}
 
 void vqueueNotify(PVPCISTATE pState, PVQUEUE pQueue)
 {
@@ -285,7 +469,26 @@ void vqueueNotify(PVPCISTATE pState, PVQUEUE pQueue)
              INSTANCE(pState), QUEUENAME(pState, pQueue),
              vringReadAvailFlags(pState, &pQueue->VRing),
              pState->uGuestFeatures, vqueueIsEmpty(pState, pQueue)?"":"not "));
-    if (!(vringReadAvailFlags(pState, &pQueue->VRing) & VRINGAVAIL_F_NO_INTERRUPT)
+    bool fNeedInterrupt;
+    if (pState->uGuestFeatures & VPCI_F_RING_EVENT_IDX)
+    {
+        /*
+         * Interrupt only if the used index has moved past used_event since the
+         * last decision, i.e. the guest has not seen these entries coming.
+         */
+        ASMMemoryFence(); /* The used index update must be visible before used_event is read. */
+        uint16_t const uNew      = pQueue->uNextUsedIndex;
+        uint16_t const uOld      = pQueue->uSignalledUsedIndex;
+        uint16_t const uEvent    = vringReadUsedEvent(pState, &pQueue->VRing);
+        fNeedInterrupt = !pQueue->fSignalledUsedValid
+                      || (uint16_t)(uNew - uEvent - 1) < (uint16_t)(uNew - uOld);
+        pQueue->uSignalledUsedIndex = uNew;
+        pQueue->fSignalledUsedValid = true;
+    }
+    else
+        fNeedInterrupt = !(vringReadAvailFlags(pState, &pQueue->VRing) & VRINGAVAIL_F_NO_INTERRUPT);
+
+    if (   fNeedInterrupt
         || ((pState->uGuestFeatures & VPCI_F_NOTIFY_ON_EMPTY) && vqueueIsEmpty(pState, pQueue)))
     {
         int rc = vpciRaiseInterrupt(pState, VERR_INTERNAL_ERROR, VPCI_ISR_QUEUE);
@@ -337,7 +540,12 @@ int vpciRaiseInterrupt(VPCISTATE *pState, int rcBusy, uint8_t u8IntCause)
     LogFlow(("%s vpciRaiseInterrupt: u8IntCause=%x\n",
              INSTANCE(pState), u8IntCause));
 
-    pState->uISR |= u8IntCause;
+    /* Completions may be signalled from I/O threads without holding the
+       device lock, so merge the cause bits atomically. */
+    uint8_t u8Old;
+    do
+        u8Old = ASMAtomicUoReadU8(&pState->uISR);
+    while (!ASMAtomicCmpXchgU8(&pState->uISR, u8Old | u8IntCause, u8Old));
     PDMDevHlpPCISetIrq(pState->CTX_SUFF(pDevIns), 0, 1);
     // vpciCsLeave(pState);
     return VINF_SUCCESS;
@@ -358,7 +566,9 @@ DECLINLINE(uint32_t) vpciGetHostFeatures(PVPCISTATE pState,
                                          PFNGETHOSTFEATURES pfnGetHostFeatures)
 {
     return pfnGetHostFeatures(pState)
-        | VPCI_F_NOTIFY_ON_EMPTY;
+        | VPCI_F_NOTIFY_ON_EMPTY
+        | VPCI_F_RING_INDIRECT_DESC
+        | VPCI_F_RING_EVENT_IDX;
 }
 
 /**
@@ -436,9 +646,11 @@ int vpciIOPortIn(PPDMDEVINS         pDevIns,
 
         case VPCI_ISR:
             Assert(cb == 1);
-            *(uint8_t*)pu32 = pState->uISR;
-            pState->uISR = 0; /* read clears all interrupts */
+            *(uint8_t*)pu32 = ASMAtomicXchgU8(&pState->uISR, 0); /* read clears all interrupts */
             vpciLowerInterrupt(pState);
+            /* Don't lose a cause raised between clearing and lowering. */
+            if (ASMAtomicReadU8(&pState->uISR))
+                PDMDevHlpPCISetIrq(pState->CTX_SUFF(pDevIns), 0, 1);
             break;
 
         default:
@@ -764,6 +976,8 @@ int vpciSaveExec(PVPCISTATE pState, PSSMHANDLE pSSM)
  * @param   pSSM        The handle to the saved state.
  * @param   uVersion    The data unit version number.
  * @param   uPass       The data pass.
+ * @param   nQueues     The number of queues implied by saved states that
+ *                      predate storing it.
  */
 int vpciLoadExec(PVPCISTATE pState, PSSMHANDLE pSSM, uint32_t uVersion, uint32_t uPass, uint32_t nQueues)
 {
@@ -778,17 +992,19 @@ int vpciLoadExec(PVPCISTATE pState, PSSMHANDLE pSSM, uint32_t uVersion, uint32_t
         AssertRCReturn(rc, rc);
         rc = SSMR3GetU8( pSSM, &pState->uStatus);
         AssertRCReturn(rc, rc);
-        rc = SSMR3GetU8( pSSM, &pState->uISR);
+        rc = SSMR3GetU8( pSSM, (uint8_t *)&pState->uISR);
         AssertRCReturn(rc, rc);
 
         /* Restore queues */
+        uint32_t nQueuesSaved = nQueues;
         if (uVersion > VIRTIO_SAVEDSTATE_VERSION_3_1_BETA1)
         {
-            rc = SSMR3GetU32(pSSM, &pState->nQueues);
+            rc = SSMR3GetU32(pSSM, &nQueuesSaved);
             AssertRCReturn(rc, rc);
         }
-        else
-            pState->nQueues = nQueues;
+        if (nQueuesSaved != pState->nQueues)
+            return SSMR3SetCfgError(pSSM, RT_SRC_POS, N_("The number of queues differs: config=%u saved=%u"),
+                                    pState->nQueues, nQueuesSaved);
         for (unsigned i = 0; i < pState->nQueues; i++)
         {
             rc = SSMR3GetU16(pSSM, &pState->Queues[i].VRing.uSize);
@@ -28,7 +28,8 @@
  * for example.
  */
 #define VIRTIO_SAVEDSTATE_VERSION_3_1_BETA1 1
-#define VIRTIO_SAVEDSTATE_VERSION           2
+#define VIRTIO_SAVEDSTATE_VERSION_PRE_MQ    2
+#define VIRTIO_SAVEDSTATE_VERSION           3
 /** @} */
 
 #define DEVICE_PCI_VENDOR_ID                0x1AF4
@@ -36,7 +37,8 @@
 #define DEVICE_PCI_SUBSYSTEM_VENDOR_ID      0x1AF4
 #define DEVICE_PCI_SUBSYSTEM_BASE_ID       1
 
-#define VIRTIO_MAX_NQUEUES                  3
+/** Enough for a network device with 8 RX/TX queue pairs plus a control queue. */
+#define VIRTIO_MAX_NQUEUES                  17
 
 #define VPCI_HOST_FEATURES                  0x0
 #define VPCI_GUEST_FEATURES                 0x4
@@ -83,6 +85,7 @@ typedef struct VRingAvail
     uint16_t uFlags;
     uint16_t uNextFreeIndex;
     uint16_t auRing[1];
+    /* uint16_t uUsedEvent; - follows auRing[uSize], VPCI_F_RING_EVENT_IDX only. */
 } VRINGAVAIL;
 
 typedef struct VRingUsedElem
@@ -98,15 +101,21 @@ typedef struct VRingUsed
     uint16_t      uFlags;
     uint16_t      uIndex;
     VRINGUSEDELEM aRing[1];
+    /* uint16_t uAvailEvent; - follows aRing[uSize], VPCI_F_RING_EVENT_IDX only. */
 } VRINGUSED;
 typedef VRINGUSED *PVRINGUSED;
 
 #define VRING_MAX_SIZE 1024
 
+/** Number of descriptors fetched from guest memory with a single read. */
+#define VRING_DESC_CACHE_SIZE 32
+
 typedef struct VRing
 {
     uint16_t   uSize;
-    uint16_t   padding[3];
+    /** Set if the device asked the guest not to notify it (vringSetNotification). */
+    bool       fNoNotify;
+    uint8_t    padding[5];
     RTGCPHYS   addrDescriptors;
     RTGCPHYS   addrAvail;
     RTGCPHYS   addrUsed;
@@ -129,6 +138,11 @@ typedef struct VQueue
     uint16_t uNextAvailIndex;
     uint16_t uNextUsedIndex;
     uint32_t uPageNumber;
+    /** The used index at the last interrupt decision (VPCI_F_RING_EVENT_IDX). */
+    uint16_t uSignalledUsedIndex;
+    /** Whether uSignalledUsedIndex is valid, cleared when the ring is set up. */
+    bool     fSignalledUsedValid;
+    bool     afPadding[5];
     R3PTRTYPE(PFNVPCIQUEUECALLBACK) pfnCallback;
     R3PTRTYPE(const char *)         pcszName;
 } VQUEUE;
@@ -202,7 +216,7 @@ typedef struct VPCIState_st
     uint32_t               uGuestFeatures;
     uint16_t               uQueueSelector;         /**< An index in aQueues array. */
     uint8_t                uStatus; /**< Device Status (bits are device-specific). */
-    uint8_t                uISR;                   /**< Interrupt Status Register. */
+    uint8_t volatile       uISR;                   /**< Interrupt Status Register, updated atomically. */
 
 #if HC_ARCH_BITS != 64
     uint32_t               padding3;
@@ -305,7 +319,9 @@ DECLINLINE(uint16_t) vringReadAvailIndex(PVPCISTATE pState, PVRING pVRing)
 
 bool vqueueSkip(PVPCISTATE pState, PVQUEUE pQueue);
 bool vqueueGet(PVPCISTATE pState, PVQUEUE pQueue, PVQUEUEELEM pElem, bool fRemove = true);
+void vqueueReadChain(PVPCISTATE pState, PVQUEUE pQueue, uint16_t uHeadIndex, PVQUEUEELEM pElem);
 void vqueuePut(PVPCISTATE pState, PVQUEUE pQueue, PVQUEUEELEM pElem, uint32_t uLen, uint32_t uReserved = 0);
+void vqueuePutIndex(PVPCISTATE pState, PVQUEUE pQueue, uint16_t uIndex, uint32_t uTotalLen);
 void vqueueNotify(PVPCISTATE pState, PVQUEUE pQueue);
 void vqueueSync(PVPCISTATE pState, PVQUEUE pQueue);
 
@@ -46,6 +46,8 @@
 #ifdef VBOX_WITH_VIRTIO
 # undef LOG_GROUP
 # include "../Network/DevVirtioNet.cpp"
+# undef LOG_GROUP
+# include "../Storage/DevVirtioBlk.cpp"
 #endif
 #undef LOG_GROUP
 #include "../PC/DevACPI.cpp"
@@ -300,6 +302,11 @@ int main()
 #endif
 #ifdef VBOX_WITH_VIRTIO
     CHECK_MEMBER_ALIGNMENT(VNETSTATE, StatReceiveBytes, 8);
+    CHECK_MEMBER_ALIGNMENT(VNETSTATE, aQueuePairs, 8);
+    CHECK_MEMBER_ALIGNMENT(VBLKSTATE, StatReads, 8);
+    CHECK_MEMBER_ALIGNMENT(VBLKSTATE, aQueues, 8);
+    CHECK_MEMBER_ALIGNMENT(VBLKQUEUE, CritSect, 8);
+    CHECK_MEMBER_ALIGNMENT(VBLKQUEUE, StatRequests, 8);
 #endif
     //CHECK_MEMBER_ALIGNMENT(E1KSTATE, csTx, 8);
 #ifdef VBOX_WITH_USB
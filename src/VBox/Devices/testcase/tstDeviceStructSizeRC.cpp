@@ -92,6 +92,8 @@
 #ifdef VBOX_WITH_VIRTIO
 # undef LOG_GROUP
 # include "../Network/DevVirtioNet.cpp"
+# undef LOG_GROUP
+# include "../Storage/DevVirtioBlk.cpp"
 #endif
 #ifdef VBOX_WITH_BUSLOGIC
 # undef LOG_GROUP
@@ -1509,8 +1511,45 @@ int main()
     GEN_CHECK_OFF(VNETSTATE, pRxQueue);
     GEN_CHECK_OFF(VNETSTATE, pTxQueue);
     GEN_CHECK_OFF(VNETSTATE, pCtlQueue);
+    GEN_CHECK_OFF(VNETSTATE, hEventTxIdle);
+    GEN_CHECK_OFF(VNETSTATE, fTxIdleWaiter);
     GEN_CHECK_OFF(VNETSTATE, fMaybeOutOfSpace);
     GEN_CHECK_OFF(VNETSTATE, hEventMoreRxDescAvail);
+    GEN_CHECK_OFF(VNETSTATE, cMaxQueuePairs);
+    GEN_CHECK_OFF(VNETSTATE, cActiveQueuePairs);
+    GEN_CHECK_OFF(VNETSTATE, aQueuePairs);
+    GEN_CHECK_OFF(VNETSTATE, aQueuePairs[1]);
+    GEN_CHECK_SIZE(VNETQUEUEPAIR);
+    GEN_CHECK_OFF(VNETQUEUEPAIR, pRxQueue);
+    GEN_CHECK_OFF(VNETQUEUEPAIR, pTxQueue);
+    GEN_CHECK_OFF(VNETQUEUEPAIR, hEventTx);
+    GEN_CHECK_OFF(VNETQUEUEPAIR, uIsTransmitting);
+    GEN_CHECK_OFF(VNETQUEUEPAIR, iPair);
+    GEN_CHECK_SIZE(VBLKSTATE);
+    GEN_CHECK_OFF(VBLKSTATE, VPCI);
+    GEN_CHECK_OFF(VBLKSTATE, IPort);
+    GEN_CHECK_OFF(VBLKSTATE, IMediaExPort);
+    GEN_CHECK_OFF(VBLKSTATE, pDrvBase);
+    GEN_CHECK_OFF(VBLKSTATE, pDrvMedia);
+    GEN_CHECK_OFF(VBLKSTATE, pDrvMediaEx);
+    GEN_CHECK_OFF(VBLKSTATE, config);
+    GEN_CHECK_OFF(VBLKSTATE, cQueues);
+    GEN_CHECK_OFF(VBLKSTATE, fReadOnly);
+    GEN_CHECK_OFF(VBLKSTATE, fDiscard);
+    GEN_CHECK_OFF(VBLKSTATE, fSignalIdle);
+    GEN_CHECK_OFF(VBLKSTATE, cReqsActive);
+    GEN_CHECK_OFF(VBLKSTATE, uResetGen);
+    GEN_CHECK_OFF(VBLKSTATE, szId);
+    GEN_CHECK_OFF(VBLKSTATE, pau32Redo);
+    GEN_CHECK_OFF(VBLKSTATE, cRedo);
+    GEN_CHECK_OFF(VBLKSTATE, StatReads);
+    GEN_CHECK_OFF(VBLKSTATE, aQueues);
+    GEN_CHECK_OFF(VBLKSTATE, aQueues[1]);
+    GEN_CHECK_SIZE(VBLKQUEUE);
+    GEN_CHECK_OFF(VBLKQUEUE, CritSect);
+    GEN_CHECK_OFF(VBLKQUEUE, pQueue);
+    GEN_CHECK_OFF(VBLKQUEUE, iQueue);
+    GEN_CHECK_OFF(VBLKQUEUE, StatRequests);
 #endif /* VBOX_WITH_VIRTIO */
 
 #ifdef VBOX_WITH_SCSI
@@ -319,6 +319,7 @@ int vbsfMappingsRemove(PSHFLSTRING pMapName)
                 FolderMapping[i].pszFolderName = NULL;
                 FolderMapping[i].pMapName      = NULL;
                 FolderMapping[i].fValid        = false;
+                vbsfPathCacheFlush(vbsfMappingGetRootFromIndex(i));
                 vbsfRootHandleRemove(i);
                 return VINF_SUCCESS;
             }
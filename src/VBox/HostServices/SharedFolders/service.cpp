@@ -22,9 +22,16 @@
 #include "mappings.h"
 #include "shflhandle.h"
 #include "vbsf.h"
+#include "vbsfpath.h"
 #include <iprt/alloc.h>
 #include <iprt/string.h>
 #include <iprt/assert.h>
+#include <iprt/asm.h>
+#include <iprt/critsect.h>
+#include <iprt/list.h>
+#include <iprt/mp.h>
+#include <iprt/semaphore.h>
+#include <iprt/thread.h>
 #include <VBox/vmm/ssm.h>
 #include <VBox/vmm/pdmifs.h>
 
@@ -73,12 +80,18 @@
 PVBOXHGCMSVCHELPERS g_pHelpers;
 static PPDMLED      pStatusLed = NULL;
 
+static void svcPoolDrain(void);
+static void svcPoolTerm(void);
+
 static DECLCALLBACK(int) svcUnload (void *)
 {
     int rc = VINF_SUCCESS;
 
     Log(("svcUnload\n"));
 
+    svcPoolTerm();
+    vbsfPathCacheTerm();
+
     return rc;
 }
 
@@ -100,6 +113,9 @@ static DECLCALLBACK(int) svcDisconnect (void *, uint32_t u32ClientID, void *pvCl
 
     Log(("SharedFolders host service: disconnected, u32ClientID = %u\n", u32ClientID));
 
+    /* The client data goes away after this, so complete everything still referring to it. */
+    svcPoolDrain();
+
     vbsfDisconnect(pClient);
     return rc;
 }
@@ -118,6 +134,8 @@ static DECLCALLBACK(int) svcSaveState(void *, uint32_t u32ClientID, void *pvClie
 
     Log(("SharedFolders host service: saving state, u32ClientID = %u\n", u32ClientID));
 
+    svcPoolDrain();
+
     int rc = SSMR3PutU32(pSSM, SHFL_SSM_VERSION);
     AssertRCReturn(rc, rc);
 
@@ -185,6 +203,8 @@ static DECLCALLBACK(int) svcLoadState(void *, uint32_t u32ClientID, void *pvClie
 
     Log(("SharedFolders host service: loading state, u32ClientID = %u\n", u32ClientID));
 
+    svcPoolDrain();
+
     int rc = SSMR3GetU32(pSSM, &version);
     AssertRCReturn(rc, rc);
 
@@ -295,17 +315,21 @@ static DECLCALLBACK(int) svcLoadState(void *, uint32_t u32ClientID, void *pvClie
     return VINF_SUCCESS;
 }
 
-static DECLCALLBACK(void) svcCall (void *, VBOXHGCMCALLHANDLE callHandle, uint32_t u32ClientID, void *pvClient, uint32_t u32Function, uint32_t cParms, VBOXHGCMSVCPARM paParms[])
+/**
+ * Executes a guest call.
+ *
+ * Called either on the HGCM service thread or on one of the worker threads,
+ * see svcCall().
+ *
+ * @returns VBox status code to complete the call with.
+ */
+static int svcCallWorker(uint32_t u32ClientID, SHFLCLIENTDATA *pClient, uint32_t u32Function, uint32_t cParms, VBOXHGCMSVCPARM paParms[])
 {
     RT_NOREF1(u32ClientID);
     int rc = VINF_SUCCESS;
 
     Log(("SharedFolders host service: svcCall: u32ClientID = %u, fn = %u, cParms = %u, pparms = %p\n", u32ClientID, u32Function, cParms, paParms));
 
-    SHFLCLIENTDATA *pClient = (SHFLCLIENTDATA *)pvClient;
-
-    bool fAsynchronousProcessing = false;
-
 #ifdef LOG_ENABLED
     for (uint32_t i = 0; i < cParms; i++)
     {
@@ -558,12 +582,14 @@ static DECLCALLBACK(void) svcCall (void *, VBOXHGCMCALLHANDLE callHandle, uint32
                     if (pStatusLed)
                     {
                         Assert(pStatusLed->u32Magic == PDMLED_MAGIC);
-                        pStatusLed->Asserted.s.fReading = pStatusLed->Actual.s.fReading = 1;
+                        /* Several workers may update the LED at once. */
+                        ASMAtomicOrU32(&pStatusLed->Asserted.u32, PDMLED_READING);
+                        ASMAtomicOrU32(&pStatusLed->Actual.u32, PDMLED_READING);
                     }
 
                     rc = vbsfRead (pClient, root, Handle, offset, &count, pBuffer);
                     if (pStatusLed)
-                        pStatusLed->Actual.s.fReading = 0;
+                        ASMAtomicAndU32(&pStatusLed->Actual.u32, ~PDMLED_READING);
 
                     if (RT_SUCCESS(rc))
                     {
@@ -625,12 +651,14 @@ static DECLCALLBACK(void) svcCall (void *, VBOXHGCMCALLHANDLE callHandle, uint32
                     if (pStatusLed)
                     {
                         Assert(pStatusLed->u32Magic == PDMLED_MAGIC);
-                        pStatusLed->Asserted.s.fWriting = pStatusLed->Actual.s.fWriting = 1;
+                        /* Several workers may update the LED at once. */
+                        ASMAtomicOrU32(&pStatusLed->Asserted.u32, PDMLED_WRITING);
+                        ASMAtomicOrU32(&pStatusLed->Actual.u32, PDMLED_WRITING);
                     }
 
                     rc = vbsfWrite (pClient, root, Handle, offset, &count, pBuffer);
                     if (pStatusLed)
-                        pStatusLed->Actual.s.fWriting = 0;
+                        ASMAtomicAndU32(&pStatusLed->Actual.u32, ~PDMLED_WRITING);
 
                     if (RT_SUCCESS(rc))
                     {
@@ -694,7 +722,6 @@ static DECLCALLBACK(void) svcCall (void *, VBOXHGCMCALLHANDLE callHandle, uint32
                      *           g_pHelpers->pfnCallComplete (callHandle, rc);
                      *
                      * The operation is async.
-                     * fAsynchronousProcessing = true;
                      */
 
                     /* Here the operation must be posted to another thread. At the moment it is not implemented.
@@ -779,14 +806,16 @@ static DECLCALLBACK(void) svcCall (void *, VBOXHGCMCALLHANDLE callHandle, uint32
                     if (pStatusLed)
                     {
                         Assert(pStatusLed->u32Magic == PDMLED_MAGIC);
-                        pStatusLed->Asserted.s.fReading = pStatusLed->Actual.s.fReading = 1;
+                        /* Several workers may update the LED at once. */
+                        ASMAtomicOrU32(&pStatusLed->Asserted.u32, PDMLED_READING);
+                        ASMAtomicOrU32(&pStatusLed->Actual.u32, PDMLED_READING);
                     }
 
                     /* Execute the function. */
                     rc = vbsfDirList (pClient, root, Handle, pPath, flags, &length, pBuffer, &resumePoint, &cFiles);
 
                     if (pStatusLed)
-                        pStatusLed->Actual.s.fReading = 0;
+                        ASMAtomicAndU32(&pStatusLed->Actual.u32, ~PDMLED_READING);
 
                     if (rc == VERR_NO_MORE_FILES && cFiles != 0)
                         rc = VINF_SUCCESS; /* Successfully return these files. */
@@ -1267,17 +1296,318 @@ static DECLCALLBACK(void) svcCall (void *, VBOXHGCMCALLHANDLE callHandle, uint32
     }
 
     LogFlow(("SharedFolders host service: svcCall: rc=%Rrc\n", rc));
+    LogFlow(("\n"));        /* Add a new line to differentiate between calls more easily. */
+
+    return rc;
+}
 
-    if (   !fAsynchronousProcessing
-        || RT_FAILURE (rc))
+
+/*
+ * Worker pool.
+ *
+ * The HGCM service thread only queues the file I/O calls, which are then
+ * executed on a small pool of worker threads and completed from there, so
+ * that independent operations from different guest threads overlap. Calls
+ * referring to the same handle are executed in the order they were queued.
+ *
+ * Everything else (mapping management, client flags, host calls, saved
+ * state) is still executed on the service thread, after waiting for all
+ * outstanding requests to finish.
+ */
+
+/** Maximum number of worker threads. */
+#define SHFL_SVC_MAX_WORKERS    8
+
+/** A guest call queued for execution on a worker thread. */
+typedef struct SHFLSVCREQ
+{
+    /** Node in SHFLSVCPOOL::PendingList. */
+    RTLISTNODE          Node;
+    /** The HGCM call handle to complete. */
+    VBOXHGCMCALLHANDLE  hCall;
+    uint32_t            u32ClientID;
+    SHFLCLIENTDATA     *pClient;
+    uint32_t            u32Function;
+    uint32_t            cParms;
+    VBOXHGCMSVCPARM    *paParms;
+    /** The handle the call refers to, SHFL_HANDLE_NIL if none. Calls with the
+     *  same client and handle are never executed concurrently. */
+    SHFLHANDLE          hHandle;
+} SHFLSVCREQ;
+typedef SHFLSVCREQ *PSHFLSVCREQ;
+
+/** The worker pool state. */
+typedef struct SHFLSVCPOOL
+{
+    /** Protects the members below. */
+    RTCRITSECT          CritSect;
+    /** Signalled when requests have been queued or on shutdown. */
+    RTSEMEVENT          hEvtWork;
+    /** Signalled when the last outstanding request was completed while fDrainWaiting. */
+    RTSEMEVENT          hEvtDrained;
+    /** Queued requests not picked up by a worker yet. */
+    RTLISTANCHOR        PendingList;
+    /** Number of queued and executing requests. */
+    uint32_t            cOutstanding;
+    /** Set when the service thread waits for cOutstanding to drop to zero. */
+    bool                fDrainWaiting;
+    /** Set when the workers should terminate. */
+    bool volatile       fShutdown;
+    /** Number of worker threads. */
+    uint32_t            cWorkers;
+    /** The worker threads. */
+    RTTHREAD            aThreads[SHFL_SVC_MAX_WORKERS];
+    /** The requests the workers are executing, NULL if idle. */
+    PSHFLSVCREQ         apActive[SHFL_SVC_MAX_WORKERS];
+} SHFLSVCPOOL;
+
+/** The worker pool, cWorkers is zero if guest calls are executed synchronously. */
+static SHFLSVCPOOL g_Pool;
+
+
+/**
+ * Waits until all queued guest calls have been executed and completed.
+ *
+ * @thread  HGCM service thread.
+ */
+static void svcPoolDrain(void)
+{
+    if (!g_Pool.cWorkers)
+        return;
+
+    RTCritSectEnter(&g_Pool.CritSect);
+    while (g_Pool.cOutstanding)
     {
-        /* Complete the operation if it was unsuccessful or
-         * it was processed synchronously.
-         */
-        g_pHelpers->pfnCallComplete (callHandle, rc);
+        g_Pool.fDrainWaiting = true;
+        RTCritSectLeave(&g_Pool.CritSect);
+        RTSemEventWait(g_Pool.hEvtDrained, RT_INDEFINITE_WAIT);
+        RTCritSectEnter(&g_Pool.CritSect);
     }
+    RTCritSectLeave(&g_Pool.CritSect);
+}
 
-    LogFlow(("\n"));        /* Add a new line to differentiate between calls more easily. */
+#ifndef UNITTEST /* The testcase expects calls to complete synchronously. */
+
+/**
+ * Picks the first queued request which does not have to wait for another
+ * request on the same handle.
+ *
+ * @returns The request, removed from the pending list. NULL if none.
+ * @note    Caller owns the pool lock.
+ */
+static PSHFLSVCREQ svcPoolPickRequest(void)
+{
+    PSHFLSVCREQ pReq;
+    RTListForEach(&g_Pool.PendingList, pReq, SHFLSVCREQ, Node)
+    {
+        bool fBusy = false;
+        if (pReq->hHandle != SHFL_HANDLE_NIL)
+            for (uint32_t i = 0; i < g_Pool.cWorkers && !fBusy; i++)
+                fBusy =    g_Pool.apActive[i]
+                        && g_Pool.apActive[i]->pClient == pReq->pClient
+                        && g_Pool.apActive[i]->hHandle == pReq->hHandle;
+        if (!fBusy)
+        {
+            RTListNodeRemove(&pReq->Node);
+            return pReq;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Worker thread executing queued guest calls.
+ */
+static DECLCALLBACK(int) svcPoolWorkerThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    RT_NOREF1(hThreadSelf);
+    uint32_t const idxWorker = (uint32_t)(uintptr_t)pvUser;
+
+    RTCritSectEnter(&g_Pool.CritSect);
+    while (!ASMAtomicReadBool(&g_Pool.fShutdown))
+    {
+        PSHFLSVCREQ pReq = svcPoolPickRequest();
+        if (!pReq)
+        {
+            RTCritSectLeave(&g_Pool.CritSect);
+            RTSemEventWait(g_Pool.hEvtWork, RT_INDEFINITE_WAIT);
+            RTCritSectEnter(&g_Pool.CritSect);
+            continue;
+        }
+
+        /* Pass on the wakeup if there is more to do, the event does not count. */
+        g_Pool.apActive[idxWorker] = pReq;
+        if (!RTListIsEmpty(&g_Pool.PendingList))
+            RTSemEventSignal(g_Pool.hEvtWork);
+        RTCritSectLeave(&g_Pool.CritSect);
+
+        int rc = svcCallWorker(pReq->u32ClientID, pReq->pClient, pReq->u32Function, pReq->cParms, pReq->paParms);
+        g_pHelpers->pfnCallComplete(pReq->hCall, rc);
+
+        RTCritSectEnter(&g_Pool.CritSect);
+        g_Pool.apActive[idxWorker] = NULL;
+        RTMemFree(pReq);
+
+        Assert(g_Pool.cOutstanding > 0);
+        if (   --g_Pool.cOutstanding == 0
+            && g_Pool.fDrainWaiting)
+        {
+            g_Pool.fDrainWaiting = false;
+            RTSemEventSignal(g_Pool.hEvtDrained);
+        }
+    }
+    RTCritSectLeave(&g_Pool.CritSect);
+
+    /* Wake up the next worker so it notices the shutdown as well. */
+    RTSemEventSignal(g_Pool.hEvtWork);
+    return VINF_SUCCESS;
+}
+
+/**
+ * Starts the worker pool.
+ *
+ * Guest calls are executed synchronously if this fails.
+ */
+static int svcPoolInit(void)
+{
+    RTListInit(&g_Pool.PendingList);
+    g_Pool.cOutstanding  = 0;
+    g_Pool.fDrainWaiting = false;
+    g_Pool.fShutdown     = false;
+    g_Pool.cWorkers      = 0;
+
+    int rc = RTCritSectInit(&g_Pool.CritSect);
+    if (RT_SUCCESS(rc))
+    {
+        rc = RTSemEventCreate(&g_Pool.hEvtWork);
+        if (RT_SUCCESS(rc))
+        {
+            rc = RTSemEventCreate(&g_Pool.hEvtDrained);
+            if (RT_SUCCESS(rc))
+            {
+                uint32_t const cWorkers = RT_MIN(RT_MAX(RTMpGetOnlineCount(), 2), SHFL_SVC_MAX_WORKERS);
+                for (uint32_t i = 0; i < cWorkers; i++)
+                {
+                    g_Pool.apActive[i] = NULL;
+                    rc = RTThreadCreateF(&g_Pool.aThreads[i], svcPoolWorkerThread, (void *)(uintptr_t)i, 0,
+                                         RTTHREADTYPE_IO, RTTHREADFLAGS_WAITABLE, "ShFl%u", i);
+                    if (RT_FAILURE(rc))
+                        break;
+                    g_Pool.cWorkers++;
+                }
+
+                if (g_Pool.cWorkers)
+                {
+                    LogRel(("SharedFolders host service: using %u worker threads\n", g_Pool.cWorkers));
+                    return VINF_SUCCESS;
+                }
+
+                RTSemEventDestroy(g_Pool.hEvtDrained);
+            }
+            RTSemEventDestroy(g_Pool.hEvtWork);
+        }
+        RTCritSectDelete(&g_Pool.CritSect);
+    }
+
+    LogRel(("SharedFolders host service: failed to start worker threads (%Rrc), executing calls synchronously\n", rc));
+    return rc;
+}
+
+#endif /* !UNITTEST */
+
+/**
+ * Stops the worker pool, if running.
+ */
+static void svcPoolTerm(void)
+{
+    if (!g_Pool.cWorkers)
+        return;
+
+    svcPoolDrain();
+
+    ASMAtomicWriteBool(&g_Pool.fShutdown, true);
+    RTSemEventSignal(g_Pool.hEvtWork);
+    for (uint32_t i = 0; i < g_Pool.cWorkers; i++)
+        RTThreadWait(g_Pool.aThreads[i], RT_INDEFINITE_WAIT, NULL);
+    g_Pool.cWorkers = 0;
+
+    RTSemEventDestroy(g_Pool.hEvtDrained);
+    RTSemEventDestroy(g_Pool.hEvtWork);
+    RTCritSectDelete(&g_Pool.CritSect);
+}
+
+/**
+ * Checks whether a guest call may be executed on a worker thread.
+ *
+ * @returns true if it may, with *phHandle set to the handle the call must be
+ *          serialized on (SHFL_HANDLE_NIL if none).
+ */
+static bool svcCallIsAsync(uint32_t u32Function, uint32_t cParms, VBOXHGCMSVCPARM paParms[], SHFLHANDLE *phHandle)
+{
+    *phHandle = SHFL_HANDLE_NIL;
+    switch (u32Function)
+    {
+        /* Operations on an open handle. */
+        case SHFL_FN_CLOSE:
+        case SHFL_FN_READ:
+        case SHFL_FN_WRITE:
+        case SHFL_FN_LOCK:
+        case SHFL_FN_LIST:
+        case SHFL_FN_INFORMATION:
+        case SHFL_FN_FLUSH:
+            if (   cParms >= 2
+                && paParms[1].type == VBOX_HGCM_SVC_PARM_64BIT)
+                *phHandle = paParms[1].u.uint64;
+            return true;
+
+        /* Operations on paths only. */
+        case SHFL_FN_CREATE:
+        case SHFL_FN_REMOVE:
+        case SHFL_FN_RENAME:
+        case SHFL_FN_READLINK:
+        case SHFL_FN_SYMLINK:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static DECLCALLBACK(void) svcCall (void *, VBOXHGCMCALLHANDLE callHandle, uint32_t u32ClientID, void *pvClient, uint32_t u32Function, uint32_t cParms, VBOXHGCMSVCPARM paParms[])
+{
+    SHFLCLIENTDATA *pClient = (SHFLCLIENTDATA *)pvClient;
+
+    SHFLHANDLE hHandle;
+    if (   g_Pool.cWorkers
+        && svcCallIsAsync(u32Function, cParms, paParms, &hHandle))
+    {
+        PSHFLSVCREQ pReq = (PSHFLSVCREQ)RTMemAlloc(sizeof(*pReq));
+        if (pReq)
+        {
+            pReq->hCall       = callHandle;
+            pReq->u32ClientID = u32ClientID;
+            pReq->pClient     = pClient;
+            pReq->u32Function = u32Function;
+            pReq->cParms      = cParms;
+            pReq->paParms     = paParms;
+            pReq->hHandle     = hHandle;
+
+            RTCritSectEnter(&g_Pool.CritSect);
+            RTListAppend(&g_Pool.PendingList, &pReq->Node);
+            g_Pool.cOutstanding++;
+            RTCritSectLeave(&g_Pool.CritSect);
+
+            RTSemEventSignal(g_Pool.hEvtWork);
+            return;
+        }
+        /* Out of memory: fall back to synchronous execution. */
+    }
+
+    /* Everything else may depend on or change state the queued calls use. */
+    svcPoolDrain();
+
+    int rc = svcCallWorker(u32ClientID, pClient, u32Function, cParms, paParms);
+    g_pHelpers->pfnCallComplete (callHandle, rc);
 }
 
 /*
@@ -1291,6 +1621,9 @@ static DECLCALLBACK(int) svcHostCall (void *, uint32_t u32Function, uint32_t cPa
 
     Log(("svcHostCall: fn = %d, cParms = %d, pparms = %d\n", u32Function, cParms, paParms));
 
+    /* Mappings may be added or removed, wait for the guest calls using them. */
+    svcPoolDrain();
+
 #ifdef DEBUG
     uint32_t i;
 
@@ -1502,6 +1835,14 @@ extern "C" DECLCALLBACK(DECLEXPORT(int)) VBoxHGCMSvcLoad (VBOXHGCMSVCFNTABLE *pt
         AssertRC(rc);
 
         vbsfMappingInit();
+
+        int rc2 = vbsfPathCacheInit();
+        AssertRC(rc2);
+
+#ifndef UNITTEST /* The testcase expects calls to complete synchronously. */
+        if (RT_SUCCESS(rc))
+            svcPoolInit();
+#endif
     }
 
     return rc;
@@ -940,6 +940,9 @@ int vbsfCreate(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLSTRING *pPath, uint32
                 {
                     rc = vbsfOpenFile(pClient, root, pszFullPath, pParms);
                 }
+
+                if (pParms->Result == SHFL_FILE_CREATED)
+                    vbsfPathCacheInvalidate(root, pszFullPath);
             }
             else
             {
@@ -1868,6 +1871,9 @@ int vbsfRemove(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLSTRING *pPath, uint32
                 rc = RTFileDelete(pszFullPath);
             else
                 rc = RTDirRemove(pszFullPath);
+
+            if (RT_SUCCESS(rc))
+                vbsfPathCacheInvalidate(root, pszFullPath);
         }
 
 #ifndef DEBUG_dmik
@@ -1938,6 +1944,12 @@ int vbsfRename(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLSTRING *pSrc, SHFLSTR
                 rc = RTDirRename(pszFullPathSrc, pszFullPathDest,
                                    ((flags & SHFL_RENAME_REPLACE_IF_EXISTS) ? RTPATHRENAME_FLAGS_REPLACE : 0));
             }
+
+            if (RT_SUCCESS(rc))
+            {
+                vbsfPathCacheInvalidate(root, pszFullPathSrc);
+                vbsfPathCacheInvalidate(root, pszFullPathDest);
+            }
         }
 
         /* free the path string */
@@ -1993,6 +2005,8 @@ int vbsfSymlink(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLSTRING *pNewPath, SH
                          RTSYMLINKTYPE_UNKNOWN, 0);
     if (RT_SUCCESS(rc))
     {
+        vbsfPathCacheInvalidate(root, pszFullNewPath);
+
         RTFSOBJINFO info;
         rc = RTPathQueryInfoEx(pszFullNewPath, &info, RTFSOBJATTRADD_NOTHING, SHFL_RT_LINK(pClient));
         if (RT_SUCCESS(rc))
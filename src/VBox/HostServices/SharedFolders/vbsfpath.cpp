@@ -27,12 +27,15 @@
 #include <iprt/alloc.h>
 #include <iprt/asm.h>
 #include <iprt/assert.h>
+#include <iprt/critsect.h>
 #include <iprt/fs.h>
 #include <iprt/dir.h>
 #include <iprt/file.h>
+#include <iprt/list.h>
 #include <iprt/path.h>
 #include <iprt/string.h>
 #include <iprt/symlink.h>
+#include <iprt/time.h>
 #include <iprt/uni.h>
 #include <iprt/stream.h>
 #ifdef RT_OS_DARWIN
@@ -50,15 +53,433 @@
  * guests on windows host. Search for "0111" to find all the relevant places.
  */
 
+
+/*
+ * Path cache.
+ *
+ * Case correction (case sensitive host, case insensitive guest) has to scan
+ * the host directories for every path component which does not match
+ * exactly, on every call.  To avoid this each mapping caches:
+ *    - Directory listings used for the case insensitive lookups. A listing
+ *      is only used while the modification time of the directory is
+ *      unchanged, so changes made on the host are picked up as well.
+ *    - Fully resolved paths, mapping the path as given by the guest to the
+ *      correctly cased host path.  A hit is verified with a single stat.
+ *
+ * Operations done through the service which add, remove or rename objects
+ * invalidate the affected entries, see vbsfPathCacheInvalidate().
+ */
+
+/** Maximum number of directory listings cached per mapping. */
+#define VBSF_PATHCACHE_MAX_DIRS         64
+/** Maximum size of a single cached directory listing (names). */
+#define VBSF_PATHCACHE_MAX_DIR_NAMES    _256K
+/** Maximum number of resolved paths cached per mapping. */
+#define VBSF_PATHCACHE_MAX_RESOLVED     256
+/** Directories modified less than this many nanoseconds ago are not cached,
+ *  as a following change might not alter the modification time. */
+#define VBSF_PATHCACHE_MIN_AGE_NS       (UINT64_C(2) * RT_NS_1SEC)
+
+/** A cached directory listing. */
+typedef struct VBSFDIRCACHEENTRY
+{
+    /** Node in VBSFPATHCACHE::DirList, most recently used first. */
+    RTLISTNODE      Node;
+    /** The modification time of the directory when it was read. */
+    RTTIMESPEC      ModificationTime;
+    /** The names, each zero terminated, followed by an empty name. */
+    char           *pachNames;
+    /** Length of szDir. */
+    size_t          cchDir;
+    /** The directory path, including the trailing delimiter. */
+    char            szDir[1];
+} VBSFDIRCACHEENTRY;
+typedef VBSFDIRCACHEENTRY *PVBSFDIRCACHEENTRY;
+
+/** A cached resolved path. */
+typedef struct VBSFRESOLVEDPATH
+{
+    /** Node in VBSFPATHCACHE::ResolvedList, most recently used first. */
+    RTLISTNODE      Node;
+    /** Length of both paths (case correction does not change it). */
+    size_t          cchPath;
+    /** The correctly cased host path. */
+    char           *pszHost;
+    /** The path as passed by the guest, followed by pszHost. */
+    char            szGuest[1];
+} VBSFRESOLVEDPATH;
+typedef VBSFRESOLVEDPATH *PVBSFRESOLVEDPATH;
+
+/** The path cache of a mapping. */
+typedef struct VBSFPATHCACHE
+{
+    RTLISTANCHOR    DirList;
+    uint32_t        cDirs;
+    RTLISTANCHOR    ResolvedList;
+    uint32_t        cResolved;
+
+    /** @name Statistics.
+     * @{ */
+    uint64_t        cDirHits;
+    uint64_t        cDirMisses;
+    uint64_t        cDirStale;
+    uint64_t        cResolvedHits;
+    uint64_t        cResolvedMisses;
+    uint64_t        cResolvedStale;
+    uint64_t        cInvalidations;
+    /** @} */
+} VBSFPATHCACHE;
+typedef VBSFPATHCACHE *PVBSFPATHCACHE;
+
+/** Protects the path caches, calls are executed on several threads. */
+static RTCRITSECT       g_PathCacheCritSect;
+/** The path caches, indexed by root. */
+static VBSFPATHCACHE    g_aPathCaches[SHFL_MAX_MAPPINGS];
+
+
+int vbsfPathCacheInit(void)
+{
+    for (unsigned i = 0; i < RT_ELEMENTS(g_aPathCaches); i++)
+    {
+        RT_ZERO(g_aPathCaches[i]);
+        RTListInit(&g_aPathCaches[i].DirList);
+        RTListInit(&g_aPathCaches[i].ResolvedList);
+    }
+    return RTCritSectInit(&g_PathCacheCritSect);
+}
+
+void vbsfPathCacheTerm(void)
+{
+    if (!RTCritSectIsInitialized(&g_PathCacheCritSect))
+        return;
+    for (unsigned i = 0; i < RT_ELEMENTS(g_aPathCaches); i++)
+        vbsfPathCacheFlush(i);
+    RTCritSectDelete(&g_PathCacheCritSect);
+}
+
+/** Returns the cache of the given root, NULL if not available. */
+DECLINLINE(PVBSFPATHCACHE) vbsfPathCacheGet(SHFLROOT hRoot)
+{
+    if (   hRoot < RT_ELEMENTS(g_aPathCaches)
+        && RTCritSectIsInitialized(&g_PathCacheCritSect))
+        return &g_aPathCaches[hRoot];
+    return NULL;
+}
+
+static void vbsfPathCacheFreeDir(PVBSFPATHCACHE pCache, PVBSFDIRCACHEENTRY pDir)
+{
+    RTListNodeRemove(&pDir->Node);
+    pCache->cDirs--;
+    RTMemFree(pDir->pachNames);
+    RTMemFree(pDir);
+}
+
+static void vbsfPathCacheFreeResolved(PVBSFPATHCACHE pCache, PVBSFRESOLVEDPATH pResolved)
+{
+    RTListNodeRemove(&pResolved->Node);
+    pCache->cResolved--;
+    RTMemFree(pResolved);
+}
+
+void vbsfPathCacheFlush(SHFLROOT hRoot)
+{
+    PVBSFPATHCACHE pCache = vbsfPathCacheGet(hRoot);
+    if (!pCache)
+        return;
+
+    RTCritSectEnter(&g_PathCacheCritSect);
+
+    if (pCache->cDirHits + pCache->cDirMisses + pCache->cResolvedHits + pCache->cResolvedMisses)
+        LogRel(("SharedFolders: path cache of root %u: dirs %RU64 hits, %RU64 misses, %RU64 stale; "
+                "paths %RU64 hits, %RU64 misses, %RU64 stale; %RU64 invalidations\n",
+                hRoot, pCache->cDirHits, pCache->cDirMisses, pCache->cDirStale,
+                pCache->cResolvedHits, pCache->cResolvedMisses, pCache->cResolvedStale, pCache->cInvalidations));
+
+    PVBSFDIRCACHEENTRY pDir, pDirNext;
+    RTListForEachSafe(&pCache->DirList, pDir, pDirNext, VBSFDIRCACHEENTRY, Node)
+        vbsfPathCacheFreeDir(pCache, pDir);
+    PVBSFRESOLVEDPATH pResolved, pResolvedNext;
+    RTListForEachSafe(&pCache->ResolvedList, pResolved, pResolvedNext, VBSFRESOLVEDPATH, Node)
+        vbsfPathCacheFreeResolved(pCache, pResolved);
+
+    pCache->cDirHits = pCache->cDirMisses = pCache->cDirStale = 0;
+    pCache->cResolvedHits = pCache->cResolvedMisses = pCache->cResolvedStale = 0;
+    pCache->cInvalidations = 0;
+
+    RTCritSectLeave(&g_PathCacheCritSect);
+}
+
+/** Checks if pszPath equals pszPrefix or is below it. */
+DECLINLINE(bool) vbsfPathCacheIsAtOrBelow(const char *pszPath, const char *pszPrefix, size_t cchPrefix)
+{
+    return    !strncmp(pszPath, pszPrefix, cchPrefix)
+           && (pszPath[cchPrefix] == '\0' || pszPath[cchPrefix] == RTPATH_DELIMITER);
+}
+
+void vbsfPathCacheInvalidate(SHFLROOT hRoot, const char *pszHostPath)
+{
+    PVBSFPATHCACHE pCache = vbsfPathCacheGet(hRoot);
+    if (!pCache)
+        return;
+
+    size_t cchPath = strlen(pszHostPath);
+    while (cchPath > 1 && pszHostPath[cchPath - 1] == RTPATH_DELIMITER)
+        cchPath--;
+    const char *pszName = pszHostPath + cchPath;
+    while (pszName > pszHostPath && pszName[-1] != RTPATH_DELIMITER)
+        pszName--;
+    size_t const cchParent = pszName - pszHostPath; /* including the delimiter */
+
+    RTCritSectEnter(&g_PathCacheCritSect);
+    pCache->cInvalidations++;
+
+    /* The listing of the parent and everything at or below the object itself. */
+    PVBSFDIRCACHEENTRY pDir, pDirNext;
+    RTListForEachSafe(&pCache->DirList, pDir, pDirNext, VBSFDIRCACHEENTRY, Node)
+        if (   (pDir->cchDir == cchParent && !memcmp(pDir->szDir, pszHostPath, cchParent))
+            || vbsfPathCacheIsAtOrBelow(pDir->szDir, pszHostPath, cchPath))
+            vbsfPathCacheFreeDir(pCache, pDir);
+
+    PVBSFRESOLVEDPATH pResolved, pResolvedNext;
+    RTListForEachSafe(&pCache->ResolvedList, pResolved, pResolvedNext, VBSFRESOLVEDPATH, Node)
+        if (vbsfPathCacheIsAtOrBelow(pResolved->pszHost, pszHostPath, cchPath))
+            vbsfPathCacheFreeResolved(pCache, pResolved);
+
+    RTCritSectLeave(&g_PathCacheCritSect);
+}
+
+/**
+ * Looks up a component in the cached listing of its parent directory.
+ *
+ * @returns VINF_SUCCESS if found, the correctly cased name is copied to
+ *          pszComponent.
+ * @returns VERR_FILE_NOT_FOUND if the directory has no such entry.
+ * @returns VERR_NOT_FOUND if there is no valid listing of the directory.
+ * @param   pCache          The path cache.
+ * @param   pszDir          The directory, including the trailing delimiter.
+ * @param   cchDir          The length of the directory.
+ * @param   pModTime        The current modification time of the directory.
+ * @param   pszComponent    The name to look up.
+ * @param   cchComponent    The length of the name.
+ */
+static int vbsfPathCacheLookupDir(PVBSFPATHCACHE pCache, const char *pszDir, size_t cchDir, PCRTTIMESPEC pModTime,
+                                  char *pszComponent, size_t cchComponent)
+{
+    int rc = VERR_NOT_FOUND;
+    RTCritSectEnter(&g_PathCacheCritSect);
+
+    PVBSFDIRCACHEENTRY pDir;
+    RTListForEach(&pCache->DirList, pDir, VBSFDIRCACHEENTRY, Node)
+    {
+        if (   pDir->cchDir == cchDir
+            && !memcmp(pDir->szDir, pszDir, cchDir))
+        {
+            if (!RTTimeSpecIsEqual(&pDir->ModificationTime, pModTime))
+            {
+                pCache->cDirStale++;
+                vbsfPathCacheFreeDir(pCache, pDir);
+                break;
+            }
+
+            pCache->cDirHits++;
+            RTListNodeRemove(&pDir->Node);
+            RTListPrepend(&pCache->DirList, &pDir->Node);
+
+            rc = VERR_FILE_NOT_FOUND;
+            for (const char *pszName = pDir->pachNames; *pszName; )
+            {
+                size_t const cchName = strlen(pszName);
+                if (   cchName == cchComponent
+                    && !RTStrICmp(pszComponent, pszName))
+                {
+                    memcpy(pszComponent, pszName, cchName);
+                    rc = VINF_SUCCESS;
+                    break;
+                }
+                pszName += cchName + 1;
+            }
+            break;
+        }
+    }
+
+    if (rc == VERR_NOT_FOUND)
+        pCache->cDirMisses++;
+    RTCritSectLeave(&g_PathCacheCritSect);
+    return rc;
+}
+
+/**
+ * Adds a directory listing to the cache, taking ownership of pachNames.
+ */
+static void vbsfPathCacheInsertDir(PVBSFPATHCACHE pCache, const char *pszDir, size_t cchDir, PCRTTIMESPEC pModTime,
+                                   char *pachNames)
+{
+    /* Skip directories which were modified very recently, see VBSF_PATHCACHE_MIN_AGE_NS. */
+    RTTIMESPEC Now;
+    if (RTTimeSpecGetNano(RTTimeNow(&Now)) - RTTimeSpecGetNano(pModTime) < (int64_t)VBSF_PATHCACHE_MIN_AGE_NS)
+    {
+        RTMemFree(pachNames);
+        return;
+    }
+
+    PVBSFDIRCACHEENTRY pDir = (PVBSFDIRCACHEENTRY)RTMemAlloc(RT_OFFSETOF(VBSFDIRCACHEENTRY, szDir[cchDir + 1]));
+    if (!pDir)
+    {
+        RTMemFree(pachNames);
+        return;
+    }
+    pDir->ModificationTime = *pModTime;
+    pDir->pachNames        = pachNames;
+    pDir->cchDir           = cchDir;
+    memcpy(pDir->szDir, pszDir, cchDir);
+    pDir->szDir[cchDir]    = '\0';
+
+    RTCritSectEnter(&g_PathCacheCritSect);
+
+    /* Replace an older listing of the same directory (another thread). */
+    PVBSFDIRCACHEENTRY pCur, pNext;
+    RTListForEachSafe(&pCache->DirList, pCur, pNext, VBSFDIRCACHEENTRY, Node)
+        if (   pCur->cchDir == cchDir
+            && !memcmp(pCur->szDir, pszDir, cchDir))
+            vbsfPathCacheFreeDir(pCache, pCur);
+
+    if (pCache->cDirs >= VBSF_PATHCACHE_MAX_DIRS)
+        vbsfPathCacheFreeDir(pCache, RTListGetLast(&pCache->DirList, VBSFDIRCACHEENTRY, Node));
+
+    RTListPrepend(&pCache->DirList, &pDir->Node);
+    pCache->cDirs++;
+
+    RTCritSectLeave(&g_PathCacheCritSect);
+}
+
+/**
+ * Appends a name to a directory listing being collected.
+ *
+ * @returns false if the listing is too big or out of memory, in which case it
+ *          has been freed.
+ */
+static bool vbsfPathCacheAddName(char **ppachNames, size_t *pcbNames, size_t *pcbAlloc, const char *pszName, size_t cchName)
+{
+    size_t cbNeeded = *pcbNames + cchName + 2; /* name terminator + list terminator */
+    if (cbNeeded > *pcbAlloc)
+    {
+        size_t cbNew = RT_MAX(*pcbAlloc * 2, _4K);
+        while (cbNew < cbNeeded)
+            cbNew *= 2;
+        void *pvNew = cbNew <= VBSF_PATHCACHE_MAX_DIR_NAMES ? RTMemRealloc(*ppachNames, cbNew) : NULL;
+        if (!pvNew)
+        {
+            RTMemFree(*ppachNames);
+            *ppachNames = NULL;
+            return false;
+        }
+        *ppachNames = (char *)pvNew;
+        *pcbAlloc   = cbNew;
+    }
+
+    memcpy(*ppachNames + *pcbNames, pszName, cchName + 1);
+    *pcbNames += cchName + 1;
+    (*ppachNames)[*pcbNames] = '\0';
+    return true;
+}
+
+/**
+ * Looks up a resolved path.
+ *
+ * @returns true if found, the host path is copied to pszPath.
+ */
+static bool vbsfPathCacheLookupResolved(PVBSFPATHCACHE pCache, char *pszPath, size_t cchPath)
+{
+    bool fFound = false;
+    RTCritSectEnter(&g_PathCacheCritSect);
+
+    PVBSFRESOLVEDPATH pResolved;
+    RTListForEach(&pCache->ResolvedList, pResolved, VBSFRESOLVEDPATH, Node)
+    {
+        if (   pResolved->cchPath == cchPath
+            && !memcmp(pResolved->szGuest, pszPath, cchPath))
+        {
+            memcpy(pszPath, pResolved->pszHost, cchPath);
+            RTListNodeRemove(&pResolved->Node);
+            RTListPrepend(&pCache->ResolvedList, &pResolved->Node);
+            fFound = true;
+            break;
+        }
+    }
+
+    if (fFound)
+        pCache->cResolvedHits++;
+    else
+        pCache->cResolvedMisses++;
+    RTCritSectLeave(&g_PathCacheCritSect);
+    return fFound;
+}
+
+/**
+ * Drops a resolved path entry which turned out to be out of date.
+ */
+static void vbsfPathCacheDropResolved(PVBSFPATHCACHE pCache, const char *pszGuestPath, size_t cchPath)
+{
+    RTCritSectEnter(&g_PathCacheCritSect);
+
+    PVBSFRESOLVEDPATH pResolved;
+    RTListForEach(&pCache->ResolvedList, pResolved, VBSFRESOLVEDPATH, Node)
+    {
+        if (   pResolved->cchPath == cchPath
+            && !memcmp(pResolved->szGuest, pszGuestPath, cchPath))
+        {
+            vbsfPathCacheFreeResolved(pCache, pResolved);
+            break;
+        }
+    }
+
+    pCache->cResolvedStale++;
+    RTCritSectLeave(&g_PathCacheCritSect);
+}
+
+/**
+ * Adds a resolved path to the cache.
+ */
+static void vbsfPathCacheInsertResolved(PVBSFPATHCACHE pCache, const char *pszGuestPath, const char *pszHostPath, size_t cchPath)
+{
+    PVBSFRESOLVEDPATH pResolved = (PVBSFRESOLVEDPATH)RTMemAlloc(RT_OFFSETOF(VBSFRESOLVEDPATH, szGuest[2 * (cchPath + 1)]));
+    if (!pResolved)
+        return;
+    pResolved->cchPath = cchPath;
+    pResolved->pszHost = &pResolved->szGuest[cchPath + 1];
+    memcpy(pResolved->szGuest, pszGuestPath, cchPath);
+    pResolved->szGuest[cchPath] = '\0';
+    memcpy(pResolved->pszHost, pszHostPath, cchPath);
+    pResolved->pszHost[cchPath] = '\0';
+
+    RTCritSectEnter(&g_PathCacheCritSect);
+
+    PVBSFRESOLVEDPATH pCur, pNext;
+    RTListForEachSafe(&pCache->ResolvedList, pCur, pNext, VBSFRESOLVEDPATH, Node)
+        if (   pCur->cchPath == cchPath
+            && !memcmp(pCur->szGuest, pszGuestPath, cchPath))
+            vbsfPathCacheFreeResolved(pCache, pCur);
+
+    if (pCache->cResolved >= VBSF_PATHCACHE_MAX_RESOLVED)
+        vbsfPathCacheFreeResolved(pCache, RTListGetLast(&pCache->ResolvedList, VBSFRESOLVEDPATH, Node));
+
+    RTListPrepend(&pCache->ResolvedList, &pResolved->Node);
+    pCache->cResolved++;
+
+    RTCritSectLeave(&g_PathCacheCritSect);
+}
+
+
 /**
  * Corrects the casing of the final component
  *
  * @returns
  * @param   pClient             .
+ * @param   hRoot               The root handle, selects the path cache.
  * @param   pszFullPath         .
  * @param   pszStartComponent   .
  */
-static int vbsfCorrectCasing(SHFLCLIENTDATA *pClient, char *pszFullPath, char *pszStartComponent)
+static int vbsfCorrectCasing(SHFLCLIENTDATA *pClient, SHFLROOT hRoot, char *pszFullPath, char *pszStartComponent)
 {
     Log2(("vbsfCorrectCasing: %s %s\n", pszFullPath, pszStartComponent));
 
@@ -74,6 +495,33 @@ static int vbsfCorrectCasing(SHFLCLIENTDATA *pClient, char *pszFullPath, char *p
     size_t cchFullPath  = cchParentDir + cchComponent;
     Assert(strlen(pszFullPath) == cchFullPath);
 
+    /*
+     * Try the cached listing of the parent directory first.
+     */
+    PVBSFPATHCACHE pCache = vbsfPathCacheGet(hRoot);
+    RTTIMESPEC     DirModTime;
+    RTTimeSpecSetNano(&DirModTime, 0);
+    if (pCache)
+    {
+        char const  chSaved = *pszStartComponent;
+        RTFSOBJINFO DirInfo;
+        *pszStartComponent = '\0';
+        int rc2 = RTPathQueryInfoEx(pszFullPath, &DirInfo, RTFSOBJATTRADD_NOTHING, RTPATH_F_FOLLOW_LINK);
+        *pszStartComponent = chSaved;
+        if (RT_SUCCESS(rc2))
+        {
+            DirModTime = DirInfo.ModificationTime;
+            rc2 = vbsfPathCacheLookupDir(pCache, pszFullPath, cchParentDir, &DirModTime, pszStartComponent, cchComponent);
+            if (rc2 != VERR_NOT_FOUND)
+            {
+                Log2(("vbsfCorrectCasing: cached %s -> %Rrc\n", pszFullPath, rc2));
+                return rc2;
+            }
+        }
+        else
+            pCache = NULL;
+    }
+
     size_t cbDirEntry   = 4096;
     if (cchFullPath + 4 > cbDirEntry - RT_OFFSETOF(RTDIRENTRYEX, szName))
         cbDirEntry = RT_OFFSETOF(RTDIRENTRYEX, szName) + cchFullPath + 4;
@@ -96,6 +544,13 @@ static int vbsfCorrectCasing(SHFLCLIENTDATA *pClient, char *pszFullPath, char *p
     AssertRC(rc);
     if (RT_SUCCESS(rc))
     {
+        /* Collect the whole listing for the cache while searching. */
+        char   *pachNames    = NULL;
+        size_t  cbNames      = 0;
+        size_t  cbNamesAlloc = 0;
+        bool    fCollect     = pCache != NULL;
+        bool    fFound       = false;
+
         PRTDIR hSearch = NULL;
         rc = RTDirOpenFiltered(&hSearch, pDirEntry->szName, RTDIRFILTER_WINNT, 0);
         if (RT_SUCCESS(rc))
@@ -119,18 +574,37 @@ static int vbsfCorrectCasing(SHFLCLIENTDATA *pClient, char *pszFullPath, char *p
                 }
 
                 Log2(("vbsfCorrectCasing: found %s\n", &pDirEntry->szName[0]));
-                if (    pDirEntry->cbName == cchComponent
+                if (    !fFound
+                    &&  pDirEntry->cbName == cchComponent
                     &&  !RTStrICmp(pszStartComponent, &pDirEntry->szName[0]))
                 {
                     Log(("Found original name %s (%s)\n", &pDirEntry->szName[0], pszStartComponent));
                     strcpy(pszStartComponent, &pDirEntry->szName[0]);
-                    rc = VINF_SUCCESS;
-                    break;
+                    fFound = true;
                 }
+
+                if (fCollect)
+                    fCollect = vbsfPathCacheAddName(&pachNames, &cbNames, &cbNamesAlloc,
+                                                    &pDirEntry->szName[0], pDirEntry->cbName);
+                if (fFound && !fCollect)
+                    break;
             }
 
             RTDirClose(hSearch);
+
+            if (fCollect && rc == VERR_NO_MORE_FILES)
+            {
+                if (!pachNames)
+                    pachNames = (char *)RTMemAllocZ(1); /* empty directory */
+                if (pachNames)
+                    vbsfPathCacheInsertDir(pCache, pszFullPath, cchParentDir, &DirModTime, pachNames);
+                pachNames = NULL;
+            }
+            if (fFound)
+                rc = VINF_SUCCESS;
         }
+
+        RTMemFree(pachNames);
     }
 
     if (RT_FAILURE(rc))
@@ -158,6 +632,7 @@ static int vbsfQueryExistsEx(const char *pszPath, uint32_t fFlags)
  *
  * @returns VINF_SUCCESS at the moment.
  * @param   pClient                 The client data.
+ * @param   hRoot                   The root handle, selects the path cache.
  * @param   pszFullPath             Pointer to the full path.  This is the path
  *                                  which may need case corrections.  The
  *                                  corrections will be applied in place.
@@ -168,7 +643,7 @@ static int vbsfQueryExistsEx(const char *pszPath, uint32_t fFlags)
  * @param   fPreserveLastComponent  Always exclude the last component from case
  *                                  correction if set.
  */
-static int vbsfCorrectPathCasing(SHFLCLIENTDATA *pClient, char *pszFullPath, size_t cchFullPath,
+static int vbsfCorrectPathCasing(SHFLCLIENTDATA *pClient, SHFLROOT hRoot, char *pszFullPath, size_t cchFullPath,
                                  bool fWildCard, bool fPreserveLastComponent)
 {
     /*
@@ -213,6 +688,30 @@ static int vbsfCorrectPathCasing(SHFLCLIENTDATA *pClient, char *pszFullPath, siz
     {
         Log(("Handle case insensitive guest fs on top of host case sensitive fs for %s\n", pszFullPath));
 
+        /*
+         * Check whether this path was resolved before and still exists.
+         */
+        size_t const   cchPath      = pszLastComponent ? (size_t)(pszLastComponent - pszFullPath) : cchFullPath;
+        PVBSFPATHCACHE pCache       = vbsfPathCacheGet(hRoot);
+        char          *pszGuestPath = pCache ? RTStrDupN(pszFullPath, cchPath) : NULL;
+        if (pszGuestPath)
+        {
+            if (vbsfPathCacheLookupResolved(pCache, pszFullPath, cchPath))
+            {
+                rc = vbsfQueryExistsEx(pszFullPath, SHFL_RT_LINK(pClient));
+                if (RT_SUCCESS(rc))
+                {
+                    Log(("Using cached path %s\n", pszFullPath));
+                    RTStrFree(pszGuestPath);
+                    if (pszLastComponent)
+                        *pszLastComponent = RTPATH_DELIMITER;
+                    return VINF_SUCCESS;
+                }
+                vbsfPathCacheDropResolved(pCache, pszGuestPath, cchPath);
+                memcpy(pszFullPath, pszGuestPath, cchPath);
+            }
+        }
+
         /*
          * Work from the end of the path to find a partial path that's valid.
          */
@@ -279,7 +778,7 @@ static int vbsfCorrectPathCasing(SHFLCLIENTDATA *pClient, char *pszFullPath, siz
                 if (rc == VERR_FILE_NOT_FOUND || rc == VERR_PATH_NOT_FOUND)
                 {
                     /* Path component is invalid; try to correct the casing. */
-                    rc = vbsfCorrectCasing(pClient, pszFullPath, pszSrc);
+                    rc = vbsfCorrectCasing(pClient, hRoot, pszFullPath, pszSrc);
                     if (RT_FAILURE(rc))
                     {
                         /* Failed, so don't bother trying any further components. */
@@ -298,10 +797,13 @@ static int vbsfCorrectPathCasing(SHFLCLIENTDATA *pClient, char *pszFullPath, siz
             }
             if (RT_FAILURE(rc))
                 Log(("Unable to find suitable component rc=%d\n", rc));
+            else if (pszGuestPath)
+                vbsfPathCacheInsertResolved(pCache, pszGuestPath, pszFullPath, cchPath);
         }
         else
             rc = VERR_FILE_NOT_FOUND;
 
+        RTStrFree(pszGuestPath);
     }
 
     /* Restore the final component if it was dropped. */
@@ -625,7 +1127,7 @@ int vbsfPathGuestToHost(SHFLCLIENTDATA *pClient, SHFLROOT hRoot,
                             {
                                 const bool fWildCard = RT_BOOL(fu32Options & VBSF_O_PATH_WILDCARD);
                                 const bool fPreserveLastComponent = RT_BOOL(fu32Options & VBSF_O_PATH_PRESERVE_LAST_COMPONENT);
-                                rc = vbsfCorrectPathCasing(pClient, pszFullPath, strlen(pszFullPath),
+                                rc = vbsfCorrectPathCasing(pClient, hRoot, pszFullPath, strlen(pszFullPath),
                                                            fWildCard, fPreserveLastComponent);
                             }
 
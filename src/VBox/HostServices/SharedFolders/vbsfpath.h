@@ -64,4 +64,26 @@ void vbsfFreeHostPath(char *pszHostPath);
  */
 int vbsfPathAbs(const char *pszRoot, const char *pszPath, char *pszAbsPath, size_t cbAbsPath);
 
+/** Initialize the per-mapping path caches. */
+int vbsfPathCacheInit(void);
+
+/** Free all path caches. */
+void vbsfPathCacheTerm(void);
+
+/**
+ * Free the path cache of a mapping, e.g. when it is removed.
+ *
+ * @param hRoot Root handle.
+ */
+void vbsfPathCacheFlush(SHFLROOT hRoot);
+
+/**
+ * Invalidate the cached information about a host path, its parent directory
+ * and everything below it.  Called when an object is created, removed or renamed.
+ *
+ * @param hRoot       Root handle.
+ * @param pszHostPath Full host path of the object, as returned by vbsfPathGuestToHost.
+ */
+void vbsfPathCacheInvalidate(SHFLROOT hRoot, const char *pszHostPath);
+
 #endif /* __VBSFPATH__H */
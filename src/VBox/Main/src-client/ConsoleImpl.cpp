@@ -9016,6 +9016,14 @@ HRESULT Console::i_attachToTapInterface(INetworkAdapter *networkAdapter)
             Utf8Str str(tapDeviceName);
             RTStrCopy(IfReq.ifr_name, sizeof(IfReq.ifr_name), str.c_str()); /** @todo bitch about names which are too long... */
             IfReq.ifr_flags = IFF_TAP | IFF_NO_PI;
+# ifdef IFF_VNET_HDR
+            /* Prefix frames with virtio-net headers if the kernel can, so the TAP
+               driver can pass segmentation and checksum offloading through. */
+            unsigned int fTunFeatures = 0;
+            if (   ioctl(RTFileToNative(maTapFD[slot]), TUNGETFEATURES, &fTunFeatures) == 0
+                && (fTunFeatures & IFF_VNET_HDR))
+                IfReq.ifr_flags |= IFF_VNET_HDR;
+# endif
             rcVBox = ioctl(RTFileToNative(maTapFD[slot]), TUNSETIFF, &IfReq);
             if (rcVBox != 0)
             {
@@ -23,6 +23,7 @@
 #include <VBox/log.h>
 #include <iprt/asm.h>
 #include <iprt/assert.h>
+#include <iprt/mp.h>
 #include <iprt/semaphore.h>
 #include <iprt/thread.h>
 #include <iprt/time.h>
@@ -43,8 +44,19 @@
 # define DEFAULTCODEC (vpx_codec_vp8_cx())
 #endif /* VBOX_WITH_LIBVPX */
 
+#ifdef RT_ARCH_AMD64
+/* SSE2 is part of the AMD64 base architecture, so no CPUID checking needed. */
+# define VIDEOREC_WITH_SSE2
+# include <emmintrin.h>
+#endif
+
+/** Maximum number of threads a single stream's encoder may use by default. */
+#define VIDEOREC_MAX_ENCODER_THREADS    4
+/** Maximum time (in ms) an unchanged screen goes without a new frame being encoded. */
+#define VIDEOREC_MAX_IDLE_MS            1000
+
 static int videoRecEncodeAndWrite(PVIDEORECSTREAM pStrm);
-static int videoRecRGBToYUV(PVIDEORECSTREAM pStrm);
+static int videoRecRGBToYUV(PVIDEORECSTREAM pStrm, uint32_t uRowFirst, uint32_t uRowEnd);
 
 using namespace com;
 
@@ -104,6 +116,12 @@ typedef struct VIDEORECCODEC
  */
 typedef struct VIDEORECSTREAM
 {
+    /** The recording context this stream belongs to. */
+    PVIDEORECCONTEXT    pCtx;
+    /** Semaphore to signal the stream's encoding worker thread. */
+    RTSEMEVENT          WaitEvent;
+    /** Encoding worker thread of this stream. */
+    RTTHREAD            Thread;
     /** Container context. */
     WebMWriter         *pEBML;
 #ifdef VBOX_WITH_AUDIO_VIDEOREC
@@ -125,6 +143,10 @@ typedef struct VIDEORECSTREAM
 
     /** Whether the RGB buffer is filled or not. */
     bool                fHasVideoData;
+#ifdef VBOX_WITH_AUDIO_VIDEOREC
+    /** Whether the context's current audio frame still has to be written to this stream. */
+    bool                fHasAudioData;
+#endif
 
     struct
     {
@@ -146,6 +168,11 @@ typedef struct VIDEORECSTREAM
         uint32_t            uDelayMs;
         /** Encoder deadline. */
         unsigned int        uEncoderDeadline;
+        /** First row of the RGB buffer changed since the last YUV conversion. */
+        uint32_t            uDirtyFirst;
+        /** Row after the last row of the RGB buffer changed since the last YUV conversion.
+         *  Equal to uDirtyFirst if nothing changed. */
+        uint32_t            uDirtyEnd;
     } Video;
 } VIDEORECSTREAM, *PVIDEORECSTREAM;
 
@@ -169,14 +196,10 @@ typedef struct VIDEORECCONTEXT
 {
     /** The current state. */
     uint32_t            enmState;
-    /** Semaphore to signal the encoding worker thread. */
-    RTSEMEVENT          WaitEvent;
     /** Whether video recording is enabled or not. */
     bool                fEnabled;
     /** Shutdown indicator. */
     bool                fShutdown;
-    /** Worker thread. */
-    RTTHREAD            Thread;
     /** Maximal time (in ms) to record. */
     uint64_t            uMaxTimeMs;
     /** Maximal file size (in MB) to record. */
@@ -185,6 +208,8 @@ typedef struct VIDEORECCONTEXT
     VideoRecStreams     vecStreams;
 #ifdef VBOX_WITH_AUDIO_VIDEOREC
     bool                fHasAudioData;
+    /** Number of streams which still have to write the current audio frame. */
+    uint32_t volatile   cAudioPending;
     VIDEORECAUDIOFRAME  Audio;
 #endif
 } VIDEORECCONTEXT, *PVIDEORECCONTEXT;
@@ -360,21 +385,26 @@ private:
  * @param aDestBuf  an allocated memory buffer large enough to hold the
  *                  destination image (i.e. width * height * 12bits)
  * @param aSrcBuf   the source image as an array of bytes
+ * @param aRowFirst first row to convert, must be even
+ * @param aRowEnd   row after the last row to convert, must be even
  */
 template <class T>
-inline bool colorConvWriteYUV420p(unsigned aWidth, unsigned aHeight, uint8_t *aDestBuf, uint8_t *aSrcBuf)
+inline bool colorConvWriteYUV420p(unsigned aWidth, unsigned aHeight, uint8_t *aDestBuf, uint8_t *aSrcBuf,
+                                  unsigned aRowFirst, unsigned aRowEnd)
 {
     AssertReturn(!(aWidth & 1), false);
     AssertReturn(!(aHeight & 1), false);
+    AssertReturn(!(aRowFirst & 1) && !(aRowEnd & 1) && aRowFirst <= aRowEnd && aRowEnd <= aHeight, false);
     bool fRc = true;
     T iter1(aWidth, aHeight, aSrcBuf);
+    iter1.skip(aRowFirst * aWidth);
     T iter2 = iter1;
     iter2.skip(aWidth);
     unsigned cPixels = aWidth * aHeight;
-    unsigned offY = 0;
-    unsigned offU = cPixels;
-    unsigned offV = cPixels + cPixels / 4;
-    unsigned const cyHalf = aHeight / 2;
+    unsigned offY = aRowFirst * aWidth;
+    unsigned offU = cPixels + aRowFirst / 2 * aWidth / 2;
+    unsigned offV = cPixels + cPixels / 4 + aRowFirst / 2 * aWidth / 2;
+    unsigned const cyHalf = (aRowEnd - aRowFirst) / 2;
     unsigned const cxHalf = aWidth  / 2;
     for (unsigned i = 0; i < cyHalf && fRc; ++i)
     {
@@ -420,6 +450,126 @@ inline bool colorConvWriteYUV420p(unsigned aWidth, unsigned aHeight, uint8_t *aD
     return true;
 }
 
+#ifdef VIDEOREC_WITH_SSE2
+/**
+ * Converts 8 BGRA32 pixels to 16-bit blue, green and red components.
+ */
+DECLINLINE(void) colorConvSse2LoadBGRA32(const uint8_t *pbSrc, __m128i *pBlue, __m128i *pGreen, __m128i *pRed)
+{
+    __m128i const Mask = _mm_set1_epi32(0xff);
+    __m128i const Lo   = _mm_loadu_si128((const __m128i *)pbSrc);
+    __m128i const Hi   = _mm_loadu_si128((const __m128i *)(pbSrc + 16));
+    *pBlue  = _mm_packs_epi32(_mm_and_si128(Lo, Mask), _mm_and_si128(Hi, Mask));
+    *pGreen = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(Lo, 8), Mask), _mm_and_si128(_mm_srli_epi32(Hi, 8), Mask));
+    *pRed   = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(Lo, 16), Mask), _mm_and_si128(_mm_srli_epi32(Hi, 16), Mask));
+}
+
+/**
+ * Calculates the luma of 8 pixels, see colorConvWriteYUV420p().
+ *
+ * The weighted sum does not fit into a signed word, but as it is never
+ * negative, unsigned wrap-around arithmetic yields the correct result.
+ */
+DECLINLINE(__m128i) colorConvSse2Luma(__m128i Blue, __m128i Green, __m128i Red)
+{
+    __m128i Sum = _mm_add_epi16(_mm_mullo_epi16(Red, _mm_set1_epi16(66)), _mm_mullo_epi16(Green, _mm_set1_epi16(129)));
+    Sum = _mm_add_epi16(Sum, _mm_mullo_epi16(Blue, _mm_set1_epi16(25)));
+    Sum = _mm_srli_epi16(_mm_add_epi16(Sum, _mm_set1_epi16(128)), 8);
+    return _mm_add_epi16(Sum, _mm_set1_epi16(16));
+}
+
+/**
+ * Calculates the quarter chroma contribution of 8 pixels, see colorConvWriteYUV420p().
+ *
+ * The weighted sums stay within +/-28688, so signed words are sufficient.
+ */
+DECLINLINE(__m128i) colorConvSse2Chroma(__m128i Blue, __m128i Green, __m128i Red, short iRed, short iGreen, short iBlue)
+{
+    __m128i Sum = _mm_add_epi16(_mm_mullo_epi16(Red, _mm_set1_epi16(iRed)), _mm_mullo_epi16(Green, _mm_set1_epi16(iGreen)));
+    Sum = _mm_add_epi16(Sum, _mm_mullo_epi16(Blue, _mm_set1_epi16(iBlue)));
+    Sum = _mm_srai_epi16(_mm_add_epi16(Sum, _mm_set1_epi16(128)), 8);
+    return _mm_srli_epi16(_mm_add_epi16(Sum, _mm_set1_epi16(128)), 2);
+}
+
+/**
+ * Sums up the chroma contributions of two 2x2 blocks and stores the 4 resulting bytes.
+ */
+DECLINLINE(void) colorConvSse2StoreChroma(uint8_t *pbDst, __m128i Row1, __m128i Row2)
+{
+    __m128i Sum = _mm_madd_epi16(_mm_add_epi16(Row1, Row2), _mm_set1_epi16(1));
+    Sum = _mm_packs_epi32(Sum, Sum);
+    *(uint32_t *)pbDst = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(Sum, Sum));
+}
+
+/**
+ * SSE2 variant of colorConvWriteYUV420p<ColorConvBGRA32Iter>, producing
+ * identical output.
+ *
+ * Converts 8x2 pixels per iteration and leaves any remaining columns to the
+ * generic code.
+ */
+static bool colorConvWriteYUV420pBGRA32Sse2(unsigned aWidth, unsigned aHeight, uint8_t *aDestBuf, uint8_t *aSrcBuf,
+                                            unsigned aRowFirst, unsigned aRowEnd)
+{
+    AssertReturn(!(aWidth & 1), false);
+    AssertReturn(!(aHeight & 1), false);
+    AssertReturn(!(aRowFirst & 1) && !(aRowEnd & 1) && aRowFirst <= aRowEnd && aRowEnd <= aHeight, false);
+
+    unsigned const cPixels  = aWidth * aHeight;
+    unsigned const cxSimd   = aWidth & ~7U;
+    uint8_t * const pbDstU  = aDestBuf + cPixels;
+    uint8_t * const pbDstV  = aDestBuf + cPixels + cPixels / 4;
+
+    for (unsigned y = aRowFirst; y < aRowEnd; y += 2)
+    {
+        const uint8_t *pbSrc1 = aSrcBuf + y * aWidth * 4;
+        const uint8_t *pbSrc2 = pbSrc1 + aWidth * 4;
+        uint8_t       *pbY1   = aDestBuf + y * aWidth;
+        uint8_t       *pbY2   = pbY1 + aWidth;
+        unsigned const offUV  = y / 2 * aWidth / 2;
+
+        for (unsigned x = 0; x < cxSimd; x += 8)
+        {
+            __m128i Blue1, Green1, Red1, Blue2, Green2, Red2;
+            colorConvSse2LoadBGRA32(pbSrc1 + x * 4, &Blue1, &Green1, &Red1);
+            colorConvSse2LoadBGRA32(pbSrc2 + x * 4, &Blue2, &Green2, &Red2);
+
+            __m128i const Y1 = colorConvSse2Luma(Blue1, Green1, Red1);
+            __m128i const Y2 = colorConvSse2Luma(Blue2, Green2, Red2);
+            _mm_storel_epi64((__m128i *)(pbY1 + x), _mm_packus_epi16(Y1, Y1));
+            _mm_storel_epi64((__m128i *)(pbY2 + x), _mm_packus_epi16(Y2, Y2));
+
+            colorConvSse2StoreChroma(pbDstU + offUV + x / 2,
+                                     colorConvSse2Chroma(Blue1, Green1, Red1, -38, -74, 112),
+                                     colorConvSse2Chroma(Blue2, Green2, Red2, -38, -74, 112));
+            colorConvSse2StoreChroma(pbDstV + offUV + x / 2,
+                                     colorConvSse2Chroma(Blue1, Green1, Red1, 112, -94, -18),
+                                     colorConvSse2Chroma(Blue2, Green2, Red2, 112, -94, -18));
+        }
+
+        for (unsigned x = cxSimd; x < aWidth; x += 2)
+        {
+            unsigned u = 0;
+            unsigned v = 0;
+            for (unsigned i = 0; i < 4; i++)
+            {
+                const uint8_t *pbPixel = (i < 2 ? pbSrc1 : pbSrc2) + (x + (i & 1)) * 4;
+                int const      red     = pbPixel[2];
+                int const      green   = pbPixel[1];
+                int const      blue    = pbPixel[0];
+                (i < 2 ? pbY1 : pbY2)[x + (i & 1)] = ((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16;
+                u += (((-38 * red - 74 * green + 112 * blue + 128) >> 8) + 128) / 4;
+                v += (((112 * red - 94 * green -  18 * blue + 128) >> 8) + 128) / 4;
+            }
+            pbDstU[offUV + x / 2] = u;
+            pbDstV[offUV + x / 2] = v;
+        }
+    }
+
+    return true;
+}
+#endif /* VIDEOREC_WITH_SSE2 */
+
 /**
  * Convert an image to RGB24 format
  * @returns true on success, false on failure
@@ -454,71 +604,63 @@ inline bool colorConvWriteRGB24(unsigned aWidth, unsigned aHeight,
 }
 
 /**
- * Worker thread for all streams of a video recording context.
+ * Worker thread of a single video recording stream.
  *
- * Does RGB/YUV conversion and encoding.
+ * Does RGB/YUV conversion and encoding for the stream's screen, and writes
+ * the context's audio frames to the stream's container. Each stream has its
+ * own thread so that multi-monitor recordings are encoded in parallel.
  */
-static DECLCALLBACK(int) videoRecThread(RTTHREAD hThreadSelf, void *pvUser)
+static DECLCALLBACK(int) videoRecStreamThread(RTTHREAD hThreadSelf, void *pvUser)
 {
-    PVIDEORECCONTEXT pCtx = (PVIDEORECCONTEXT)pvUser;
+    PVIDEORECSTREAM  pStream = (PVIDEORECSTREAM)pvUser;
+    PVIDEORECCONTEXT pCtx    = pStream->pCtx;
 
     /* Signal that we're up and rockin'. */
     RTThreadUserSignal(hThreadSelf);
 
     for (;;)
     {
-        int rc = RTSemEventWait(pCtx->WaitEvent, RT_INDEFINITE_WAIT);
+        int rc = RTSemEventWait(pStream->WaitEvent, RT_INDEFINITE_WAIT);
         AssertRCBreak(rc);
 
         if (ASMAtomicReadBool(&pCtx->fShutdown))
             break;
 
-#ifdef VBOX_WITH_AUDIO_VIDEOREC
-        const bool fHasAudioData = ASMAtomicReadBool(&pCtx->fHasAudioData);
-#endif
-        /** @todo r=andy This is inefficient -- as we already wake up this thread
-         *               for every screen from Main, we here go again (on every wake up) through
-         *               all screens.  */
-        for (VideoRecStreams::iterator it = pCtx->vecStreams.begin(); it != pCtx->vecStreams.end(); it++)
+        if (ASMAtomicReadBool(&pStream->fHasVideoData))
         {
-            PVIDEORECSTREAM pStream = (*it);
-
-            if (!pStream->fEnabled)
-                continue;
+            /* The dirty range is only written by the EMT while no video data is pending. */
+            uint32_t const uRowFirst = pStream->Video.uDirtyFirst & ~1U;
+            uint32_t const uRowEnd   = RT_MIN(RT_ALIGN_32(pStream->Video.uDirtyEnd, 2), pStream->Video.uDstHeight);
+            pStream->Video.uDirtyFirst = pStream->Video.uDirtyEnd = 0;
 
-            if (ASMAtomicReadBool(&pStream->fHasVideoData))
-            {
-                rc = videoRecRGBToYUV(pStream);
+            rc = uRowFirst < uRowEnd ? videoRecRGBToYUV(pStream, uRowFirst, uRowEnd) : VINF_SUCCESS;
 
-                ASMAtomicWriteBool(&pStream->fHasVideoData, false);
+            ASMAtomicWriteBool(&pStream->fHasVideoData, false);
 
-                if (RT_SUCCESS(rc))
-                    rc = videoRecEncodeAndWrite(pStream);
+            if (RT_SUCCESS(rc))
+                rc = videoRecEncodeAndWrite(pStream);
 
-                if (RT_FAILURE(rc))
+            if (RT_FAILURE(rc))
+            {
+                static unsigned s_cErrEnc = 100;
+                if (s_cErrEnc > 0)
                 {
-                    static unsigned s_cErrEnc = 100;
-                    if (s_cErrEnc > 0)
-                    {
-                        LogRel(("VideoRec: Error %Rrc encoding / writing video frame\n", rc));
-                        s_cErrEnc--;
-                    }
+                    LogRel(("VideoRec: Error %Rrc encoding / writing video frame\n", rc));
+                    s_cErrEnc--;
                 }
             }
+        }
 
 #ifdef VBOX_WITH_AUDIO_VIDEOREC
-            /* Each (enabled) screen has to get the audio data. */
-            if (fHasAudioData)
-            {
-                WebMWriter::BlockData_Opus blockData = { pCtx->Audio.abBuf, pCtx->Audio.cbBuf, pCtx->Audio.uTimeStampMs };
-                rc = pStream->pEBML->WriteBlock(pStream->uTrackAudio, &blockData, sizeof(blockData));
-            }
-#endif
-        } /* for */
+        /* Each (enabled) screen has to get the audio data; the last one done releases the frame. */
+        if (ASMAtomicXchgBool(&pStream->fHasAudioData, false))
+        {
+            WebMWriter::BlockData_Opus blockData = { pCtx->Audio.abBuf, pCtx->Audio.cbBuf, pCtx->Audio.uTimeStampMs };
+            rc = pStream->pEBML->WriteBlock(pStream->uTrackAudio, &blockData, sizeof(blockData));
 
-#ifdef VBOX_WITH_AUDIO_VIDEOREC
-        if (fHasAudioData)
-            ASMAtomicWriteBool(&pCtx->fHasAudioData, false);
+            if (ASMAtomicDecU32(&pCtx->cAudioPending) == 0)
+                ASMAtomicWriteBool(&pCtx->fHasAudioData, false);
+        }
 #endif
     }
 
@@ -554,7 +696,10 @@ int VideoRecContextCreate(uint32_t cScreens, PVIDEORECCONTEXT *ppCtx)
 
         try
         {
-            pStream->uScreen = uScreen;
+            pStream->pCtx      = pCtx;
+            pStream->uScreen   = uScreen;
+            pStream->WaitEvent = NIL_RTSEMEVENT;
+            pStream->Thread    = NIL_RTTHREAD;
 
             pCtx->vecStreams.push_back(pStream);
 
@@ -569,26 +714,13 @@ int VideoRecContextCreate(uint32_t cScreens, PVIDEORECCONTEXT *ppCtx)
 
     if (RT_SUCCESS(rc))
     {
-        pCtx->enmState  = VIDEORECSTS_UNINITIALIZED;
+        /* The encoding threads are created per stream in VideoRecStreamInit(). */
         pCtx->fShutdown = false;
+        pCtx->enmState  = VIDEORECSTS_IDLE;
+        pCtx->fEnabled  = true;
 
-        rc = RTSemEventCreate(&pCtx->WaitEvent);
-        AssertRCReturn(rc, rc);
-
-        rc = RTThreadCreate(&pCtx->Thread, videoRecThread, (void *)pCtx, 0,
-                            RTTHREADTYPE_MAIN_WORKER, RTTHREADFLAGS_WAITABLE, "VideoRec");
-
-        if (RT_SUCCESS(rc)) /* Wait for the thread to start. */
-            rc = RTThreadUserWait(pCtx->Thread, 30 * 1000 /* 30s timeout */);
-
-        if (RT_SUCCESS(rc))
-        {
-            pCtx->enmState = VIDEORECSTS_IDLE;
-            pCtx->fEnabled = true;
-
-            if (ppCtx)
-                *ppCtx = pCtx;
-        }
+        if (ppCtx)
+            *ppCtx = pCtx;
     }
 
     if (RT_FAILURE(rc))
@@ -627,19 +759,35 @@ int VideoRecContextDestroy(PVIDEORECCONTEXT pCtx)
     /* Set shutdown indicator. */
     ASMAtomicWriteBool(&pCtx->fShutdown, true);
 
-    /* Signal the thread. */
-    RTSemEventSignal(pCtx->WaitEvent);
+    /* Signal all stream threads first so that they can wind down in parallel. */
+    VideoRecStreams::iterator it;
+    for (it = pCtx->vecStreams.begin(); it != pCtx->vecStreams.end(); it++)
+        if ((*it)->WaitEvent != NIL_RTSEMEVENT)
+            RTSemEventSignal((*it)->WaitEvent);
 
-    int rc = RTThreadWait(pCtx->Thread, 10 * 1000 /* 10s timeout */, NULL);
-    if (RT_FAILURE(rc))
-        return rc;
+    for (it = pCtx->vecStreams.begin(); it != pCtx->vecStreams.end(); it++)
+    {
+        PVIDEORECSTREAM pStream = (*it);
+
+        if (pStream->Thread != NIL_RTTHREAD)
+        {
+            int rc = RTThreadWait(pStream->Thread, 10 * 1000 /* 10s timeout */, NULL);
+            if (RT_FAILURE(rc))
+                return rc;
+
+            pStream->Thread = NIL_RTTHREAD;
+        }
 
-    rc = RTSemEventDestroy(pCtx->WaitEvent);
-    AssertRC(rc);
+        if (pStream->WaitEvent != NIL_RTSEMEVENT)
+        {
+            int rc2 = RTSemEventDestroy(pStream->WaitEvent);
+            AssertRC(rc2);
 
-    pCtx->WaitEvent = NIL_RTSEMEVENT;
+            pStream->WaitEvent = NIL_RTSEMEVENT;
+        }
+    }
 
-    VideoRecStreams::iterator it = pCtx->vecStreams.begin();
+    it = pCtx->vecStreams.begin();
     while (it != pCtx->vecStreams.end())
     {
         PVIDEORECSTREAM pStream = (*it);
@@ -746,6 +894,14 @@ int VideoRecStreamInit(PVIDEORECCONTEXT pCtx, uint32_t uScreen, const char *pszF
     pStream->Video.pu8RgbBuf = (uint8_t *)RTMemAllocZ(uWidth * uHeight * 4);
     AssertReturn(pStream->Video.pu8RgbBuf, VERR_NO_MEMORY);
 
+    /* The YUV buffer has no defined content yet, so the first frame has to be converted completely. */
+    pStream->Video.uDirtyFirst = 0;
+    pStream->Video.uDirtyEnd   = uHeight;
+
+    /* Share the host CPUs between the screens' encoders. */
+    uint32_t cEncoderThreads = RTMpGetOnlineCount() / RT_MAX((uint32_t)pCtx->vecStreams.size(), 1);
+    cEncoderThreads = RT_MIN(RT_MAX(cEncoderThreads, 1), VIDEOREC_MAX_ENCODER_THREADS);
+
     /* Play safe: the file must not exist, overwriting is potentially
      * hazardous as nothing prevents the user from picking a file name of some
      * other important file, causing unintentional data loss. */
@@ -797,6 +953,11 @@ int VideoRecStreamInit(PVIDEORECCONTEXT pCtx, uint32_t uScreen, const char *pszF
                 pStream->Video.uEncoderDeadline = value.toUInt32();
             }
         }
+        else if (key.compare("vc_threads", Utf8Str::CaseInsensitive) == 0)
+        {
+            cEncoderThreads = RT_MAX(value.toUInt32(), 1);
+            LogRel(("VideoRec: Using %u encoder threads\n", cEncoderThreads));
+        }
         else if (key.compare("vc_enabled", Utf8Str::CaseInsensitive) == 0)
         {
 #ifdef VBOX_WITH_AUDIO_VIDEOREC
@@ -875,8 +1036,8 @@ int VideoRecStreamInit(PVIDEORECCONTEXT pCtx, uint32_t uScreen, const char *pszF
     /* 1ms per frame. */
     pStream->Codec.VPX.Config.g_timebase.num = 1;
     pStream->Codec.VPX.Config.g_timebase.den = 1000;
-    /* Disable multithreading. */
-    pStream->Codec.VPX.Config.g_threads = 0;
+    /* Number of threads; the VP8 encoder distributes macroblock rows among them. */
+    pStream->Codec.VPX.Config.g_threads = cEncoderThreads;
 
     /* Initialize codec. */
     rcv = vpx_codec_enc_init(&pStream->Codec.VPX.CodecCtx, DEFAULTCODEC, &pStream->Codec.VPX.Config, 0);
@@ -893,7 +1054,23 @@ int VideoRecStreamInit(PVIDEORECCONTEXT pCtx, uint32_t uScreen, const char *pszF
     }
 
     pStream->Video.pu8YuvBuf = pStream->Codec.VPX.RawImage.planes[0];
+#else
+    RT_NOREF(cEncoderThreads);
 #endif
+
+    rc = RTSemEventCreate(&pStream->WaitEvent);
+    AssertRCReturn(rc, rc);
+
+    rc = RTThreadCreateF(&pStream->Thread, videoRecStreamThread, (void *)pStream, 0,
+                         RTTHREADTYPE_MAIN_WORKER, RTTHREADFLAGS_WAITABLE, "VideoRec%u", uScreen);
+    if (RT_SUCCESS(rc)) /* Wait for the thread to start. */
+        rc = RTThreadUserWait(pStream->Thread, 30 * 1000 /* 30s timeout */);
+    if (RT_FAILURE(rc))
+    {
+        LogRel(("VideoRec: Failed to start encoding thread for screen #%u (%Rrc)\n", uScreen, rc));
+        return rc;
+    }
+
     pStream->fEnabled = true;
 
     return VINF_SUCCESS;
@@ -1058,17 +1235,26 @@ static int videoRecEncodeAndWrite(PVIDEORECSTREAM pStream)
  *
  * @returns IPRT status code.
  * @param   pStream             Recording stream to convert RGB to YUV video frame buffer for.
+ * @param   uRowFirst           First row to convert, must be even.
+ * @param   uRowEnd             Row after the last row to convert, must be even.
  */
-static int videoRecRGBToYUV(PVIDEORECSTREAM pStream)
+static int videoRecRGBToYUV(PVIDEORECSTREAM pStream, uint32_t uRowFirst, uint32_t uRowEnd)
 {
     switch (pStream->Video.uPixelFormat)
     {
         case VIDEORECPIXELFMT_RGB32:
             LogFlow(("32 bit\n"));
+#ifdef VIDEOREC_WITH_SSE2
+            if (!colorConvWriteYUV420pBGRA32Sse2(pStream->Video.uDstWidth,
+                                                 pStream->Video.uDstHeight,
+                                                 pStream->Video.pu8YuvBuf,
+                                                 pStream->Video.pu8RgbBuf, uRowFirst, uRowEnd))
+#else
             if (!colorConvWriteYUV420p<ColorConvBGRA32Iter>(pStream->Video.uDstWidth,
                                                             pStream->Video.uDstHeight,
                                                             pStream->Video.pu8YuvBuf,
-                                                            pStream->Video.pu8RgbBuf))
+                                                            pStream->Video.pu8RgbBuf, uRowFirst, uRowEnd))
+#endif
                 return VERR_INVALID_PARAMETER;
             break;
         case VIDEORECPIXELFMT_RGB24:
@@ -1076,7 +1262,7 @@ static int videoRecRGBToYUV(PVIDEORECSTREAM pStream)
             if (!colorConvWriteYUV420p<ColorConvBGR24Iter>(pStream->Video.uDstWidth,
                                                            pStream->Video.uDstHeight,
                                                            pStream->Video.pu8YuvBuf,
-                                                           pStream->Video.pu8RgbBuf))
+                                                           pStream->Video.pu8RgbBuf, uRowFirst, uRowEnd))
                 return VERR_INVALID_PARAMETER;
             break;
         case VIDEORECPIXELFMT_RGB565:
@@ -1084,7 +1270,7 @@ static int videoRecRGBToYUV(PVIDEORECSTREAM pStream)
             if (!colorConvWriteYUV420p<ColorConvBGR565Iter>(pStream->Video.uDstWidth,
                                                             pStream->Video.uDstHeight,
                                                             pStream->Video.pu8YuvBuf,
-                                                            pStream->Video.pu8RgbBuf))
+                                                            pStream->Video.pu8RgbBuf, uRowFirst, uRowEnd))
                 return VERR_INVALID_PARAMETER;
             break;
         default:
@@ -1113,32 +1299,62 @@ int VideoRecSendAudioFrame(PVIDEORECCONTEXT pCtx, const void *pvData, size_t cbD
     if (!ASMAtomicCmpXchgU32(&pCtx->enmState, VIDEORECSTS_BUSY, VIDEORECSTS_IDLE))
         return VINF_TRY_AGAIN;
 
-    /* To save time spent in EMT, do the required audio multiplexing in the encoding thread.
+    /* To save time spent in EMT, do the required audio multiplexing in the encoding threads.
      *
      * The multiplexing is needed to supply all recorded (enabled) screens with the same
-     * audio data at the same given point in time.
+     * audio data at the same given point in time. The audio frame is released again
+     * by the last stream thread which has written it.
      */
 
-    if (ASMAtomicReadBool(&pCtx->fHasAudioData))
-        return VERR_TRY_AGAIN; /* Previous frame not yet encoded. */
+    int rc = VINF_SUCCESS;
+    if (!ASMAtomicReadBool(&pCtx->fHasAudioData))
+    {
+        memcpy(pCtx->Audio.abBuf, pvData, RT_MIN(_64K, cbData));
+
+        pCtx->Audio.cbBuf        = cbData;
+        pCtx->Audio.uTimeStampMs = uTimeStampMs;
+
+        uint32_t cStreams = 0;
+        VideoRecStreams::iterator it;
+        for (it = pCtx->vecStreams.begin(); it != pCtx->vecStreams.end(); it++)
+            if ((*it)->fEnabled)
+                cStreams++;
+
+        if (cStreams)
+        {
+            ASMAtomicWriteU32(&pCtx->cAudioPending, cStreams);
+            ASMAtomicWriteBool(&pCtx->fHasAudioData, true);
 
-    memcpy(pCtx->Audio.abBuf, pvData, RT_MIN(_64K, cbData));
+            for (it = pCtx->vecStreams.begin(); it != pCtx->vecStreams.end(); it++)
+            {
+                PVIDEORECSTREAM pStream = (*it);
+                if (pStream->fEnabled)
+                {
+                    ASMAtomicWriteBool(&pStream->fHasAudioData, true);
+                    RTSemEventSignal(pStream->WaitEvent);
+                }
+            }
+        }
+    }
+    else
+        rc = VERR_TRY_AGAIN; /* Previous frame not yet encoded. */
 
-    pCtx->Audio.cbBuf        = cbData;
-    pCtx->Audio.uTimeStampMs = uTimeStampMs;
+    ASMAtomicCmpXchgU32(&pCtx->enmState, VIDEORECSTS_IDLE, VIDEORECSTS_BUSY);
 
-    ASMAtomicWriteBool(&pCtx->fHasAudioData, true);
-    RTSemEventSignal(pCtx->WaitEvent);
+    return rc;
 #else
     RT_NOREF(pCtx, pvData, cbData, uTimeStampMs);
-#endif
     return VINF_SUCCESS;
+#endif
 }
 
 /**
  * VideoRec utility function to copy a source video frame to the intermediate
  * RGB buffer. This function is executed only once per time.
  *
+ * Frames which do not differ from the previous one are not handed to the
+ * encoder (see VIDEOREC_MAX_IDLE_MS), and only the changed rows get converted.
+ *
  * @thread  EMT
  *
  * @returns IPRT status code.
@@ -1248,6 +1464,7 @@ int VideoRecSendVideoFrame(PVIDEORECCONTEXT pCtx, uint32_t uScreen, uint32_t x,
             h = pStream->Video.uDstHeight - destY;
 
         /* Calculate bytes per pixel. */
+        uint32_t const uPixelFormatOld = pStream->Video.uPixelFormat;
         uint32_t bpp = 1;
         if (uPixelFormat == BitmapFormat_BGR)
         {
@@ -1274,10 +1491,19 @@ int VideoRecSendVideoFrame(PVIDEORECCONTEXT pCtx, uint32_t uScreen, uint32_t x,
             AssertMsgFailed(("Unknown pixel format! mPixelFormat=%d\n", pStream->Video.uPixelFormat));
 
         /* One of the dimensions of the current frame is smaller than before so
-         * clear the entire buffer to prevent artifacts from the previous frame. */
+         * clear the entire buffer to prevent artifacts from the previous frame.
+         * The same goes for a changed pixel format, where the buffer content
+         * cannot be compared against the new frame. */
+        uint32_t uDirtyFirst = UINT32_MAX;
+        uint32_t uDirtyEnd   = 0;
         if (   uSrcWidth  < pStream->Video.uSrcLastWidth
-            || uSrcHeight < pStream->Video.uSrcLastHeight)
+            || uSrcHeight < pStream->Video.uSrcLastHeight
+            || uPixelFormatOld != pStream->Video.uPixelFormat)
+        {
             memset(pStream->Video.pu8RgbBuf, 0, pStream->Video.uDstWidth * pStream->Video.uDstHeight * 4);
+            uDirtyFirst = 0;
+            uDirtyEnd   = pStream->Video.uDstHeight;
+        }
 
         pStream->Video.uSrcLastWidth  = uSrcWidth;
         pStream->Video.uSrcLastHeight = uSrcHeight;
@@ -1286,23 +1512,47 @@ int VideoRecSendVideoFrame(PVIDEORECCONTEXT pCtx, uint32_t uScreen, uint32_t x,
         uint32_t offSrc = y * uBytesPerLine + x * bpp;
         uint32_t offDst = (destY * pStream->Video.uDstWidth + destX) * bpp;
 
-        /* Do the copy. */
+        /* Do the copy, only touching (and later converting) rows which actually changed. */
         for (unsigned int i = 0; i < h; i++)
         {
             /* Overflow check. */
             Assert(offSrc + w * bpp <= uSrcHeight * uBytesPerLine);
             Assert(offDst + w * bpp <= pStream->Video.uDstHeight * pStream->Video.uDstWidth * bpp);
 
-            memcpy(pStream->Video.pu8RgbBuf + offDst, puSrcData + offSrc, w * bpp);
+            if (memcmp(pStream->Video.pu8RgbBuf + offDst, puSrcData + offSrc, w * bpp))
+            {
+                memcpy(pStream->Video.pu8RgbBuf + offDst, puSrcData + offSrc, w * bpp);
+
+                uDirtyFirst = RT_MIN(uDirtyFirst, destY + i);
+                uDirtyEnd   = RT_MAX(uDirtyEnd,   destY + i + 1);
+            }
 
             offSrc += uBytesPerLine;
             offDst += pStream->Video.uDstWidth * bpp;
         }
 
+        /* Merge with what has not been converted yet (e.g. the initial full frame). */
+        if (pStream->Video.uDirtyFirst < pStream->Video.uDirtyEnd)
+        {
+            uDirtyFirst = RT_MIN(uDirtyFirst, pStream->Video.uDirtyFirst);
+            uDirtyEnd   = RT_MAX(uDirtyEnd,   pStream->Video.uDirtyEnd);
+        }
+
+        if (uDirtyFirst >= uDirtyEnd)
+        {
+            /* Nothing changed, skip the frame unless the screen has been idle for too long. */
+            if (uTimeStampMs - pStream->uCurTimeStampMs < VIDEOREC_MAX_IDLE_MS)
+                break;
+            uDirtyFirst = uDirtyEnd = 0;
+        }
+
+        pStream->Video.uDirtyFirst = uDirtyFirst;
+        pStream->Video.uDirtyEnd   = uDirtyEnd;
+
         pStream->uCurTimeStampMs = uTimeStampMs;
 
         ASMAtomicWriteBool(&pStream->fHasVideoData, true);
-        RTSemEventSignal(pCtx->WaitEvent);
+        RTSemEventSignal(pStream->WaitEvent);
 
     } while (0);
 
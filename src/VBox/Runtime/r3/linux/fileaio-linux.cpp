@@ -40,6 +40,26 @@
  * compensated if the user of this API implements caching itself. The next
  * limitation is that data buffers must be aligned at a 512 byte boundary or the
  * request will fail.
+ *
+ * On kernels providing io_uring (5.11 or later, we need IORING_FEAT_EXT_ARG for
+ * waiting with a timeout) contexts are backed by a submission/completion ring
+ * pair instead.  Requests are written straight into the shared submission
+ * ring and a whole batch is handed to the kernel with a single io_uring_enter
+ * call, completions are reaped from the shared completion ring without any
+ * syscall at all if they are already there.  io_uring also completes buffered
+ * (non O_DIRECT) I/O asynchronously.  Flush requests are submitted with
+ * IOSQE_IO_DRAIN so they are only started after all previously submitted
+ * requests on the context have completed, i.e. they act as a barrier like the
+ * callers expect.
+ *
+ * The backend is selected when the context is created.  Setting the
+ * IPRT_FILE_AIO_NO_IO_URING environment variable forces the old io_* based
+ * backend, setting IPRT_FILE_AIO_IO_URING_SQPOLL makes the kernel poll the
+ * submission ring with a dedicated thread, saving the submission syscall at
+ * the cost of a busy kernel thread.
+ *
+ * Registering buffers and files with the ring is not done since the RTFileAio
+ * API has no way to tell when a buffer or a file stops being used.
  */
 /** @todo r=bird: What's this about "must be opened with O_DIRECT"? An
  *        explanation would be nice, esp. seeing what Linus is quoted saying
@@ -53,13 +73,17 @@
 #include <iprt/asm.h>
 #include <iprt/mem.h>
 #include <iprt/assert.h>
+#include <iprt/critsect.h>
+#include <iprt/env.h>
 #include <iprt/string.h>
 #include <iprt/err.h>
 #include <iprt/log.h>
 #include <iprt/thread.h>
+#include <iprt/time.h>
 #include "internal/fileaio.h"
 
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/syscall.h>
 #include <errno.h>
 
@@ -167,6 +191,174 @@ typedef struct LNXKAIOIOEVENT
 } LNXKAIOIOEVENT, *PLNXKAIOIOEVENT;
 
 
+/**
+ * io_uring submission queue entry.
+ * Redefined here so we don't depend on recent kernel headers.
+ */
+typedef struct LNXIOURINGSQE
+{
+    /** The opcode (LNXIOURING_OP_XXX). */
+    uint8_t             u8Opc;
+    /** Flags (LNXIOURING_SQE_F_XXX). */
+    uint8_t             fFlags;
+    /** I/O priority. */
+    uint16_t            u16IoPrio;
+    /** The file descriptor. */
+    int32_t             iFd;
+    /** The file offset. */
+    uint64_t            off;
+    /** The buffer address. */
+    uint64_t            u64Addr;
+    /** The transfer size. */
+    uint32_t            cbLen;
+    /** Opcode specific flags. */
+    uint32_t            fOpc;
+    /** User data passed back in the completion entry. */
+    uint64_t            u64User;
+    /** Unused here. */
+    uint64_t            au64Reserved[3];
+} LNXIOURINGSQE;
+AssertCompileSize(LNXIOURINGSQE, 64);
+/** Pointer to an io_uring submission queue entry. */
+typedef LNXIOURINGSQE *PLNXIOURINGSQE;
+
+/**
+ * io_uring completion queue entry.
+ */
+typedef struct LNXIOURINGCQE
+{
+    /** The user data from the submission queue entry. */
+    uint64_t            u64User;
+    /** The result, negative errno on failure. */
+    int32_t             rcLnx;
+    /** Flags. */
+    uint32_t            fFlags;
+} LNXIOURINGCQE;
+AssertCompileSize(LNXIOURINGCQE, 16);
+/** Pointer to a const io_uring completion queue entry. */
+typedef LNXIOURINGCQE const *PCLNXIOURINGCQE;
+
+/**
+ * io_uring submission ring offsets (struct io_sqring_offsets).
+ */
+typedef struct LNXIOURINGSQOFFSETS
+{
+    uint32_t            offHead;
+    uint32_t            offTail;
+    uint32_t            offRingMask;
+    uint32_t            offRingEntries;
+    uint32_t            offFlags;
+    uint32_t            offDropped;
+    uint32_t            offArray;
+    uint32_t            u32Reserved;
+    uint64_t            u64Reserved;
+} LNXIOURINGSQOFFSETS;
+AssertCompileSize(LNXIOURINGSQOFFSETS, 40);
+
+/**
+ * io_uring completion ring offsets (struct io_cqring_offsets).
+ */
+typedef struct LNXIOURINGCQOFFSETS
+{
+    uint32_t            offHead;
+    uint32_t            offTail;
+    uint32_t            offRingMask;
+    uint32_t            offRingEntries;
+    uint32_t            offOverflow;
+    uint32_t            offCqes;
+    uint32_t            offFlags;
+    uint32_t            u32Reserved;
+    uint64_t            u64Reserved;
+} LNXIOURINGCQOFFSETS;
+AssertCompileSize(LNXIOURINGCQOFFSETS, 40);
+
+/**
+ * io_uring setup parameters (struct io_uring_params).
+ */
+typedef struct LNXIOURINGPARAMS
+{
+    uint32_t            cSqEntries;
+    uint32_t            cCqEntries;
+    uint32_t            fFlags;
+    uint32_t            uSqThreadCpu;
+    uint32_t            cMsSqThreadIdle;
+    uint32_t            fFeatures;
+    uint32_t            uWqFd;
+    uint32_t            au32Reserved[3];
+    LNXIOURINGSQOFFSETS SqOffsets;
+    LNXIOURINGCQOFFSETS CqOffsets;
+} LNXIOURINGPARAMS;
+AssertCompileSize(LNXIOURINGPARAMS, 120);
+
+/**
+ * Extended argument for io_uring_enter (struct io_uring_getevents_arg).
+ */
+typedef struct LNXIOURINGGETEVENTSARG
+{
+    uint64_t            u64SigMask;
+    uint32_t            cbSigMask;
+    uint32_t            u32Pad;
+    uint64_t            u64Timeout;
+} LNXIOURINGGETEVENTSARG;
+AssertCompileSize(LNXIOURINGGETEVENTSARG, 24);
+
+/**
+ * Timeout for io_uring_enter (struct __kernel_timespec).
+ */
+typedef struct LNXIOURINGTIMESPEC
+{
+    int64_t             tv_sec;
+    int64_t             tv_nsec;
+} LNXIOURINGTIMESPEC;
+
+/**
+ * io_uring instance state of a context.
+ */
+typedef struct LNXIOURING
+{
+    /** The ring file descriptor, -1 if the io_* API is used. */
+    int                 iFdRing;
+    /** Whether the kernel polls the submission ring. */
+    bool                fSqPoll;
+    /** Mapping of the submission ring. */
+    void               *pvSqRing;
+    /** Size of the submission ring mapping. */
+    size_t              cbSqRing;
+    /** Mapping of the completion ring, can be the same as pvSqRing. */
+    void               *pvCqRing;
+    /** Size of the completion ring mapping. */
+    size_t              cbCqRing;
+    /** The submission queue entries. */
+    PLNXIOURINGSQE      paSqes;
+    /** Size of the submission queue entries mapping. */
+    size_t              cbSqes;
+    /** Submission ring: head (kernel updated). */
+    uint32_t volatile  *pu32SqHead;
+    /** Submission ring: tail. */
+    uint32_t volatile  *pu32SqTail;
+    /** Submission ring: flags (kernel updated). */
+    uint32_t volatile  *pfSqFlags;
+    /** Submission ring: index array. */
+    uint32_t volatile  *pau32SqArray;
+    /** Submission ring: index mask. */
+    uint32_t            fSqMask;
+    /** Submission ring: number of entries. */
+    uint32_t            cSqEntries;
+    /** Completion ring: head. */
+    uint32_t volatile  *pu32CqHead;
+    /** Completion ring: tail (kernel updated). */
+    uint32_t volatile  *pu32CqTail;
+    /** Completion ring: the entries. */
+    PCLNXIOURINGCQE     paCqes;
+    /** Completion ring: index mask. */
+    uint32_t            fCqMask;
+    /** Serializes access to the submission ring. */
+    RTCRITSECT          CritSectSubmit;
+} LNXIOURING;
+/** Pointer to io_uring instance state. */
+typedef LNXIOURING *PLNXIOURING;
+
+
 /**
  * Async I/O completion context state.
  */
@@ -188,6 +380,8 @@ typedef struct RTFILEAIOCTXINTERNAL
     uint32_t            fFlags;
     /** Magic value (RTFILEAIOCTX_MAGIC). */
     uint32_t            u32Magic;
+    /** The io_uring state, IoUring.iFdRing is -1 when the io_* API is used. */
+    LNXIOURING          IoUring;
 } RTFILEAIOCTXINTERNAL;
 /** Pointer to an internal context structure. */
 typedef RTFILEAIOCTXINTERNAL *PRTFILEAIOCTXINTERNAL;
@@ -223,6 +417,40 @@ typedef RTFILEAIOREQINTERNAL *PRTFILEAIOREQINTERNAL;
 /** The max number of events to get in one call. */
 #define AIO_MAXIMUM_REQUESTS_PER_CONTEXT 64
 
+#ifndef __NR_io_uring_setup
+# define __NR_io_uring_setup            425
+#endif
+#ifndef __NR_io_uring_enter
+# define __NR_io_uring_enter            426
+#endif
+
+/** @name io_uring constants.
+ * @{ */
+#define LNXIOURING_OP_FSYNC             UINT8_C(3)
+#define LNXIOURING_OP_ASYNC_CANCEL      UINT8_C(14)
+#define LNXIOURING_OP_READ              UINT8_C(22)
+#define LNXIOURING_OP_WRITE             UINT8_C(23)
+#define LNXIOURING_SQE_F_IO_DRAIN       UINT8_C(0x02)
+#define LNXIOURING_SETUP_SQPOLL         RT_BIT_32(1)
+#define LNXIOURING_SETUP_CQSIZE         RT_BIT_32(3)
+#define LNXIOURING_FEAT_SINGLE_MMAP     RT_BIT_32(0)
+#define LNXIOURING_FEAT_EXT_ARG         RT_BIT_32(8)
+#define LNXIOURING_ENTER_GETEVENTS      RT_BIT_32(0)
+#define LNXIOURING_ENTER_SQ_WAKEUP      RT_BIT_32(1)
+#define LNXIOURING_ENTER_EXT_ARG        RT_BIT_32(3)
+#define LNXIOURING_SQ_NEED_WAKEUP       RT_BIT_32(0)
+#define LNXIOURING_OFF_SQ_RING          UINT64_C(0)
+#define LNXIOURING_OFF_CQ_RING          UINT64_C(0x8000000)
+#define LNXIOURING_OFF_SQES             UINT64_C(0x10000000)
+/** @} */
+
+/** Max number of submission ring entries we ask for. */
+#define LNXIOURING_SQ_ENTRIES_MAX       _4K
+/** Max number of completion ring entries the kernel supports. */
+#define LNXIOURING_CQ_ENTRIES_MAX       _64K
+/** Idle time before the submission polling thread goes to sleep. */
+#define LNXIOURING_SQPOLL_IDLE_MS       10
+
 
 /**
  * Creates a new async I/O context.
@@ -293,6 +521,418 @@ DECLINLINE(int) rtFileAsyncIoLinuxGetEvents(LNXKAIOCONTEXT AioContext, long cReq
     return rc;
 }
 
+/**
+ * Enters the io_uring.
+ * @returns Number of consumed submissions (natural number w/ 0), IPRT error code (negative).
+ */
+DECLINLINE(int) rtFileAsyncIoLinuxUringEnter(PLNXIOURING pIoUring, uint32_t cToSubmit, uint32_t cMinComplete,
+                                             uint32_t fFlags, LNXIOURINGGETEVENTSARG *pArg)
+{
+    int rc = syscall(__NR_io_uring_enter, pIoUring->iFdRing, cToSubmit, cMinComplete, fFlags,
+                     pArg, pArg ? sizeof(*pArg) : 0);
+    if (RT_UNLIKELY(rc == -1))
+    {
+        if (errno == ETIME)
+            return VERR_TIMEOUT;
+        return RTErrConvertFromErrno(errno);
+    }
+
+    return rc;
+}
+
+/**
+ * Unmaps the rings and closes the io_uring.
+ */
+static void rtFileAsyncIoLinuxUringDestroy(PLNXIOURING pIoUring)
+{
+    if (pIoUring->paSqes)
+        munmap(pIoUring->paSqes, pIoUring->cbSqes);
+    if (pIoUring->pvCqRing && pIoUring->pvCqRing != pIoUring->pvSqRing)
+        munmap(pIoUring->pvCqRing, pIoUring->cbCqRing);
+    if (pIoUring->pvSqRing)
+        munmap(pIoUring->pvSqRing, pIoUring->cbSqRing);
+    if (pIoUring->iFdRing != -1)
+    {
+        close(pIoUring->iFdRing);
+        RTCritSectDelete(&pIoUring->CritSectSubmit);
+    }
+    pIoUring->paSqes   = NULL;
+    pIoUring->pvCqRing = NULL;
+    pIoUring->pvSqRing = NULL;
+    pIoUring->iFdRing  = -1;
+}
+
+/**
+ * Tries to set up an io_uring for a context.
+ *
+ * @returns IPRT status code, the caller falls back to the io_* API on failure.
+ * @param   pIoUring        The io_uring state to initialize.
+ * @param   cAioReqsMax     The max number of outstanding requests.
+ */
+static int rtFileAsyncIoLinuxUringCreate(PLNXIOURING pIoUring, uint32_t cAioReqsMax)
+{
+    pIoUring->iFdRing = -1;
+    if (RTEnvExist("IPRT_FILE_AIO_NO_IO_URING"))
+        return VERR_NOT_SUPPORTED;
+
+    /* Every outstanding request must fit into the completion ring. */
+    if (cAioReqsMax > LNXIOURING_CQ_ENTRIES_MAX)
+        return VERR_OUT_OF_RANGE;
+    uint32_t cCqEntries = 1;
+    while (cCqEntries < cAioReqsMax)
+        cCqEntries <<= 1;
+
+    LNXIOURINGPARAMS Params;
+    RT_ZERO(Params);
+    Params.fFlags     = LNXIOURING_SETUP_CQSIZE;
+    Params.cCqEntries = cCqEntries;
+    if (RTEnvExist("IPRT_FILE_AIO_IO_URING_SQPOLL"))
+    {
+        Params.fFlags         |= LNXIOURING_SETUP_SQPOLL;
+        Params.cMsSqThreadIdle = LNXIOURING_SQPOLL_IDLE_MS;
+    }
+    uint32_t const cSqEntries = RT_MIN(cCqEntries, LNXIOURING_SQ_ENTRIES_MAX);
+
+    int iFdRing = syscall(__NR_io_uring_setup, cSqEntries, &Params);
+    if (iFdRing == -1)
+        return RTErrConvertFromErrno(errno);
+    if (!(Params.fFeatures & LNXIOURING_FEAT_EXT_ARG))
+    {
+        /* Too old, we can't wait with a timeout. */
+        close(iFdRing);
+        return VERR_NOT_SUPPORTED;
+    }
+
+    int rc = RTCritSectInit(&pIoUring->CritSectSubmit);
+    if (RT_FAILURE(rc))
+    {
+        close(iFdRing);
+        return rc;
+    }
+    pIoUring->iFdRing = iFdRing;
+    pIoUring->fSqPoll = RT_BOOL(Params.fFlags & LNXIOURING_SETUP_SQPOLL);
+
+    /*
+     * Map the rings.
+     */
+    pIoUring->cbSqRing = Params.SqOffsets.offArray + Params.cSqEntries * sizeof(uint32_t);
+    pIoUring->cbCqRing = Params.CqOffsets.offCqes  + Params.cCqEntries * sizeof(LNXIOURINGCQE);
+    if (Params.fFeatures & LNXIOURING_FEAT_SINGLE_MMAP)
+        pIoUring->cbSqRing = pIoUring->cbCqRing = RT_MAX(pIoUring->cbSqRing, pIoUring->cbCqRing);
+
+    void *pv = mmap(NULL, pIoUring->cbSqRing, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    iFdRing, LNXIOURING_OFF_SQ_RING);
+    if (pv != MAP_FAILED)
+    {
+        pIoUring->pvSqRing = pv;
+        if (Params.fFeatures & LNXIOURING_FEAT_SINGLE_MMAP)
+            pIoUring->pvCqRing = pv;
+        else
+        {
+            pv = mmap(NULL, pIoUring->cbCqRing, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      iFdRing, LNXIOURING_OFF_CQ_RING);
+            if (pv != MAP_FAILED)
+                pIoUring->pvCqRing = pv;
+        }
+    }
+    if (pIoUring->pvCqRing)
+    {
+        pIoUring->cbSqes = Params.cSqEntries * sizeof(LNXIOURINGSQE);
+        pv = mmap(NULL, pIoUring->cbSqes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  iFdRing, LNXIOURING_OFF_SQES);
+        if (pv != MAP_FAILED)
+        {
+            uint8_t *pbSq = (uint8_t *)pIoUring->pvSqRing;
+            uint8_t *pbCq = (uint8_t *)pIoUring->pvCqRing;
+            pIoUring->paSqes       = (PLNXIOURINGSQE)pv;
+            pIoUring->pu32SqHead   = (uint32_t volatile *)(pbSq + Params.SqOffsets.offHead);
+            pIoUring->pu32SqTail   = (uint32_t volatile *)(pbSq + Params.SqOffsets.offTail);
+            pIoUring->pfSqFlags    = (uint32_t volatile *)(pbSq + Params.SqOffsets.offFlags);
+            pIoUring->pau32SqArray = (uint32_t volatile *)(pbSq + Params.SqOffsets.offArray);
+            pIoUring->fSqMask      = *(uint32_t *)(pbSq + Params.SqOffsets.offRingMask);
+            pIoUring->cSqEntries   = *(uint32_t *)(pbSq + Params.SqOffsets.offRingEntries);
+            pIoUring->pu32CqHead   = (uint32_t volatile *)(pbCq + Params.CqOffsets.offHead);
+            pIoUring->pu32CqTail   = (uint32_t volatile *)(pbCq + Params.CqOffsets.offTail);
+            pIoUring->paCqes       = (PCLNXIOURINGCQE)(pbCq + Params.CqOffsets.offCqes);
+            pIoUring->fCqMask      = *(uint32_t *)(pbCq + Params.CqOffsets.offRingMask);
+            return VINF_SUCCESS;
+        }
+    }
+
+    rc = RTErrConvertFromErrno(errno);
+    rtFileAsyncIoLinuxUringDestroy(pIoUring);
+    return rc;
+}
+
+/**
+ * Submits requests through the io_uring of the given context.
+ *
+ * @returns IPRT status code.
+ * @param   pCtxInt         The context.
+ * @param   pahReqs         The requests, already validated and in the submitted state.
+ * @param   cReqs           Number of requests.
+ */
+static int rtFileAsyncIoLinuxUringSubmit(PRTFILEAIOCTXINTERNAL pCtxInt, PRTFILEAIOREQ pahReqs, size_t cReqs)
+{
+    PLNXIOURING pIoUring = &pCtxInt->IoUring;
+    int         rc       = VINF_SUCCESS;
+
+    RTCritSectEnter(&pIoUring->CritSectSubmit);
+    size_t   iReq  = 0;
+    uint32_t uTail = *pIoUring->pu32SqTail;
+    while (iReq < cReqs)
+    {
+        /*
+         * Fill as many entries as there is room for and publish them.
+         */
+        uint32_t const uHead = ASMAtomicReadU32(pIoUring->pu32SqHead);
+        uint32_t       cFree = pIoUring->cSqEntries - (uTail - uHead);
+        if (!cFree)
+        {
+            /* Only happens with the polling thread, give it a chance to catch up. */
+            Assert(pIoUring->fSqPoll);
+            RTThreadYield();
+            continue;
+        }
+
+        size_t const iFirst = iReq;
+        for (; cFree > 0 && iReq < cReqs; cFree--, iReq++, uTail++)
+        {
+            PRTFILEAIOREQINTERNAL pReqInt = pahReqs[iReq];
+            uint32_t const        idxSqe  = uTail & pIoUring->fSqMask;
+            PLNXIOURINGSQE        pSqe    = &pIoUring->paSqes[idxSqe];
+            RT_ZERO(*pSqe);
+            pSqe->iFd     = (int32_t)pReqInt->AioCB.uFileDesc;
+            pSqe->u64User = (uintptr_t)pReqInt;
+            switch (pReqInt->AioCB.u16IoOpCode)
+            {
+                case LNXKAIO_IOCB_CMD_READ:
+                    pSqe->u8Opc = LNXIOURING_OP_READ;
+                    break;
+                case LNXKAIO_IOCB_CMD_WRITE:
+                    pSqe->u8Opc = LNXIOURING_OP_WRITE;
+                    break;
+                default:
+                    AssertFailed();
+                    /* fall thru */
+                case LNXKAIO_IOCB_CMD_FSYNC:
+                    pSqe->u8Opc  = LNXIOURING_OP_FSYNC;
+                    pSqe->fFlags = LNXIOURING_SQE_F_IO_DRAIN;
+                    break;
+            }
+            if (pSqe->u8Opc != LNXIOURING_OP_FSYNC)
+            {
+                pSqe->off     = pReqInt->AioCB.off;
+                pSqe->u64Addr = (uintptr_t)pReqInt->AioCB.pvBuf;
+                pSqe->cbLen   = (uint32_t)pReqInt->AioCB.cbTransfer;
+            }
+            pIoUring->pau32SqArray[idxSqe] = idxSqe;
+        }
+        ASMAtomicWriteU32(pIoUring->pu32SqTail, uTail);
+        uint32_t const cAdded = (uint32_t)(iReq - iFirst);
+
+        /*
+         * Kick the kernel.
+         */
+        if (pIoUring->fSqPoll)
+        {
+            if (ASMAtomicReadU32(pIoUring->pfSqFlags) & LNXIOURING_SQ_NEED_WAKEUP)
+                rtFileAsyncIoLinuxUringEnter(pIoUring, 0, 0, LNXIOURING_ENTER_SQ_WAKEUP, NULL);
+            ASMAtomicAddS32(&pCtxInt->cRequests, cAdded);
+            continue;
+        }
+
+        uint32_t cPending = uTail - ASMAtomicReadU32(pIoUring->pu32SqHead);
+        while (cPending > 0)
+        {
+            rc = rtFileAsyncIoLinuxUringEnter(pIoUring, cPending, 0, 0, NULL);
+            if (rc == VERR_INTERRUPTED)
+                continue;
+            if (RT_FAILURE(rc))
+                break;
+            cPending = uTail - ASMAtomicReadU32(pIoUring->pu32SqHead);
+        }
+        ASMAtomicAddS32(&pCtxInt->cRequests, cAdded - cPending);
+        if (RT_FAILURE(rc))
+        {
+            /*
+             * Nothing in the ring was consumed by the kernel, so take the
+             * unconsumed entries back and return the requests to the
+             * prepared state.
+             */
+            uTail -= cPending;
+            ASMAtomicWriteU32(pIoUring->pu32SqTail, uTail);
+            for (size_t i = iReq - cPending; i < cReqs; i++)
+            {
+                PRTFILEAIOREQINTERNAL pReqInt = pahReqs[i];
+                pReqInt->pCtxInt = NULL;
+                RTFILEAIOREQ_SET_STATE(pReqInt, PREPARED);
+            }
+            if (rc == VERR_TRY_AGAIN || rc == VERR_RESOURCE_BUSY)
+                rc = VERR_FILE_AIO_INSUFFICIENT_RESSOURCES;
+            break;
+        }
+        rc = VINF_SUCCESS;
+    }
+    RTCritSectLeave(&pIoUring->CritSectSubmit);
+
+    return rc;
+}
+
+/**
+ * Asks the kernel to cancel a request submitted through the io_uring.
+ *
+ * The request still shows up in the completion ring, with VERR_FILE_AIO_CANCELED
+ * if the cancelling succeeded.  The completion of the cancel operation itself
+ * carries no user data and is skipped by rtFileAsyncIoLinuxUringReap.  It can
+ * exceed the completion ring size we asked for, the kernel (5.11+ because of
+ * LNXIOURING_FEAT_EXT_ARG) keeps overflowing entries instead of dropping them.
+ *
+ * @returns IPRT status code.
+ * @param   pIoUring        The io_uring state.
+ * @param   pReqInt         The request to cancel.
+ */
+static int rtFileAsyncIoLinuxUringCancel(PLNXIOURING pIoUring, PRTFILEAIOREQINTERNAL pReqInt)
+{
+    int rc = VINF_SUCCESS;
+
+    RTCritSectEnter(&pIoUring->CritSectSubmit);
+    uint32_t uTail = *pIoUring->pu32SqTail;
+    if (uTail - ASMAtomicReadU32(pIoUring->pu32SqHead) < pIoUring->cSqEntries)
+    {
+        uint32_t const idxSqe = uTail & pIoUring->fSqMask;
+        PLNXIOURINGSQE pSqe   = &pIoUring->paSqes[idxSqe];
+        RT_ZERO(*pSqe);
+        pSqe->u8Opc   = LNXIOURING_OP_ASYNC_CANCEL;
+        pSqe->iFd     = -1;
+        pSqe->u64Addr = (uintptr_t)pReqInt; /* The user data of the request to cancel. */
+        pSqe->u64User = 0;
+        pIoUring->pau32SqArray[idxSqe] = idxSqe;
+        ASMAtomicWriteU32(pIoUring->pu32SqTail, ++uTail);
+
+        if (pIoUring->fSqPoll)
+        {
+            if (ASMAtomicReadU32(pIoUring->pfSqFlags) & LNXIOURING_SQ_NEED_WAKEUP)
+                rtFileAsyncIoLinuxUringEnter(pIoUring, 0, 0, LNXIOURING_ENTER_SQ_WAKEUP, NULL);
+        }
+        else
+        {
+            do
+                rc = rtFileAsyncIoLinuxUringEnter(pIoUring, 1, 0, 0, NULL);
+            while (rc == VERR_INTERRUPTED);
+            if (RT_FAILURE(rc))
+                ASMAtomicWriteU32(pIoUring->pu32SqTail, --uTail); /* Not consumed, take it back. */
+        }
+    }
+    else
+        rc = VERR_TRY_AGAIN;
+    RTCritSectLeave(&pIoUring->CritSectSubmit);
+
+    return rc;
+}
+
+/**
+ * Reaps completed requests from the io_uring completion ring.
+ *
+ * @returns Number of requests returned in @a pahReqs.
+ * @param   pIoUring        The io_uring state.
+ * @param   pahReqs         Where to store the completed requests.
+ * @param   cReqs           Max number of requests to return.
+ */
+static uint32_t rtFileAsyncIoLinuxUringReap(PLNXIOURING pIoUring, PRTFILEAIOREQ pahReqs, size_t cReqs)
+{
+    uint32_t       cDone = 0;
+    uint32_t       uHead = *pIoUring->pu32CqHead;
+    uint32_t const uTail = ASMAtomicReadU32(pIoUring->pu32CqTail);
+    while (uHead != uTail && cDone < cReqs)
+    {
+        PCLNXIOURINGCQE       pCqe    = &pIoUring->paCqes[uHead & pIoUring->fCqMask];
+        PRTFILEAIOREQINTERNAL pReqInt = (PRTFILEAIOREQINTERNAL)(uintptr_t)pCqe->u64User;
+        if (!pReqInt)
+        {
+            /* Completion of a cancel operation, see rtFileAsyncIoLinuxUringCancel. */
+            uHead++;
+            continue;
+        }
+        AssertPtr(pReqInt);
+        Assert(pReqInt->u32Magic == RTFILEAIOREQ_MAGIC);
+
+        if (RT_UNLIKELY(pCqe->rcLnx < 0))
+            pReqInt->Rc = pCqe->rcLnx == -ECANCELED ? VERR_FILE_AIO_CANCELED : RTErrConvertFromErrno(-pCqe->rcLnx);
+        else
+        {
+            pReqInt->Rc = VINF_SUCCESS;
+            pReqInt->cbTransfered = (uint32_t)pCqe->rcLnx;
+        }
+        RTFILEAIOREQ_SET_STATE(pReqInt, COMPLETED);
+
+        pahReqs[cDone++] = (RTFILEAIOREQ)pReqInt;
+        uHead++;
+    }
+    ASMAtomicWriteU32(pIoUring->pu32CqHead, uHead);
+    return cDone;
+}
+
+/**
+ * Waits for completed requests on the io_uring of the given context.
+ *
+ * @returns IPRT status code.
+ * @param   pCtxInt         The context.
+ * @param   cMinReqs        Minimum number of requests to wait for (at least 1).
+ * @param   cMillies        The timeout.
+ * @param   pahReqs         Where to store the completed requests.
+ * @param   cReqs           Size of the @a pahReqs array.
+ * @param   pcReqs          Where to return the number of completed requests.
+ */
+static int rtFileAsyncIoLinuxUringWait(PRTFILEAIOCTXINTERNAL pCtxInt, size_t cMinReqs, RTMSINTERVAL cMillies,
+                                       PRTFILEAIOREQ pahReqs, size_t cReqs, uint32_t *pcReqs)
+{
+    PLNXIOURING            pIoUring    = &pCtxInt->IoUring;
+    uint64_t const         StartNanoTS = cMillies != RT_INDEFINITE_WAIT ? RTTimeNanoTS() : 0;
+    LNXIOURINGTIMESPEC     Timeout     = { 0, 0 };
+    LNXIOURINGGETEVENTSARG Arg;
+    RT_ZERO(Arg);
+
+    int      rc    = VINF_SUCCESS;
+    uint32_t cDone = 0;
+    while (!pCtxInt->fWokenUp)
+    {
+        uint32_t const cReaped = rtFileAsyncIoLinuxUringReap(pIoUring, &pahReqs[cDone], cReqs - cDone);
+        cDone += cReaped;
+        if (cReaped >= cMinReqs)
+            break;
+        cMinReqs -= cReaped;
+
+        if (cMillies != RT_INDEFINITE_WAIT)
+        {
+            uint64_t cMilliesElapsed = (RTTimeNanoTS() - StartNanoTS) / RT_NS_1MS;
+            if (cMilliesElapsed >= cMillies)
+            {
+                rc = VERR_TIMEOUT;
+                break;
+            }
+            Timeout.tv_sec  = (cMillies - (RTMSINTERVAL)cMilliesElapsed) / 1000;
+            Timeout.tv_nsec = (cMillies - (RTMSINTERVAL)cMilliesElapsed) % 1000 * 1000000;
+            Arg.u64Timeout  = (uintptr_t)&Timeout;
+        }
+
+        ASMAtomicXchgBool(&pCtxInt->fWaiting, true);
+        rc = rtFileAsyncIoLinuxUringEnter(pIoUring, 0, (uint32_t)cMinReqs,
+                                          LNXIOURING_ENTER_GETEVENTS | LNXIOURING_ENTER_EXT_ARG, &Arg);
+        ASMAtomicXchgBool(&pCtxInt->fWaiting, false);
+        if (RT_FAILURE(rc))
+        {
+            /* Don't leave behind anything which completed meanwhile. */
+            cDone += rtFileAsyncIoLinuxUringReap(pIoUring, &pahReqs[cDone], cReqs - cDone);
+            break;
+        }
+        rc = VINF_SUCCESS;
+    }
+
+    *pcReqs = cDone;
+    return rc;
+}
+
 RTR3DECL(int) RTFileAioGetLimits(PRTFILEAIOLIMITS pAioLimits)
 {
     int rc = VINF_SUCCESS;
@@ -442,6 +1082,19 @@ RTDECL(int) RTFileAioReqCancel(RTFILEAIOREQ hReq)
     RTFILEAIOREQ_VALID_RETURN(pReqInt);
     RTFILEAIOREQ_STATE_RETURN_RC(pReqInt, SUBMITTED, VERR_FILE_AIO_NOT_SUBMITTED);
 
+    /*
+     * Cancelling is asynchronous with io_uring.  The request completes through
+     * the normal wait path in any case, so it is always still in progress for
+     * the caller.
+     */
+    if (pReqInt->pCtxInt->IoUring.iFdRing != -1)
+    {
+        int rc = rtFileAsyncIoLinuxUringCancel(&pReqInt->pCtxInt->IoUring, pReqInt);
+        if (RT_FAILURE(rc) && rc != VERR_TRY_AGAIN)
+            return rc;
+        return VERR_FILE_AIO_IN_PROGRESS;
+    }
+
     LNXKAIOIOEVENT AioEvent;
     int rc = rtFileAsyncIoLinuxCancel(pReqInt->AioContext, &pReqInt->AioCB, &AioEvent);
     if (RT_SUCCESS(rc))
@@ -495,8 +1148,13 @@ RTDECL(int) RTFileAioCtxCreate(PRTFILEAIOCTX phAioCtx, uint32_t cAioReqsMax,
     if (RT_UNLIKELY(!pCtxInt))
         return VERR_NO_MEMORY;
 
-    /* Init the event handle. */
-    int rc = rtFileAsyncIoLinuxCreate(cAioReqsMax, &pCtxInt->AioContext);
+    /* Init the event handle, preferring io_uring. */
+    int rc = rtFileAsyncIoLinuxUringCreate(&pCtxInt->IoUring, cAioReqsMax);
+    if (RT_FAILURE(rc))
+    {
+        Log(("RTFileAioCtxCreate: io_uring not used (%Rrc)\n", rc));
+        rc = rtFileAsyncIoLinuxCreate(cAioReqsMax, &pCtxInt->AioContext);
+    }
     if (RT_SUCCESS(rc))
     {
         pCtxInt->fWokenUp     = false;
@@ -527,9 +1185,14 @@ RTDECL(int) RTFileAioCtxDestroy(RTFILEAIOCTX hAioCtx)
         return VERR_FILE_AIO_BUSY;
 
     /* The native bit first, then mark it as dead and free it. */
-    int rc = rtFileAsyncIoLinuxDestroy(pCtxInt->AioContext);
-    if (RT_FAILURE(rc))
-        return rc;
+    if (pCtxInt->IoUring.iFdRing != -1)
+        rtFileAsyncIoLinuxUringDestroy(&pCtxInt->IoUring);
+    else
+    {
+        int rc = rtFileAsyncIoLinuxDestroy(pCtxInt->AioContext);
+        if (RT_FAILURE(rc))
+            return rc;
+    }
     ASMAtomicUoWriteU32(&pCtxInt->u32Magic, RTFILEAIOCTX_MAGIC_DEAD);
     RTMemFree(pCtxInt);
 
@@ -596,6 +1259,9 @@ RTDECL(int) RTFileAioCtxSubmit(RTFILEAIOCTX hAioCtx, PRTFILEAIOREQ pahReqs, size
         RTFILEAIOREQ_SET_STATE(pReqInt, SUBMITTED);
     }
 
+    if (pCtxInt->IoUring.iFdRing != -1)
+        return rtFileAsyncIoLinuxUringSubmit(pCtxInt, pahReqs, cReqs);
+
     do
     {
         /*
@@ -701,72 +1367,81 @@ RTDECL(int) RTFileAioCtxWait(RTFILEAIOCTX hAioCtx, size_t cMinReqs, RTMSINTERVAL
      */
     int rc = VINF_SUCCESS;
     int cRequestsCompleted = 0;
-    while (!pCtxInt->fWokenUp)
+    if (pCtxInt->IoUring.iFdRing != -1)
     {
-        LNXKAIOIOEVENT  aPortEvents[AIO_MAXIMUM_REQUESTS_PER_CONTEXT];
-        int             cRequestsToWait = RT_MIN(cReqs, AIO_MAXIMUM_REQUESTS_PER_CONTEXT);
-        ASMAtomicXchgBool(&pCtxInt->fWaiting, true);
-        rc = rtFileAsyncIoLinuxGetEvents(pCtxInt->AioContext, cMinReqs, cRequestsToWait, &aPortEvents[0], pTimeout);
-        ASMAtomicXchgBool(&pCtxInt->fWaiting, false);
-        if (RT_FAILURE(rc))
-            break;
-        uint32_t const cDone = rc;
-        rc = VINF_SUCCESS;
-
-        /*
-         * Process received events / requests.
-         */
-        for (uint32_t i = 0; i < cDone; i++)
+        uint32_t cUringCompleted = 0;
+        rc = rtFileAsyncIoLinuxUringWait(pCtxInt, cMinReqs, cMillies, pahReqs, cReqs, &cUringCompleted);
+        cRequestsCompleted = (int)cUringCompleted;
+    }
+    else
+    {
+        while (!pCtxInt->fWokenUp)
         {
+            LNXKAIOIOEVENT  aPortEvents[AIO_MAXIMUM_REQUESTS_PER_CONTEXT];
+            int             cRequestsToWait = RT_MIN(cReqs, AIO_MAXIMUM_REQUESTS_PER_CONTEXT);
+            ASMAtomicXchgBool(&pCtxInt->fWaiting, true);
+            rc = rtFileAsyncIoLinuxGetEvents(pCtxInt->AioContext, cMinReqs, cRequestsToWait, &aPortEvents[0], pTimeout);
+            ASMAtomicXchgBool(&pCtxInt->fWaiting, false);
+            if (RT_FAILURE(rc))
+                break;
+            uint32_t const cDone = rc;
+            rc = VINF_SUCCESS;
+
             /*
-             * The iocb is the first element in our request structure.
-             * So we can safely cast it directly to the handle (see above)
+             * Process received events / requests.
              */
-            PRTFILEAIOREQINTERNAL pReqInt = (PRTFILEAIOREQINTERNAL)aPortEvents[i].pIoCB;
-            AssertPtr(pReqInt);
-            Assert(pReqInt->u32Magic == RTFILEAIOREQ_MAGIC);
-
-            /** @todo aeichner: The rc field contains the result code
-             *  like you can find in errno for the normal read/write ops.
-             *  But there is a second field called rc2. I don't know the
-             *  purpose for it yet.
-             */
-            if (RT_UNLIKELY(aPortEvents[i].rc < 0))
-                pReqInt->Rc = RTErrConvertFromErrno(-aPortEvents[i].rc); /* Convert to positive value. */
-            else
+            for (uint32_t i = 0; i < cDone; i++)
             {
-                pReqInt->Rc = VINF_SUCCESS;
-                pReqInt->cbTransfered = aPortEvents[i].rc;
-            }
-
-            /* Mark the request as finished. */
-            RTFILEAIOREQ_SET_STATE(pReqInt, COMPLETED);
+                /*
+                 * The iocb is the first element in our request structure.
+                 * So we can safely cast it directly to the handle (see above)
+                 */
+                PRTFILEAIOREQINTERNAL pReqInt = (PRTFILEAIOREQINTERNAL)aPortEvents[i].pIoCB;
+                AssertPtr(pReqInt);
+                Assert(pReqInt->u32Magic == RTFILEAIOREQ_MAGIC);
+
+                /** @todo aeichner: The rc field contains the result code
+                 *  like you can find in errno for the normal read/write ops.
+                 *  But there is a second field called rc2. I don't know the
+                 *  purpose for it yet.
+                 */
+                if (RT_UNLIKELY(aPortEvents[i].rc < 0))
+                    pReqInt->Rc = RTErrConvertFromErrno(-aPortEvents[i].rc); /* Convert to positive value. */
+                else
+                {
+                    pReqInt->Rc = VINF_SUCCESS;
+                    pReqInt->cbTransfered = aPortEvents[i].rc;
+                }
+
+                /* Mark the request as finished. */
+                RTFILEAIOREQ_SET_STATE(pReqInt, COMPLETED);
 
-            pahReqs[cRequestsCompleted++] = (RTFILEAIOREQ)pReqInt;
-        }
+                pahReqs[cRequestsCompleted++] = (RTFILEAIOREQ)pReqInt;
+            }
 
-        /*
-         * Done Yet? If not advance and try again.
-         */
-        if (cDone >= cMinReqs)
-            break;
-        cMinReqs -= cDone;
-        cReqs    -= cDone;
+            /*
+             * Done Yet? If not advance and try again.
+             */
+            if (cDone >= cMinReqs)
+                break;
+            cMinReqs -= cDone;
+            cReqs    -= cDone;
 
-        if (cMillies != RT_INDEFINITE_WAIT)
-        {
-            /* The API doesn't return ETIMEDOUT, so we have to fix that ourselves. */
-            uint64_t NanoTS = RTTimeNanoTS();
-            uint64_t cMilliesElapsed = (NanoTS - StartNanoTS) / 1000000;
-            if (cMilliesElapsed >= cMillies)
+            if (cMillies != RT_INDEFINITE_WAIT)
             {
-                rc = VERR_TIMEOUT;
-                break;
+                /* The API doesn't return ETIMEDOUT, so we have to fix that ourselves. */
+                uint64_t NanoTS = RTTimeNanoTS();
+                uint64_t cMilliesElapsed = (NanoTS - StartNanoTS) / 1000000;
+                if (cMilliesElapsed >= cMillies)
+                {
+                    rc = VERR_TIMEOUT;
+                    break;
+                }
+
+                /* The syscall supposedly updates it, but we're paranoid. :-) */
+                Timeout.tv_sec  = (cMillies - (RTMSINTERVAL)cMilliesElapsed) / 1000;
+                Timeout.tv_nsec = (cMillies - (RTMSINTERVAL)cMilliesElapsed) % 1000 * 1000000;
             }
-
-            /* The syscall supposedly updates it, but we're paranoid. :-) */
-            Timeout.tv_sec  = (cMillies - (RTMSINTERVAL)cMilliesElapsed) / 1000;
-            Timeout.tv_nsec = (cMillies - (RTMSINTERVAL)cMilliesElapsed) % 1000 * 1000000;
         }
     }
 
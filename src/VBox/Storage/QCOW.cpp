@@ -30,6 +30,7 @@
 #include <iprt/alloc.h>
 #include <iprt/path.h>
 #include <iprt/list.h>
+#include <iprt/avl.h>
 
 #include "VDBackends.h"
 
@@ -141,8 +142,8 @@ typedef QCowHeader *PQCowHeader;
  */
 typedef struct QCOWL2CACHEENTRY
 {
-    /** List node for the search list. */
-    RTLISTNODE              NodeSearch;
+    /** AVL tree node for searching, keyed by the range the L2 table occupies in the image. */
+    AVLRU64NODECORE         Core;
     /** List node for the LRU list. */
     RTLISTNODE              NodeLru;
     /** Reference counter. */
@@ -153,7 +154,8 @@ typedef struct QCOWL2CACHEENTRY
     uint64_t               *paL2Tbl;
 } QCOWL2CACHEENTRY, *PQCOWL2CACHEENTRY;
 
-/** Maximum amount of memory the cache is allowed to use. */
+/** Default amount of memory the cache is allowed to use,
+ * can be changed with the "L2CacheSize" config key. */
 #define QCOW_L2_CACHE_MEMORY_MAX (2*_1M)
 
 /** QCOW default cluster size for image version 2. */
@@ -224,10 +226,16 @@ typedef struct QCOWIMAGE
     uint32_t            cL2TableEntries;
     /** Memory occupied by the L2 table cache. */
     size_t              cbL2Cache;
-    /** The sorted L2 entry list used for searching. */
-    RTLISTNODE          ListSearch;
+    /** Maximum amount of memory the L2 table cache may occupy. */
+    size_t              cbL2CacheMax;
+    /** The L2 entry tree used for searching. */
+    AVLRU64TREE         TreeL2Search;
     /** The LRU L2 entry list used for eviction. */
     RTLISTNODE          ListLru;
+    /** Number of L2 table lookups satisfied by the cache. */
+    uint64_t            cL2CacheHits;
+    /** Number of L2 table lookups which had to read from the image. */
+    uint64_t            cL2CacheMisses;
 
     /** Offset of the refcount table. */
     uint64_t            offRefcountTable;
@@ -463,10 +471,23 @@ static void qcowTableConvertFromHostEndianess(uint64_t *paTblImg, uint64_t *paTb
  */
 static int qcowL2TblCacheCreate(PQCOWIMAGE pImage)
 {
-    pImage->cbL2Cache = 0;
-    RTListInit(&pImage->ListSearch);
+    pImage->cbL2Cache      = 0;
+    pImage->cbL2CacheMax   = QCOW_L2_CACHE_MEMORY_MAX;
+    pImage->TreeL2Search   = NULL;
+    pImage->cL2CacheHits   = 0;
+    pImage->cL2CacheMisses = 0;
     RTListInit(&pImage->ListLru);
 
+    PVDINTERFACECONFIG pIfCfg = VDIfConfigGet(pImage->pVDIfsImage);
+    if (pIfCfg)
+    {
+        uint64_t cbL2CacheMax = 0;
+        int rc = VDCFGQueryU64Def(pIfCfg, "L2CacheSize", &cbL2CacheMax, QCOW_L2_CACHE_MEMORY_MAX);
+        if (RT_FAILURE(rc))
+            return rc;
+        pImage->cbL2CacheMax = (size_t)RT_MIN(cbL2CacheMax, _1G);
+    }
+
     return VINF_SUCCESS;
 }
 
@@ -478,19 +499,24 @@ static int qcowL2TblCacheCreate(PQCOWIMAGE pImage)
  */
 static void qcowL2TblCacheDestroy(PQCOWIMAGE pImage)
 {
+    if (pImage->cL2CacheHits + pImage->cL2CacheMisses)
+        LogRel(("QCow: L2 table cache for '%s': %llu hits, %llu misses, %zu of %zu bytes used\n",
+                pImage->pszFilename, pImage->cL2CacheHits, pImage->cL2CacheMisses,
+                pImage->cbL2Cache, pImage->cbL2CacheMax));
+
     PQCOWL2CACHEENTRY pL2Entry;
     PQCOWL2CACHEENTRY pL2Next;
-    RTListForEachSafe(&pImage->ListSearch, pL2Entry, pL2Next, QCOWL2CACHEENTRY, NodeSearch)
+    RTListForEachSafe(&pImage->ListLru, pL2Entry, pL2Next, QCOWL2CACHEENTRY, NodeLru)
     {
         Assert(!pL2Entry->cRefs);
 
-        RTListNodeRemove(&pL2Entry->NodeSearch);
+        RTListNodeRemove(&pL2Entry->NodeLru);
         RTMemPageFree(pL2Entry->paL2Tbl, pImage->cbL2Table);
         RTMemFree(pL2Entry);
     }
 
     pImage->cbL2Cache       = 0;
-    RTListInit(&pImage->ListSearch);
+    pImage->TreeL2Search    = NULL;
     RTListInit(&pImage->ListLru);
 }
 
@@ -510,19 +536,14 @@ static PQCOWL2CACHEENTRY qcowL2TblCacheRetain(PQCOWIMAGE pImage, uint64_t offL2T
         return pImage->pL2TblAlloc;
     }
 
-    PQCOWL2CACHEENTRY pL2Entry;
-    RTListForEach(&pImage->ListSearch, pL2Entry, QCOWL2CACHEENTRY, NodeSearch)
-    {
-        if (pL2Entry->offL2Tbl == offL2Tbl)
-            break;
-    }
-
-    if (!RTListNodeIsDummy(&pImage->ListSearch, pL2Entry, QCOWL2CACHEENTRY, NodeSearch))
+    PQCOWL2CACHEENTRY pL2Entry = (PQCOWL2CACHEENTRY)RTAvlrU64Get(&pImage->TreeL2Search, offL2Tbl);
+    if (pL2Entry)
     {
         /* Update LRU list. */
         RTListNodeRemove(&pL2Entry->NodeLru);
         RTListPrepend(&pImage->ListLru, &pL2Entry->NodeLru);
         pL2Entry->cRefs++;
+        pImage->cL2CacheHits++;
         return pL2Entry;
     }
 
@@ -551,7 +572,8 @@ static PQCOWL2CACHEENTRY qcowL2TblCacheEntryAlloc(PQCOWIMAGE pImage)
 {
     PQCOWL2CACHEENTRY pL2Entry = NULL;
 
-    if (pImage->cbL2Cache + pImage->cbL2Table <= QCOW_L2_CACHE_MEMORY_MAX)
+    if (   pImage->cbL2Cache + pImage->cbL2Table <= pImage->cbL2CacheMax
+        || RTListIsEmpty(&pImage->ListLru))
     {
         /* Add a new entry. */
         pL2Entry = (PQCOWL2CACHEENTRY)RTMemAllocZ(sizeof(QCOWL2CACHEENTRY));
@@ -581,9 +603,9 @@ static PQCOWL2CACHEENTRY qcowL2TblCacheEntryAlloc(PQCOWIMAGE pImage)
                 break;
         }
 
-        if (!RTListNodeIsDummy(&pImage->ListSearch, pL2Entry, QCOWL2CACHEENTRY, NodeSearch))
+        if (!RTListNodeIsDummy(&pImage->ListLru, pL2Entry, QCOWL2CACHEENTRY, NodeLru))
         {
-            RTListNodeRemove(&pL2Entry->NodeSearch);
+            RTAvlrU64Remove(&pImage->TreeL2Search, pL2Entry->Core.Key);
             RTListNodeRemove(&pL2Entry->NodeLru);
             pL2Entry->offL2Tbl = 0;
             pL2Entry->cRefs    = 1;
@@ -625,34 +647,11 @@ static void qcowL2TblCacheEntryInsert(PQCOWIMAGE pImage, PQCOWL2CACHEENTRY pL2En
     /* Insert at the top of the LRU list. */
     RTListPrepend(&pImage->ListLru, &pL2Entry->NodeLru);
 
-    if (RTListIsEmpty(&pImage->ListSearch))
-    {
-        RTListAppend(&pImage->ListSearch, &pL2Entry->NodeSearch);
-    }
-    else
-    {
-        /* Insert into search list. */
-        PQCOWL2CACHEENTRY pIt;
-        pIt = RTListGetFirst(&pImage->ListSearch, QCOWL2CACHEENTRY, NodeSearch);
-        if (pIt->offL2Tbl > pL2Entry->offL2Tbl)
-            RTListPrepend(&pImage->ListSearch, &pL2Entry->NodeSearch);
-        else
-        {
-            bool fInserted = false;
-
-            RTListForEach(&pImage->ListSearch, pIt, QCOWL2CACHEENTRY, NodeSearch)
-            {
-                Assert(pIt->offL2Tbl != pL2Entry->offL2Tbl);
-                if (pIt->offL2Tbl < pL2Entry->offL2Tbl)
-                {
-                    RTListNodeInsertAfter(&pIt->NodeSearch, &pL2Entry->NodeSearch);
-                    fInserted = true;
-                    break;
-                }
-            }
-            Assert(fInserted);
-        }
-    }
+    /* Insert into the search tree. */
+    pL2Entry->Core.Key     = pL2Entry->offL2Tbl;
+    pL2Entry->Core.KeyLast = pL2Entry->offL2Tbl + pImage->cbL2Table - 1;
+    bool fInserted = RTAvlrU64Insert(&pImage->TreeL2Search, &pL2Entry->Core);
+    Assert(fInserted); NOREF(fInserted);
 }
 
 /**
@@ -674,6 +673,7 @@ static int qcowL2TblCacheFetch(PQCOWIMAGE pImage, PVDIOCTX pIoCtx, uint64_t offL
     PQCOWL2CACHEENTRY pL2Entry = qcowL2TblCacheRetain(pImage, offL2Tbl);
     if (!pL2Entry)
     {
+        pImage->cL2CacheMisses++;
         pL2Entry = qcowL2TblCacheEntryAlloc(pImage);
 
         if (pL2Entry)
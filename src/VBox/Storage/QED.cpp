@@ -30,6 +30,7 @@
 #include <iprt/alloc.h>
 #include <iprt/path.h>
 #include <iprt/list.h>
+#include <iprt/avl.h>
 
 #include "VDBackends.h"
 
@@ -130,8 +131,8 @@ typedef QedHeader *PQedHeader;
  */
 typedef struct QEDL2CACHEENTRY
 {
-    /** List node for the search list. */
-    RTLISTNODE              NodeSearch;
+    /** AVL tree node for searching, keyed by the range the L2 table occupies in the image. */
+    AVLRU64NODECORE         Core;
     /** List node for the LRU list. */
     RTLISTNODE              NodeLru;
     /** Reference counter. */
@@ -142,7 +143,8 @@ typedef struct QEDL2CACHEENTRY
     uint64_t               *paL2Tbl;
 } QEDL2CACHEENTRY, *PQEDL2CACHEENTRY;
 
-/** Maximum amount of memory the cache is allowed to use. */
+/** Default amount of memory the cache is allowed to use,
+ * can be changed with the "L2CacheSize" config key. */
 #define QED_L2_CACHE_MEMORY_MAX (2*_1M)
 
 /**
@@ -212,10 +214,16 @@ typedef struct QEDIMAGE
 
     /** Memory occupied by the L2 table cache. */
     size_t              cbL2Cache;
-    /** The sorted L2 entry list used for searching. */
-    RTLISTNODE          ListSearch;
+    /** Maximum amount of memory the L2 table cache may occupy. */
+    size_t              cbL2CacheMax;
+    /** The L2 entry tree used for searching. */
+    AVLRU64TREE         TreeL2Search;
     /** The LRU L2 entry list used for eviction. */
     RTLISTNODE          ListLru;
+    /** Number of L2 table lookups satisfied by the cache. */
+    uint64_t            cL2CacheHits;
+    /** Number of L2 table lookups which had to read from the image. */
+    uint64_t            cL2CacheMisses;
 
 } QEDIMAGE, *PQEDIMAGE;
 
@@ -381,10 +389,23 @@ static void qedTableConvertFromHostEndianess(uint64_t *paTblImg, uint64_t *paTbl
  */
 static int qedL2TblCacheCreate(PQEDIMAGE pImage)
 {
-    pImage->cbL2Cache = 0;
-    RTListInit(&pImage->ListSearch);
+    pImage->cbL2Cache      = 0;
+    pImage->cbL2CacheMax   = QED_L2_CACHE_MEMORY_MAX;
+    pImage->TreeL2Search   = NULL;
+    pImage->cL2CacheHits   = 0;
+    pImage->cL2CacheMisses = 0;
     RTListInit(&pImage->ListLru);
 
+    PVDINTERFACECONFIG pIfCfg = VDIfConfigGet(pImage->pVDIfsImage);
+    if (pIfCfg)
+    {
+        uint64_t cbL2CacheMax = 0;
+        int rc = VDCFGQueryU64Def(pIfCfg, "L2CacheSize", &cbL2CacheMax, QED_L2_CACHE_MEMORY_MAX);
+        if (RT_FAILURE(rc))
+            return rc;
+        pImage->cbL2CacheMax = (size_t)RT_MIN(cbL2CacheMax, _1G);
+    }
+
     return VINF_SUCCESS;
 }
 
@@ -396,19 +417,24 @@ static int qedL2TblCacheCreate(PQEDIMAGE pImage)
  */
 static void qedL2TblCacheDestroy(PQEDIMAGE pImage)
 {
+    if (pImage->cL2CacheHits + pImage->cL2CacheMisses)
+        LogRel(("QED: L2 table cache for '%s': %llu hits, %llu misses, %zu of %zu bytes used\n",
+                pImage->pszFilename, pImage->cL2CacheHits, pImage->cL2CacheMisses,
+                pImage->cbL2Cache, pImage->cbL2CacheMax));
+
     PQEDL2CACHEENTRY pL2Entry;
     PQEDL2CACHEENTRY pL2Next;
-    RTListForEachSafe(&pImage->ListSearch, pL2Entry, pL2Next, QEDL2CACHEENTRY, NodeSearch)
+    RTListForEachSafe(&pImage->ListLru, pL2Entry, pL2Next, QEDL2CACHEENTRY, NodeLru)
     {
         Assert(!pL2Entry->cRefs);
 
-        RTListNodeRemove(&pL2Entry->NodeSearch);
+        RTListNodeRemove(&pL2Entry->NodeLru);
         RTMemPageFree(pL2Entry->paL2Tbl, pImage->cbTable);
         RTMemFree(pL2Entry);
     }
 
     pImage->cbL2Cache       = 0;
-    RTListInit(&pImage->ListSearch);
+    pImage->TreeL2Search    = NULL;
     RTListInit(&pImage->ListLru);
 }
 
@@ -428,23 +454,18 @@ static PQEDL2CACHEENTRY qedL2TblCacheRetain(PQEDIMAGE pImage, uint64_t offL2Tbl)
         return pImage->pL2TblAlloc;
     }
 
-    PQEDL2CACHEENTRY pL2Entry;
-    RTListForEach(&pImage->ListSearch, pL2Entry, QEDL2CACHEENTRY, NodeSearch)
-    {
-        if (pL2Entry->offL2Tbl == offL2Tbl)
-            break;
-    }
-
-    if (!RTListNodeIsDummy(&pImage->ListSearch, pL2Entry, QEDL2CACHEENTRY, NodeSearch))
+    PQEDL2CACHEENTRY pL2Entry = (PQEDL2CACHEENTRY)RTAvlrU64Get(&pImage->TreeL2Search, offL2Tbl);
+    if (pL2Entry)
     {
         /* Update LRU list. */
         RTListNodeRemove(&pL2Entry->NodeLru);
         RTListPrepend(&pImage->ListLru, &pL2Entry->NodeLru);
         pL2Entry->cRefs++;
+        pImage->cL2CacheHits++;
         return pL2Entry;
     }
-    else
-        return NULL;
+
+    return NULL;
 }
 
 /**
@@ -469,7 +490,8 @@ static PQEDL2CACHEENTRY qedL2TblCacheEntryAlloc(PQEDIMAGE pImage)
 {
     PQEDL2CACHEENTRY pL2Entry = NULL;
 
-    if (pImage->cbL2Cache + pImage->cbTable <= QED_L2_CACHE_MEMORY_MAX)
+    if (   pImage->cbL2Cache + pImage->cbTable <= pImage->cbL2CacheMax
+        || RTListIsEmpty(&pImage->ListLru))
     {
         /* Add a new entry. */
         pL2Entry = (PQEDL2CACHEENTRY)RTMemAllocZ(sizeof(QEDL2CACHEENTRY));
@@ -499,9 +521,9 @@ static PQEDL2CACHEENTRY qedL2TblCacheEntryAlloc(PQEDIMAGE pImage)
                 break;
         }
 
-        if (!RTListNodeIsDummy(&pImage->ListSearch, pL2Entry, QEDL2CACHEENTRY, NodeSearch))
+        if (!RTListNodeIsDummy(&pImage->ListLru, pL2Entry, QEDL2CACHEENTRY, NodeLru))
         {
-            RTListNodeRemove(&pL2Entry->NodeSearch);
+            RTAvlrU64Remove(&pImage->TreeL2Search, pL2Entry->Core.Key);
             RTListNodeRemove(&pL2Entry->NodeLru);
             pL2Entry->offL2Tbl = 0;
             pL2Entry->cRefs    = 1;
@@ -543,34 +565,11 @@ static void qedL2TblCacheEntryInsert(PQEDIMAGE pImage, PQEDL2CACHEENTRY pL2Entry
     /* Insert at the top of the LRU list. */
     RTListPrepend(&pImage->ListLru, &pL2Entry->NodeLru);
 
-    if (RTListIsEmpty(&pImage->ListSearch))
-    {
-        RTListAppend(&pImage->ListSearch, &pL2Entry->NodeSearch);
-    }
-    else
-    {
-        /* Insert into search list. */
-        PQEDL2CACHEENTRY pIt;
-        pIt = RTListGetFirst(&pImage->ListSearch, QEDL2CACHEENTRY, NodeSearch);
-        if (pIt->offL2Tbl > pL2Entry->offL2Tbl)
-            RTListPrepend(&pImage->ListSearch, &pL2Entry->NodeSearch);
-        else
-        {
-            bool fInserted = false;
-
-            RTListForEach(&pImage->ListSearch, pIt, QEDL2CACHEENTRY, NodeSearch)
-            {
-                Assert(pIt->offL2Tbl != pL2Entry->offL2Tbl);
-                if (pIt->offL2Tbl < pL2Entry->offL2Tbl)
-                {
-                    RTListNodeInsertAfter(&pIt->NodeSearch, &pL2Entry->NodeSearch);
-                    fInserted = true;
-                    break;
-                }
-            }
-            Assert(fInserted);
-        }
-    }
+    /* Insert into the search tree. */
+    pL2Entry->Core.Key     = pL2Entry->offL2Tbl;
+    pL2Entry->Core.KeyLast = pL2Entry->offL2Tbl + pImage->cbTable - 1;
+    bool fInserted = RTAvlrU64Insert(&pImage->TreeL2Search, &pL2Entry->Core);
+    Assert(fInserted); NOREF(fInserted);
 }
 
 /**
@@ -592,6 +591,7 @@ static int qedL2TblCacheFetchAsync(PQEDIMAGE pImage, PVDIOCTX pIoCtx,
     PQEDL2CACHEENTRY pL2Entry = qedL2TblCacheRetain(pImage, offL2Tbl);
     if (!pL2Entry)
     {
+        pImage->cL2CacheMisses++;
         pL2Entry = qedL2TblCacheEntryAlloc(pImage);
 
         if (pL2Entry)
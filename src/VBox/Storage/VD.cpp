@@ -40,6 +40,7 @@
 #include <iprt/list.h>
 #include <iprt/avl.h>
 #include <iprt/semaphore.h>
+#include <iprt/thread.h>
 
 #include <VBox/vd-plugin.h>
 
@@ -193,6 +194,108 @@ typedef struct VDDISCARDSTATE
     RTLISTNODE          ListLru;
 } VDDISCARDSTATE, *PVDDISCARDSTATE;
 
+/** Number of read-ahead buffers per disk. */
+#define VD_READ_AHEAD_BUFFERS       2
+/** Maximum read-ahead window size. */
+#define VD_READ_AHEAD_WINDOW_MAX    (16 * _1M)
+
+/**
+ * VD read-ahead buffer.
+ */
+typedef struct VDREADAHEADBUF
+{
+    /** Start offset of the buffered range in the virtual disk. */
+    uint64_t            uOffset;
+    /** Number of valid bytes in the buffer, 0 if empty. */
+    size_t              cbValid;
+    /** Number of bytes the pending read-ahead request reads. */
+    size_t              cbPending;
+    /** Flag whether a read-ahead request is filling the buffer. */
+    bool                fPending;
+    /** Flag whether the pending request was overtaken by a write or discard
+     * and the data must be dropped on completion. */
+    bool                fStale;
+    /** The segment describing the buffer for the read-ahead I/O context. */
+    RTSGSEG             Seg;
+    /** The buffer memory. */
+    uint8_t            *pbBuf;
+} VDREADAHEADBUF, *PVDREADAHEADBUF;
+
+/**
+ * VD read-ahead state.
+ *
+ * Everything is protected by the disk lock except cPending.
+ */
+typedef struct VDREADAHEAD
+{
+    /** Number of bytes to read ahead with one request (size of a buffer). */
+    size_t              cbWindow;
+    /** Number of sequential reads before read-ahead kicks in. */
+    uint32_t            cSeqThreshold;
+    /** Number of consecutive sequential reads seen. */
+    uint32_t            cSeqReads;
+    /** Offset the next read of the current stream is expected at. */
+    uint64_t            uOffsetNext;
+    /** Number of read-ahead requests in flight. */
+    volatile uint32_t   cPending;
+    /** The read-ahead buffers. */
+    VDREADAHEADBUF      aBufs[VD_READ_AHEAD_BUFFERS];
+    /** Statistics. */
+    VDREADAHEADSTATS    Stats;
+} VDREADAHEAD, *PVDREADAHEAD;
+
+/** Number of buffers in the copy pipeline. */
+#define VD_COPY_BUFFERS             8
+/** Size of one copy pipeline buffer. */
+#define VD_COPY_BUFFER_SIZE         (4 * _1M)
+
+/**
+ * Copy pipeline buffer, filled by the reader thread and written by the caller.
+ */
+typedef struct VDCOPYBUF
+{
+    /** Start offset of the data in the buffer. */
+    uint64_t            uOffset;
+    /** Number of bytes covered by the buffer. */
+    size_t              cbData;
+    /** Flag whether the range is unallocated in the source and
+     * doesn't need to be written. */
+    bool                fBlockFree;
+    /** The buffer memory. */
+    void               *pvBuf;
+} VDCOPYBUF, *PVDCOPYBUF;
+
+/**
+ * Copy pipeline state shared between the reader thread and the writer.
+ */
+typedef struct VDCOPYPIPE
+{
+    /** The source disk. */
+    PVBOXHDD            pDiskFrom;
+    /** The source image. */
+    PVDIMAGE            pImageFrom;
+    /** Number of bytes to copy. */
+    uint64_t            cbSize;
+    /** Number of images to read back in the source disk for blockwise copying. */
+    unsigned            cImagesFromRead;
+    /** Flag whether the copy is done blockwise, skipping unallocated ranges. */
+    bool                fBlockwiseCopy;
+    /** Flag whether the writer cancelled the copy. */
+    volatile bool       fCancelled;
+    /** Flag whether the reader finished (successfully or not). */
+    volatile bool       fReaderDone;
+    /** Status code of the reader. */
+    int                 rcReader;
+    /** Number of filled buffers not yet consumed by the writer. */
+    volatile uint32_t   cFilled;
+    /** Signalled by the reader when a buffer was filled or it is done. */
+    RTSEMEVENT          hEvtFilled;
+    /** Signalled by the writer when a buffer was consumed or on cancellation. */
+    RTSEMEVENT          hEvtFree;
+    /** The buffer ring. */
+    VDCOPYBUF           aBufs[VD_COPY_BUFFERS];
+} VDCOPYPIPE, *PVDCOPYPIPE;
+
 /**
  * VD filter instance.
  */
@@ -291,6 +394,8 @@ struct VBOXHDD
     PVDCACHE               pCache;
     /** Pointer to the discard state if any. */
     PVDDISCARDSTATE        pDiscard;
+    /** Pointer to the read-ahead state, NULL if read-ahead is disabled. */
+    PVDREADAHEAD           pReadAhead;
 
     /** Read filter chain - PVDFILTER. */
     RTLISTANCHOR           ListFilterChainRead;
@@ -490,6 +595,12 @@ typedef struct VDIOCTX
  * multiple times.
  */
 #define VDIOCTX_FLAGS_WRITE_FILTER_APPLIED   RT_BIT_32(6)
+/** The I/O context is an internal read-ahead request filling a read-ahead buffer. */
+#define VDIOCTX_FLAGS_READ_AHEAD             RT_BIT_32(7)
+/** The read request was already checked against the read-ahead state. */
+#define VDIOCTX_FLAGS_READ_AHEAD_CHECKED     RT_BIT_32(8)
+/** The read request may be satisfied from the read-ahead buffers. */
+#define VDIOCTX_FLAGS_READ_AHEAD_USE         RT_BIT_32(9)
 
 /** NIL I/O context pointer value. */
 #define NIL_VDIOCTX ((PVDIOCTX)0)
@@ -666,6 +777,8 @@ static PRTLDRMOD g_pahFilterBackendPlugins = NULL;
 /** Forward declaration of the async discard helper. */
 static DECLCALLBACK(int) vdDiscardHelperAsync(PVDIOCTX pIoCtx);
 static DECLCALLBACK(int) vdWriteHelperAsync(PVDIOCTX pIoCtx);
+static DECLCALLBACK(int) vdReadHelperAsync(PVDIOCTX pIoCtx);
+static void vdReadAheadQuiesce(PVBOXHDD pDisk);
 static void vdDiskProcessBlockedIoCtx(PVBOXHDD pDisk);
 static int vdDiskUnlock(PVBOXHDD pDisk, PVDIOCTX pIoCtxRc);
 static DECLCALLBACK(void) vdIoCtxSyncComplete(void *pvUser1, void *pvUser2, int rcReq);
@@ -938,6 +1051,9 @@ static void vdRemoveImageFromList(PVBOXHDD pDisk, PVDIMAGE pImage)
 {
     Assert(pDisk->cImages > 0);
 
+    /* Read-ahead requests might still reference the image and the buffered data might change. */
+    vdReadAheadQuiesce(pDisk);
+
     if (pImage->pPrev)
         pImage->pPrev->pNext = pImage->pNext;
     else
@@ -1063,8 +1179,10 @@ static int vdFilterChainApplyRead(PVBOXHDD pDisk, uint64_t uOffset, size_t cbRea
 
 DECLINLINE(void) vdIoCtxRootComplete(PVBOXHDD pDisk, PVDIOCTX pIoCtx)
 {
+    /* Read-ahead buffers keep the unfiltered data, the filters are applied when it is handed out. */
     if (   RT_SUCCESS(pIoCtx->rcReq)
-        && pIoCtx->enmTxDir == VDIOCTXTXDIR_READ)
+        && pIoCtx->enmTxDir == VDIOCTXTXDIR_READ
+        && !(pIoCtx->fFlags & VDIOCTX_FLAGS_READ_AHEAD))
         pIoCtx->rcReq = vdFilterChainApplyRead(pDisk, pIoCtx->Req.Io.uOffsetXferOrig,
                                                pIoCtx->Req.Io.cbXferOrig, pIoCtx);
 
@@ -1675,6 +1793,355 @@ DECLINLINE(bool) vdIoCtxIsBlocked(PVDIOCTX pIoCtx)
     return false;
 }
 
+/**
+ * Returns the end of the range the given read-ahead buffer covers or is about
+ * to cover.
+ *
+ * @returns End offset, equal to the start offset if the buffer is unused.
+ * @param   pBuf      The read-ahead buffer.
+ */
+DECLINLINE(uint64_t) vdReadAheadBufEnd(PVDREADAHEADBUF pBuf)
+{
+    return pBuf->uOffset + (pBuf->fPending ? pBuf->cbPending : pBuf->cbValid);
+}
+
+/**
+ * Drops all read-ahead data overlapping the given range.
+ *
+ * @returns nothing.
+ * @param   pDisk     The disk.
+ * @param   uOffset   Start offset of the modified range.
+ * @param   cbRange   Size of the modified range.
+ */
+static void vdReadAheadInvalidate(PVBOXHDD pDisk, uint64_t uOffset, size_t cbRange)
+{
+    PVDREADAHEAD pReadAhead = pDisk->pReadAhead;
+
+    VD_IS_LOCKED(pDisk);
+
+    for (unsigned i = 0; i < RT_ELEMENTS(pReadAhead->aBufs); i++)
+    {
+        PVDREADAHEADBUF pBuf = &pReadAhead->aBufs[i];
+
+        if (   uOffset < vdReadAheadBufEnd(pBuf)
+            && uOffset + cbRange > pBuf->uOffset)
+        {
+            if (pBuf->fPending)
+            {
+                if (!pBuf->fStale)
+                    pReadAhead->Stats.cInvalidated++;
+                pBuf->fStale = true;
+            }
+            else
+            {
+                pBuf->cbValid = 0;
+                pReadAhead->Stats.cInvalidated++;
+            }
+        }
+    }
+}
+
+/**
+ * Drops all read-ahead data the given write or discard I/O context modifies.
+ *
+ * Called whenever the context is processed, so data read ahead while the
+ * modification was still in flight is dropped as well.
+ *
+ * @returns nothing.
+ * @param   pDisk     The disk.
+ * @param   pIoCtx    The I/O context.
+ */
+DECLINLINE(void) vdReadAheadIoCtxInvalidate(PVBOXHDD pDisk, PVDIOCTX pIoCtx)
+{
+    if (   RT_LIKELY(!pDisk->pReadAhead)
+        || pIoCtx->pIoCtxParent)
+        return;
+
+    if (pIoCtx->enmTxDir == VDIOCTXTXDIR_WRITE)
+        vdReadAheadInvalidate(pDisk, pIoCtx->Req.Io.uOffsetXferOrig, pIoCtx->Req.Io.cbXferOrig);
+    else if (pIoCtx->enmTxDir == VDIOCTXTXDIR_DISCARD)
+    {
+        for (unsigned i = 0; i < pIoCtx->Req.Discard.cRanges; i++)
+            vdReadAheadInvalidate(pDisk, pIoCtx->Req.Discard.paRanges[i].offStart,
+                                  pIoCtx->Req.Discard.paRanges[i].cbRange);
+    }
+}
+
+/**
+ * Completion callback for read-ahead requests.
+ *
+ * @returns nothing.
+ * @param   pvUser1   The disk.
+ * @param   pvUser2   The read-ahead buffer which was filled.
+ * @param   rcReq     Status code of the request.
+ */
+static DECLCALLBACK(void) vdReadAheadComplete(void *pvUser1, void *pvUser2, int rcReq)
+{
+    PVBOXHDD        pDisk = (PVBOXHDD)pvUser1;
+    PVDREADAHEADBUF pBuf  = (PVDREADAHEADBUF)pvUser2;
+
+    VD_IS_LOCKED(pDisk);
+    Assert(pBuf->fPending);
+
+    LogFlowFunc(("pDisk=%#p uOffset=%llu cbPending=%zu fStale=%RTbool rcReq=%Rrc\n",
+                 pDisk, pBuf->uOffset, pBuf->cbPending, pBuf->fStale, rcReq));
+
+    if (   RT_SUCCESS(rcReq)
+        && !pBuf->fStale)
+        pBuf->cbValid = pBuf->cbPending;
+    else
+        pBuf->cbValid = 0;
+    pBuf->cbPending = 0;
+    pBuf->fStale    = false;
+    pBuf->fPending  = false;
+
+    ASMAtomicDecU32(&pDisk->pReadAhead->cPending);
+}
+
+/**
+ * Feeds a new root read request into the sequential stream detection and
+ * issues a read-ahead request if the stream is about to run out of buffered data.
+ *
+ * @returns nothing.
+ * @param   pDisk     The disk.
+ * @param   pIoCtx    The read I/O context.
+ */
+static void vdReadAheadRequestStart(PVBOXHDD pDisk, PVDIOCTX pIoCtx)
+{
+    PVDREADAHEAD pReadAhead = pDisk->pReadAhead;
+    uint64_t     uOffset    = pIoCtx->Req.Io.uOffsetXferOrig;
+    uint64_t     uOffsetEnd = uOffset + pIoCtx->Req.Io.cbXferOrig;
+    bool         fAhead     = false;
+    bool         fHit       = false;
+
+    VD_IS_LOCKED(pDisk);
+
+    for (unsigned i = 0; i < RT_ELEMENTS(pReadAhead->aBufs); i++)
+    {
+        PVDREADAHEADBUF pBuf = &pReadAhead->aBufs[i];
+        if (   uOffset >= pBuf->uOffset
+            && uOffset < vdReadAheadBufEnd(pBuf))
+        {
+            fAhead = true;
+            fHit   = !pBuf->fPending;
+        }
+    }
+
+    /* A request hitting (pending) read-ahead data keeps the stream alive even if it arrived out of order. */
+    if (   !fAhead
+        && uOffset != pReadAhead->uOffsetNext)
+    {
+        pReadAhead->cSeqReads   = 0;
+        pReadAhead->uOffsetNext = uOffsetEnd;
+        return;
+    }
+
+    pReadAhead->uOffsetNext = RT_MAX(pReadAhead->uOffsetNext, uOffsetEnd);
+    pReadAhead->cSeqReads++;
+    pReadAhead->Stats.cSeqReads++;
+    if (fHit)
+        pReadAhead->Stats.cHits++;
+    else if (pReadAhead->cSeqReads > pReadAhead->cSeqThreshold)
+        pReadAhead->Stats.cMisses++;
+
+    if (pReadAhead->cSeqReads < pReadAhead->cSeqThreshold)
+        return;
+
+    /* Determine how far the buffered data reaches beyond the request. */
+    uint64_t uOffsetAhead = uOffsetEnd;
+    for (unsigned iPass = 0; iPass < RT_ELEMENTS(pReadAhead->aBufs); iPass++)
+        for (unsigned i = 0; i < RT_ELEMENTS(pReadAhead->aBufs); i++)
+        {
+            PVDREADAHEADBUF pBuf = &pReadAhead->aBufs[i];
+            if (   uOffsetAhead >= pBuf->uOffset
+                && uOffsetAhead < vdReadAheadBufEnd(pBuf))
+                uOffsetAhead = vdReadAheadBufEnd(pBuf);
+        }
+
+    if (   uOffsetAhead - uOffsetEnd >= pReadAhead->cbWindow
+        || uOffsetAhead >= pDisk->cbSize
+        || (uOffsetAhead & 511))
+        return;
+
+    /* Find a buffer which is unused or already consumed by the stream. */
+    PVDREADAHEADBUF pBuf = NULL;
+    for (unsigned i = 0; i < RT_ELEMENTS(pReadAhead->aBufs); i++)
+    {
+        PVDREADAHEADBUF pBufCur = &pReadAhead->aBufs[i];
+        if (   !pBufCur->fPending
+            && (   !pBufCur->cbValid
+                || vdReadAheadBufEnd(pBufCur) <= uOffset))
+        {
+            pBuf = pBufCur;
+            break;
+        }
+    }
+
+    if (!pBuf)
+        return;
+
+    size_t cbAhead = (size_t)RT_MIN(pReadAhead->cbWindow, pDisk->cbSize - uOffsetAhead);
+    cbAhead &= ~(size_t)511;
+    if (!cbAhead)
+        return;
+
+    RTSGBUF SgBuf;
+    pBuf->Seg.pvSeg = pBuf->pbBuf;
+    pBuf->Seg.cbSeg = cbAhead;
+    RTSgBufInit(&SgBuf, &pBuf->Seg, 1);
+
+    uint32_t fFlags = VDIOCTX_FLAGS_ZERO_FREE_BLOCKS | VDIOCTX_FLAGS_READ_AHEAD;
+    if (pDisk->pCache)
+        fFlags |= VDIOCTX_FLAGS_READ_UPDATE_CACHE;
+
+    PVDIOCTX pIoCtxAhead = vdIoCtxRootAlloc(pDisk, VDIOCTXTXDIR_READ, uOffsetAhead, cbAhead,
+                                            pDisk->pLast, &SgBuf, vdReadAheadComplete,
+                                            pDisk, pBuf, NULL, vdReadHelperAsync, fFlags);
+    if (!pIoCtxAhead)
+        return;
+
+    LogFlowFunc(("Reading ahead %zu bytes at %llu for the stream at %llu\n", cbAhead, uOffsetAhead, uOffset));
+
+    pBuf->uOffset   = uOffsetAhead;
+    pBuf->cbValid   = 0;
+    pBuf->cbPending = cbAhead;
+    pBuf->fStale    = false;
+    pBuf->fPending  = true;
+    ASMAtomicIncU32(&pReadAhead->cPending);
+    pReadAhead->Stats.cReadAheads++;
+    pReadAhead->Stats.cbReadAhead += cbAhead;
+
+    /* Processed before the disk lock is released. */
+    vdIoCtxAddToWaitingList(&pDisk->pIoCtxHead, pIoCtxAhead);
+}
+
+/**
+ * Tries to satisfy the start of the given range from the read-ahead buffers.
+ *
+ * @returns true if data was copied into the I/O context, false otherwise.
+ * @param   pDisk          The disk.
+ * @param   pIoCtx         The read I/O context.
+ * @param   uOffset        The offset to read from.
+ * @param   pcbThisRead    On input the number of bytes to read. On output the
+ *                         number of bytes copied, or if nothing was copied the
+ *                         number of bytes before the next buffered range.
+ */
+static bool vdReadAheadCopy(PVBOXHDD pDisk, PVDIOCTX pIoCtx, uint64_t uOffset, size_t *pcbThisRead)
+{
+    PVDREADAHEAD pReadAhead = pDisk->pReadAhead;
+    size_t       cbThisRead = *pcbThisRead;
+
+    VD_IS_LOCKED(pDisk);
+
+    for (unsigned i = 0; i < RT_ELEMENTS(pReadAhead->aBufs); i++)
+    {
+        PVDREADAHEADBUF pBuf = &pReadAhead->aBufs[i];
+
+        if (!pBuf->cbValid || pBuf->fPending)
+            continue;
+
+        if (   uOffset >= pBuf->uOffset
+            && uOffset < pBuf->uOffset + pBuf->cbValid)
+        {
+            size_t cbCopy = (size_t)RT_MIN(cbThisRead, pBuf->uOffset + pBuf->cbValid - uOffset);
+
+            cbCopy = vdIoCtxCopyTo(pIoCtx, pBuf->pbBuf + (uOffset - pBuf->uOffset), cbCopy);
+            Assert(cbCopy == (uint32_t)cbCopy);
+            ASMAtomicSubU32(&pIoCtx->Req.Io.cbTransferLeft, (uint32_t)cbCopy);
+            pReadAhead->Stats.cbHit += cbCopy;
+            *pcbThisRead = cbCopy;
+            return true;
+        }
+
+        /* Don't read over buffered data. */
+        if (   pBuf->uOffset > uOffset
+            && pBuf->uOffset < uOffset + cbThisRead)
+            cbThisRead = (size_t)(pBuf->uOffset - uOffset);
+    }
+
+    *pcbThisRead = cbThisRead;
+    return false;
+}
+
+/**
+ * Waits for all read-ahead requests to complete and drops the buffered data.
+ *
+ * @returns nothing.
+ * @param   pDisk     The disk.
+ *
+ * @note The caller must make sure no new read requests are started, i.e. own
+ *       the disk exclusively and must not own the disk lock.
+ */
+static void vdReadAheadQuiesce(PVBOXHDD pDisk)
+{
+    PVDREADAHEAD pReadAhead = pDisk->pReadAhead;
+
+    if (!pReadAhead)
+        return;
+
+    while (ASMAtomicReadU32(&pReadAhead->cPending))
+        RTThreadSleep(1);
+
+    for (unsigned i = 0; i < RT_ELEMENTS(pReadAhead->aBufs); i++)
+        pReadAhead->aBufs[i].cbValid = 0;
+    pReadAhead->cSeqReads   = 0;
+    pReadAhead->uOffsetNext = 0;
+}
+
+/**
+ * Destroys the read-ahead state of the disk if there is one.
+ *
+ * @returns nothing.
+ * @param   pDisk     The disk.
+ */
+static void vdReadAheadDestroy(PVBOXHDD pDisk)
+{
+    PVDREADAHEAD pReadAhead = pDisk->pReadAhead;
+
+    if (!pReadAhead)
+        return;
+
+    vdReadAheadQuiesce(pDisk);
+    pDisk->pReadAhead = NULL;
+
+    for (unsigned i = 0; i < RT_ELEMENTS(pReadAhead->aBufs); i++)
+        if (pReadAhead->aBufs[i].pbBuf)
+            RTMemPageFree(pReadAhead->aBufs[i].pbBuf, pReadAhead->cbWindow);
+    RTMemFree(pReadAhead);
+}
+
+/**
+ * Creates the read-ahead state of the disk.
+ *
+ * @returns VBox status code.
+ * @param   pDisk          The disk.
+ * @param   cbWindow       Size of one read-ahead request.
+ * @param   cSeqThreshold  Number of sequential reads before read-ahead kicks in.
+ */
+static int vdReadAheadCreate(PVBOXHDD pDisk, size_t cbWindow, uint32_t cSeqThreshold)
+{
+    PVDREADAHEAD pReadAhead = (PVDREADAHEAD)RTMemAllocZ(sizeof(VDREADAHEAD));
+    if (!pReadAhead)
+        return VERR_NO_MEMORY;
+
+    pReadAhead->cbWindow      = cbWindow;
+    pReadAhead->cSeqThreshold = cSeqThreshold;
+    for (unsigned i = 0; i < RT_ELEMENTS(pReadAhead->aBufs); i++)
+    {
+        pReadAhead->aBufs[i].pbBuf = (uint8_t *)RTMemPageAlloc(cbWindow);
+        if (!pReadAhead->aBufs[i].pbBuf)
+        {
+            while (i-- > 0)
+                RTMemPageFree(pReadAhead->aBufs[i].pbBuf, cbWindow);
+            RTMemFree(pReadAhead);
+            return VERR_NO_MEMORY;
+        }
+    }
+
+    pDisk->pReadAhead = pReadAhead;
+    return VINF_SUCCESS;
+}
+
 /**
  * Process the I/O context, core method which assumes that the I/O context
  * acquired the lock.
@@ -1690,6 +2157,8 @@ static int vdIoCtxProcessLocked(PVDIOCTX pIoCtx)
 
     LogFlowFunc(("pIoCtx=%#p\n", pIoCtx));
 
+    vdReadAheadIoCtxInvalidate(pIoCtx->pDisk, pIoCtx);
+
     if (!vdIoCtxIsComplete(pIoCtx))
     {
         if (!vdIoCtxIsBlocked(pIoCtx))
@@ -1744,6 +2213,10 @@ static int vdIoCtxProcessLocked(PVDIOCTX pIoCtx)
     else
         rc = VINF_VD_ASYNC_IO_FINISHED;
 
+    /* Drop anything read ahead while the modification was in flight. */
+    if (rc == VINF_VD_ASYNC_IO_FINISHED)
+        vdReadAheadIoCtxInvalidate(pIoCtx->pDisk, pIoCtx);
+
     LogFlowFunc(("pIoCtx=%#p rc=%Rrc cDataTransfersPending=%u cMetaTransfersPending=%u fComplete=%RTbool\n",
                  pIoCtx, rc, pIoCtx->cDataTransfersPending, pIoCtx->cMetaTransfersPending,
                  pIoCtx->fComplete));
@@ -1830,7 +2303,8 @@ static int vdDiskProcessWaitingIoCtx(PVBOXHDD pDisk, PVDIOCTX pIoCtxRc)
                  && ASMAtomicCmpXchgBool(&pTmp->fComplete, true, false))
         {
             LogFlowFunc(("Waiting I/O context completed pTmp=%#p\n", pTmp));
-            vdThreadFinishWrite(pDisk);
+            if (!(pTmp->fFlags & VDIOCTX_FLAGS_READ_AHEAD))
+                vdThreadFinishWrite(pDisk);
             vdIoCtxRootComplete(pDisk, pTmp);
             vdIoCtxFree(pDisk, pTmp);
         }
@@ -1885,7 +2359,8 @@ static void vdDiskProcessBlockedIoCtx(PVBOXHDD pDisk)
             && ASMAtomicCmpXchgBool(&pTmp->fComplete, true, false))
         {
             LogFlowFunc(("Waiting I/O context completed pTmp=%#p\n", pTmp));
-            vdThreadFinishWrite(pDisk);
+            if (!(pTmp->fFlags & VDIOCTX_FLAGS_READ_AHEAD))
+                vdThreadFinishWrite(pDisk);
             vdIoCtxRootComplete(pDisk, pTmp);
             vdIoCtxFree(pDisk, pTmp);
         }
@@ -2076,6 +2551,25 @@ static DECLCALLBACK(int) vdReadHelperAsync(PVDIOCTX pIoCtx)
         return VERR_VD_ASYNC_IO_IN_PROGRESS;
     }
 
+    /*
+     * Only plain reads of the whole chain issued by the user take part in read-ahead,
+     * everything else (including read-ahead requests) bypasses the buffers.
+     */
+    if (   pDisk->pReadAhead
+        && !(pIoCtx->fFlags & (VDIOCTX_FLAGS_READ_AHEAD | VDIOCTX_FLAGS_READ_AHEAD_CHECKED)))
+    {
+        pIoCtx->fFlags |= VDIOCTX_FLAGS_READ_AHEAD_CHECKED;
+        if (   !pIoCtx->pIoCtxParent
+            && !pImageParentOverride
+            && !cImagesRead
+            && pIoCtx->Req.Io.pImageStart == pDisk->pLast)
+        {
+            pIoCtx->fFlags |= VDIOCTX_FLAGS_READ_AHEAD_USE;
+            vdReadAheadRequestStart(pDisk, pIoCtx);
+        }
+    }
+    bool fReadAhead = pDisk->pReadAhead && (pIoCtx->fFlags & VDIOCTX_FLAGS_READ_AHEAD_USE);
+
     /* Loop until all reads started or we have a backend which needs to read metadata. */
     do
     {
@@ -2084,8 +2578,11 @@ static DECLCALLBACK(int) vdReadHelperAsync(PVDIOCTX pIoCtx)
          * stale data when different block sizes are used for the images. */
         cbThisRead = cbToRead;
 
-        if (   pDisk->pCache
-            && !pImageParentOverride)
+        if (   fReadAhead
+            && vdReadAheadCopy(pDisk, pIoCtx, uOffset, &cbThisRead))
+            rc = VINF_SUCCESS;
+        else if (   pDisk->pCache
+                 && !pImageParentOverride)
         {
             rc = vdCacheReadHelper(pDisk->pCache, uOffset, cbThisRead,
                                    pIoCtx, &cbThisRead);
@@ -2403,9 +2900,131 @@ static int vdWriteHelper(PVBOXHDD pDisk, PVDIMAGE pImage, uint64_t uOffset,
                            fFlags, 0);
 }
 
+/**
+ * Internal: Reads the next chunk of the source disk for copying.
+ *
+ * @returns VBox status code, VERR_VD_BLOCK_FREE if the range is unallocated
+ *          and doesn't need to be copied.
+ * @param   pPipe           The copy pipeline state.
+ * @param   uOffset         Where to start reading.
+ * @param   pvBuf           Where to store the data.
+ * @param   pcbThisRead     On input the maximum number of bytes to read,
+ *                          on output the number of bytes actually covered.
+ */
+static int vdCopyHelperRead(PVDCOPYPIPE pPipe, uint64_t uOffset, void *pvBuf, size_t *pcbThisRead)
+{
+    int rc;
+    PVBOXHDD pDiskFrom = pPipe->pDiskFrom;
+    PVDIMAGE pImageFrom = pPipe->pImageFrom;
+
+    /* Note that we don't attempt to synchronize cross-disk accesses.
+     * It wouldn't be very difficult to do, just the lock order would
+     * need to be defined somehow to prevent deadlocks. Postpone such
+     * magic as there is no use case for this. */
+    int rc2 = vdThreadStartRead(pDiskFrom);
+    AssertRC(rc2);
+
+    if (pPipe->fBlockwiseCopy)
+    {
+        RTSGSEG SegmentBuf;
+        RTSGBUF SgBuf;
+        VDIOCTX IoCtx;
+
+        SegmentBuf.pvSeg = pvBuf;
+        SegmentBuf.cbSeg = VD_COPY_BUFFER_SIZE;
+        RTSgBufInit(&SgBuf, &SegmentBuf, 1);
+        vdIoCtxInit(&IoCtx, pDiskFrom, VDIOCTXTXDIR_READ, 0, 0, NULL,
+                    &SgBuf, NULL, NULL, VDIOCTX_FLAGS_SYNC);
+
+        /* Read the source data. */
+        rc = pImageFrom->Backend->pfnRead(pImageFrom->pBackendData,
+                                          uOffset, *pcbThisRead, &IoCtx,
+                                          pcbThisRead);
+
+        if (   rc == VERR_VD_BLOCK_FREE
+            && pPipe->cImagesFromRead != 1)
+        {
+            unsigned cImagesToProcess = pPipe->cImagesFromRead;
+
+            for (PVDIMAGE pCurrImage = pImageFrom->pPrev;
+                 pCurrImage != NULL && rc == VERR_VD_BLOCK_FREE;
+                 pCurrImage = pCurrImage->pPrev)
+            {
+                rc = pCurrImage->Backend->pfnRead(pCurrImage->pBackendData,
+                                                  uOffset, *pcbThisRead,
+                                                  &IoCtx, pcbThisRead);
+                if (cImagesToProcess == 1)
+                    break;
+                else if (cImagesToProcess > 0)
+                    cImagesToProcess--;
+            }
+        }
+    }
+    else
+        rc = vdReadHelper(pDiskFrom, pImageFrom, uOffset, pvBuf, *pcbThisRead,
+                          false /* fUpdateCache */);
+
+    rc2 = vdThreadFinishRead(pDiskFrom);
+    AssertRC(rc2);
+
+    return rc;
+}
+
+/**
+ * Internal: Reader thread of the copy pipeline, reads the source disk ahead
+ * of the writer until all buffers are filled.
+ */
+static DECLCALLBACK(int) vdCopyHelperReaderThread(RTTHREAD hThread, void *pvUser)
+{
+    PVDCOPYPIPE pPipe = (PVDCOPYPIPE)pvUser;
+    uint64_t uOffset = 0;
+    unsigned iBuf = 0;
+    int rc = VINF_SUCCESS;
+
+    NOREF(hThread);
+
+    while (   uOffset < pPipe->cbSize
+           && !ASMAtomicReadBool(&pPipe->fCancelled))
+    {
+        /* Wait for the writer to hand back a buffer. */
+        if (ASMAtomicReadU32(&pPipe->cFilled) == VD_COPY_BUFFERS)
+        {
+            RTSemEventWait(pPipe->hEvtFree, RT_INDEFINITE_WAIT);
+            continue;
+        }
+
+        PVDCOPYBUF pBuf = &pPipe->aBufs[iBuf];
+        size_t cbThisRead = (size_t)RT_MIN(VD_COPY_BUFFER_SIZE, pPipe->cbSize - uOffset);
+
+        rc = vdCopyHelperRead(pPipe, uOffset, pBuf->pvBuf, &cbThisRead);
+        if (RT_FAILURE(rc) && rc != VERR_VD_BLOCK_FREE)
+            break;
+
+        pBuf->uOffset    = uOffset;
+        pBuf->cbData     = cbThisRead;
+        pBuf->fBlockFree = rc == VERR_VD_BLOCK_FREE;
+        rc = VINF_SUCCESS;
+
+        uOffset += cbThisRead;
+        iBuf = (iBuf + 1) % VD_COPY_BUFFERS;
+
+        ASMAtomicIncU32(&pPipe->cFilled);
+        RTSemEventSignal(pPipe->hEvtFilled);
+    }
+
+    pPipe->rcReader = rc;
+    ASMAtomicWriteBool(&pPipe->fReaderDone, true);
+    RTSemEventSignal(pPipe->hEvtFilled);
+    return rc;
+}
+
 /**
  * Internal: Copies the content of one disk to another one applying optimizations
  * to speed up the copy process if possible.
+ *
+ * The source is read by a separate thread into a ring of buffers while the
+ * calling thread writes the data to the destination, so reading and writing
+ * overlap. Unallocated ranges are skipped when copying blockwise.
  */
 static int vdCopyHelper(PVBOXHDD pDiskFrom, PVDIMAGE pImageFrom, PVBOXHDD pDiskTo,
                         uint64_t cbSize, unsigned cImagesFromRead, unsigned cImagesToRead,
@@ -2414,108 +3033,83 @@ static int vdCopyHelper(PVBOXHDD pDiskFrom, PVDIMAGE pImageFrom, PVBOXHDD pDiskT
 {
     int rc = VINF_SUCCESS;
     int rc2;
-    uint64_t uOffset = 0;
-    uint64_t cbRemaining = cbSize;
-    void *pvBuf = NULL;
-    bool fLockReadFrom = false;
-    bool fLockWriteTo = false;
-    bool fBlockwiseCopy = false;
     unsigned uProgressOld = 0;
+    unsigned iBuf = 0;
+    PVDCOPYPIPE pPipe = NULL;
+    RTTHREAD hThreadReader = NIL_RTTHREAD;
 
     LogFlowFunc(("pDiskFrom=%#p pImageFrom=%#p pDiskTo=%#p cbSize=%llu cImagesFromRead=%u cImagesToRead=%u fSuppressRedundantIo=%RTbool pIfProgress=%#p pDstIfProgress=%#p\n",
                  pDiskFrom, pImageFrom, pDiskTo, cbSize, cImagesFromRead, cImagesToRead, fSuppressRedundantIo, pDstIfProgress, pDstIfProgress));
 
-    if (   (fSuppressRedundantIo || (cImagesFromRead > 0))
-        && RTListIsEmpty(&pDiskFrom->ListFilterChainRead))
-        fBlockwiseCopy = true;
+    pPipe = (PVDCOPYPIPE)RTMemAllocZ(sizeof(VDCOPYPIPE));
+    if (!pPipe)
+        return VERR_NO_MEMORY;
 
-    /* Allocate tmp buffer. */
-    pvBuf = RTMemTmpAlloc(VD_MERGE_BUFFER_SIZE);
-    if (!pvBuf)
-        return rc;
+    pPipe->pDiskFrom       = pDiskFrom;
+    pPipe->pImageFrom      = pImageFrom;
+    pPipe->cbSize          = cbSize;
+    pPipe->cImagesFromRead = cImagesFromRead;
+    pPipe->fBlockwiseCopy  =    (fSuppressRedundantIo || (cImagesFromRead > 0))
+                             && RTListIsEmpty(&pDiskFrom->ListFilterChainRead);
+    pPipe->hEvtFilled      = NIL_RTSEMEVENT;
+    pPipe->hEvtFree        = NIL_RTSEMEVENT;
 
-    do
+    /* Allocate tmp buffers. */
+    for (unsigned i = 0; i < VD_COPY_BUFFERS && RT_SUCCESS(rc); i++)
     {
-        size_t cbThisRead = RT_MIN(VD_MERGE_BUFFER_SIZE, cbRemaining);
-
-        /* Note that we don't attempt to synchronize cross-disk accesses.
-         * It wouldn't be very difficult to do, just the lock order would
-         * need to be defined somehow to prevent deadlocks. Postpone such
-         * magic as there is no use case for this. */
+        pPipe->aBufs[i].pvBuf = RTMemTmpAlloc(VD_COPY_BUFFER_SIZE);
+        if (!pPipe->aBufs[i].pvBuf)
+            rc = VERR_NO_MEMORY;
+    }
 
-        rc2 = vdThreadStartRead(pDiskFrom);
-        AssertRC(rc2);
-        fLockReadFrom = true;
+    if (RT_SUCCESS(rc))
+        rc = RTSemEventCreate(&pPipe->hEvtFilled);
+    if (RT_SUCCESS(rc))
+        rc = RTSemEventCreate(&pPipe->hEvtFree);
+    if (RT_SUCCESS(rc))
+        rc = RTThreadCreate(&hThreadReader, vdCopyHelperReaderThread, pPipe, 0,
+                            RTTHREADTYPE_IO, RTTHREADFLAGS_WAITABLE, "VDCopyRd");
 
-        if (fBlockwiseCopy)
+    while (RT_SUCCESS(rc))
+    {
+        if (!ASMAtomicReadU32(&pPipe->cFilled))
         {
-            RTSGSEG SegmentBuf;
-            RTSGBUF SgBuf;
-            VDIOCTX IoCtx;
-
-            SegmentBuf.pvSeg = pvBuf;
-            SegmentBuf.cbSeg = VD_MERGE_BUFFER_SIZE;
-            RTSgBufInit(&SgBuf, &SegmentBuf, 1);
-            vdIoCtxInit(&IoCtx, pDiskFrom, VDIOCTXTXDIR_READ, 0, 0, NULL,
-                        &SgBuf, NULL, NULL, VDIOCTX_FLAGS_SYNC);
-
-            /* Read the source data. */
-            rc = pImageFrom->Backend->pfnRead(pImageFrom->pBackendData,
-                                              uOffset, cbThisRead, &IoCtx,
-                                              &cbThisRead);
-
-            if (   rc == VERR_VD_BLOCK_FREE
-                && cImagesFromRead != 1)
+            if (ASMAtomicReadBool(&pPipe->fReaderDone))
             {
-                unsigned cImagesToProcess = cImagesFromRead;
-
-                for (PVDIMAGE pCurrImage = pImageFrom->pPrev;
-                     pCurrImage != NULL && rc == VERR_VD_BLOCK_FREE;
-                     pCurrImage = pCurrImage->pPrev)
-                {
-                    rc = pCurrImage->Backend->pfnRead(pCurrImage->pBackendData,
-                                                           uOffset, cbThisRead,
-                                                           &IoCtx, &cbThisRead);
-                    if (cImagesToProcess == 1)
-                        break;
-                    else if (cImagesToProcess > 0)
-                        cImagesToProcess--;
-                }
+                /* The reader might have posted the last buffer right before finishing. */
+                if (ASMAtomicReadU32(&pPipe->cFilled))
+                    continue;
+                rc = pPipe->rcReader;
+                break;
             }
+            RTSemEventWait(pPipe->hEvtFilled, RT_INDEFINITE_WAIT);
+            continue;
         }
-        else
-            rc = vdReadHelper(pDiskFrom, pImageFrom, uOffset, pvBuf, cbThisRead,
-                              false /* fUpdateCache */);
 
-        if (RT_FAILURE(rc) && rc != VERR_VD_BLOCK_FREE)
-            break;
+        PVDCOPYBUF pBuf = &pPipe->aBufs[iBuf];
 
-        rc2 = vdThreadFinishRead(pDiskFrom);
-        AssertRC(rc2);
-        fLockReadFrom = false;
-
-        if (rc != VERR_VD_BLOCK_FREE)
+        if (!pBuf->fBlockFree)
         {
             rc2 = vdThreadStartWrite(pDiskTo);
             AssertRC(rc2);
-            fLockWriteTo = true;
 
             /* Only do collapsed I/O if we are copying the data blockwise. */
-            rc = vdWriteHelperEx(pDiskTo, pDiskTo->pLast, NULL, uOffset, pvBuf,
-                                 cbThisRead, VDIOCTX_FLAGS_DONT_SET_MODIFIED_FLAG /* fFlags */,
-                                 fBlockwiseCopy ? cImagesToRead : 0);
-            if (RT_FAILURE(rc))
-                break;
+            rc = vdWriteHelperEx(pDiskTo, pDiskTo->pLast, NULL, pBuf->uOffset, pBuf->pvBuf,
+                                 pBuf->cbData, VDIOCTX_FLAGS_DONT_SET_MODIFIED_FLAG /* fFlags */,
+                                 pPipe->fBlockwiseCopy ? cImagesToRead : 0);
 
             rc2 = vdThreadFinishWrite(pDiskTo);
             AssertRC(rc2);
-            fLockWriteTo = false;
+            if (RT_FAILURE(rc))
+                break;
         }
-        else /* Don't propagate the error to the outside */
-            rc = VINF_SUCCESS;
 
-        uOffset += cbThisRead;
-        cbRemaining -= cbThisRead;
+        uint64_t uOffset = pBuf->uOffset + pBuf->cbData;
+
+        /* Hand the buffer back to the reader. */
+        iBuf = (iBuf + 1) % VD_COPY_BUFFERS;
+        ASMAtomicDecU32(&pPipe->cFilled);
+        RTSemEventSignal(pPipe->hEvtFree);
 
         unsigned uProgressNew = uOffset * 99 / cbSize;
         if (uProgressNew != uProgressOld)
@@ -2537,22 +3131,26 @@ static int vdCopyHelper(PVBOXHDD pDiskFrom, PVDIMAGE pImageFrom, PVBOXHDD pDiskT
                     break;
             }
         }
-    } while (uOffset < cbSize);
-
-    RTMemFree(pvBuf);
-
-    if (fLockReadFrom)
-    {
-        rc2 = vdThreadFinishRead(pDiskFrom);
-        AssertRC(rc2);
     }
 
-    if (fLockWriteTo)
+    if (hThreadReader != NIL_RTTHREAD)
     {
-        rc2 = vdThreadFinishWrite(pDiskTo);
+        /* Stop the reader if we bailed out early. */
+        ASMAtomicWriteBool(&pPipe->fCancelled, true);
+        RTSemEventSignal(pPipe->hEvtFree);
+        rc2 = RTThreadWait(hThreadReader, RT_INDEFINITE_WAIT, NULL);
         AssertRC(rc2);
     }
 
+    if (pPipe->hEvtFree != NIL_RTSEMEVENT)
+        RTSemEventDestroy(pPipe->hEvtFree);
+    if (pPipe->hEvtFilled != NIL_RTSEMEVENT)
+        RTSemEventDestroy(pPipe->hEvtFilled);
+    for (unsigned i = 0; i < VD_COPY_BUFFERS; i++)
+        if (pPipe->aBufs[i].pvBuf)
+            RTMemTmpFree(pPipe->aBufs[i].pvBuf);
+    RTMemFree(pPipe);
+
     LogFlowFunc(("returns rc=%Rrc\n", rc));
     return rc;
 }
@@ -4212,7 +4810,9 @@ static int vdIoCtxContinue(PVDIOCTX pIoCtx, int rcReq)
                 else
                 {
                     Assert(pIoCtx->enmTxDir == VDIOCTXTXDIR_READ);
-                    vdThreadFinishRead(pDisk);
+                    /* Read-ahead requests don't hold the read lock. */
+                    if (!(pIoCtx->fFlags & VDIOCTX_FLAGS_READ_AHEAD))
+                        vdThreadFinishRead(pDisk);
                 }
 
                 LogFlowFunc(("I/O context completed pIoCtx=%#p rcReq=%Rrc\n", pIoCtx, pIoCtx->rcReq));
@@ -6171,6 +6771,7 @@ VBOXDDU_DECL(int) VDCreate(PVDINTERFACE pVDIfsDisk, VDTYPE enmType, PVBOXHDD *pp
             pDisk->pInterfaceThreadSync    = NULL;
             pDisk->pIoCtxLockOwner         = NULL;
             pDisk->pIoCtxHead              = NULL;
+            pDisk->pReadAhead              = NULL;
             pDisk->fLocked                 = false;
             pDisk->hMemCacheIoCtx          = NIL_RTMEMCACHE;
             pDisk->hMemCacheIoTask         = NIL_RTMEMCACHE;
@@ -6237,6 +6838,8 @@ VBOXDDU_DECL(int) VDDestroy(PVBOXHDD pDisk)
         if (RT_SUCCESS(rc))
             rc = rc2;
 
+        vdReadAheadDestroy(pDisk);
+
         RTMemCacheDestroy(pDisk->hMemCacheIoCtx);
         RTMemCacheDestroy(pDisk->hMemCacheIoTask);
         RTMemFree(pDisk);
@@ -9175,6 +9778,9 @@ VBOXDDU_DECL(int) VDCacheClose(PVBOXHDD pDisk, bool fDelete)
 
         AssertPtrBreakStmt(pDisk->pCache, rc = VERR_VD_CACHE_NOT_FOUND);
 
+        /* Pending read-ahead requests might still update the cache. */
+        vdReadAheadQuiesce(pDisk);
+
         pCache = pDisk->pCache;
         pDisk->pCache = NULL;
 
@@ -10970,6 +11576,14 @@ VBOXDDU_DECL(void) VDDumpImages(PVBOXHDD pDisk)
                              pImage->pszFilename, pImage->Backend->pszBackendName);
             pImage->Backend->pfnDump(pImage->pBackendData);
         }
+
+        PVDREADAHEAD pReadAhead = pDisk->pReadAhead;
+        if (pReadAhead)
+            vdMessageWrapper(pDisk, "Read-ahead: Window=%zu Threshold=%u SeqReads=%llu Hits=%llu Misses=%llu BytesHit=%llu ReadAheads=%llu BytesReadAhead=%llu Invalidated=%llu\n",
+                             pReadAhead->cbWindow, pReadAhead->cSeqThreshold, pReadAhead->Stats.cSeqReads,
+                             pReadAhead->Stats.cHits, pReadAhead->Stats.cMisses, pReadAhead->Stats.cbHit,
+                             pReadAhead->Stats.cReadAheads, pReadAhead->Stats.cbReadAhead,
+                             pReadAhead->Stats.cInvalidated);
     } while (0);
 
     if (RT_UNLIKELY(fLockRead))
@@ -10980,6 +11594,77 @@ VBOXDDU_DECL(void) VDDumpImages(PVBOXHDD pDisk)
 }
 
 
+VBOXDDU_DECL(int) VDSetReadAhead(PVBOXHDD pDisk, size_t cbWindow, uint32_t cSeqThreshold)
+{
+    int rc = VINF_SUCCESS;
+    int rc2;
+    bool fLockWrite = false;
+
+    LogFlowFunc(("pDisk=%#p cbWindow=%zu cSeqThreshold=%u\n", pDisk, cbWindow, cSeqThreshold));
+    do
+    {
+        /* sanity check */
+        AssertPtrBreakStmt(pDisk, rc = VERR_INVALID_PARAMETER);
+        AssertMsg(pDisk->u32Signature == VBOXHDDDISK_SIGNATURE, ("u32Signature=%08x\n", pDisk->u32Signature));
+
+        /* Check arguments, they come from the user configuration. */
+        if (   (cbWindow % 512)
+            || cbWindow > VD_READ_AHEAD_WINDOW_MAX
+            || (cbWindow && !cSeqThreshold))
+        {
+            rc = VERR_INVALID_PARAMETER;
+            break;
+        }
+
+        rc2 = vdThreadStartWrite(pDisk);
+        AssertRC(rc2);
+        fLockWrite = true;
+
+        vdReadAheadDestroy(pDisk);
+        if (cbWindow)
+            rc = vdReadAheadCreate(pDisk, cbWindow, cSeqThreshold);
+    } while (0);
+
+    if (RT_UNLIKELY(fLockWrite))
+    {
+        rc2 = vdThreadFinishWrite(pDisk);
+        AssertRC(rc2);
+    }
+
+    LogFlowFunc(("returns %Rrc\n", rc));
+    return rc;
+}
+
+
+VBOXDDU_DECL(int) VDGetReadAheadStats(PVBOXHDD pDisk, PVDREADAHEADSTATS pStats)
+{
+    int rc = VINF_SUCCESS;
+
+    LogFlowFunc(("pDisk=%#p pStats=%#p\n", pDisk, pStats));
+    do
+    {
+        /* sanity check */
+        AssertPtrBreakStmt(pDisk, rc = VERR_INVALID_PARAMETER);
+        AssertMsg(pDisk->u32Signature == VBOXHDDDISK_SIGNATURE, ("u32Signature=%08x\n", pDisk->u32Signature));
+
+        /* Check arguments. */
+        AssertMsgBreakStmt(VALID_PTR(pStats),
+                           ("pStats=%#p\n", pStats),
+                           rc = VERR_INVALID_PARAMETER);
+
+        /* The counters are only updated with the disk lock held, a racy snapshot is good enough here. */
+        PVDREADAHEAD pReadAhead = pDisk->pReadAhead;
+        if (pReadAhead)
+            *pStats = pReadAhead->Stats;
+        else
+            rc = VERR_NOT_SUPPORTED;
+    } while (0);
+
+    LogFlowFunc(("returns %Rrc\n", rc));
+    return rc;
+}
+
+
 VBOXDDU_DECL(int) VDDiscardRanges(PVBOXHDD pDisk, PCRTRANGE paRanges, unsigned cRanges)
 {
     int rc;
@@ -193,6 +193,125 @@ static void vdiConvBlocksEndianess(VDIECONV enmConv, PVDIIMAGEBLOCKPOINTER paBlo
         paBlocks[i] = SET_ENDIAN_U32(enmConv, paBlocks[i]);
 }
 
+/**
+ * Internal: Updates a block array entry and the bitmap of present blocks.
+ *
+ * @param   pImage          The VDI image descriptor.
+ * @param   uBlock          The block to update.
+ * @param   ptrBlock        The new block pointer.
+ */
+DECLINLINE(void) vdiBlockPtrSet(PVDIIMAGEDESC pImage, unsigned uBlock, VDIIMAGEBLOCKPOINTER ptrBlock)
+{
+    pImage->paBlocks[uBlock] = ptrBlock;
+    if (ptrBlock == VDI_IMAGE_BLOCK_FREE)
+        ASMBitClear(pImage->pbmBlocksPresent, uBlock);
+    else
+        ASMBitSet(pImage->pbmBlocksPresent, uBlock);
+}
+
+/**
+ * Internal: Returns the size in bytes of a bitmap with the given number of bits,
+ * rounded up so the ASMBit* search functions can be used on it.
+ */
+DECLINLINE(size_t) vdiBitmapSize(unsigned cBits)
+{
+    return RT_MAX(RT_ALIGN_Z(cBits, 64) / 8, 8);
+}
+
+/**
+ * Internal: Sets up the in-memory block state after the block array was
+ * loaded or created: the bitmap of present blocks and, if configured, the
+ * state for batching block array updates until the next flush.
+ *
+ * @returns VBox status code.
+ * @param   pImage          The VDI image descriptor.
+ */
+static int vdiBlockStateInit(PVDIIMAGEDESC pImage)
+{
+    unsigned cBlocks = getImageBlocks(&pImage->Header);
+
+    pImage->pbmBlocksPresent = RTMemAllocZ(vdiBitmapSize(cBlocks));
+    if (!pImage->pbmBlocksPresent)
+        return VERR_NO_MEMORY;
+
+    for (unsigned i = 0; i < cBlocks; i++)
+        if (pImage->paBlocks[i] != VDI_IMAGE_BLOCK_FREE)
+            ASMBitSet(pImage->pbmBlocksPresent, i);
+
+    /*
+     * Batching block array updates is only possible if the image is writable
+     * and discard is disabled. Discarding relocates blocks and shrinks the file
+     * so the block array must be written right away.
+     */
+    bool fBatch = false;
+    PVDINTERFACECONFIG pIfCfg = VDIfConfigGet(pImage->pVDIfsImage);
+    if (pIfCfg)
+    {
+        int rc = VDCFGQueryBoolDef(pIfCfg, "BatchBlockUpdates", &fBatch, false);
+        if (RT_FAILURE(rc))
+            return vdIfError(pImage->pIfError, rc, RT_SRC_POS,
+                             N_("VDI: Getting \"BatchBlockUpdates\" for '%s' failed (%Rrc)"), pImage->pszFilename, rc);
+    }
+
+    if (   fBatch
+        && !(pImage->uOpenFlags & (VD_OPEN_FLAGS_READONLY | VD_OPEN_FLAGS_DISCARD)))
+    {
+        pImage->pbmBlocksDirty = RTMemAllocZ(vdiBitmapSize(cBlocks / VDI_BLOCKS_CHUNK_ENTRIES + 1));
+        if (!pImage->pbmBlocksDirty)
+            return VERR_NO_MEMORY;
+    }
+
+    return VINF_SUCCESS;
+}
+
+/**
+ * Internal: Writes all changed chunks of the block array if updates are batched.
+ *
+ * The chunks are always written as a whole at fixed offsets so overlapping
+ * metadata transfers of concurrent flushes always match.
+ *
+ * @returns VBox status code.
+ * @param   pImage          The VDI image descriptor.
+ * @param   pIoCtx          The I/O context for async writes, NULL for synchronous I/O.
+ */
+static int vdiBlocksDirtyWrite(PVDIIMAGEDESC pImage, PVDIOCTX pIoCtx)
+{
+    int rc = VINF_SUCCESS;
+
+    if (!pImage->pbmBlocksDirty)
+        return VINF_SUCCESS;
+
+    unsigned cBlocks = getImageBlocks(&pImage->Header);
+    unsigned cChunks = cBlocks / VDI_BLOCKS_CHUNK_ENTRIES + 1;
+    int iChunk = ASMBitFirstSet(pImage->pbmBlocksDirty, RT_ALIGN_32(cChunks, 32));
+    while (iChunk != -1)
+    {
+        VDIIMAGEBLOCKPOINTER aBlocks[VDI_BLOCKS_CHUNK_ENTRIES];
+        unsigned idxStart = (unsigned)iChunk * VDI_BLOCKS_CHUNK_ENTRIES;
+        unsigned cEntries = RT_MIN(VDI_BLOCKS_CHUNK_ENTRIES, cBlocks - idxStart);
+
+        for (unsigned i = 0; i < cEntries; i++)
+            aBlocks[i] = RT_H2LE_U32(pImage->paBlocks[idxStart + i]);
+
+        ASMBitClear(pImage->pbmBlocksDirty, iChunk);
+        rc = vdIfIoIntFileWriteMeta(pImage->pIfIo, pImage->pStorage,
+                                    pImage->offStartBlocks + idxStart * sizeof(VDIIMAGEBLOCKPOINTER),
+                                    &aBlocks[0], cEntries * sizeof(VDIIMAGEBLOCKPOINTER),
+                                    pIoCtx, NULL, NULL);
+        if (RT_FAILURE(rc) && rc != VERR_VD_ASYNC_IO_IN_PROGRESS)
+        {
+            ASMBitSet(pImage->pbmBlocksDirty, iChunk);
+            break;
+        }
+
+        iChunk = ASMBitNextSet(pImage->pbmBlocksDirty, RT_ALIGN_32(cChunks, 32), iChunk);
+    }
+
+    AssertMsg(RT_SUCCESS(rc) || rc == VERR_VD_ASYNC_IO_IN_PROGRESS,
+              ("vdiBlocksDirtyWrite failed, filename=\"%s\" rc=%Rrc\n", pImage->pszFilename, rc));
+    return rc;
+}
+
 /**
  * Internal: Flush the image file to disk.
  */
@@ -200,8 +319,12 @@ static void vdiFlushImage(PVDIIMAGEDESC pImage)
 {
     if (!(pImage->uOpenFlags & VD_OPEN_FLAGS_READONLY))
     {
+        /* Save the block array changes not written yet. */
+        int rc = vdiBlocksDirtyWrite(pImage, NULL);
+        AssertMsgRC(rc, ("vdiBlocksDirtyWrite() failed, filename=\"%s\", rc=%Rrc\n",
+                         pImage->pszFilename, rc));
         /* Save header. */
-        int rc = vdiUpdateHeader(pImage);
+        rc = vdiUpdateHeader(pImage);
         AssertMsgRC(rc, ("vdiUpdateHeader() failed, filename=\"%s\", rc=%Rrc\n",
                          pImage->pszFilename, rc));
         vdIfIoIntFileFlushSync(pImage->pIfIo, pImage->pStorage);
@@ -242,6 +365,18 @@ static int vdiFreeImage(PVDIIMAGEDESC pImage, bool fDelete)
             pImage->paBlocksRev = NULL;
         }
 
+        if (pImage->pbmBlocksPresent)
+        {
+            RTMemFree(pImage->pbmBlocksPresent);
+            pImage->pbmBlocksPresent = NULL;
+        }
+
+        if (pImage->pbmBlocksDirty)
+        {
+            RTMemFree(pImage->pbmBlocksDirty);
+            pImage->pbmBlocksDirty = NULL;
+        }
+
         if (fDelete && pImage->pszFilename)
             vdIfIoIntFileDelete(pImage->pIfIo, pImage->pszFilename);
     }
@@ -726,6 +861,8 @@ static int vdiCreateImage(PVDIIMAGEDESC pImage, uint64_t cbSize,
 
             rc = vdiImageCreateFile(pImage, uOpenFlags, pIfProgress,
                                     uPercentStart, uPercentSpan);
+            if (RT_SUCCESS(rc))
+                rc = vdiBlockStateInit(pImage);
         }
     }
 
@@ -949,6 +1086,8 @@ static int vdiOpenImage(PVDIIMAGEDESC pImage, unsigned uOpenFlags)
 
                     if (uOpenFlags & VD_OPEN_FLAGS_DISCARD)
                         rc = vdiImageBackResolvTblCreate(pImage);
+                    if (RT_SUCCESS(rc))
+                        rc = vdiBlockStateInit(pImage);
                 }
                 else
                     rc = vdIfError(pImage->pIfError, rc, RT_SRC_POS, N_("VDI: Error reading the block table in '%s'"), pImage->pszFilename);
@@ -1106,6 +1245,11 @@ static int vdiFlushImageIoCtx(PVDIIMAGEDESC pImage, PVDIOCTX pIoCtx)
 
     if (!(pImage->uOpenFlags & VD_OPEN_FLAGS_READONLY))
     {
+        /* Save the block array changes not written yet. */
+        rc = vdiBlocksDirtyWrite(pImage, pIoCtx);
+        if (RT_FAILURE(rc) && rc != VERR_VD_ASYNC_IO_IN_PROGRESS)
+            return rc;
+
         /* Save header. */
         rc = vdiUpdateHeaderAsync(pImage, pIoCtx);
         AssertMsg(RT_SUCCESS(rc) || rc == VERR_VD_ASYNC_IO_IN_PROGRESS,
@@ -1173,11 +1317,11 @@ static DECLCALLBACK(int) vdiDiscardBlockAsyncUpdate(void *pBackendData, PVDIOCTX
 
             /* Block write complete. Update metadata. */
             pImage->paBlocksRev[pDiscardAsync->idxLastBlock] = VDI_IMAGE_BLOCK_FREE;
-            pImage->paBlocks[pDiscardAsync->uBlock] = VDI_IMAGE_BLOCK_ZERO;
+            vdiBlockPtrSet(pImage, pDiscardAsync->uBlock, VDI_IMAGE_BLOCK_ZERO);
 
             if (pDiscardAsync->idxLastBlock != pDiscardAsync->ptrBlockDiscard)
             {
-                pImage->paBlocks[pDiscardAsync->uBlockLast] = pDiscardAsync->ptrBlockDiscard;
+                vdiBlockPtrSet(pImage, pDiscardAsync->uBlockLast, pDiscardAsync->ptrBlockDiscard);
                 pImage->paBlocksRev[pDiscardAsync->ptrBlockDiscard] = pDiscardAsync->uBlockLast;
 
                 rc = vdiUpdateBlockInfoAsync(pImage, pDiscardAsync->uBlockLast, pIoCtx, false /* fUpdateHdr */);
@@ -1328,14 +1472,19 @@ static DECLCALLBACK(int) vdiBlockAllocUpdate(void *pBackendData, PVDIOCTX pIoCtx
     if (RT_SUCCESS(rcReq))
     {
         pImage->cbImage += pImage->cbTotalBlockData;
-        pImage->paBlocks[pBlockAlloc->uBlock] = pBlockAlloc->cBlocksAllocated;
+        vdiBlockPtrSet(pImage, pBlockAlloc->uBlock, pBlockAlloc->cBlocksAllocated);
 
         if (pImage->paBlocksRev)
             pImage->paBlocksRev[pBlockAlloc->cBlocksAllocated] = pBlockAlloc->uBlock;
 
         setImageBlocksAllocated(&pImage->Header, pBlockAlloc->cBlocksAllocated + 1);
-        rc = vdiUpdateBlockInfoAsync(pImage, pBlockAlloc->uBlock, pIoCtx,
-                                     true /* fUpdateHdr */);
+
+        /* With batching the block array and header are written on the next flush. */
+        if (pImage->pbmBlocksDirty)
+            ASMBitSet(pImage->pbmBlocksDirty, pBlockAlloc->uBlock / VDI_BLOCKS_CHUNK_ENTRIES);
+        else
+            rc = vdiUpdateBlockInfoAsync(pImage, pBlockAlloc->uBlock, pIoCtx,
+                                         true /* fUpdateHdr */);
     }
     /* else: I/O error don't update the block table. */
 
@@ -1555,34 +1704,49 @@ static DECLCALLBACK(int) vdiRead(void *pBackendData, uint64_t uOffset, size_t cb
     uBlock = (unsigned)(uOffset >> pImage->uShiftOffset2Index);
     offRead = (unsigned)uOffset & pImage->uBlockMask;
 
-    /* Clip read range to at most the rest of the block. */
-    cbToRead = RT_MIN(cbToRead, getImageBlockSize(&pImage->Header) - offRead);
-    Assert(!(cbToRead % 512));
-
     if (pImage->paBlocks[uBlock] == VDI_IMAGE_BLOCK_FREE)
-        rc = VERR_VD_BLOCK_FREE;
-    else if (pImage->paBlocks[uBlock] == VDI_IMAGE_BLOCK_ZERO)
     {
-        size_t cbSet;
-
-        cbSet = vdIfIoIntIoCtxSet(pImage->pIfIo, pIoCtx, 0, cbToRead);
-        Assert(cbSet == cbToRead);
+        /*
+         * Report the whole range of consecutive free blocks at once, saves
+         * a lot of calls when copying or reading through sparse images.
+         */
+        unsigned cBlocks = getImageBlocks(&pImage->Header);
+        int iBlockPresent = ASMBitNextSet(pImage->pbmBlocksPresent, RT_ALIGN_32(cBlocks, 32), uBlock);
+        if (iBlockPresent != -1)
+            cbToRead = (size_t)RT_MIN((uint64_t)cbToRead,
+                                      ((uint64_t)iBlockPresent << pImage->uShiftOffset2Index) - uOffset);
+        Assert(!(cbToRead % 512));
+        rc = VERR_VD_BLOCK_FREE;
     }
     else
     {
-        /* Block present in image file, read relevant data. */
-        uint64_t u64Offset = (uint64_t)pImage->paBlocks[uBlock] * pImage->cbTotalBlockData
-                           + (pImage->offStartData + pImage->offStartBlockData + offRead);
+        /* Clip read range to at most the rest of the block. */
+        cbToRead = RT_MIN(cbToRead, getImageBlockSize(&pImage->Header) - offRead);
+        Assert(!(cbToRead % 512));
+
+        if (pImage->paBlocks[uBlock] == VDI_IMAGE_BLOCK_ZERO)
+        {
+            size_t cbSet;
 
-        if (u64Offset + cbToRead <= pImage->cbImage)
-            rc = vdIfIoIntFileReadUser(pImage->pIfIo, pImage->pStorage, u64Offset,
-                                       pIoCtx, cbToRead);
+            cbSet = vdIfIoIntIoCtxSet(pImage->pIfIo, pIoCtx, 0, cbToRead);
+            Assert(cbSet == cbToRead);
+        }
         else
         {
-            LogRel(("VDI: Out of range access (%llu) in image %s, image size %llu\n",
-                    u64Offset, pImage->pszFilename, pImage->cbImage));
-            vdIfIoIntIoCtxSet(pImage->pIfIo, pIoCtx, 0, cbToRead);
-            rc = VERR_VD_READ_OUT_OF_RANGE;
+            /* Block present in image file, read relevant data. */
+            uint64_t u64Offset = (uint64_t)pImage->paBlocks[uBlock] * pImage->cbTotalBlockData
+                               + (pImage->offStartData + pImage->offStartBlockData + offRead);
+
+            if (u64Offset + cbToRead <= pImage->cbImage)
+                rc = vdIfIoIntFileReadUser(pImage->pIfIo, pImage->pStorage, u64Offset,
+                                           pIoCtx, cbToRead);
+            else
+            {
+                LogRel(("VDI: Out of range access (%llu) in image %s, image size %llu\n",
+                        u64Offset, pImage->pszFilename, pImage->cbImage));
+                vdIfIoIntIoCtxSet(pImage->pIfIo, pIoCtx, 0, cbToRead);
+                rc = VERR_VD_READ_OUT_OF_RANGE;
+            }
         }
     }
 
@@ -1638,7 +1802,7 @@ static DECLCALLBACK(int) vdiWrite(void *pBackendData, uint64_t uOffset, size_t c
                      * anything to this block  if the data consists of just zeroes. */
                     if (vdIfIoIntIoCtxIsZero(pImage->pIfIo, pIoCtx, cbToWrite, true))
                     {
-                        pImage->paBlocks[uBlock] = VDI_IMAGE_BLOCK_ZERO;
+                        vdiBlockPtrSet(pImage, uBlock, VDI_IMAGE_BLOCK_ZERO);
                         *pcbPreRead = 0;
                         *pcbPostRead = 0;
                         break;
@@ -2301,8 +2465,13 @@ static DECLCALLBACK(int) vdiCompact(void *pBackendData, unsigned uPercentStart,
         for (unsigned i = 0; i < cBlocksAllocated; i++)
             paBlocks2[i] = VDI_IMAGE_BLOCK_FREE;
         rc = VINF_SUCCESS;
-        for (unsigned i = 0; i < cBlocks; i++)
+        /* Only the blocks marked present in the bitmap can have data in the file. */
+        uint32_t const cBitsPresent = RT_ALIGN_32(cBlocks, 32);
+        for (int iBlock = ASMBitFirstSet(pImage->pbmBlocksPresent, cBitsPresent);
+             iBlock != -1;
+             iBlock = ASMBitNextSet(pImage->pbmBlocksPresent, cBitsPresent, iBlock))
         {
+            unsigned i = (unsigned)iBlock;
             VDIIMAGEBLOCKPOINTER ptrBlock = pImage->paBlocks[i];
             if (IS_VDI_IMAGE_BLOCK_ALLOCATED(ptrBlock))
             {
@@ -2314,7 +2483,7 @@ static DECLCALLBACK(int) vdiCompact(void *pBackendData, unsigned uPercentStart,
                     {
                         LogFunc(("Freed cross-linked block %u in file \"%s\"\n",
                                  i, pImage->pszFilename));
-                        pImage->paBlocks[i] = VDI_IMAGE_BLOCK_FREE;
+                        vdiBlockPtrSet(pImage, i, VDI_IMAGE_BLOCK_FREE);
                         rc = vdiUpdateBlockInfo(pImage, i);
                         if (RT_FAILURE(rc))
                             break;
@@ -2324,7 +2493,7 @@ static DECLCALLBACK(int) vdiCompact(void *pBackendData, unsigned uPercentStart,
                 {
                     LogFunc(("Freed out of bounds reference for block %u in file \"%s\"\n",
                              i, pImage->pszFilename));
-                    pImage->paBlocks[i] = VDI_IMAGE_BLOCK_FREE;
+                    vdiBlockPtrSet(pImage, i, VDI_IMAGE_BLOCK_FREE);
                     rc = vdiUpdateBlockInfo(pImage, i);
                     if (RT_FAILURE(rc))
                         break;
@@ -2337,8 +2506,11 @@ static DECLCALLBACK(int) vdiCompact(void *pBackendData, unsigned uPercentStart,
         /* Find redundant information and update the block pointers
          * accordingly, creating bubbles. Keep disk up to date, as this
          * enables cancelling. */
-        for (unsigned i = 0; i < cBlocks; i++)
+        for (int iBlock = ASMBitFirstSet(pImage->pbmBlocksPresent, cBitsPresent);
+             iBlock != -1;
+             iBlock = ASMBitNextSet(pImage->pbmBlocksPresent, cBitsPresent, iBlock))
         {
+            unsigned i = (unsigned)iBlock;
             VDIIMAGEBLOCKPOINTER ptrBlock = pImage->paBlocks[i];
             if (IS_VDI_IMAGE_BLOCK_ALLOCATED(ptrBlock))
             {
@@ -2351,7 +2523,7 @@ static DECLCALLBACK(int) vdiCompact(void *pBackendData, unsigned uPercentStart,
 
                 if (ASMBitFirstSet((volatile void *)pvTmp, (uint32_t)cbBlock * 8) == -1)
                 {
-                    pImage->paBlocks[i] = VDI_IMAGE_BLOCK_ZERO;
+                    vdiBlockPtrSet(pImage, i, VDI_IMAGE_BLOCK_ZERO);
                     rc = vdiUpdateBlockInfo(pImage, i);
                     if (RT_FAILURE(rc))
                         break;
@@ -2366,7 +2538,7 @@ static DECLCALLBACK(int) vdiCompact(void *pBackendData, unsigned uPercentStart,
                         break;
                     if (!memcmp(pvTmp, pvBuf, cbBlock))
                     {
-                        pImage->paBlocks[i] = VDI_IMAGE_BLOCK_FREE;
+                        vdiBlockPtrSet(pImage, i, VDI_IMAGE_BLOCK_FREE);
                         rc = vdiUpdateBlockInfo(pImage, i);
                         if (RT_FAILURE(rc))
                             break;
@@ -2389,7 +2561,7 @@ static DECLCALLBACK(int) vdiCompact(void *pBackendData, unsigned uPercentStart,
                     break;
                 if (!fUsed)
                 {
-                    pImage->paBlocks[i] = VDI_IMAGE_BLOCK_ZERO;
+                    vdiBlockPtrSet(pImage, i, VDI_IMAGE_BLOCK_ZERO);
                     rc = vdiUpdateBlockInfo(pImage, i);
                     if (RT_FAILURE(rc))
                         break;
@@ -2431,7 +2603,7 @@ static DECLCALLBACK(int) vdiCompact(void *pBackendData, unsigned uPercentStart,
                           + (pImage->offStartData + pImage->offStartBlockData);
                 rc = vdIfIoIntFileWriteSync(pImage->pIfIo, pImage->pStorage, u64Offset,
                                             pvTmp, cbBlock);
-                pImage->paBlocks[uBlockData] = i;
+                vdiBlockPtrSet(pImage, uBlockData, i);
                 setImageBlocksAllocated(&pImage->Header, cBlocksAllocated - cBlocksMoved);
                 rc = vdiUpdateBlockInfo(pImage, uBlockData);
                 if (RT_FAILURE(rc))
@@ -2643,15 +2815,39 @@ static DECLCALLBACK(int) vdiResize(void *pBackendData, uint64_t cbSize,
                 /* Mark the new blocks as unallocated. */
                 for (unsigned idxBlock = cBlocksOld; idxBlock < cBlocksNew; idxBlock++)
                     pImage->paBlocks[idxBlock] = VDI_IMAGE_BLOCK_FREE;
+
+                /* Grow the bitmaps, the whole block array is written below. */
+                size_t cbBitmapOld = vdiBitmapSize(cBlocksOld);
+                size_t cbBitmapNew = vdiBitmapSize(cBlocksNew);
+                void *pbmBlocksPresentNew = RTMemRealloc(pImage->pbmBlocksPresent, cbBitmapNew);
+                if (pbmBlocksPresentNew)
+                {
+                    pImage->pbmBlocksPresent = pbmBlocksPresentNew;
+                    if (cbBitmapNew > cbBitmapOld)
+                        memset((uint8_t *)pbmBlocksPresentNew + cbBitmapOld, 0, cbBitmapNew - cbBitmapOld);
+                }
+                else
+                    rc = VERR_NO_MEMORY;
+
+                if (pImage->pbmBlocksDirty)
+                {
+                    RTMemFree(pImage->pbmBlocksDirty);
+                    pImage->pbmBlocksDirty = RTMemAllocZ(vdiBitmapSize(cBlocksNew / VDI_BLOCKS_CHUNK_ENTRIES + 1));
+                    if (!pImage->pbmBlocksDirty)
+                        rc = VERR_NO_MEMORY;
+                }
             }
             else
                 rc = VERR_NO_MEMORY;
 
             /* Write the block array before updating the rest. */
-            vdiConvBlocksEndianess(VDIECONV_H2F, pImage->paBlocks, cBlocksNew);
-            rc = vdIfIoIntFileWriteSync(pImage->pIfIo, pImage->pStorage, pImage->offStartBlocks,
-                                        pImage->paBlocks, cbBlockspaceNew);
-            vdiConvBlocksEndianess(VDIECONV_F2H, pImage->paBlocks, cBlocksNew);
+            if (RT_SUCCESS(rc))
+            {
+                vdiConvBlocksEndianess(VDIECONV_H2F, pImage->paBlocks, cBlocksNew);
+                rc = vdIfIoIntFileWriteSync(pImage->pIfIo, pImage->pStorage, pImage->offStartBlocks,
+                                            pImage->paBlocks, cbBlockspaceNew);
+                vdiConvBlocksEndianess(VDIECONV_F2H, pImage->paBlocks, cBlocksNew);
+            }
 
             if (RT_SUCCESS(rc))
             {
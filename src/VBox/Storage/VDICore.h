@@ -264,6 +264,12 @@ typedef VDIIMAGEBLOCKPOINTER *PVDIIMAGEBLOCKPOINTER;
 #define VDI_IMAGE_BLOCK_UNALLOCATED   (VDI_IMAGE_BLOCK_ZERO)
 #define IS_VDI_IMAGE_BLOCK_ALLOCATED(bp)   (bp < VDI_IMAGE_BLOCK_UNALLOCATED)
 
+/**
+ * Number of block array entries written together when block array updates
+ * are batched (one 4KB chunk of the on-disk block array).
+ */
+#define VDI_BLOCKS_CHUNK_ENTRIES   (_4K / sizeof(VDIIMAGEBLOCKPOINTER))
+
 #define GET_MAJOR_HEADER_VERSION(ph) (VDI_GET_VERSION_MAJOR((ph)->uVersion))
 #define GET_MINOR_HEADER_VERSION(ph) (VDI_GET_VERSION_MINOR((ph)->uVersion))
 
@@ -535,6 +541,12 @@ typedef struct VDIIMAGEDESC
     PVDIIMAGEBLOCKPOINTER   paBlocks;
     /** Pointer to the block array for back resolving (used if discarding is enabled). */
     unsigned               *paBlocksRev;
+    /** Bitmap of blocks which are not VDI_IMAGE_BLOCK_FREE (allocated or zero),
+     * for quickly finding ranges which are not present in this image. */
+    void                   *pbmBlocksPresent;
+    /** Bitmap of block array chunks (VDI_BLOCKS_CHUNK_ENTRIES) which were changed
+     * but not written yet, NULL if block array updates are not batched. */
+    void                   *pbmBlocksDirty;
     /** fFlags copy from image header, for speed optimization. */
     unsigned                uImageFlags;
     /** Start offset of block array in image file, here for speed optimization. */
@@ -32,6 +32,10 @@
 #include <iprt/rand.h>
 #include <iprt/zip.h>
 #include <iprt/asm.h>
+#include <iprt/critsect.h>
+#include <iprt/mp.h>
+#include <iprt/semaphore.h>
+#include <iprt/thread.h>
 
 #include "VDBackends.h"
 
@@ -288,6 +292,9 @@ typedef struct VMDKEXTENT
     void        *pvCompGrain;
     /** Decompressed grain buffer for streamOptimized extents. */
     void        *pvGrain;
+    /** Worker pool (de)compressing grains for sequential streamOptimized
+     * access, NULL if disabled. */
+    struct VMDKZIPPOOL *pZipPool;
     /** Reference to the image in which this extent is used. Do not use this
      * on a regular basis to avoid passing pImage references to functions
      * explicitly. */
@@ -452,6 +459,78 @@ typedef struct VMDKCOMPRESSIO
 } VMDKCOMPRESSIO;
 
 
+/** Maximum number of worker threads (de)compressing streamOptimized grains. */
+#define VMDK_ZIP_THREADS_MAX        8
+/** Number of grains in flight per worker thread. */
+#define VMDK_ZIP_JOBS_PER_THREAD    2
+
+/**
+ * A single grain (de)compression job. The workers process jobs in any order,
+ * but they are always retired in submission order, which keeps the grains in
+ * the stream sorted by LBA.
+ */
+typedef struct VMDKZIPJOB
+{
+    /** LBA of the first sector of the grain. */
+    uint64_t            uLBA;
+    /** Sector in the image holding the grain marker (reading only). */
+    uint32_t            uSectorAbs;
+    /** Size of the marker and compressed data, padded to a full sector. */
+    uint32_t            cbMarkerData;
+    /** Status code of the job. */
+    int                 rc;
+    /** Set by the worker thread when the job was processed. */
+    volatile bool       fDone;
+    /** Uncompressed grain data. */
+    void               *pvGrain;
+    /** Compressed grain data, starting with the marker. */
+    void               *pvCompGrain;
+} VMDKZIPJOB, *PVMDKZIPJOB;
+
+/**
+ * Worker pool compressing the grains of a streamOptimized extent when writing
+ * or decompressing them when reading sequentially.
+ */
+typedef struct VMDKZIPPOOL
+{
+    /** Flag whether the jobs compress (write) or decompress (read) grains. */
+    bool                fCompress;
+    /** Set to tell the worker threads to terminate. */
+    volatile bool       fShutdown;
+    /** Size of an uncompressed grain in bytes. */
+    size_t              cbGrain;
+    /** Size of a compressed grain buffer in bytes. */
+    size_t              cbCompGrain;
+    /** Critical section protecting the job indexes shared with the workers. */
+    RTCRITSECT          CritSect;
+    /** Signalled when new jobs were submitted. */
+    RTSEMEVENT          hEvtWork;
+    /** Signalled whenever a worker completed a job. */
+    RTSEMEVENT          hEvtDone;
+    /** Index of the next job to submit (free running). */
+    uint32_t            iJobSubmit;
+    /** Index of the next job a worker picks up (free running). */
+    uint32_t            iJobTake;
+    /** Index of the oldest job not yet retired (free running). */
+    uint32_t            iJobRetire;
+    /** Next sector to scan for grain markers when reading ahead, 0 if the
+     * scan didn't start yet. */
+    uint32_t            uSectorAbsScan;
+    /** Status of the read ahead scan, no further scanning after a failure. */
+    int                 rcScan;
+    /** Set when the read ahead scan hit the end of stream marker. */
+    bool                fEOS;
+    /** Number of worker threads. */
+    uint32_t            cThreads;
+    /** The worker thread handles. */
+    RTTHREAD            ahThreads[VMDK_ZIP_THREADS_MAX];
+    /** Number of jobs in the ring. */
+    uint32_t            cJobs;
+    /** The job ring, variable size. */
+    VMDKZIPJOB          aJobs[1];
+} VMDKZIPPOOL, *PVMDKZIPPOOL;
+
+
 /** Tracks async grain allocation. */
 typedef struct VMDKGRAINALLOCASYNC
 {
@@ -677,6 +756,46 @@ static DECLCALLBACK(int) vmdkFileInflateHelper(void *pvUser, void *pvBuf, size_t
 }
 #endif
 
+/**
+ * Internal: inflate a compressed grain which is already in memory.
+ *
+ * Doesn't touch any extent or image state, so this can be called from the
+ * grain compression worker threads.
+ *
+ * @returns VBox status code.
+ * @param   pvCompGrain     The compressed grain, starting with the marker.
+ * @param   cbCompSize      Size of the compressed data following the marker.
+ * @param   pvBuf           Where to store the inflated data.
+ * @param   cbToRead        Expected size of the inflated data.
+ */
+static int vmdkGrainInflate(void *pvCompGrain, size_t cbCompSize, void *pvBuf, size_t cbToRead)
+{
+    int rc;
+    size_t cbActuallyRead;
+
+#ifdef VMDK_USE_BLOCK_DECOMP_API
+    rc = RTZipBlockDecompress(RTZIPTYPE_ZLIB, 0 /*fFlags*/,
+                              pvCompGrain, cbCompSize + RT_OFFSETOF(VMDKMARKER, uType), NULL,
+                              pvBuf, cbToRead, &cbActuallyRead);
+#else
+    PRTZIPDECOMP pZip = NULL;
+    VMDKCOMPRESSIO InflateState;
+    InflateState.pImage = NULL;
+    InflateState.iOffset = -1;
+    InflateState.cbCompGrain = cbCompSize + RT_OFFSETOF(VMDKMARKER, uType);
+    InflateState.pvCompGrain = pvCompGrain;
+
+    rc = RTZipDecompCreate(&pZip, &InflateState, vmdkFileInflateHelper);
+    if (RT_FAILURE(rc))
+        return rc;
+    rc = RTZipDecompress(pZip, pvBuf, cbToRead, &cbActuallyRead);
+    RTZipDecompDestroy(pZip);
+#endif /* !VMDK_USE_BLOCK_DECOMP_API */
+    if (RT_SUCCESS(rc) && cbActuallyRead != cbToRead)
+        rc = VERR_VD_VMDK_INVALID_FORMAT;
+    return rc;
+}
+
 /**
  * Internal: read from a file and inflate the compressed data,
  * distinguishing between async and normal operation
@@ -687,11 +806,8 @@ DECLINLINE(int) vmdkFileInflateSync(PVMDKIMAGE pImage, PVMDKEXTENT pExtent,
                                     uint64_t *puLBA, uint32_t *pcbMarkerData)
 {
     int rc;
-#ifndef VMDK_USE_BLOCK_DECOMP_API
-    PRTZIPDECOMP pZip = NULL;
-#endif
     VMDKMARKER *pMarker = (VMDKMARKER *)pExtent->pvCompGrain;
-    size_t cbCompSize, cbActuallyRead;
+    size_t cbCompSize;
 
     if (!pcvMarker)
     {
@@ -737,31 +853,9 @@ DECLINLINE(int) vmdkFileInflateSync(PVMDKIMAGE pImage, PVMDKEXTENT pExtent,
                                   + RT_OFFSETOF(VMDKMARKER, uType),
                                   512);
 
-#ifdef VMDK_USE_BLOCK_DECOMP_API
-    rc = RTZipBlockDecompress(RTZIPTYPE_ZLIB, 0 /*fFlags*/,
-                              pExtent->pvCompGrain, cbCompSize + RT_OFFSETOF(VMDKMARKER, uType), NULL,
-                              pvBuf, cbToRead, &cbActuallyRead);
-#else
-    VMDKCOMPRESSIO InflateState;
-    InflateState.pImage = pImage;
-    InflateState.iOffset = -1;
-    InflateState.cbCompGrain = cbCompSize + RT_OFFSETOF(VMDKMARKER, uType);
-    InflateState.pvCompGrain = pExtent->pvCompGrain;
-
-    rc = RTZipDecompCreate(&pZip, &InflateState, vmdkFileInflateHelper);
-    if (RT_FAILURE(rc))
-        return rc;
-    rc = RTZipDecompress(pZip, pvBuf, cbToRead, &cbActuallyRead);
-    RTZipDecompDestroy(pZip);
-#endif /* !VMDK_USE_BLOCK_DECOMP_API */
-    if (RT_FAILURE(rc))
-    {
-        if (rc == VERR_ZIP_CORRUPTED)
-            rc = vdIfError(pImage->pIfError, rc, RT_SRC_POS, N_("VMDK: Compressed image is corrupted '%s'"), pExtent->pszFullname);
-        return rc;
-    }
-    if (cbActuallyRead != cbToRead)
-        rc = VERR_VD_VMDK_INVALID_FORMAT;
+    rc = vmdkGrainInflate(pExtent->pvCompGrain, cbCompSize, pvBuf, cbToRead);
+    if (rc == VERR_ZIP_CORRUPTED)
+        rc = vdIfError(pImage->pIfError, rc, RT_SRC_POS, N_("VMDK: Compressed image is corrupted '%s'"), pExtent->pszFullname);
     return rc;
 }
 
@@ -787,22 +881,31 @@ static DECLCALLBACK(int) vmdkFileDeflateHelper(void *pvUser, const void *pvBuf,
 }
 
 /**
- * Internal: deflate the uncompressed data and write to a file,
- * distinguishing between async and normal operation
+ * Internal: deflate a grain into the given buffer and prepend the marker.
+ *
+ * Doesn't touch any extent or image state, so this can be called from the
+ * grain compression worker threads.
+ *
+ * @returns VBox status code.
+ * @param   pvCompGrain     Where to store the marker and compressed data.
+ * @param   cbCompGrain     Size of the compressed grain buffer.
+ * @param   pvBuf           The uncompressed grain data.
+ * @param   cbToWrite       Size of the uncompressed grain data.
+ * @param   uLBA            Sector the grain starts at, stored in the marker.
+ * @param   pcbMarkerData   Where to store the size of the marker and the
+ *                          compressed data, padded to a full sector.
  */
-DECLINLINE(int) vmdkFileDeflateSync(PVMDKIMAGE pImage, PVMDKEXTENT pExtent,
-                                    uint64_t uOffset, const void *pvBuf,
-                                    size_t cbToWrite, uint64_t uLBA,
-                                    uint32_t *pcbMarkerData)
+static int vmdkGrainDeflate(void *pvCompGrain, size_t cbCompGrain, const void *pvBuf,
+                            size_t cbToWrite, uint64_t uLBA, uint32_t *pcbMarkerData)
 {
     int rc;
     PRTZIPCOMP pZip = NULL;
     VMDKCOMPRESSIO DeflateState;
 
-    DeflateState.pImage = pImage;
+    DeflateState.pImage = NULL;
     DeflateState.iOffset = -1;
-    DeflateState.cbCompGrain = pExtent->cbCompGrain;
-    DeflateState.pvCompGrain = pExtent->pvCompGrain;
+    DeflateState.cbCompGrain = cbCompGrain;
+    DeflateState.pvCompGrain = pvCompGrain;
 
     rc = RTZipCompCreate(&pZip, &DeflateState, vmdkFileDeflateHelper,
                          RTZIPTYPE_ZLIB, RTZIPLEVEL_DEFAULT);
@@ -822,27 +925,257 @@ DECLINLINE(int) vmdkFileDeflateSync(PVMDKIMAGE pImage, PVMDKEXTENT pExtent,
         if (uSize % 512)
         {
             uint32_t uSizeAlign = RT_ALIGN(uSize, 512);
-            memset((uint8_t *)pExtent->pvCompGrain + uSize, '\0',
+            memset((uint8_t *)pvCompGrain + uSize, '\0',
                    uSizeAlign - uSize);
             uSize = uSizeAlign;
         }
 
-        if (pcbMarkerData)
-            *pcbMarkerData = uSize;
+        *pcbMarkerData = uSize;
 
         /* Compressed grain marker. Data follows immediately. */
-        VMDKMARKER *pMarker = (VMDKMARKER *)pExtent->pvCompGrain;
+        VMDKMARKER *pMarker = (VMDKMARKER *)pvCompGrain;
         pMarker->uSector = RT_H2LE_U64(uLBA);
         pMarker->cbSize = RT_H2LE_U32(  DeflateState.iOffset
                                       - RT_OFFSETOF(VMDKMARKER, uType));
+    }
+    return rc;
+}
+
+/**
+ * Internal: deflate the uncompressed data and write to a file,
+ * distinguishing between async and normal operation
+ */
+DECLINLINE(int) vmdkFileDeflateSync(PVMDKIMAGE pImage, PVMDKEXTENT pExtent,
+                                    uint64_t uOffset, const void *pvBuf,
+                                    size_t cbToWrite, uint64_t uLBA,
+                                    uint32_t *pcbMarkerData)
+{
+    uint32_t cbMarkerData = 0;
+    int rc = vmdkGrainDeflate(pExtent->pvCompGrain, pExtent->cbCompGrain,
+                              pvBuf, cbToWrite, uLBA, &cbMarkerData);
+    if (RT_SUCCESS(rc))
+    {
+        if (pcbMarkerData)
+            *pcbMarkerData = cbMarkerData;
         rc = vdIfIoIntFileWriteSync(pImage->pIfIo, pExtent->pFile->pStorage,
-                                    uOffset, pMarker, uSize);
+                                    uOffset, pExtent->pvCompGrain, cbMarkerData);
+    }
+    return rc;
+}
+
+
+/**
+ * Internal: worker thread of the grain (de)compression pool.
+ */
+static DECLCALLBACK(int) vmdkZipPoolWorker(RTTHREAD hThreadSelf, void *pvUser)
+{
+    PVMDKZIPPOOL pPool = (PVMDKZIPPOOL)pvUser;
+    RT_NOREF1(hThreadSelf);
+
+    for (;;)
+    {
+        PVMDKZIPJOB pJob = NULL;
+        bool fMore = false;
+
+        RTCritSectEnter(&pPool->CritSect);
+        if (ASMAtomicReadBool(&pPool->fShutdown))
+        {
+            RTCritSectLeave(&pPool->CritSect);
+            /* Pass the wakeup on, the event doesn't count signals. */
+            RTSemEventSignal(pPool->hEvtWork);
+            break;
+        }
+        if (pPool->iJobTake != pPool->iJobSubmit)
+        {
+            pJob = &pPool->aJobs[pPool->iJobTake % pPool->cJobs];
+            pPool->iJobTake++;
+            fMore = pPool->iJobTake != pPool->iJobSubmit;
+        }
+        RTCritSectLeave(&pPool->CritSect);
+
+        if (!pJob)
+        {
+            RTSemEventWait(pPool->hEvtWork, RT_INDEFINITE_WAIT);
+            continue;
+        }
+
+        /* Wake up another worker if there is more to do. */
+        if (fMore)
+            RTSemEventSignal(pPool->hEvtWork);
+
+        if (pPool->fCompress)
+            pJob->rc = vmdkGrainDeflate(pJob->pvCompGrain, pPool->cbCompGrain,
+                                        pJob->pvGrain, pPool->cbGrain,
+                                        pJob->uLBA, &pJob->cbMarkerData);
+        else
+        {
+            PVMDKMARKER pMarker = (PVMDKMARKER)pJob->pvCompGrain;
+            pJob->rc = vmdkGrainInflate(pJob->pvCompGrain, RT_LE2H_U32(pMarker->cbSize),
+                                        pJob->pvGrain, pPool->cbGrain);
+        }
+        ASMAtomicWriteBool(&pJob->fDone, true);
+        RTSemEventSignal(pPool->hEvtDone);
+    }
+
+    return VINF_SUCCESS;
+}
+
+/**
+ * Internal: destroy the grain (de)compression pool of an extent, discarding
+ * all jobs which are not retired yet.
+ */
+static void vmdkZipPoolDestroy(PVMDKEXTENT pExtent)
+{
+    PVMDKZIPPOOL pPool = pExtent->pZipPool;
+
+    if (!pPool)
+        return;
+
+    ASMAtomicWriteBool(&pPool->fShutdown, true);
+    RTSemEventSignal(pPool->hEvtWork);
+    for (uint32_t i = 0; i < pPool->cThreads; i++)
+    {
+        int rc = RTThreadWait(pPool->ahThreads[i], RT_INDEFINITE_WAIT, NULL);
+        AssertRC(rc);
+    }
+
+    for (uint32_t i = 0; i < pPool->cJobs; i++)
+    {
+        RTMemFree(pPool->aJobs[i].pvGrain);
+        RTMemFree(pPool->aJobs[i].pvCompGrain);
+    }
+    if (pPool->hEvtDone != NIL_RTSEMEVENT)
+        RTSemEventDestroy(pPool->hEvtDone);
+    if (pPool->hEvtWork != NIL_RTSEMEVENT)
+        RTSemEventDestroy(pPool->hEvtWork);
+    if (RTCritSectIsInitialized(&pPool->CritSect))
+        RTCritSectDelete(&pPool->CritSect);
+    RTMemFree(pPool);
+    pExtent->pZipPool = NULL;
+}
+
+/**
+ * Internal: create the grain (de)compression pool of an extent.
+ *
+ * The number of worker threads defaults to the number of online CPUs and can
+ * be changed with the "ZipThreads" configuration key, 0 disables the pool.
+ *
+ * @returns VBox status code.
+ * @param   pImage      The image instance data.
+ * @param   pExtent     The extent to create the pool for.
+ * @param   fCompress   Whether the pool compresses (write) or decompresses
+ *                      (read) grains.
+ */
+static int vmdkZipPoolCreate(PVMDKIMAGE pImage, PVMDKEXTENT pExtent, bool fCompress)
+{
+    int rc = VINF_SUCCESS;
+    uint32_t cThreads = RT_MIN(RTMpGetOnlineCount(), VMDK_ZIP_THREADS_MAX);
+
+    PVDINTERFACECONFIG pIfCfg = VDIfConfigGet(pImage->pVDIfsImage);
+    if (pIfCfg)
+    {
+        rc = VDCFGQueryU32Def(pIfCfg, "ZipThreads", &cThreads, cThreads);
         if (RT_FAILURE(rc))
             return rc;
+        cThreads = RT_MIN(cThreads, VMDK_ZIP_THREADS_MAX);
     }
+    if (!cThreads)
+        return VINF_SUCCESS;
+
+    uint32_t cJobs = cThreads * VMDK_ZIP_JOBS_PER_THREAD;
+    PVMDKZIPPOOL pPool = (PVMDKZIPPOOL)RTMemAllocZ(RT_OFFSETOF(VMDKZIPPOOL, aJobs[cJobs]));
+    if (!pPool)
+        return VERR_NO_MEMORY;
+
+    pPool->fCompress   = fCompress;
+    pPool->cbGrain     = VMDK_SECTOR2BYTE(pExtent->cSectorsPerGrain);
+    pPool->cbCompGrain = pExtent->cbCompGrain;
+    pPool->hEvtWork    = NIL_RTSEMEVENT;
+    pPool->hEvtDone    = NIL_RTSEMEVENT;
+    pPool->cJobs       = cJobs;
+    pExtent->pZipPool  = pPool;
+
+    for (uint32_t i = 0; i < cJobs && RT_SUCCESS(rc); i++)
+    {
+        pPool->aJobs[i].pvGrain     = RTMemAlloc(pPool->cbGrain);
+        pPool->aJobs[i].pvCompGrain = RTMemAlloc(pPool->cbCompGrain);
+        if (   !pPool->aJobs[i].pvGrain
+            || !pPool->aJobs[i].pvCompGrain)
+            rc = VERR_NO_MEMORY;
+    }
+    if (RT_SUCCESS(rc))
+        rc = RTCritSectInit(&pPool->CritSect);
+    if (RT_SUCCESS(rc))
+        rc = RTSemEventCreate(&pPool->hEvtWork);
+    if (RT_SUCCESS(rc))
+        rc = RTSemEventCreate(&pPool->hEvtDone);
+    for (uint32_t i = 0; i < cThreads && RT_SUCCESS(rc); i++)
+    {
+        rc = RTThreadCreateF(&pPool->ahThreads[i], vmdkZipPoolWorker, pPool, 0,
+                             RTTHREADTYPE_IO, RTTHREADFLAGS_WAITABLE, "VMDKZip%u", i);
+        if (RT_SUCCESS(rc))
+            pPool->cThreads++;
+    }
+
+    if (RT_FAILURE(rc))
+        vmdkZipPoolDestroy(pExtent);
+    else
+        LogRel(("VMDK: Using %u threads for grain %s in '%s'\n", cThreads,
+                fCompress ? "compression" : "decompression", pExtent->pszFullname));
     return rc;
 }
 
+/**
+ * Internal: return the next free job of the pool, NULL if all are in flight.
+ */
+DECLINLINE(PVMDKZIPJOB) vmdkZipPoolJobGetFree(PVMDKZIPPOOL pPool)
+{
+    if (pPool->iJobSubmit - pPool->iJobRetire >= pPool->cJobs)
+        return NULL;
+    return &pPool->aJobs[pPool->iJobSubmit % pPool->cJobs];
+}
+
+/**
+ * Internal: return the oldest job of the pool which is not retired yet, NULL
+ * if there is none.
+ */
+DECLINLINE(PVMDKZIPJOB) vmdkZipPoolJobGetOldest(PVMDKZIPPOOL pPool)
+{
+    if (pPool->iJobRetire == pPool->iJobSubmit)
+        return NULL;
+    return &pPool->aJobs[pPool->iJobRetire % pPool->cJobs];
+}
+
+/**
+ * Internal: hand the job returned by vmdkZipPoolJobGetFree to the workers.
+ */
+static void vmdkZipPoolJobSubmit(PVMDKZIPPOOL pPool, PVMDKZIPJOB pJob)
+{
+    Assert(pJob == vmdkZipPoolJobGetFree(pPool));
+    pJob->rc = VINF_SUCCESS;
+    ASMAtomicWriteBool(&pJob->fDone, false);
+
+    RTCritSectEnter(&pPool->CritSect);
+    pPool->iJobSubmit++;
+    RTCritSectLeave(&pPool->CritSect);
+    RTSemEventSignal(pPool->hEvtWork);
+}
+
+/**
+ * Internal: wait for the given job to complete and retire it. The job buffers
+ * stay valid until the next job is submitted.
+ *
+ * @returns Status code of the job.
+ */
+static int vmdkZipPoolJobRetire(PVMDKZIPPOOL pPool, PVMDKZIPJOB pJob)
+{
+    Assert(pJob == vmdkZipPoolJobGetOldest(pPool));
+    while (!ASMAtomicReadBool(&pJob->fDone))
+        RTSemEventWait(pPool->hEvtDone, RT_INDEFINITE_WAIT);
+    pPool->iJobRetire++;
+    return pJob->rc;
+}
+
 
 /**
  * Internal: check if all files are closed, prevent leaking resources.
@@ -1002,6 +1335,13 @@ static int vmdkAllocStreamBuffers(PVMDKIMAGE pImage, PVMDKEXTENT pExtent)
         }
         else
             rc = VERR_NO_MEMORY;
+
+        /* Sequential access (import/export) spreads the (de)compression of the
+         * grains over a few worker threads. */
+        if (   RT_SUCCESS(rc)
+            && (pImage->uOpenFlags & VD_OPEN_FLAGS_SEQUENTIAL))
+            rc = vmdkZipPoolCreate(pImage, pExtent,
+                                   !(pImage->uOpenFlags & VD_OPEN_FLAGS_READONLY));
     }
 
     if (RT_FAILURE(rc))
@@ -2854,6 +3194,7 @@ static int vmdkWriteMetaSparseExtent(PVMDKIMAGE pImage, PVMDKEXTENT pExtent,
  */
 static void vmdkFreeStreamBuffers(PVMDKEXTENT pExtent)
 {
+    vmdkZipPoolDestroy(pExtent);
     if (pExtent->pvCompGrain)
     {
         RTMemFree(pExtent->pvCompGrain);
@@ -4091,6 +4432,70 @@ static void vmdkStreamClearGT(PVMDKIMAGE pImage, PVMDKEXTENT pExtent)
                VMDK_GT_CACHELINE_SIZE * sizeof(uint32_t));
 }
 
+/**
+ * Internal. Waits for a compressed grain from the worker pool, writes it at
+ * the append position and enters it into the grain table buffer.
+ */
+static int vmdkStreamRetireGrain(PVMDKIMAGE pImage, PVMDKEXTENT pExtent,
+                                 PVMDKZIPJOB pJob)
+{
+    int rc = vmdkZipPoolJobRetire(pExtent->pZipPool, pJob);
+    if (RT_SUCCESS(rc))
+    {
+        uint32_t uGrain = pJob->uLBA / pExtent->cSectorsPerGrain;
+        uint32_t uCacheLine = uGrain % pExtent->cGTEntries / VMDK_GT_CACHELINE_SIZE;
+        uint32_t uCacheEntry = uGrain % VMDK_GT_CACHELINE_SIZE;
+
+        uint64_t uFileOffset = pExtent->uAppendPosition;
+        if (!uFileOffset)
+            return VERR_INTERNAL_ERROR;
+        /* Align to sector, as the previous write could have been any size. */
+        uFileOffset = RT_ALIGN_64(uFileOffset, 512);
+
+        /* Paranoia check: grain table entry must be clear. */
+        if (pImage->pGTCache->aGTCache[uCacheLine].aGTData[uCacheEntry])
+            return VERR_INTERNAL_ERROR;
+
+        /* Update grain table entry. */
+        pImage->pGTCache->aGTCache[uCacheLine].aGTData[uCacheEntry] = VMDK_BYTE2SECTOR(uFileOffset);
+
+        rc = vdIfIoIntFileWriteSync(pImage->pIfIo, pExtent->pFile->pStorage, uFileOffset,
+                                    pJob->pvCompGrain, pJob->cbMarkerData);
+        if (RT_SUCCESS(rc))
+        {
+            pExtent->uAppendPosition += pJob->cbMarkerData;
+            return rc;
+        }
+    }
+
+    pExtent->uGrainSectorAbs = 0;
+    AssertRC(rc);
+    return vdIfError(pImage->pIfError, rc, RT_SRC_POS, N_("VMDK: cannot write compressed data block in '%s'"), pExtent->pszFullname);
+}
+
+/**
+ * Internal. Writes out all grains still pending in the worker pool, in
+ * submission order. After a failure the remaining grains are discarded.
+ */
+static int vmdkStreamDrainGrains(PVMDKIMAGE pImage, PVMDKEXTENT pExtent)
+{
+    int rc = VINF_SUCCESS;
+    PVMDKZIPPOOL pPool = pExtent->pZipPool;
+    PVMDKZIPJOB pJob;
+
+    if (!pPool)
+        return VINF_SUCCESS;
+
+    while ((pJob = vmdkZipPoolJobGetOldest(pPool)) != NULL)
+    {
+        if (RT_SUCCESS(rc))
+            rc = vmdkStreamRetireGrain(pImage, pExtent, pJob);
+        else
+            vmdkZipPoolJobRetire(pPool, pJob);
+    }
+    return rc;
+}
+
 /**
  * Internal. Flush the grain table buffer for real stream optimized writing.
  */
@@ -4100,6 +4505,11 @@ static int vmdkStreamFlushGT(PVMDKIMAGE pImage, PVMDKEXTENT pExtent,
     int rc = VINF_SUCCESS;
     uint32_t cCacheLines = RT_ALIGN(pExtent->cGTEntries, VMDK_GT_CACHELINE_SIZE) / VMDK_GT_CACHELINE_SIZE;
 
+    /* The grains still being compressed belong to this grain table. */
+    rc = vmdkStreamDrainGrains(pImage, pExtent);
+    if (RT_FAILURE(rc))
+        return rc;
+
     /* VMware does not write out completely empty grain tables in the case
      * of streamOptimized images, which according to my interpretation of
      * the VMDK 1.1 spec is bending the rules. Since they do it and we can
@@ -4562,6 +4972,38 @@ static int vmdkStreamAllocGrain(PVMDKIMAGE pImage, PVMDKEXTENT pExtent,
         }
     }
 
+    PVMDKZIPPOOL pPool = pExtent->pZipPool;
+    if (pPool)
+    {
+        /* Paranoia check: extent type, grain table buffer presence and
+         * grain table buffer space. The grain table entry is checked when
+         * the compressed grain is written. */
+        if (   !pExtent->uAppendPosition
+            || pExtent->enmType != VMDKETYPE_HOSTED_SPARSE
+            || !pImage->pGTCache
+            || pExtent->cGTEntries > VMDK_GT_CACHE_SIZE * VMDK_GT_CACHELINE_SIZE)
+            return VERR_INTERNAL_ERROR;
+
+        PVMDKZIPJOB pJob = vmdkZipPoolJobGetFree(pPool);
+        if (!pJob)
+        {
+            /* All jobs are in flight, write out the oldest grain first. */
+            rc = vmdkStreamRetireGrain(pImage, pExtent, vmdkZipPoolJobGetOldest(pPool));
+            if (RT_FAILURE(rc))
+                return rc;
+            pJob = vmdkZipPoolJobGetFree(pPool);
+        }
+
+        vdIfIoIntIoCtxCopyFrom(pImage->pIfIo, pIoCtx, pJob->pvGrain, cbWrite);
+        if (cbWrite != VMDK_SECTOR2BYTE(pExtent->cSectorsPerGrain))
+            memset((char *)pJob->pvGrain + cbWrite, '\0',
+                   VMDK_SECTOR2BYTE(pExtent->cSectorsPerGrain) - cbWrite);
+        pJob->uLBA = uSector;
+        vmdkZipPoolJobSubmit(pPool, pJob);
+        pExtent->uLastGrainAccess = uGrain;
+        return VINF_SUCCESS;
+    }
+
     uint64_t uFileOffset;
     uFileOffset = pExtent->uAppendPosition;
     if (!uFileOffset)
@@ -4957,6 +5399,292 @@ static int vmdkAllocGrain(PVMDKIMAGE pImage, PVMDKEXTENT pExtent, PVDIOCTX pIoCt
     return rc;
 }
 
+/**
+ * Internal. Scans the stream for the next compressed grain at or after the
+ * given sector and decompresses it into the grain buffer of the extent.
+ */
+static int vmdkStreamReadNextGrain(PVMDKIMAGE pImage, PVMDKEXTENT pExtent,
+                                   uint64_t uSector)
+{
+    int rc;
+    uint32_t uGrainSectorAbs =   pExtent->uGrainSectorAbs
+                               + VMDK_BYTE2SECTOR(pExtent->cbGrainStreamRead);
+
+    /* Get the marker from the next data block - and skip everything which
+     * is not a compressed grain. If it's a compressed grain which is for
+     * the requested sector (or after), read it. */
+    VMDKMARKER Marker;
+    do
+    {
+        RT_ZERO(Marker);
+        rc = vdIfIoIntFileReadSync(pImage->pIfIo, pExtent->pFile->pStorage,
+                                   VMDK_SECTOR2BYTE(uGrainSectorAbs),
+                                   &Marker, RT_OFFSETOF(VMDKMARKER, uType));
+        if (RT_FAILURE(rc))
+            return rc;
+        Marker.uSector = RT_LE2H_U64(Marker.uSector);
+        Marker.cbSize = RT_LE2H_U32(Marker.cbSize);
+
+        if (Marker.cbSize == 0)
+        {
+            /* A marker for something else than a compressed grain. */
+            rc = vdIfIoIntFileReadSync(pImage->pIfIo, pExtent->pFile->pStorage,
+                                         VMDK_SECTOR2BYTE(uGrainSectorAbs)
+                                       + RT_OFFSETOF(VMDKMARKER, uType),
+                                       &Marker.uType, sizeof(Marker.uType));
+            if (RT_FAILURE(rc))
+                return rc;
+            Marker.uType = RT_LE2H_U32(Marker.uType);
+            switch (Marker.uType)
+            {
+                case VMDK_MARKER_EOS:
+                    uGrainSectorAbs++;
+                    /* Read (or mostly skip) to the end of file. Uses the
+                     * Marker (LBA sector) as it is unused anyway. This
+                     * makes sure that really everything is read in the
+                     * success case. If this read fails it means the image
+                     * is truncated, but this is harmless so ignore. */
+                    vdIfIoIntFileReadSync(pImage->pIfIo, pExtent->pFile->pStorage,
+                                            VMDK_SECTOR2BYTE(uGrainSectorAbs)
+                                          + 511,
+                                          &Marker.uSector, 1);
+                    break;
+                case VMDK_MARKER_GT:
+                    uGrainSectorAbs += 1 + VMDK_BYTE2SECTOR(pExtent->cGTEntries * sizeof(uint32_t));
+                    break;
+                case VMDK_MARKER_GD:
+                    uGrainSectorAbs += 1 + VMDK_BYTE2SECTOR(RT_ALIGN(pExtent->cGDEntries * sizeof(uint32_t), 512));
+                    break;
+                case VMDK_MARKER_FOOTER:
+                    uGrainSectorAbs += 2;
+                    break;
+                case VMDK_MARKER_UNSPECIFIED:
+                    /* Skip over the contents of the unspecified marker
+                     * type 4 which exists in some vSphere created files. */
+                    /** @todo figure out what the payload means. */
+                    uGrainSectorAbs += 1;
+                    break;
+                default:
+                    AssertMsgFailed(("VMDK: corrupted marker, type=%#x\n", Marker.uType));
+                    pExtent->uGrainSectorAbs = 0;
+                    return VERR_VD_VMDK_INVALID_STATE;
+            }
+            pExtent->cbGrainStreamRead = 0;
+        }
+        else
+        {
+            /* A compressed grain marker. If it is at/after what we're
+             * interested in read and decompress data. */
+            if (uSector > Marker.uSector + pExtent->cSectorsPerGrain)
+            {
+                uGrainSectorAbs += VMDK_BYTE2SECTOR(RT_ALIGN(Marker.cbSize + RT_OFFSETOF(VMDKMARKER, uType), 512));
+                continue;
+            }
+            uint64_t uLBA = 0;
+            uint32_t cbGrainStreamRead = 0;
+            rc = vmdkFileInflateSync(pImage, pExtent,
+                                     VMDK_SECTOR2BYTE(uGrainSectorAbs),
+                                     pExtent->pvGrain,
+                                     VMDK_SECTOR2BYTE(pExtent->cSectorsPerGrain),
+                                     &Marker, &uLBA, &cbGrainStreamRead);
+            if (RT_FAILURE(rc))
+            {
+                pExtent->uGrainSectorAbs = 0;
+                return rc;
+            }
+            if (   pExtent->uGrain
+                && uLBA / pExtent->cSectorsPerGrain <= pExtent->uGrain)
+            {
+                pExtent->uGrainSectorAbs = 0;
+                return VERR_VD_VMDK_INVALID_STATE;
+            }
+            pExtent->uGrain = uLBA / pExtent->cSectorsPerGrain;
+            pExtent->cbGrainStreamRead = cbGrainStreamRead;
+            break;
+        }
+    } while (Marker.uType != VMDK_MARKER_EOS);
+
+    pExtent->uGrainSectorAbs = uGrainSectorAbs;
+
+    if (!pExtent->cbGrainStreamRead && Marker.uType == VMDK_MARKER_EOS)
+    {
+        pExtent->uGrain = UINT32_MAX;
+        /* Must set a non-zero value for pExtent->cbGrainStreamRead or
+         * the next read would try to get more data, and we're at EOF. */
+        pExtent->cbGrainStreamRead = 1;
+    }
+
+    return VINF_SUCCESS;
+}
+
+/**
+ * Internal. Scans the stream ahead for compressed grains and hands them to
+ * the worker pool for decompression, until all jobs are in flight, the end
+ * of the stream is reached or something went wrong.
+ */
+static void vmdkStreamReadAheadFill(PVMDKIMAGE pImage, PVMDKEXTENT pExtent)
+{
+    int rc = VINF_SUCCESS;
+    PVMDKZIPPOOL pPool = pExtent->pZipPool;
+    PVMDKZIPJOB pJob;
+
+    if (!pPool->uSectorAbsScan)
+        pPool->uSectorAbsScan =   pExtent->uGrainSectorAbs
+                                + VMDK_BYTE2SECTOR(pExtent->cbGrainStreamRead);
+    uint32_t uGrainSectorAbs = pPool->uSectorAbsScan;
+
+    while (   !pPool->fEOS
+           && RT_SUCCESS(rc)
+           && RT_SUCCESS(pPool->rcScan)
+           && (pJob = vmdkZipPoolJobGetFree(pPool)) != NULL)
+    {
+        PVMDKMARKER pMarker = (PVMDKMARKER)pJob->pvCompGrain;
+        rc = vdIfIoIntFileReadSync(pImage->pIfIo, pExtent->pFile->pStorage,
+                                   VMDK_SECTOR2BYTE(uGrainSectorAbs),
+                                   pMarker, RT_OFFSETOF(VMDKMARKER, uType));
+        if (RT_FAILURE(rc))
+            break;
+
+        uint32_t cbCompSize = RT_LE2H_U32(pMarker->cbSize);
+        if (!cbCompSize)
+        {
+            /* A marker for something else than a compressed grain. */
+            uint32_t uType = 0;
+            rc = vdIfIoIntFileReadSync(pImage->pIfIo, pExtent->pFile->pStorage,
+                                         VMDK_SECTOR2BYTE(uGrainSectorAbs)
+                                       + RT_OFFSETOF(VMDKMARKER, uType),
+                                       &uType, sizeof(uType));
+            if (RT_FAILURE(rc))
+                break;
+            uType = RT_LE2H_U32(uType);
+            switch (uType)
+            {
+                case VMDK_MARKER_EOS:
+                    uGrainSectorAbs++;
+                    /* Read (or mostly skip) to the end of file, see
+                     * vmdkStreamReadNextGrain. */
+                    vdIfIoIntFileReadSync(pImage->pIfIo, pExtent->pFile->pStorage,
+                                            VMDK_SECTOR2BYTE(uGrainSectorAbs)
+                                          + 511,
+                                          &uType, 1);
+                    pPool->fEOS = true;
+                    break;
+                case VMDK_MARKER_GT:
+                    uGrainSectorAbs += 1 + VMDK_BYTE2SECTOR(pExtent->cGTEntries * sizeof(uint32_t));
+                    break;
+                case VMDK_MARKER_GD:
+                    uGrainSectorAbs += 1 + VMDK_BYTE2SECTOR(RT_ALIGN(pExtent->cGDEntries * sizeof(uint32_t), 512));
+                    break;
+                case VMDK_MARKER_FOOTER:
+                    uGrainSectorAbs += 2;
+                    break;
+                case VMDK_MARKER_UNSPECIFIED:
+                    uGrainSectorAbs += 1;
+                    break;
+                default:
+                    AssertMsgFailed(("VMDK: corrupted marker, type=%#x\n", uType));
+                    rc = VERR_VD_VMDK_INVALID_STATE;
+                    break;
+            }
+        }
+        else
+        {
+            /* A compressed grain marker. Read the data and queue it, the
+             * decompression happens on the worker threads. */
+            uint32_t cbMarkerData = RT_ALIGN_32(cbCompSize + RT_OFFSETOF(VMDKMARKER, uType), 512);
+            if (   cbCompSize >= 2 * pPool->cbGrain
+                || cbMarkerData > pPool->cbCompGrain)
+            {
+                rc = VERR_VD_VMDK_INVALID_FORMAT;
+                break;
+            }
+            rc = vdIfIoIntFileReadSync(pImage->pIfIo, pExtent->pFile->pStorage,
+                                         VMDK_SECTOR2BYTE(uGrainSectorAbs)
+                                       + RT_OFFSETOF(VMDKMARKER, uType),
+                                       (uint8_t *)pJob->pvCompGrain + RT_OFFSETOF(VMDKMARKER, uType),
+                                       cbMarkerData - RT_OFFSETOF(VMDKMARKER, uType));
+            if (RT_FAILURE(rc))
+                break;
+
+            pJob->uLBA         = RT_LE2H_U64(pMarker->uSector);
+            pJob->uSectorAbs   = uGrainSectorAbs;
+            pJob->cbMarkerData = cbMarkerData;
+            vmdkZipPoolJobSubmit(pPool, pJob);
+            uGrainSectorAbs += VMDK_BYTE2SECTOR(cbMarkerData);
+        }
+    }
+
+    pPool->uSectorAbsScan = uGrainSectorAbs;
+    if (RT_FAILURE(rc))
+        pPool->rcScan = rc;
+}
+
+/**
+ * Internal. Variant of vmdkStreamReadNextGrain which takes the grains
+ * decompressed ahead of time by the worker pool, in stream order.
+ */
+static int vmdkStreamReadAhead(PVMDKIMAGE pImage, PVMDKEXTENT pExtent,
+                               uint64_t uSector)
+{
+    PVMDKZIPPOOL pPool = pExtent->pZipPool;
+    PVMDKZIPJOB pJob;
+
+    for (;;)
+    {
+        vmdkStreamReadAheadFill(pImage, pExtent);
+
+        pJob = vmdkZipPoolJobGetOldest(pPool);
+        if (!pJob)
+            break;
+
+        /* The job stays untouched until the next fill. */
+        int rc = vmdkZipPoolJobRetire(pPool, pJob);
+        if (RT_FAILURE(rc))
+        {
+            pExtent->uGrainSectorAbs = 0;
+            if (rc == VERR_ZIP_CORRUPTED)
+                rc = vdIfError(pImage->pIfError, rc, RT_SRC_POS, N_("VMDK: Compressed image is corrupted '%s'"), pExtent->pszFullname);
+            return rc;
+        }
+
+        /* Skip grains before what we're interested in. */
+        if (uSector > pJob->uLBA + pExtent->cSectorsPerGrain)
+            continue;
+
+        if (   pExtent->uGrain
+            && pJob->uLBA / pExtent->cSectorsPerGrain <= pExtent->uGrain)
+        {
+            pExtent->uGrainSectorAbs = 0;
+            return VERR_VD_VMDK_INVALID_STATE;
+        }
+
+        /* Hand the decompressed grain to the extent by swapping buffers. */
+        void *pvGrain = pExtent->pvGrain;
+        pExtent->pvGrain = pJob->pvGrain;
+        pJob->pvGrain = pvGrain;
+
+        pExtent->uGrain = pJob->uLBA / pExtent->cSectorsPerGrain;
+        pExtent->uGrainSectorAbs = pJob->uSectorAbs;
+        pExtent->cbGrainStreamRead = pJob->cbMarkerData;
+        return VINF_SUCCESS;
+    }
+
+    /* All grains read ahead were consumed and scanning stopped. */
+    if (RT_FAILURE(pPool->rcScan))
+    {
+        pExtent->uGrainSectorAbs = 0;
+        return pPool->rcScan;
+    }
+
+    Assert(pPool->fEOS);
+    pExtent->uGrainSectorAbs = pPool->uSectorAbsScan;
+    pExtent->uGrain = UINT32_MAX;
+    /* Must set a non-zero value for pExtent->cbGrainStreamRead or
+     * the next read would try to get more data, and we're at EOF. */
+    pExtent->cbGrainStreamRead = 1;
+    return VINF_SUCCESS;
+}
+
 /**
  * Internal. Reads the contents by sequentially going over the compressed
  * grains (hoping that they are in sequence).
@@ -4989,112 +5717,12 @@ static int vmdkStreamReadSequential(PVMDKIMAGE pImage, PVMDKEXTENT pExtent,
      * in the buffer is good to fulfill the request. */
     if (!pExtent->cbGrainStreamRead || uGrain > pExtent->uGrain)
     {
-        uint32_t uGrainSectorAbs =   pExtent->uGrainSectorAbs
-                                   + VMDK_BYTE2SECTOR(pExtent->cbGrainStreamRead);
-
-        /* Get the marker from the next data block - and skip everything which
-         * is not a compressed grain. If it's a compressed grain which is for
-         * the requested sector (or after), read it. */
-        VMDKMARKER Marker;
-        do
-        {
-            RT_ZERO(Marker);
-            rc = vdIfIoIntFileReadSync(pImage->pIfIo, pExtent->pFile->pStorage,
-                                       VMDK_SECTOR2BYTE(uGrainSectorAbs),
-                                       &Marker, RT_OFFSETOF(VMDKMARKER, uType));
-            if (RT_FAILURE(rc))
-                return rc;
-            Marker.uSector = RT_LE2H_U64(Marker.uSector);
-            Marker.cbSize = RT_LE2H_U32(Marker.cbSize);
-
-            if (Marker.cbSize == 0)
-            {
-                /* A marker for something else than a compressed grain. */
-                rc = vdIfIoIntFileReadSync(pImage->pIfIo, pExtent->pFile->pStorage,
-                                             VMDK_SECTOR2BYTE(uGrainSectorAbs)
-                                           + RT_OFFSETOF(VMDKMARKER, uType),
-                                           &Marker.uType, sizeof(Marker.uType));
-                if (RT_FAILURE(rc))
-                    return rc;
-                Marker.uType = RT_LE2H_U32(Marker.uType);
-                switch (Marker.uType)
-                {
-                    case VMDK_MARKER_EOS:
-                        uGrainSectorAbs++;
-                        /* Read (or mostly skip) to the end of file. Uses the
-                         * Marker (LBA sector) as it is unused anyway. This
-                         * makes sure that really everything is read in the
-                         * success case. If this read fails it means the image
-                         * is truncated, but this is harmless so ignore. */
-                        vdIfIoIntFileReadSync(pImage->pIfIo, pExtent->pFile->pStorage,
-                                                VMDK_SECTOR2BYTE(uGrainSectorAbs)
-                                              + 511,
-                                              &Marker.uSector, 1);
-                        break;
-                    case VMDK_MARKER_GT:
-                        uGrainSectorAbs += 1 + VMDK_BYTE2SECTOR(pExtent->cGTEntries * sizeof(uint32_t));
-                        break;
-                    case VMDK_MARKER_GD:
-                        uGrainSectorAbs += 1 + VMDK_BYTE2SECTOR(RT_ALIGN(pExtent->cGDEntries * sizeof(uint32_t), 512));
-                        break;
-                    case VMDK_MARKER_FOOTER:
-                        uGrainSectorAbs += 2;
-                        break;
-                    case VMDK_MARKER_UNSPECIFIED:
-                        /* Skip over the contents of the unspecified marker
-                         * type 4 which exists in some vSphere created files. */
-                        /** @todo figure out what the payload means. */
-                        uGrainSectorAbs += 1;
-                        break;
-                    default:
-                        AssertMsgFailed(("VMDK: corrupted marker, type=%#x\n", Marker.uType));
-                        pExtent->uGrainSectorAbs = 0;
-                        return VERR_VD_VMDK_INVALID_STATE;
-                }
-                pExtent->cbGrainStreamRead = 0;
-            }
-            else
-            {
-                /* A compressed grain marker. If it is at/after what we're
-                 * interested in read and decompress data. */
-                if (uSector > Marker.uSector + pExtent->cSectorsPerGrain)
-                {
-                    uGrainSectorAbs += VMDK_BYTE2SECTOR(RT_ALIGN(Marker.cbSize + RT_OFFSETOF(VMDKMARKER, uType), 512));
-                    continue;
-                }
-                uint64_t uLBA = 0;
-                uint32_t cbGrainStreamRead = 0;
-                rc = vmdkFileInflateSync(pImage, pExtent,
-                                         VMDK_SECTOR2BYTE(uGrainSectorAbs),
-                                         pExtent->pvGrain,
-                                         VMDK_SECTOR2BYTE(pExtent->cSectorsPerGrain),
-                                         &Marker, &uLBA, &cbGrainStreamRead);
-                if (RT_FAILURE(rc))
-                {
-                    pExtent->uGrainSectorAbs = 0;
-                    return rc;
-                }
-                if (   pExtent->uGrain
-                    && uLBA / pExtent->cSectorsPerGrain <= pExtent->uGrain)
-                {
-                    pExtent->uGrainSectorAbs = 0;
-                    return VERR_VD_VMDK_INVALID_STATE;
-                }
-                pExtent->uGrain = uLBA / pExtent->cSectorsPerGrain;
-                pExtent->cbGrainStreamRead = cbGrainStreamRead;
-                break;
-            }
-        } while (Marker.uType != VMDK_MARKER_EOS);
-
-        pExtent->uGrainSectorAbs = uGrainSectorAbs;
-
-        if (!pExtent->cbGrainStreamRead && Marker.uType == VMDK_MARKER_EOS)
-        {
-            pExtent->uGrain = UINT32_MAX;
-            /* Must set a non-zero value for pExtent->cbGrainStreamRead or
-             * the next read would try to get more data, and we're at EOF. */
-            pExtent->cbGrainStreamRead = 1;
-        }
+        if (pExtent->pZipPool)
+            rc = vmdkStreamReadAhead(pImage, pExtent, uSector);
+        else
+            rc = vmdkStreamReadNextGrain(pImage, pExtent, uSector);
+        if (RT_FAILURE(rc))
+            return rc;
     }
 
     if (pExtent->uGrain > uSector / pExtent->cSectorsPerGrain)
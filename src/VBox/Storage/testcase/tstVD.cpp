@@ -700,6 +700,167 @@ static int tstVDCreateWriteOpenRead(const char *pszBackend,
     return 0;
 }
 
+static DECLCALLBACK(bool) tstVDBatchAreKeysValid(void *pvUser, const char *pszzValid)
+{
+    RT_NOREF2(pvUser, pszzValid);
+    return true;
+}
+
+static DECLCALLBACK(int) tstVDBatchQuerySize(void *pvUser, const char *pszName, size_t *pcbValue)
+{
+    RT_NOREF1(pvUser);
+    if (strcmp(pszName, "BatchBlockUpdates"))
+        return VERR_CFGM_VALUE_NOT_FOUND;
+    *pcbValue = sizeof("1");
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(int) tstVDBatchQuery(void *pvUser, const char *pszName, char *pszValue, size_t cchValue)
+{
+    RT_NOREF1(pvUser);
+    if (strcmp(pszName, "BatchBlockUpdates"))
+        return VERR_CFGM_VALUE_NOT_FOUND;
+    return RTStrCopy(pszValue, cchValue, "1");
+}
+
+/**
+ * Tests that the block array updates batched with the "BatchBlockUpdates"
+ * VDI option reach the image on flush, on close and when resizing.
+ */
+static int tstVDIBatchBlockUpdates(const char *pszFilename, uint32_t u32Seed)
+{
+    int rc;
+    PVBOXHDD pVD = NULL;
+    PVBOXHDD pVD2 = NULL;
+    VDGEOMETRY PCHS = { 0, 0, 0 };
+    VDGEOMETRY LCHS = { 0, 0, 0 };
+    uint64_t u64DiskSize = 200 * _1M;
+    uint64_t u64DiskSizeNew = 2100 * _1M;
+    uint32_t u32SectorSize = 512;
+    PVDINTERFACE      pVDIfs = NULL;
+    PVDINTERFACE      pVDIfsImage = NULL;
+    VDINTERFACEERROR  VDIfError;
+    VDINTERFACECONFIG VDIfConfig;
+
+#define CHECK(str) \
+    do \
+    { \
+        RTPrintf("%s rc=%Rrc\n", str, rc); \
+        if (RT_FAILURE(rc)) \
+        { \
+            if (pvBuf) \
+                RTMemFree(pvBuf); \
+            RTMemFree(paSegmentsA); \
+            RTMemFree(paSegmentsB); \
+            RTMemFree(paSegmentsAB); \
+            RTMemFree(paSegmentsC); \
+            if (pVD2) \
+                VDDestroy(pVD2); \
+            VDDestroy(pVD); \
+            return rc; \
+        } \
+    } while (0)
+
+    void *pvBuf = RTMemAlloc(_1M);
+
+    int nSegments = 100;
+    /* Allocate one extra element for a sentinel. */
+    PSEGMENT paSegmentsA  = (PSEGMENT)RTMemAllocZ(sizeof(struct Segment) * (nSegments + 1));
+    PSEGMENT paSegmentsB  = (PSEGMENT)RTMemAllocZ(sizeof(struct Segment) * (nSegments + 1));
+    PSEGMENT paSegmentsAB = (PSEGMENT)RTMemAllocZ(sizeof(struct Segment) * (nSegments + 1) * 3);
+    PSEGMENT paSegmentsC  = (PSEGMENT)RTMemAllocZ(sizeof(struct Segment) * (nSegments + 1));
+
+    /* Create error interface. */
+    VDIfError.pfnError = tstVDError;
+    VDIfError.pfnMessage = tstVDMessage;
+
+    rc = VDInterfaceAdd(&VDIfError.Core, "tstVD_Error", VDINTERFACETYPE_ERROR,
+                        NULL, sizeof(VDINTERFACEERROR), &pVDIfs);
+    AssertRC(rc);
+
+    /* Create the config interface enabling batched block array updates. */
+    VDIfConfig.pfnAreKeysValid = tstVDBatchAreKeysValid;
+    VDIfConfig.pfnQuerySize    = tstVDBatchQuerySize;
+    VDIfConfig.pfnQuery        = tstVDBatchQuery;
+
+    rc = VDInterfaceAdd(&VDIfConfig.Core, "tstVD_Config", VDINTERFACETYPE_CONFIG,
+                        NULL, sizeof(VDINTERFACECONFIG), &pVDIfsImage);
+    AssertRC(rc);
+
+    rc = VDCreate(pVDIfs, VDTYPE_HDD, &pVD);
+    CHECK("VDCreate()");
+
+    RTFileDelete(pszFilename);
+    rc = VDCreateBase(pVD, "VDI", pszFilename, u64DiskSize,
+                      VD_IMAGE_FLAGS_NONE, "Test image",
+                      &PCHS, &LCHS, NULL, VD_OPEN_FLAGS_NORMAL,
+                      pVDIfsImage, NULL);
+    CHECK("VDCreateBase()");
+
+    RNDCTX ctx;
+    initializeRandomGenerator(&ctx, u32Seed);
+    generateRandomSegments(&ctx, paSegmentsA, nSegments, _1M, u64DiskSize, u32SectorSize, 0u, 127u);
+    generateRandomSegments(&ctx, paSegmentsB, nSegments, _1M, u64DiskSize, u32SectorSize, 128u, 255u);
+    /* The last set only covers the part added by the resize. */
+    generateRandomSegments(&ctx, paSegmentsC, nSegments, _1M, u64DiskSizeNew - u64DiskSize, u32SectorSize, 0u, 127u);
+    for (int i = 0; i <= nSegments; i++)
+        paSegmentsC[i].u64Offset += u64DiskSize;
+
+    /* After a flush the blocks must be visible to another instance opening the image. */
+    writeSegmentsToDisk(pVD, pvBuf, paSegmentsA);
+    rc = VDFlush(pVD);
+    CHECK("VDFlush()");
+
+    rc = VDCreate(pVDIfs, VDTYPE_HDD, &pVD2);
+    CHECK("VDCreate()");
+    rc = VDOpen(pVD2, "VDI", pszFilename, VD_OPEN_FLAGS_READONLY, NULL);
+    CHECK("VDOpen() (read-only)");
+    rc = readAndCompareSegments(pVD2, pvBuf, paSegmentsA);
+    CHECK("readAndCompareSegments() (after flush)");
+    VDDestroy(pVD2);
+    pVD2 = NULL;
+
+    /* Updates after the flush must be written on close. */
+    writeSegmentsToDisk(pVD, pvBuf, paSegmentsB);
+    VDCloseAll(pVD);
+
+    mergeSegments(paSegmentsA, paSegmentsB, paSegmentsAB, _1M);
+    rc = VDOpen(pVD, "VDI", pszFilename, VD_OPEN_FLAGS_NORMAL, NULL);
+    CHECK("VDOpen()");
+    rc = readAndCompareSegments(pVD, pvBuf, paSegmentsAB);
+    CHECK("readAndCompareSegments() (after close)");
+    VDCloseAll(pVD);
+
+    /* Grow the image while batching and fill the new part. */
+    rc = VDOpen(pVD, "VDI", pszFilename, VD_OPEN_FLAGS_NORMAL, pVDIfsImage);
+    CHECK("VDOpen() (batched)");
+    rc = VDResize(pVD, u64DiskSizeNew, &PCHS, &LCHS, NULL);
+    CHECK("VDResize()");
+    writeSegmentsToDisk(pVD, pvBuf, paSegmentsC);
+    VDCloseAll(pVD);
+
+    rc = VDOpen(pVD, "VDI", pszFilename, VD_OPEN_FLAGS_NORMAL, NULL);
+    CHECK("VDOpen()");
+    rc = readAndCompareSegments(pVD, pvBuf, paSegmentsAB);
+    CHECK("readAndCompareSegments() (after resize, old part)");
+    rc = readAndCompareSegments(pVD, pvBuf, paSegmentsC);
+    CHECK("readAndCompareSegments() (after resize, new part)");
+
+    rc = VDClose(pVD, true /* fDelete */);
+    CHECK("VDClose()");
+
+    RTMemFree(paSegmentsC);
+    RTMemFree(paSegmentsAB);
+    RTMemFree(paSegmentsB);
+    RTMemFree(paSegmentsA);
+
+    VDDestroy(pVD);
+    if (pvBuf)
+        RTMemFree(pvBuf);
+#undef CHECK
+    return 0;
+}
+
 static int tstVmdkRename(const char *src, const char *dst)
 {
     int rc;
@@ -868,6 +1029,7 @@ int main(int argc, char *argv[])
     RTFileDelete("tmpVDCreate.vhd");
     RTFileDelete("tmpVDBase.vdi");
     RTFileDelete("tmpVDDiff.vdi");
+    RTFileDelete("tmpVDBatch.vdi");
     RTFileDelete("tmpVDBase.vmdk");
     RTFileDelete("tmpVDDiff.vmdk");
     RTFileDelete("tmpVDBase.vhd");
@@ -994,6 +1156,12 @@ int main(int argc, char *argv[])
         RTPrintf("tstVD: VDI test failed (existing image)! rc=%Rrc\n", rc);
         g_cErrors++;
     }
+    rc = tstVDIBatchBlockUpdates("tmpVDBatch.vdi", u32Seed);
+    if (RT_FAILURE(rc))
+    {
+        RTPrintf("tstVD: VDI test failed (batched block updates)! rc=%Rrc\n", rc);
+        g_cErrors++;
+    }
 #endif /* VDI_TEST */
 #ifdef VMDK_TEST
     rc = tstVDOpenCreateWriteMerge("VMDK", "tmpVDBase.vmdk", "tmpVDDiff.vmdk", u32Seed);
@@ -1033,6 +1201,7 @@ int main(int argc, char *argv[])
     RTFileDelete("tmpVDCreate.vhd");
     RTFileDelete("tmpVDBase.vdi");
     RTFileDelete("tmpVDDiff.vdi");
+    RTFileDelete("tmpVDBatch.vdi");
     RTFileDelete("tmpVDBase.vmdk");
     RTFileDelete("tmpVDDiff.vmdk");
     RTFileDelete("tmpVDBase.vhd");
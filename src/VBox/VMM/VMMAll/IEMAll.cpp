@@ -1219,6 +1219,95 @@ DECLINLINE(void) iemReInitDecoder(PVMCPU pVCpu)
 }
 
 
+/**
+ * Converts page table flags as returned by PGMGstGetPage to the complemented
+ * IEMTLBE_F_PT_XXX flags.
+ *
+ * @returns IEMTLBE_F_PT_NO_EXEC, IEMTLBE_F_PT_NO_WRITE, IEMTLBE_F_PT_NO_USER
+ *          and IEMTLBE_F_PT_NO_DIRTY.
+ * @param   fPteFlags           The combined page table flags.
+ */
+DECLINLINE(uint64_t) iemTlbPteFlagsToEntryFlags(uint64_t fPteFlags)
+{
+    AssertCompile(IEMTLBE_F_PT_NO_EXEC  == 1);
+    AssertCompile(IEMTLBE_F_PT_NO_WRITE == X86_PTE_RW);
+    AssertCompile(IEMTLBE_F_PT_NO_USER  == X86_PTE_US);
+    AssertCompile(IEMTLBE_F_PT_NO_DIRTY == X86_PTE_D);
+    return (~fPteFlags & (X86_PTE_US | X86_PTE_RW | X86_PTE_D)) | (fPteFlags >> X86_PTE_PAE_BIT_NX);
+}
+
+#ifndef IEM_WITH_CODE_TLB
+
+/**
+ * Translates an opcode fetch address, consulting the code TLB first.
+ *
+ * The access checks are left to the caller.  Failed translations are not
+ * entered into the TLB, just like a real CPU doesn't cache not-present entries.
+ *
+ * @returns VBox status code from PGMGstGetPage.
+ * @param   pVCpu               The cross context virtual CPU structure of the
+ *                              calling thread.
+ * @param   GCPtr               The linear address of the opcode bytes.
+ * @param   pfTlbFlags          Where to return the IEMTLBE_F_PT_XXX flags.
+ * @param   pGCPhys             Where to return the guest physical page address.
+ */
+DECLINLINE(int) iemOpcodeTranslate(PVMCPU pVCpu, RTGCPTR GCPtr, uint64_t *pfTlbFlags, PRTGCPHYS pGCPhys)
+{
+# ifdef IEM_WITH_DATA_TLB
+    PIEMTLB const  pTlb  = &pVCpu->iem.s.CodeTlb;
+    uint64_t const uTag  = IEMTLB_CALC_TAG(pTlb, GCPtr);
+    PIEMTLBENTRY   pTlbe = IEMTLB_TAG_TO_ENTRY(pTlb, uTag);
+    if (pTlbe->uTag == uTag)
+    {
+#  ifdef VBOX_WITH_STATISTICS
+        pTlb->cTlbHits++;
+#  endif
+        *pfTlbFlags = pTlbe->fFlagsAndPhysRev;
+        *pGCPhys    = pTlbe->GCPhys;
+        return VINF_SUCCESS;
+    }
+    pTlb->cTlbMisses++;
+# endif
+
+    uint64_t fPteFlags;
+    int rc = PGMGstGetPage(pVCpu, GCPtr, &fPteFlags, pGCPhys);
+    if (RT_SUCCESS(rc))
+    {
+        *pfTlbFlags = iemTlbPteFlagsToEntryFlags(fPteFlags);
+# ifdef IEM_WITH_DATA_TLB
+        pTlbe->uTag             = uTag;
+        pTlbe->fFlagsAndPhysRev = *pfTlbFlags | IEMTLBE_F_NO_MAPPINGR3;
+        pTlbe->GCPhys           = *pGCPhys;
+        pTlbe->pbMappingR3      = NULL;
+# endif
+    }
+    return rc;
+}
+
+
+/**
+ * Drops the code TLB entry of an opcode fetch address that failed the access
+ * checks, like the CPU does for the faulting address when raising \#PF.
+ *
+ * @param   pVCpu               The cross context virtual CPU structure of the
+ *                              calling thread.
+ * @param   GCPtr               The linear address of the opcode bytes.
+ */
+DECLINLINE(void) iemOpcodeTlbDropEntry(PVMCPU pVCpu, RTGCPTR GCPtr)
+{
+# ifdef IEM_WITH_DATA_TLB
+    PIEMTLB const  pTlb  = &pVCpu->iem.s.CodeTlb;
+    uint64_t const uTag  = IEMTLB_CALC_TAG(pTlb, GCPtr);
+    PIEMTLBENTRY   pTlbe = IEMTLB_TAG_TO_ENTRY(pTlb, uTag);
+    if (pTlbe->uTag == uTag)
+        pTlbe->uTag = 0;
+# else
+    NOREF(pVCpu); NOREF(GCPtr);
+# endif
+}
+
+#endif /* !IEM_WITH_CODE_TLB */
+
 
 /**
  * Prefetch opcodes the first time when starting executing.
@@ -1289,24 +1378,26 @@ IEM_STATIC VBOXSTRICTRC iemInitDecoderAndPrefetchOpcodes(PVMCPU pVCpu, bool fByp
 # endif /* VBOX_WITH_RAW_MODE_NOT_R0 */
 
     RTGCPHYS    GCPhys;
-    uint64_t    fFlags;
-    int rc = PGMGstGetPage(pVCpu, GCPtrPC, &fFlags, &GCPhys);
+    uint64_t    fTlbFlags;
+    int rc = iemOpcodeTranslate(pVCpu, GCPtrPC, &fTlbFlags, &GCPhys);
     if (RT_SUCCESS(rc)) { /* probable */ }
     else
     {
         Log(("iemInitDecoderAndPrefetchOpcodes: %RGv - rc=%Rrc\n", GCPtrPC, rc));
         return iemRaisePageFault(pVCpu, GCPtrPC, IEM_ACCESS_INSTRUCTION, rc);
     }
-    if ((fFlags & X86_PTE_US) || pVCpu->iem.s.uCpl != 3) { /* likely */ }
+    if (!(fTlbFlags & IEMTLBE_F_PT_NO_USER) || pVCpu->iem.s.uCpl != 3) { /* likely */ }
     else
     {
         Log(("iemInitDecoderAndPrefetchOpcodes: %RGv - supervisor page\n", GCPtrPC));
+        iemOpcodeTlbDropEntry(pVCpu, GCPtrPC);
         return iemRaisePageFault(pVCpu, GCPtrPC, IEM_ACCESS_INSTRUCTION, VERR_ACCESS_DENIED);
     }
-    if (!(fFlags & X86_PTE_PAE_NX) || !(pCtx->msrEFER & MSR_K6_EFER_NXE)) { /* likely */ }
+    if (!(fTlbFlags & IEMTLBE_F_PT_NO_EXEC) || !(pCtx->msrEFER & MSR_K6_EFER_NXE)) { /* likely */ }
     else
     {
         Log(("iemInitDecoderAndPrefetchOpcodes: %RGv - NX\n", GCPtrPC));
+        iemOpcodeTlbDropEntry(pVCpu, GCPtrPC);
         return iemRaisePageFault(pVCpu, GCPtrPC, IEM_ACCESS_INSTRUCTION, VERR_ACCESS_DENIED);
     }
     GCPhys |= GCPtrPC & PAGE_OFFSET_MASK;
@@ -1406,8 +1497,11 @@ IEM_STATIC VBOXSTRICTRC iemInitDecoderAndPrefetchOpcodes(PVMCPU pVCpu, bool fByp
  */
 VMM_INT_DECL(void) IEMTlbInvalidateAll(PVMCPU pVCpu, bool fVmm)
 {
-#ifdef IEM_WITH_CODE_TLB
+#if defined(IEM_WITH_CODE_TLB) || defined(IEM_WITH_DATA_TLB)
+# ifdef IEM_WITH_CODE_TLB
     pVCpu->iem.s.cbInstrBufTotal = 0;
+# endif
+    pVCpu->iem.s.CodeTlb.cTlbFlushes++;
     pVCpu->iem.s.CodeTlb.uTlbRevision += IEMTLB_REVISION_INCR;
     if (pVCpu->iem.s.CodeTlb.uTlbRevision != 0)
     { /* very likely */ }
@@ -1421,6 +1515,7 @@ VMM_INT_DECL(void) IEMTlbInvalidateAll(PVMCPU pVCpu, bool fVmm)
 #endif
 
 #ifdef IEM_WITH_DATA_TLB
+    pVCpu->iem.s.DataTlb.cTlbFlushes++;
     pVCpu->iem.s.DataTlb.uTlbRevision += IEMTLB_REVISION_INCR;
     if (pVCpu->iem.s.DataTlb.uTlbRevision != 0)
     { /* very likely */ }
@@ -1436,6 +1531,45 @@ VMM_INT_DECL(void) IEMTlbInvalidateAll(PVMCPU pVCpu, bool fVmm)
 }
 
 
+#if defined(IEM_WITH_CODE_TLB) || defined(IEM_WITH_DATA_TLB)
+/**
+ * Worker for IEMTlbInvalidatePage that invalidates the page in one TLB.
+ *
+ * @returns true if any entry was invalidated, false if not.
+ * @param   pTlb        The TLB.
+ * @param   uTagNoRev   The tag of the page without the revision.
+ * @param   fLargePages Whether the guest can use large pages, in which case
+ *                      all entries within the surrounding 4MB region are
+ *                      invalidated (INVLPG flushes the whole large page and
+ *                      we don't know which entries came from one).
+ */
+IEM_STATIC bool iemTlbInvalidatePageWorker(PIEMTLB pTlb, uint64_t uTagNoRev, bool fLargePages)
+{
+    uint64_t const uTag = uTagNoRev | pTlb->uTlbRevision;
+    if (!fLargePages)
+    {
+        PIEMTLBENTRY pTlbe = IEMTLB_TAG_TO_ENTRY(pTlb, uTag);
+        if (pTlbe->uTag != uTag)
+            return false;
+        pTlbe->uTag = 0;
+        pTlb->cTlbPageFlushes++;
+        return true;
+    }
+
+    bool     fRet = false;
+    unsigned i    = RT_ELEMENTS(pTlb->aEntries);
+    while (i-- > 0)
+        if ((pTlb->aEntries[i].uTag ^ uTag) < RT_BIT_64(X86_PD_SHIFT - X86_PAGE_SHIFT))
+        {
+            pTlb->aEntries[i].uTag = 0;
+            pTlb->cTlbPageFlushes++;
+            fRet = true;
+        }
+    return fRet;
+}
+#endif
+
+
 /**
  * Invalidates a page in the TLBs.
  *
@@ -1446,23 +1580,17 @@ VMM_INT_DECL(void) IEMTlbInvalidateAll(PVMCPU pVCpu, bool fVmm)
 VMM_INT_DECL(void) IEMTlbInvalidatePage(PVMCPU pVCpu, RTGCPTR GCPtr)
 {
 #if defined(IEM_WITH_CODE_TLB) || defined(IEM_WITH_DATA_TLB)
-    GCPtr = GCPtr >> X86_PAGE_SHIFT;
-    AssertCompile(RT_ELEMENTS(pVCpu->iem.s.CodeTlb.aEntries) == 256);
-    AssertCompile(RT_ELEMENTS(pVCpu->iem.s.DataTlb.aEntries) == 256);
-    uintptr_t idx = (uint8_t)GCPtr;
+    uint64_t const uTagNoRev   = IEMTLB_CALC_TAG_NO_REV(GCPtr);
+    bool const     fLargePages = RT_BOOL(CPUMGetGuestCR4(pVCpu) & (X86_CR4_PSE | X86_CR4_PAE));
 
-# ifdef IEM_WITH_CODE_TLB
-    if (pVCpu->iem.s.CodeTlb.aEntries[idx].uTag == (GCPtr | pVCpu->iem.s.CodeTlb.uTlbRevision))
+    if (iemTlbInvalidatePageWorker(&pVCpu->iem.s.CodeTlb, uTagNoRev, fLargePages))
     {
-        pVCpu->iem.s.CodeTlb.aEntries[idx].uTag = 0;
-        if (GCPtr == (pVCpu->iem.s.uInstrBufPc >> X86_PAGE_SHIFT))
-            pVCpu->iem.s.cbInstrBufTotal = 0;
-    }
+# ifdef IEM_WITH_CODE_TLB
+        pVCpu->iem.s.cbInstrBufTotal = 0;
 # endif
-
+    }
 # ifdef IEM_WITH_DATA_TLB
-    if (pVCpu->iem.s.DataTlb.aEntries[idx].uTag == (GCPtr | pVCpu->iem.s.DataTlb.uTlbRevision))
-        pVCpu->iem.s.DataTlb.aEntries[idx].uTag = 0;
+    iemTlbInvalidatePageWorker(&pVCpu->iem.s.DataTlb, uTagNoRev, fLargePages);
 # endif
 #else
     NOREF(pVCpu); NOREF(GCPtr);
@@ -1628,9 +1756,8 @@ IEM_STATIC void iemOpcodeFetchBytesJmp(PVMCPU pVCpu, size_t cbDst, void *pvDst)
         /*
          * Get the TLB entry for this piece of code.
          */
-        uint64_t     uTag  = (GCPtrFirst >> X86_PAGE_SHIFT) | pVCpu->iem.s.CodeTlb.uTlbRevision;
-        AssertCompile(RT_ELEMENTS(pVCpu->iem.s.CodeTlb.aEntries) == 256);
-        PIEMTLBENTRY pTlbe = &pVCpu->iem.s.CodeTlb.aEntries[(uint8_t)uTag];
+        uint64_t     uTag  = IEMTLB_CALC_TAG(&pVCpu->iem.s.CodeTlb, GCPtrFirst);
+        PIEMTLBENTRY pTlbe = IEMTLB_TAG_TO_ENTRY(&pVCpu->iem.s.CodeTlb, uTag);
         if (pTlbe->uTag == uTag)
         {
             /* likely when executing lots of code, otherwise unlikely */
@@ -1662,9 +1789,8 @@ IEM_STATIC void iemOpcodeFetchBytesJmp(PVMCPU pVCpu, size_t cbDst, void *pvDst)
                     iemRaisePageFaultJmp(pVCpu, GCPtrFirst, IEM_ACCESS_INSTRUCTION, rc);
                 }
 
-                AssertCompile(IEMTLBE_F_PT_NO_EXEC == 1);
                 pTlbe->uTag             = uTag;
-                pTlbe->fFlagsAndPhysRev = (~fFlags & (X86_PTE_US | X86_PTE_RW | X86_PTE_D)) | (fFlags >> X86_PTE_PAE_BIT_NX);
+                pTlbe->fFlagsAndPhysRev = iemTlbPteFlagsToEntryFlags(fFlags);
                 pTlbe->GCPhys           = GCPhys;
                 pTlbe->pbMappingR3      = NULL;
             }
@@ -1678,11 +1804,13 @@ IEM_STATIC void iemOpcodeFetchBytesJmp(PVMCPU pVCpu, size_t cbDst, void *pvDst)
             if ((pTlbe->fFlagsAndPhysRev & IEMTLBE_F_PT_NO_USER) && pVCpu->iem.s.uCpl == 3)
             {
                 Log(("iemOpcodeFetchBytesJmp: %RGv - supervisor page\n", GCPtrFirst));
+                pTlbe->uTag = 0;
                 iemRaisePageFaultJmp(pVCpu, GCPtrFirst, IEM_ACCESS_INSTRUCTION, VERR_ACCESS_DENIED);
             }
             if ((pTlbe->fFlagsAndPhysRev & IEMTLBE_F_PT_NO_EXEC) && (pCtx->msrEFER & MSR_K6_EFER_NXE))
             {
                 Log(("iemOpcodeFetchMoreBytes: %RGv - NX\n", GCPtrFirst));
+                pTlbe->uTag = 0;
                 iemRaisePageFaultJmp(pVCpu, GCPtrFirst, IEM_ACCESS_INSTRUCTION, VERR_ACCESS_DENIED);
             }
         }
@@ -1904,21 +2032,23 @@ IEM_STATIC VBOXSTRICTRC iemOpcodeFetchMoreBytes(PVMCPU pVCpu, size_t cbMin)
 # endif /* VBOX_WITH_RAW_MODE_NOT_R0 */
 
     RTGCPHYS    GCPhys;
-    uint64_t    fFlags;
-    int rc = PGMGstGetPage(pVCpu, GCPtrNext, &fFlags, &GCPhys);
+    uint64_t    fTlbFlags;
+    int rc = iemOpcodeTranslate(pVCpu, GCPtrNext, &fTlbFlags, &GCPhys);
     if (RT_FAILURE(rc))
     {
         Log(("iemOpcodeFetchMoreBytes: %RGv - rc=%Rrc\n", GCPtrNext, rc));
         return iemRaisePageFault(pVCpu, GCPtrNext, IEM_ACCESS_INSTRUCTION, rc);
     }
-    if (!(fFlags & X86_PTE_US) && pVCpu->iem.s.uCpl == 3)
+    if ((fTlbFlags & IEMTLBE_F_PT_NO_USER) && pVCpu->iem.s.uCpl == 3)
     {
         Log(("iemOpcodeFetchMoreBytes: %RGv - supervisor page\n", GCPtrNext));
+        iemOpcodeTlbDropEntry(pVCpu, GCPtrNext);
         return iemRaisePageFault(pVCpu, GCPtrNext, IEM_ACCESS_INSTRUCTION, VERR_ACCESS_DENIED);
     }
-    if ((fFlags & X86_PTE_PAE_NX) && (pCtx->msrEFER & MSR_K6_EFER_NXE))
+    if ((fTlbFlags & IEMTLBE_F_PT_NO_EXEC) && (pCtx->msrEFER & MSR_K6_EFER_NXE))
     {
         Log(("iemOpcodeFetchMoreBytes: %RGv - NX\n", GCPtrNext));
+        iemOpcodeTlbDropEntry(pVCpu, GCPtrNext);
         return iemRaisePageFault(pVCpu, GCPtrNext, IEM_ACCESS_INSTRUCTION, VERR_ACCESS_DENIED);
     }
     GCPhys |= GCPtrNext & PAGE_OFFSET_MASK;
@@ -7673,52 +7803,90 @@ iemMemApplySegment(PVMCPU pVCpu, uint32_t fAccess, uint8_t iSegReg, size_t cbMem
 IEM_STATIC VBOXSTRICTRC
 iemMemPageTranslateAndCheckAccess(PVMCPU pVCpu, RTGCPTR GCPtrMem, uint32_t fAccess, PRTGCPHYS pGCPhysMem)
 {
-    /** @todo Need a different PGM interface here.  We're currently using
-     *        generic / REM interfaces. this won't cut it for R0 & RC. */
     RTGCPHYS    GCPhys;
-    uint64_t    fFlags;
-    int rc = PGMGstGetPage(pVCpu, GCPtrMem, &fFlags, &GCPhys);
-    if (RT_FAILURE(rc))
+    uint64_t    fTlbFlags;
+    bool        fAccessed = true;
+#ifdef IEM_WITH_DATA_TLB
+    /*
+     * Consult the data TLB first.  Entries are only loaded after the access
+     * checks passed and the accessed bit has been set, so on a hit we only
+     * need to deal with the dirty bit.
+     */
+    PIEMTLB const  pTlb  = &pVCpu->iem.s.DataTlb;
+    uint64_t const uTag  = IEMTLB_CALC_TAG(pTlb, GCPtrMem);
+    PIEMTLBENTRY   pTlbe = IEMTLB_TAG_TO_ENTRY(pTlb, uTag);
+    bool const     fHit  = pTlbe->uTag == uTag;
+    if (fHit)
     {
-        /** @todo Check unassigned memory in unpaged mode. */
-        /** @todo Reserved bits in page tables. Requires new PGM interface. */
-        *pGCPhysMem = NIL_RTGCPHYS;
-        return iemRaisePageFault(pVCpu, GCPtrMem, fAccess, rc);
+# ifdef VBOX_WITH_STATISTICS
+        pTlb->cTlbHits++;
+# endif
+        fTlbFlags = pTlbe->fFlagsAndPhysRev;
+        GCPhys    = pTlbe->GCPhys;
+    }
+    else
+#endif
+    {
+        /** @todo Need a different PGM interface here.  We're currently using
+         *        generic / REM interfaces. this won't cut it for R0 & RC. */
+#ifdef IEM_WITH_DATA_TLB
+        pTlb->cTlbMisses++;
+#endif
+        uint64_t fPteFlags;
+        int rc = PGMGstGetPage(pVCpu, GCPtrMem, &fPteFlags, &GCPhys);
+        if (RT_FAILURE(rc))
+        {
+            /** @todo Check unassigned memory in unpaged mode. */
+            /** @todo Reserved bits in page tables. Requires new PGM interface. */
+            *pGCPhysMem = NIL_RTGCPHYS;
+            return iemRaisePageFault(pVCpu, GCPtrMem, fAccess, rc);
+        }
+        fTlbFlags = iemTlbPteFlagsToEntryFlags(fPteFlags);
+        fAccessed = RT_BOOL(fPteFlags & X86_PTE_A);
     }
 
     /* If the page is writable and does not have the no-exec bit set, all
        access is allowed.  Otherwise we'll have to check more carefully... */
-    if ((fFlags & (X86_PTE_RW | X86_PTE_US | X86_PTE_PAE_NX)) != (X86_PTE_RW | X86_PTE_US))
+    if (fTlbFlags & (IEMTLBE_F_PT_NO_WRITE | IEMTLBE_F_PT_NO_USER | IEMTLBE_F_PT_NO_EXEC))
     {
         /* Write to read only memory? */
         if (   (fAccess & IEM_ACCESS_TYPE_WRITE)
-            && !(fFlags & X86_PTE_RW)
+            && (fTlbFlags & IEMTLBE_F_PT_NO_WRITE)
             && (       (pVCpu->iem.s.uCpl == 3
                     && !(fAccess & IEM_ACCESS_WHAT_SYS))
                 || (IEM_GET_CTX(pVCpu)->cr0 & X86_CR0_WP)))
         {
             Log(("iemMemPageTranslateAndCheckAccess: GCPtrMem=%RGv - read-only page -> #PF\n", GCPtrMem));
             *pGCPhysMem = NIL_RTGCPHYS;
+#ifdef IEM_WITH_DATA_TLB
+            pTlbe->uTag = 0; /* The CPU drops the entry of the faulting address. */
+#endif
             return iemRaisePageFault(pVCpu, GCPtrMem, fAccess & ~IEM_ACCESS_TYPE_READ, VERR_ACCESS_DENIED);
         }
 
         /* Kernel memory accessed by userland? */
-        if (   !(fFlags & X86_PTE_US)
+        if (   (fTlbFlags & IEMTLBE_F_PT_NO_USER)
             && pVCpu->iem.s.uCpl == 3
             && !(fAccess & IEM_ACCESS_WHAT_SYS))
         {
             Log(("iemMemPageTranslateAndCheckAccess: GCPtrMem=%RGv - user access to kernel page -> #PF\n", GCPtrMem));
             *pGCPhysMem = NIL_RTGCPHYS;
+#ifdef IEM_WITH_DATA_TLB
+            pTlbe->uTag = 0; /* The CPU drops the entry of the faulting address. */
+#endif
             return iemRaisePageFault(pVCpu, GCPtrMem, fAccess, VERR_ACCESS_DENIED);
         }
 
         /* Executing non-executable memory? */
         if (   (fAccess & IEM_ACCESS_TYPE_EXEC)
-            && (fFlags & X86_PTE_PAE_NX)
+            && (fTlbFlags & IEMTLBE_F_PT_NO_EXEC)
             && (IEM_GET_CTX(pVCpu)->msrEFER & MSR_K6_EFER_NXE) )
         {
             Log(("iemMemPageTranslateAndCheckAccess: GCPtrMem=%RGv - NX -> #PF\n", GCPtrMem));
             *pGCPhysMem = NIL_RTGCPHYS;
+#ifdef IEM_WITH_DATA_TLB
+            pTlbe->uTag = 0; /* The CPU drops the entry of the faulting address. */
+#endif
             return iemRaisePageFault(pVCpu, GCPtrMem, fAccess & ~(IEM_ACCESS_TYPE_READ | IEM_ACCESS_TYPE_WRITE),
                                      VERR_ACCESS_DENIED);
         }
@@ -7729,13 +7897,33 @@ iemMemPageTranslateAndCheckAccess(PVMCPU pVCpu, RTGCPTR GCPtrMem, uint32_t fAcce
      * ASSUMES this is set when the address is translated rather than on committ...
      */
     /** @todo testcase: check when A and D bits are actually set by the CPU.  */
-    uint32_t fAccessedDirty = fAccess & IEM_ACCESS_TYPE_WRITE ? X86_PTE_D | X86_PTE_A : X86_PTE_A;
-    if ((fFlags & fAccessedDirty) != fAccessedDirty)
+    bool const fDirty = !(fAccess & IEM_ACCESS_TYPE_WRITE) || !(fTlbFlags & IEMTLBE_F_PT_NO_DIRTY);
+    if (!fAccessed || !fDirty)
     {
+        uint32_t fAccessedDirty = fAccess & IEM_ACCESS_TYPE_WRITE ? X86_PTE_D | X86_PTE_A : X86_PTE_A;
         int rc2 = PGMGstModifyPage(pVCpu, GCPtrMem, 1, fAccessedDirty, ~(uint64_t)fAccessedDirty);
         AssertRC(rc2);
+        if (fAccess & IEM_ACCESS_TYPE_WRITE)
+            fTlbFlags &= ~IEMTLBE_F_PT_NO_DIRTY;
+#ifdef IEM_WITH_DATA_TLB
+        if (fHit)
+            pTlbe->fFlagsAndPhysRev = fTlbFlags;
+#endif
     }
 
+#ifdef IEM_WITH_DATA_TLB
+    /*
+     * Load the TLB entry on a miss.
+     */
+    if (!fHit)
+    {
+        pTlbe->uTag             = uTag;
+        pTlbe->fFlagsAndPhysRev = fTlbFlags | IEMTLBE_F_NO_MAPPINGR3;
+        pTlbe->GCPhys           = GCPhys;
+        pTlbe->pbMappingR3      = NULL;
+    }
+#endif
+
     GCPhys |= GCPtrMem & PAGE_OFFSET_MASK;
     *pGCPhysMem = GCPhys;
     return VINF_SUCCESS;
@@ -8966,21 +9154,11 @@ IEM_STATIC uint32_t iemMemFetchDataU32SafeJmp(PVMCPU pVCpu, uint8_t iSegReg, RTG
  */
 DECL_NO_INLINE(IEM_STATIC, uint32_t) iemMemFetchDataU32Jmp(PVMCPU pVCpu, uint8_t iSegReg, RTGCPTR GCPtrMem)
 {
-# ifdef IEM_WITH_DATA_TLB
-    RTGCPTR GCPtrEff = iemMemApplySegmentToReadJmp(pVCpu, iSegReg, sizeof(uint32_t), GCPtrMem);
-    if (RT_LIKELY((GCPtrEff & X86_PAGE_OFFSET_MASK) <= X86_PAGE_SIZE - sizeof(uint32_t)))
-    {
-        /// @todo more later.
-    }
-
-    return iemMemFetchDataU32SafeJmp(pVCpu, iSegReg, GCPtrMem);
-# else
-    /* The lazy approach. */
+    /* The lazy approach.  The data TLB is consulted by iemMemMapJmp. */
     uint32_t const *pu32Src = (uint32_t const *)iemMemMapJmp(pVCpu, sizeof(*pu32Src), iSegReg, GCPtrMem, IEM_ACCESS_DATA_R);
     uint32_t const  u32Ret  = *pu32Src;
     iemMemCommitAndUnmapJmp(pVCpu, (void *)pu32Src, IEM_ACCESS_DATA_R);
     return u32Ret;
-# endif
 }
 #endif
 
@@ -2282,6 +2282,12 @@ VMMDECL(int) PGMChangeMode(PVMCPU pVCpu, uint64_t cr0, uint64_t cr4, uint64_t ef
             enmGuestMode = PGMMODE_AMD64_NX;
     }
 
+    /*
+     * The IEM TLBs must go even if the mode stays the same, CR4.PSE affects
+     * the translations as well.
+     */
+    IEMTlbInvalidateAll(pVCpu, false /*fVmm*/);
+
     /*
      * Did it change?
      */
@@ -44,24 +44,24 @@
                ("Thread does not own critical section\n"));\
     } while (0)
 
-# define PDMACFILECACHE_EP_IS_SEMRW_WRITE_OWNER(pEpCache) \
+# define PDMACFILECACHE_EP_IS_SEMRW_WRITE_OWNER(pShard) \
     do \
     { \
-        AssertMsg(RTSemRWIsWriteOwner(pEpCache->SemRWEntries), \
-                  ("Thread is not exclusive owner of the per endpoint RW semaphore\n")); \
+        AssertMsg(RTSemRWIsWriteOwner(pShard->SemRWEntries), \
+                  ("Thread is not exclusive owner of the per shard RW semaphore\n")); \
     } while (0)
 
-# define PDMACFILECACHE_EP_IS_SEMRW_READ_OWNER(pEpCache) \
+# define PDMACFILECACHE_EP_IS_SEMRW_READ_OWNER(pShard) \
     do \
     { \
-        AssertMsg(RTSemRWIsReadOwner(pEpCache->SemRWEntries), \
-                  ("Thread is not read owner of the per endpoint RW semaphore\n")); \
+        AssertMsg(RTSemRWIsReadOwner(pShard->SemRWEntries), \
+                  ("Thread is not read owner of the per shard RW semaphore\n")); \
     } while (0)
 
 #else
 # define PDMACFILECACHE_IS_CRITSECT_OWNER(Cache) do { } while (0)
-# define PDMACFILECACHE_EP_IS_SEMRW_WRITE_OWNER(pEpCache) do { } while (0)
-# define PDMACFILECACHE_EP_IS_SEMRW_READ_OWNER(pEpCache) do { } while (0)
+# define PDMACFILECACHE_EP_IS_SEMRW_WRITE_OWNER(pShard) do { } while (0)
+# define PDMACFILECACHE_EP_IS_SEMRW_READ_OWNER(pShard) do { } while (0)
 #endif
 
 #define PDM_BLK_CACHE_SAVED_STATE_VERSION 1
@@ -116,7 +116,15 @@ static void pdmBlkCacheValidate(PPDMBLKCACHEGLOBAL pCache)
 
 DECLINLINE(void) pdmBlkCacheLockEnter(PPDMBLKCACHEGLOBAL pCache)
 {
+#ifdef VBOX_WITH_STATISTICS
+    if (RT_FAILURE(RTCritSectTryEnter(&pCache->CritSect)))
+    {
+        STAM_COUNTER_INC(&pCache->StatLockContention);
+        RTCritSectEnter(&pCache->CritSect);
+    }
+#else
     RTCritSectEnter(&pCache->CritSect);
+#endif
 #ifdef VBOX_STRICT
     pdmBlkCacheValidate(pCache);
 #endif
@@ -130,6 +138,219 @@ DECLINLINE(void) pdmBlkCacheLockLeave(PPDMBLKCACHEGLOBAL pCache)
     RTCritSectLeave(&pCache->CritSect);
 }
 
+/**
+ * Returns the lookup shard responsible for the given offset.
+ *
+ * @returns Pointer to the shard.
+ * @param   pBlkCache    The endpoint cache.
+ * @param   off          The offset.
+ */
+DECLINLINE(PPDMBLKCACHESHARD) pdmBlkCacheShardGet(PPDMBLKCACHE pBlkCache, uint64_t off)
+{
+    return &pBlkCache->aShards[(off >> PDMBLKCACHE_SHARD_STRIPE_SHIFT) & (PDMBLKCACHE_SHARDS - 1)];
+}
+
+/**
+ * Returns the lookup shard the given entry lives in.
+ *
+ * @returns Pointer to the shard.
+ * @param   pEntry       The cache entry.
+ */
+DECLINLINE(PPDMBLKCACHESHARD) pdmBlkCacheEntryShardGet(PPDMBLKCACHEENTRY pEntry)
+{
+    return pdmBlkCacheShardGet(pEntry->pBlkCache, pEntry->Core.Key);
+}
+
+/**
+ * Returns the number of bytes from the given offset to the end of its stripe.
+ *
+ * @returns Number of bytes.
+ * @param   off          The offset.
+ */
+DECLINLINE(uint64_t) pdmBlkCacheShardStripeLeft(uint64_t off)
+{
+    return RT_BIT_64(PDMBLKCACHE_SHARD_STRIPE_SHIFT) - (off & (RT_BIT_64(PDMBLKCACHE_SHARD_STRIPE_SHIFT) - 1));
+}
+
+/**
+ * Acquires exclusive access to a shard.
+ *
+ * @returns nothing.
+ * @param   pBlkCache    The endpoint cache the shard belongs to.
+ * @param   pShard       The shard.
+ */
+DECLINLINE(void) pdmBlkCacheShardLockWrite(PPDMBLKCACHE pBlkCache, PPDMBLKCACHESHARD pShard)
+{
+    if (ASMAtomicIncU32(&pShard->cWriters) > 1)
+        STAM_COUNTER_INC(&pBlkCache->pCache->StatShardContention);
+    RTSemRWRequestWrite(pShard->SemRWEntries, RT_INDEFINITE_WAIT);
+    NOREF(pBlkCache);
+}
+
+/**
+ * Releases exclusive access to a shard.
+ *
+ * @returns nothing.
+ * @param   pShard       The shard.
+ */
+DECLINLINE(void) pdmBlkCacheShardUnlockWrite(PPDMBLKCACHESHARD pShard)
+{
+    RTSemRWReleaseWrite(pShard->SemRWEntries);
+    ASMAtomicDecU32(&pShard->cWriters);
+}
+
+/**
+ * Acquires shared access to a shard.
+ *
+ * @returns nothing.
+ * @param   pBlkCache    The endpoint cache the shard belongs to.
+ * @param   pShard       The shard.
+ */
+DECLINLINE(void) pdmBlkCacheShardLockRead(PPDMBLKCACHE pBlkCache, PPDMBLKCACHESHARD pShard)
+{
+    if (ASMAtomicUoReadU32(&pShard->cWriters) > 0)
+        STAM_COUNTER_INC(&pBlkCache->pCache->StatShardContention);
+    RTSemRWRequestRead(pShard->SemRWEntries, RT_INDEFINITE_WAIT);
+    NOREF(pBlkCache);
+}
+
+/**
+ * Releases shared access to a shard.
+ *
+ * @returns nothing.
+ * @param   pShard       The shard.
+ */
+DECLINLINE(void) pdmBlkCacheShardUnlockRead(PPDMBLKCACHESHARD pShard)
+{
+    RTSemRWReleaseRead(pShard->SemRWEntries);
+}
+
+/**
+ * Acquires exclusive access to the shard of the given entry.
+ *
+ * @returns nothing.
+ * @param   pEntry       The cache entry.
+ */
+DECLINLINE(void) pdmBlkCacheEntryLockWrite(PPDMBLKCACHEENTRY pEntry)
+{
+    pdmBlkCacheShardLockWrite(pEntry->pBlkCache, pdmBlkCacheEntryShardGet(pEntry));
+}
+
+/**
+ * Releases exclusive access to the shard of the given entry.
+ *
+ * @returns nothing.
+ * @param   pEntry       The cache entry.
+ */
+DECLINLINE(void) pdmBlkCacheEntryUnlockWrite(PPDMBLKCACHEENTRY pEntry)
+{
+    pdmBlkCacheShardUnlockWrite(pdmBlkCacheEntryShardGet(pEntry));
+}
+
+/**
+ * Removes the given entry from the AVL tree of its shard.
+ *
+ * @returns nothing.
+ * @param   pCache       The global cache data (for statistics).
+ * @param   pEntry       The cache entry.
+ *
+ * @note The caller must own the shard exclusively.
+ */
+DECLINLINE(void) pdmBlkCacheEntryTreeRemove(PPDMBLKCACHEGLOBAL pCache, PPDMBLKCACHEENTRY pEntry)
+{
+    PPDMBLKCACHESHARD pShard = pdmBlkCacheEntryShardGet(pEntry);
+    PDMACFILECACHE_EP_IS_SEMRW_WRITE_OWNER(pShard);
+    STAM_PROFILE_ADV_START(&pCache->StatTreeRemove, Cache);
+    RTAvlrU64Remove(pShard->pTree, pEntry->Core.Key);
+    STAM_PROFILE_ADV_STOP(&pCache->StatTreeRemove, Cache);
+    NOREF(pCache);
+}
+
+/**
+ * Acquires exclusive access to all shards of the given endpoint cache.
+ *
+ * @returns nothing.
+ * @param   pBlkCache    The endpoint cache.
+ */
+static void pdmBlkCacheShardsLockWriteAll(PPDMBLKCACHE pBlkCache)
+{
+    for (unsigned i = 0; i < RT_ELEMENTS(pBlkCache->aShards); i++)
+        pdmBlkCacheShardLockWrite(pBlkCache, &pBlkCache->aShards[i]);
+}
+
+/**
+ * Releases exclusive access to all shards of the given endpoint cache.
+ *
+ * @returns nothing.
+ * @param   pBlkCache    The endpoint cache.
+ */
+static void pdmBlkCacheShardsUnlockWriteAll(PPDMBLKCACHE pBlkCache)
+{
+    unsigned i = RT_ELEMENTS(pBlkCache->aShards);
+    while (i-- > 0)
+        pdmBlkCacheShardUnlockWrite(&pBlkCache->aShards[i]);
+}
+
+/**
+ * Frees the resources of all shards of the given endpoint cache.
+ *
+ * @returns nothing.
+ * @param   pBlkCache    The endpoint cache, the trees must be empty.
+ */
+static void pdmBlkCacheShardsDestroy(PPDMBLKCACHE pBlkCache)
+{
+    for (unsigned i = 0; i < RT_ELEMENTS(pBlkCache->aShards); i++)
+    {
+        PPDMBLKCACHESHARD pShard = &pBlkCache->aShards[i];
+
+        if (pShard->pTree)
+        {
+            RTMemFree(pShard->pTree);
+            pShard->pTree = NULL;
+        }
+        if (pShard->SemRWEntries != NIL_RTSEMRW)
+        {
+            RTSemRWDestroy(pShard->SemRWEntries);
+            pShard->SemRWEntries = NIL_RTSEMRW;
+        }
+    }
+}
+
+/**
+ * Creates the shards of the given endpoint cache.
+ *
+ * @returns VBox status code.
+ * @param   pBlkCache    The endpoint cache.
+ */
+static int pdmBlkCacheShardsCreate(PPDMBLKCACHE pBlkCache)
+{
+    int rc = VINF_SUCCESS;
+
+    for (unsigned i = 0; i < RT_ELEMENTS(pBlkCache->aShards); i++)
+    {
+        pBlkCache->aShards[i].SemRWEntries = NIL_RTSEMRW;
+        pBlkCache->aShards[i].pTree        = NULL;
+        pBlkCache->aShards[i].cWriters     = 0;
+    }
+
+    for (unsigned i = 0; i < RT_ELEMENTS(pBlkCache->aShards) && RT_SUCCESS(rc); i++)
+    {
+        PPDMBLKCACHESHARD pShard = &pBlkCache->aShards[i];
+
+        rc = RTSemRWCreate(&pShard->SemRWEntries);
+        if (RT_SUCCESS(rc))
+        {
+            pShard->pTree = (PAVLRU64TREE)RTMemAllocZ(sizeof(AVLRU64TREE));
+            if (!pShard->pTree)
+                rc = VERR_NO_MEMORY;
+        }
+    }
+
+    if (RT_FAILURE(rc))
+        pdmBlkCacheShardsDestroy(pBlkCache);
+    return rc;
+}
+
 DECLINLINE(void) pdmBlkCacheSub(PPDMBLKCACHEGLOBAL pCache, uint32_t cbAmount)
 {
     PDMACFILECACHE_IS_CRITSECT_OWNER(pCache);
@@ -343,21 +564,37 @@ static size_t pdmBlkCacheEvictPagesFrom(PPDMBLKCACHEGLOBAL pCache, size_t cbData
 
     /* Start deleting from the tail. */
     PPDMBLKCACHEENTRY pEntry = pListSrc->pTail;
+    /* The first entry moved to the head because it was referenced, stop when we get there. */
+    PPDMBLKCACHEENTRY pFirstMoved = NULL;
 
-    while ((cbEvicted < cbData) && pEntry)
+    while ((cbEvicted < cbData) && pEntry && pEntry != pFirstMoved)
     {
         PPDMBLKCACHEENTRY pCurr = pEntry;
 
         pEntry = pEntry->pPrev;
 
+        /*
+         * Hits on the frequently used list only mark the entry as referenced
+         * instead of moving it to the head under the cache lock, do it now.
+         */
+        if (   pListSrc == &pCache->LruFrequentlyUsed
+            && (ASMAtomicReadU32(&pCurr->fFlags) & PDMBLKCACHE_ENTRY_REFERENCED))
+        {
+            ASMAtomicAndU32(&pCurr->fFlags, ~PDMBLKCACHE_ENTRY_REFERENCED);
+            pdmBlkCacheEntryAddToList(pListSrc, pCurr);
+            if (!pFirstMoved)
+                pFirstMoved = pCurr;
+            STAM_COUNTER_INC(&pCache->StatSecondChance);
+            continue;
+        }
+
         /* We can't evict pages which are currently in progress or dirty but not in progress */
         if (   !(pCurr->fFlags & PDMBLKCACHE_NOT_EVICTABLE)
             && (ASMAtomicReadU32(&pCurr->cRefs) == 0))
         {
-            /* Ok eviction candidate. Grab the endpoint semaphore and check again
+            /* Ok eviction candidate. Grab the shard semaphore and check again
              * because somebody else might have raced us. */
-            PPDMBLKCACHE pBlkCache = pCurr->pBlkCache;
-            RTSemRWRequestWrite(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
+            pdmBlkCacheEntryLockWrite(pCurr);
 
             if (!(pCurr->fFlags & PDMBLKCACHE_NOT_EVICTABLE)
                 && (ASMAtomicReadU32(&pCurr->cRefs) == 0))
@@ -380,7 +617,7 @@ static size_t pdmBlkCacheEvictPagesFrom(PPDMBLKCACHEGLOBAL pCache, size_t cbData
 
                 if (pGhostListDst)
                 {
-                    RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+                    pdmBlkCacheEntryUnlockWrite(pCurr);
 
                     PPDMBLKCACHEENTRY pGhostEntFree = pGhostListDst->pTail;
 
@@ -389,32 +626,29 @@ static size_t pdmBlkCacheEvictPagesFrom(PPDMBLKCACHEGLOBAL pCache, size_t cbData
                            && pGhostEntFree)
                     {
                         PPDMBLKCACHEENTRY pFree = pGhostEntFree;
-                        PPDMBLKCACHE pBlkCacheFree = pFree->pBlkCache;
+                        PPDMBLKCACHESHARD pShardFree = pdmBlkCacheEntryShardGet(pFree);
 
                         pGhostEntFree = pGhostEntFree->pPrev;
 
-                        RTSemRWRequestWrite(pBlkCacheFree->SemRWEntries, RT_INDEFINITE_WAIT);
+                        pdmBlkCacheShardLockWrite(pFree->pBlkCache, pShardFree);
 
                         if (ASMAtomicReadU32(&pFree->cRefs) == 0)
                         {
                             pdmBlkCacheEntryRemoveFromList(pFree);
-
-                            STAM_PROFILE_ADV_START(&pCache->StatTreeRemove, Cache);
-                            RTAvlrU64Remove(pBlkCacheFree->pTree, pFree->Core.Key);
-                            STAM_PROFILE_ADV_STOP(&pCache->StatTreeRemove, Cache);
-
+                            pdmBlkCacheEntryTreeRemove(pCache, pFree);
                             RTMemFree(pFree);
                         }
 
-                        RTSemRWReleaseWrite(pBlkCacheFree->SemRWEntries);
+                        pdmBlkCacheShardUnlockWrite(pShardFree);
                     }
 
                     if (pGhostListDst->cbCached + pCurr->cbData > pCache->cbRecentlyUsedOutMax)
                     {
                         /* Couldn't remove enough entries. Delete */
-                        STAM_PROFILE_ADV_START(&pCache->StatTreeRemove, Cache);
-                        RTAvlrU64Remove(pCurr->pBlkCache->pTree, pCurr->Core.Key);
-                        STAM_PROFILE_ADV_STOP(&pCache->StatTreeRemove, Cache);
+                        PPDMBLKCACHESHARD pShardCurr = pdmBlkCacheEntryShardGet(pCurr);
+                        pdmBlkCacheShardLockWrite(pCurr->pBlkCache, pShardCurr);
+                        pdmBlkCacheEntryTreeRemove(pCache, pCurr);
+                        pdmBlkCacheShardUnlockWrite(pShardCurr);
 
                         RTMemFree(pCurr);
                     }
@@ -424,15 +658,14 @@ static size_t pdmBlkCacheEvictPagesFrom(PPDMBLKCACHEGLOBAL pCache, size_t cbData
                 else
                 {
                     /* Delete the entry from the AVL tree it is assigned to. */
-                    STAM_PROFILE_ADV_START(&pCache->StatTreeRemove, Cache);
-                    RTAvlrU64Remove(pCurr->pBlkCache->pTree, pCurr->Core.Key);
-                    STAM_PROFILE_ADV_STOP(&pCache->StatTreeRemove, Cache);
+                    pdmBlkCacheEntryTreeRemove(pCache, pCurr);
 
-                    RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+                    pdmBlkCacheEntryUnlockWrite(pCurr);
                     RTMemFree(pCurr);
                 }
             }
-
+            else
+                pdmBlkCacheEntryUnlockWrite(pCurr);
         }
         else
             LogFlow(("Entry %#p (%u bytes) is still in progress and can't be evicted\n", pCurr, pCurr->cbData));
@@ -545,7 +778,7 @@ static int pdmBlkCacheEntryReadFromMedium(PPDMBLKCACHEENTRY pEntry)
     LogFlowFunc((": Reading data into cache entry %#p\n", pEntry));
 
     /* Make sure no one evicts the entry while it is accessed. */
-    pEntry->fFlags |= PDMBLKCACHE_ENTRY_IO_IN_PROGRESS;
+    ASMAtomicOrU32(&pEntry->fFlags, PDMBLKCACHE_ENTRY_IO_IN_PROGRESS);
 
     PPDMBLKCACHEIOXFER pIoXfer = (PPDMBLKCACHEIOXFER)RTMemAllocZ(sizeof(PDMBLKCACHEIOXFER));
     if (RT_UNLIKELY(!pIoXfer))
@@ -575,7 +808,7 @@ static int pdmBlkCacheEntryWriteToMedium(PPDMBLKCACHEENTRY pEntry)
     LogFlowFunc((": Writing data from cache entry %#p\n", pEntry));
 
     /* Make sure no one evicts the entry while it is accessed. */
-    pEntry->fFlags |= PDMBLKCACHE_ENTRY_IO_IN_PROGRESS;
+    ASMAtomicOrU32(&pEntry->fFlags, PDMBLKCACHE_ENTRY_IO_IN_PROGRESS);
 
     PPDMBLKCACHEIOXFER pIoXfer = (PPDMBLKCACHEIOXFER)RTMemAllocZ(sizeof(PDMBLKCACHEIOXFER));
     if (RT_UNLIKELY(!pIoXfer))
@@ -656,7 +889,7 @@ static void pdmBlkCacheCommit(PPDMBLKCACHE pBlkCache)
     if (pBlkCache->fSuspended)
         return;
 
-    RTSemRWRequestWrite(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
+    pdmBlkCacheShardsLockWriteAll(pBlkCache);
 
     /* The list is moved to a new header to reduce locking overhead. */
     RTLISTANCHOR ListDirtyNotCommitted;
@@ -689,7 +922,7 @@ static void pdmBlkCacheCommit(PPDMBLKCACHE pBlkCache)
                   ("Committed all entries but list is not empty\n"));
     }
 
-    RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+    pdmBlkCacheShardsUnlockWriteAll(pBlkCache);
     AssertMsg(pBlkCache->pCache->cbDirty >= cbCommitted,
               ("Number of committed bytes exceeds number of dirty bytes\n"));
     uint32_t cbDirtyOld = ASMAtomicSubU32(&pBlkCache->pCache->cbDirty, cbCommitted);
@@ -750,12 +983,12 @@ static bool pdmBlkCacheAddDirtyEntry(PPDMBLKCACHE pBlkCache, PPDMBLKCACHEENTRY p
     /* If the commit timer is disabled we commit right away. */
     if (pCache->u32CommitTimeoutMs == 0)
     {
-        pEntry->fFlags |= PDMBLKCACHE_ENTRY_IS_DIRTY;
+        ASMAtomicOrU32(&pEntry->fFlags, PDMBLKCACHE_ENTRY_IS_DIRTY);
         pdmBlkCacheEntryCommit(pEntry);
     }
     else if (!(pEntry->fFlags & PDMBLKCACHE_ENTRY_IS_DIRTY))
     {
-        pEntry->fFlags |= PDMBLKCACHE_ENTRY_IS_DIRTY;
+        ASMAtomicOrU32(&pEntry->fFlags, PDMBLKCACHE_ENTRY_IS_DIRTY);
 
         RTSpinlockAcquire(pBlkCache->LockList);
         RTListAppend(&pBlkCache->ListDirtyNotCommitted, &pEntry->NodeNotCommitted);
@@ -827,7 +1060,7 @@ static DECLCALLBACK(int) pdmR3BlkCacheSaveExec(PVM pVM, PSSMHANDLE pSSM)
         uint32_t cEntries = 0;
         PPDMBLKCACHEENTRY pEntry;
 
-        RTSemRWRequestRead(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
+        pdmBlkCacheShardsLockWriteAll(pBlkCache);
         SSMR3PutU32(pSSM, (uint32_t)strlen(pBlkCache->pszId));
         SSMR3PutStrZ(pSSM, pBlkCache->pszId);
 
@@ -845,7 +1078,8 @@ static DECLCALLBACK(int) pdmR3BlkCacheSaveExec(PVM pVM, PSSMHANDLE pSSM)
             /* A few sanity checks. */
             AssertMsg(!pEntry->cRefs, ("The entry is still referenced\n"));
             AssertMsg(pEntry->fFlags & PDMBLKCACHE_ENTRY_IS_DIRTY, ("Entry is not dirty\n"));
-            AssertMsg(!(pEntry->fFlags & ~PDMBLKCACHE_ENTRY_IS_DIRTY), ("Invalid flags set\n"));
+            AssertMsg(!(pEntry->fFlags & ~(PDMBLKCACHE_ENTRY_IS_DIRTY | PDMBLKCACHE_ENTRY_REFERENCED)),
+                      ("Invalid flags set\n"));
             AssertMsg(!pEntry->pWaitingHead && !pEntry->pWaitingTail, ("There are waiting requests\n"));
             AssertMsg(   pEntry->pList == &pBlkCacheGlobal->LruRecentlyUsedIn
                       || pEntry->pList == &pBlkCacheGlobal->LruFrequentlyUsed,
@@ -859,7 +1093,7 @@ static DECLCALLBACK(int) pdmR3BlkCacheSaveExec(PVM pVM, PSSMHANDLE pSSM)
             SSMR3PutMem(pSSM, pEntry->pbData, pEntry->cbData);
         }
 
-        RTSemRWReleaseRead(pBlkCache->SemRWEntries);
+        pdmBlkCacheShardsUnlockWriteAll(pBlkCache);
     }
 
     pdmBlkCacheLockLeave(pBlkCacheGlobal);
@@ -939,30 +1173,45 @@ static DECLCALLBACK(int) pdmR3BlkCacheLoadExec(PVM pVM, PSSMHANDLE pSSM, uint32_
             SSMR3GetU64(pSSM, &off);
             SSMR3GetU32(pSSM, &cbEntry);
 
-            pEntry = pdmBlkCacheEntryAlloc(pBlkCache, off, cbEntry, NULL);
-            if (!pEntry)
+            /*
+             * Entries must not cross a shard stripe, states saved before the
+             * cache was sharded might contain such entries so split them up.
+             */
+            while (cbEntry > 0)
             {
-                rc = VERR_NO_MEMORY;
-                break;
+                uint32_t cbChunk = (uint32_t)RT_MIN(cbEntry, pdmBlkCacheShardStripeLeft(off));
+
+                pEntry = pdmBlkCacheEntryAlloc(pBlkCache, off, cbChunk, NULL);
+                if (!pEntry)
+                {
+                    rc = VERR_NO_MEMORY;
+                    break;
+                }
+
+                rc = SSMR3GetMem(pSSM, pEntry->pbData, cbChunk);
+                if (RT_FAILURE(rc))
+                {
+                    RTMemFree(pEntry->pbData);
+                    RTMemFree(pEntry);
+                    break;
+                }
+
+                /* Insert into the tree. */
+                bool fInserted = RTAvlrU64Insert(pdmBlkCacheEntryShardGet(pEntry)->pTree, &pEntry->Core);
+                Assert(fInserted); NOREF(fInserted);
+
+                /* Add to the dirty list. */
+                pdmBlkCacheAddDirtyEntry(pBlkCache, pEntry);
+                pdmBlkCacheEntryAddToList(&pBlkCacheGlobal->LruRecentlyUsedIn, pEntry);
+                pdmBlkCacheAdd(pBlkCacheGlobal, cbChunk);
+                pdmBlkCacheEntryRelease(pEntry);
+
+                off     += cbChunk;
+                cbEntry -= cbChunk;
             }
 
-            rc = SSMR3GetMem(pSSM, pEntry->pbData, cbEntry);
             if (RT_FAILURE(rc))
-            {
-                RTMemFree(pEntry->pbData);
-                RTMemFree(pEntry);
                 break;
-            }
-
-            /* Insert into the tree. */
-            bool fInserted = RTAvlrU64Insert(pBlkCache->pTree, &pEntry->Core);
-            Assert(fInserted); NOREF(fInserted);
-
-            /* Add to the dirty list. */
-            pdmBlkCacheAddDirtyEntry(pBlkCache, pEntry);
-            pdmBlkCacheEntryAddToList(&pBlkCacheGlobal->LruRecentlyUsedIn, pEntry);
-            pdmBlkCacheAdd(pBlkCacheGlobal, cbEntry);
-            pdmBlkCacheEntryRelease(pEntry);
             cEntries--;
         }
 
@@ -1108,6 +1357,18 @@ int pdmR3BlkCacheInit(PVM pVM)
                        STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS,
                        "/PDM/BlkCache/CacheBuffersReused",
                        STAMUNIT_COUNT, "Number of times a buffer could be reused");
+        STAMR3Register(pVM, &pBlkCacheGlobal->StatLockContention,
+                       STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS,
+                       "/PDM/BlkCache/CacheLockContention",
+                       STAMUNIT_OCCURENCES, "Number of times the global cache lock was contended");
+        STAMR3Register(pVM, &pBlkCacheGlobal->StatShardContention,
+                       STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS,
+                       "/PDM/BlkCache/CacheShardContention",
+                       STAMUNIT_OCCURENCES, "Number of times a shard lock had to wait for a writer");
+        STAMR3Register(pVM, &pBlkCacheGlobal->StatSecondChance,
+                       STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS,
+                       "/PDM/BlkCache/CacheSecondChance",
+                       STAMUNIT_OCCURENCES, "Number of referenced entries spared from eviction");
 #endif
 
         /* Initialize the critical section */
@@ -1223,31 +1484,24 @@ static int pdmR3BlkCacheRetain(PVM pVM, PPPDMBLKCACHE ppBlkCache, const char *pc
             rc = RTSpinlockCreate(&pBlkCache->LockList, RTSPINLOCK_FLAGS_INTERRUPT_UNSAFE, "pdmR3BlkCacheRetain");
             if (RT_SUCCESS(rc))
             {
-                rc = RTSemRWCreate(&pBlkCache->SemRWEntries);
+                rc = pdmBlkCacheShardsCreate(pBlkCache);
                 if (RT_SUCCESS(rc))
                 {
-                    pBlkCache->pTree  = (PAVLRU64TREE)RTMemAllocZ(sizeof(AVLRFOFFTREE));
-                    if (pBlkCache->pTree)
-                    {
 #ifdef VBOX_WITH_STATISTICS
-                        STAMR3RegisterF(pBlkCacheGlobal->pVM, &pBlkCache->StatWriteDeferred,
-                                        STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS,
-                                        STAMUNIT_COUNT, "Number of deferred writes",
-                                        "/PDM/BlkCache/%s/Cache/DeferredWrites", pBlkCache->pszId);
+                    STAMR3RegisterF(pBlkCacheGlobal->pVM, &pBlkCache->StatWriteDeferred,
+                                    STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS,
+                                    STAMUNIT_COUNT, "Number of deferred writes",
+                                    "/PDM/BlkCache/%s/Cache/DeferredWrites", pBlkCache->pszId);
 #endif
 
-                        /* Add to the list of users. */
-                        pBlkCacheGlobal->cRefs++;
-                        RTListAppend(&pBlkCacheGlobal->ListUsers, &pBlkCache->NodeCacheUser);
-                        pdmBlkCacheLockLeave(pBlkCacheGlobal);
-
-                        *ppBlkCache = pBlkCache;
-                        LogFlowFunc(("returns success\n"));
-                        return VINF_SUCCESS;
-                    }
+                    /* Add to the list of users. */
+                    pBlkCacheGlobal->cRefs++;
+                    RTListAppend(&pBlkCacheGlobal->ListUsers, &pBlkCache->NodeCacheUser);
+                    pdmBlkCacheLockLeave(pBlkCacheGlobal);
 
-                    rc = VERR_NO_MEMORY;
-                    RTSemRWDestroy(pBlkCache->SemRWEntries);
+                    *ppBlkCache = pBlkCache;
+                    LogFlowFunc(("returns success\n"));
+                    return VINF_SUCCESS;
                 }
 
                 RTSpinlockDestroy(pBlkCache->LockList);
@@ -1380,20 +1634,19 @@ static DECLCALLBACK(int) pdmBlkCacheEntryDestroy(PAVLRU64NODECORE pNode, void *p
 {
     PPDMBLKCACHEENTRY  pEntry = (PPDMBLKCACHEENTRY)pNode;
     PPDMBLKCACHEGLOBAL pCache = (PPDMBLKCACHEGLOBAL)pvUser;
-    PPDMBLKCACHE pBlkCache = pEntry->pBlkCache;
 
     while (ASMAtomicReadU32(&pEntry->fFlags) & PDMBLKCACHE_ENTRY_IO_IN_PROGRESS)
     {
         /* Leave the locks to let the I/O thread make progress but reference the entry to prevent eviction. */
         pdmBlkCacheEntryRef(pEntry);
-        RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+        pdmBlkCacheEntryUnlockWrite(pEntry);
         pdmBlkCacheLockLeave(pCache);
 
         RTThreadSleep(250);
 
         /* Re-enter all locks */
         pdmBlkCacheLockEnter(pCache);
-        RTSemRWRequestWrite(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
+        pdmBlkCacheEntryLockWrite(pEntry);
         pdmBlkCacheEntryRelease(pEntry);
     }
 
@@ -1414,6 +1667,28 @@ static DECLCALLBACK(int) pdmBlkCacheEntryDestroy(PAVLRU64NODECORE pNode, void *p
     return VINF_SUCCESS;
 }
 
+/**
+ * Destroys all entries of the given endpoint, one shard after the other.
+ *
+ * @returns nothing.
+ * @param   pBlkCache       The endpoint cache.
+ *
+ * @note The caller must own the global cache lock.
+ */
+static void pdmBlkCacheShardsDestroyEntries(PPDMBLKCACHE pBlkCache)
+{
+    PDMACFILECACHE_IS_CRITSECT_OWNER(pBlkCache->pCache);
+
+    for (unsigned i = 0; i < RT_ELEMENTS(pBlkCache->aShards); i++)
+    {
+        PPDMBLKCACHESHARD pShard = &pBlkCache->aShards[i];
+
+        pdmBlkCacheShardLockWrite(pBlkCache, pShard);
+        RTAvlrU64Destroy(pShard->pTree, pdmBlkCacheEntryDestroy, pBlkCache->pCache);
+        pdmBlkCacheShardUnlockWrite(pShard);
+    }
+}
+
 /**
  * Destroys all cache resources used by the given endpoint.
  *
@@ -1434,9 +1709,7 @@ VMMR3DECL(void) PDMR3BlkCacheRelease(PPDMBLKCACHE pBlkCache)
 
     /* Make sure nobody is accessing the cache while we delete the tree. */
     pdmBlkCacheLockEnter(pCache);
-    RTSemRWRequestWrite(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
-    RTAvlrU64Destroy(pBlkCache->pTree, pdmBlkCacheEntryDestroy, pCache);
-    RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+    pdmBlkCacheShardsDestroyEntries(pBlkCache);
 
     RTSpinlockDestroy(pBlkCache->LockList);
 
@@ -1445,9 +1718,7 @@ VMMR3DECL(void) PDMR3BlkCacheRelease(PPDMBLKCACHE pBlkCache)
 
     pdmBlkCacheLockLeave(pCache);
 
-    RTMemFree(pBlkCache->pTree);
-    pBlkCache->pTree = NULL;
-    RTSemRWDestroy(pBlkCache->SemRWEntries);
+    pdmBlkCacheShardsDestroy(pBlkCache);
 
 #ifdef VBOX_WITH_STATISTICS
     STAMR3DeregisterF(pCache->pVM->pUVM, "/PDM/BlkCache/%s/Cache/DeferredWrites", pBlkCache->pszId);
@@ -1551,11 +1822,12 @@ static PPDMBLKCACHEENTRY pdmBlkCacheGetCacheEntryByOffset(PPDMBLKCACHE pBlkCache
 {
     STAM_PROFILE_ADV_START(&pBlkCache->pCache->StatTreeGet, Cache);
 
-    RTSemRWRequestRead(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
-    PPDMBLKCACHEENTRY pEntry = (PPDMBLKCACHEENTRY)RTAvlrU64RangeGet(pBlkCache->pTree, off);
+    PPDMBLKCACHESHARD pShard = pdmBlkCacheShardGet(pBlkCache, off);
+    pdmBlkCacheShardLockRead(pBlkCache, pShard);
+    PPDMBLKCACHEENTRY pEntry = (PPDMBLKCACHEENTRY)RTAvlrU64RangeGet(pShard->pTree, off);
     if (pEntry)
         pdmBlkCacheEntryRef(pEntry);
-    RTSemRWReleaseRead(pBlkCache->SemRWEntries);
+    pdmBlkCacheShardUnlockRead(pShard);
 
     STAM_PROFILE_ADV_STOP(&pBlkCache->pCache->StatTreeGet, Cache);
 
@@ -1570,32 +1842,40 @@ static PPDMBLKCACHEENTRY pdmBlkCacheGetCacheEntryByOffset(PPDMBLKCACHE pBlkCache
  * @param   off          The offset.
  * @param   ppEntryAbove Where to store the pointer to the best fit entry above
  *                       the given offset. NULL if not required.
+ *
+ * @note Only the shard the offset belongs to is searched, so the entry returned
+ *       might be located in a later stripe. Callers clip their range to the end
+ *       of the stripe anyway.
  */
 static void pdmBlkCacheGetCacheBestFitEntryByOffset(PPDMBLKCACHE pBlkCache, uint64_t off, PPDMBLKCACHEENTRY *ppEntryAbove)
 {
     STAM_PROFILE_ADV_START(&pBlkCache->pCache->StatTreeGet, Cache);
 
-    RTSemRWRequestRead(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
+    PPDMBLKCACHESHARD pShard = pdmBlkCacheShardGet(pBlkCache, off);
+    pdmBlkCacheShardLockRead(pBlkCache, pShard);
     if (ppEntryAbove)
     {
-        *ppEntryAbove = (PPDMBLKCACHEENTRY)RTAvlrU64GetBestFit(pBlkCache->pTree, off, true /*fAbove*/);
+        *ppEntryAbove = (PPDMBLKCACHEENTRY)RTAvlrU64GetBestFit(pShard->pTree, off, true /*fAbove*/);
         if (*ppEntryAbove)
             pdmBlkCacheEntryRef(*ppEntryAbove);
     }
 
-    RTSemRWReleaseRead(pBlkCache->SemRWEntries);
+    pdmBlkCacheShardUnlockRead(pShard);
 
     STAM_PROFILE_ADV_STOP(&pBlkCache->pCache->StatTreeGet, Cache);
 }
 
 static void pdmBlkCacheInsertEntry(PPDMBLKCACHE pBlkCache, PPDMBLKCACHEENTRY pEntry)
 {
+    PPDMBLKCACHESHARD pShard = pdmBlkCacheEntryShardGet(pEntry);
+
+    Assert(pEntry->Core.KeyLast - pEntry->Core.Key < pdmBlkCacheShardStripeLeft(pEntry->Core.Key));
     STAM_PROFILE_ADV_START(&pBlkCache->pCache->StatTreeInsert, Cache);
-    RTSemRWRequestWrite(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
-    bool fInserted = RTAvlrU64Insert(pBlkCache->pTree, &pEntry->Core);
+    pdmBlkCacheShardLockWrite(pBlkCache, pShard);
+    bool fInserted = RTAvlrU64Insert(pShard->pTree, &pEntry->Core);
     AssertMsg(fInserted, ("Node was not inserted into tree\n")); NOREF(fInserted);
     STAM_PROFILE_ADV_STOP(&pBlkCache->pCache->StatTreeInsert, Cache);
-    RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+    pdmBlkCacheShardUnlockWrite(pShard);
 }
 
 /**
@@ -1647,7 +1927,8 @@ static PPDMBLKCACHEENTRY pdmBlkCacheEntryAlloc(PPDMBLKCACHE pBlkCache, uint64_t
  *
  * @returns true if the flag in fSet is set and the one in fClear is clear.
  *          false otherwise.
- *          The R/W semaphore is only held if true is returned.
+ *          The R/W semaphore of the shard the entry belongs to is only held
+ *          if true is returned.
  *
  * @param   pBlkCache   The endpoint cache instance data.
  * @param   pEntry           The entry to check the flags for.
@@ -1664,14 +1945,14 @@ DECLINLINE(bool) pdmBlkCacheEntryFlagIsSetClearAcquireLock(PPDMBLKCACHE pBlkCach
     if (fPassed)
     {
         /* Acquire the lock and check again because the completion callback might have raced us. */
-        RTSemRWRequestWrite(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
+        pdmBlkCacheShardLockWrite(pBlkCache, pdmBlkCacheEntryShardGet(pEntry));
 
         fFlags = ASMAtomicReadU32(&pEntry->fFlags);
         fPassed = ((fFlags & fSet) && !(fFlags & fClear));
 
         /* Drop the lock if we didn't passed the test. */
         if (!fPassed)
-            RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+            pdmBlkCacheEntryUnlockWrite(pEntry);
     }
 
     return fPassed;
@@ -1756,6 +2037,9 @@ static uint32_t pdmBlkCacheEntryBoundariesCalc(PPDMBLKCACHE pBlkCache,
                                                uint64_t off, uint32_t cb,
                                                uint32_t *pcbEntry)
 {
+    /* Entries never cross a shard stripe. */
+    cb = (uint32_t)RT_MIN(cb, pdmBlkCacheShardStripeLeft(off));
+
     /* Get the best fit entries around the offset */
     PPDMBLKCACHEENTRY pEntryAbove = NULL;
     pdmBlkCacheGetCacheBestFitEntryByOffset(pBlkCache, off, &pEntryAbove);
@@ -1997,7 +2281,7 @@ VMMR3DECL(int) PDMR3BlkCacheRead(PPDMBLKCACHE pBlkCache, uint64_t off,
                     pdmBlkCacheEntryWaitersAdd(pEntry, pReq,
                                                &SgBuf, offDiff, cbToRead,
                                                false /* fWrite */);
-                    RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+                    pdmBlkCacheEntryUnlockWrite(pEntry);
                 }
                 else
                 {
@@ -2005,13 +2289,12 @@ VMMR3DECL(int) PDMR3BlkCacheRead(PPDMBLKCACHE pBlkCache, uint64_t off,
                     RTSgBufCopyFromBuf(&SgBuf, pEntry->pbData + offDiff, cbToRead);
                 }
 
-                /* Move this entry to the top position */
+                /*
+                 * Mark the entry as referenced instead of moving it to the top position
+                 * which would require the global cache lock, eviction gives it a second chance.
+                 */
                 if (pEntry->pList == &pCache->LruFrequentlyUsed)
-                {
-                    pdmBlkCacheLockEnter(pCache);
-                    pdmBlkCacheEntryAddToList(&pCache->LruFrequentlyUsed, pEntry);
-                    pdmBlkCacheLockLeave(pCache);
-                }
+                    ASMAtomicOrU32(&pEntry->fFlags, PDMBLKCACHE_ENTRY_REFERENCED);
                 /* Release the entry */
                 pdmBlkCacheEntryRelease(pEntry);
             }
@@ -2047,11 +2330,9 @@ VMMR3DECL(int) PDMR3BlkCacheRead(PPDMBLKCACHE pBlkCache, uint64_t off,
                 }
                 else
                 {
-                    RTSemRWRequestWrite(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
-                    STAM_PROFILE_ADV_START(&pCache->StatTreeRemove, Cache);
-                    RTAvlrU64Remove(pBlkCache->pTree, pEntry->Core.Key);
-                    STAM_PROFILE_ADV_STOP(&pCache->StatTreeRemove, Cache);
-                    RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+                    pdmBlkCacheEntryLockWrite(pEntry);
+                    pdmBlkCacheEntryTreeRemove(pCache, pEntry);
+                    pdmBlkCacheEntryUnlockWrite(pEntry);
 
                     pdmBlkCacheLockLeave(pCache);
 
@@ -2105,17 +2386,14 @@ VMMR3DECL(int) PDMR3BlkCacheRead(PPDMBLKCACHE pBlkCache, uint64_t off,
             PPDMBLKCACHEENTRY pEntryAbove;
             pdmBlkCacheGetCacheBestFitEntryByOffset(pBlkCache, off, &pEntryAbove);
 
+            cbToRead = RT_MIN(cbRead, pdmBlkCacheShardStripeLeft(off));
             if (pEntryAbove)
             {
-                if (off + cbRead > pEntryAbove->Core.Key)
+                if (off + cbToRead > pEntryAbove->Core.Key)
                     cbToRead = pEntryAbove->Core.Key - off;
-                else
-                    cbToRead = cbRead;
 
                 pdmBlkCacheEntryRelease(pEntryAbove);
             }
-            else
-                cbToRead = cbRead;
 
             cbRead -= cbToRead;
             pdmBlkCacheRequestPassthrough(pBlkCache, pReq,
@@ -2207,7 +2485,7 @@ VMMR3DECL(int) PDMR3BlkCacheWrite(PPDMBLKCACHE pBlkCache, uint64_t off, PCRTSGBU
                         STAM_COUNTER_INC(&pBlkCache->StatWriteDeferred);
                     }
 
-                    RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+                    pdmBlkCacheEntryUnlockWrite(pEntry);
                 }
                 else /* Dirty bit not set */
                 {
@@ -2223,7 +2501,7 @@ VMMR3DECL(int) PDMR3BlkCacheWrite(PPDMBLKCACHE pBlkCache, uint64_t off, PCRTSGBU
                                                    &SgBuf, offDiff, cbToWrite,
                                                    true /* fWrite */);
                         STAM_COUNTER_INC(&pBlkCache->StatWriteDeferred);
-                        RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+                        pdmBlkCacheEntryUnlockWrite(pEntry);
                     }
                     else /* I/O in progress flag not set */
                     {
@@ -2236,13 +2514,12 @@ VMMR3DECL(int) PDMR3BlkCacheWrite(PPDMBLKCACHE pBlkCache, uint64_t off, PCRTSGBU
                     }
                 } /* Dirty bit not set */
 
-                /* Move this entry to the top position */
+                /*
+                 * Mark the entry as referenced instead of moving it to the top position
+                 * which would require the global cache lock, eviction gives it a second chance.
+                 */
                 if (pEntry->pList == &pCache->LruFrequentlyUsed)
-                {
-                    pdmBlkCacheLockEnter(pCache);
-                    pdmBlkCacheEntryAddToList(&pCache->LruFrequentlyUsed, pEntry);
-                    pdmBlkCacheLockLeave(pCache);
-                }
+                    ASMAtomicOrU32(&pEntry->fFlags, PDMBLKCACHE_ENTRY_REFERENCED);
 
                 pdmBlkCacheEntryRelease(pEntry);
             }
@@ -2278,11 +2555,9 @@ VMMR3DECL(int) PDMR3BlkCacheWrite(PPDMBLKCACHE pBlkCache, uint64_t off, PCRTSGBU
                 }
                 else
                 {
-                    RTSemRWRequestWrite(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
-                    STAM_PROFILE_ADV_START(&pCache->StatTreeRemove, Cache);
-                    RTAvlrU64Remove(pBlkCache->pTree, pEntry->Core.Key);
-                    STAM_PROFILE_ADV_STOP(&pCache->StatTreeRemove, Cache);
-                    RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+                    pdmBlkCacheEntryLockWrite(pEntry);
+                    pdmBlkCacheEntryTreeRemove(pCache, pEntry);
+                    pdmBlkCacheEntryUnlockWrite(pEntry);
 
                     pdmBlkCacheLockLeave(pCache);
 
@@ -2449,15 +2724,14 @@ VMMR3DECL(int) PDMR3BlkCacheDiscard(PPDMBLKCACHE pBlkCache, PCRTRANGE paRanges,
                                                                   PDMBLKCACHE_ENTRY_IS_DIRTY,
                                                                   0))
                     {
+                        PPDMBLKCACHESHARD pShard = pdmBlkCacheEntryShardGet(pEntry);
+
                         /* If it is dirty but not yet in progress remove it. */
                         if (!(pEntry->fFlags & PDMBLKCACHE_ENTRY_IO_IN_PROGRESS))
                         {
                             pdmBlkCacheLockEnter(pCache);
                             pdmBlkCacheEntryRemoveFromList(pEntry);
-
-                            STAM_PROFILE_ADV_START(&pCache->StatTreeRemove, Cache);
-                            RTAvlrU64Remove(pBlkCache->pTree, pEntry->Core.Key);
-                            STAM_PROFILE_ADV_STOP(&pCache->StatTreeRemove, Cache);
+                            pdmBlkCacheEntryTreeRemove(pCache, pEntry);
 
                             pdmBlkCacheLockLeave(pCache);
 
@@ -2474,7 +2748,7 @@ VMMR3DECL(int) PDMR3BlkCacheDiscard(PPDMBLKCACHE pBlkCache, PCRTRANGE paRanges,
 #endif
                         }
 
-                        RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+                        pdmBlkCacheShardUnlockWrite(pShard);
                         pdmBlkCacheEntryRelease(pEntry);
                     }
                     else /* Dirty bit not set */
@@ -2493,7 +2767,7 @@ VMMR3DECL(int) PDMR3BlkCacheDiscard(PPDMBLKCACHE pBlkCache, PCRTRANGE paRanges,
                                                        true /* fWrite */);
 #endif
                             STAM_COUNTER_INC(&pBlkCache->StatWriteDeferred);
-                            RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+                            pdmBlkCacheEntryUnlockWrite(pEntry);
                             pdmBlkCacheEntryRelease(pEntry);
                         }
                         else /* I/O in progress flag not set */
@@ -2501,11 +2775,9 @@ VMMR3DECL(int) PDMR3BlkCacheDiscard(PPDMBLKCACHE pBlkCache, PCRTRANGE paRanges,
                             pdmBlkCacheLockEnter(pCache);
                             pdmBlkCacheEntryRemoveFromList(pEntry);
 
-                            RTSemRWRequestWrite(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
-                            STAM_PROFILE_ADV_START(&pCache->StatTreeRemove, Cache);
-                            RTAvlrU64Remove(pBlkCache->pTree, pEntry->Core.Key);
-                            STAM_PROFILE_ADV_STOP(&pCache->StatTreeRemove, Cache);
-                            RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+                            pdmBlkCacheEntryLockWrite(pEntry);
+                            pdmBlkCacheEntryTreeRemove(pCache, pEntry);
+                            pdmBlkCacheEntryUnlockWrite(pEntry);
 
                             pdmBlkCacheLockLeave(pCache);
 
@@ -2518,11 +2790,9 @@ VMMR3DECL(int) PDMR3BlkCacheDiscard(PPDMBLKCACHE pBlkCache, PCRTRANGE paRanges,
                     pdmBlkCacheLockEnter(pCache);
                     pdmBlkCacheEntryRemoveFromList(pEntry);
 
-                    RTSemRWRequestWrite(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
-                    STAM_PROFILE_ADV_START(&pCache->StatTreeRemove, Cache);
-                    RTAvlrU64Remove(pBlkCache->pTree, pEntry->Core.Key);
-                    STAM_PROFILE_ADV_STOP(&pCache->StatTreeRemove, Cache);
-                    RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+                    pdmBlkCacheEntryLockWrite(pEntry);
+                    pdmBlkCacheEntryTreeRemove(pCache, pEntry);
+                    pdmBlkCacheEntryUnlockWrite(pEntry);
 
                     pdmBlkCacheLockLeave(pCache);
 
@@ -2579,8 +2849,8 @@ static void pdmBlkCacheIoXferCompleteEntry(PPDMBLKCACHE pBlkCache, PPDMBLKCACHEI
      * which protected the entry till now. */
     pdmBlkCacheEntryRef(pEntry);
 
-    RTSemRWRequestWrite(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
-    pEntry->fFlags &= ~PDMBLKCACHE_ENTRY_IO_IN_PROGRESS;
+    pdmBlkCacheEntryLockWrite(pEntry);
+    ASMAtomicAndU32(&pEntry->fFlags, ~PDMBLKCACHE_ENTRY_IO_IN_PROGRESS);
 
     /* Process waiting segment list. The data in entry might have changed in-between. */
     bool fDirty = false;
@@ -2619,7 +2889,7 @@ static void pdmBlkCacheIoXferCompleteEntry(PPDMBLKCACHE pBlkCache, PPDMBLKCACHEI
             fDirty = true;
         }
 
-        pEntry->fFlags &= ~PDMBLKCACHE_ENTRY_IS_DIRTY;
+        ASMAtomicAndU32(&pEntry->fFlags, ~PDMBLKCACHE_ENTRY_IS_DIRTY);
 
         while (pCurr)
         {
@@ -2654,7 +2924,7 @@ static void pdmBlkCacheIoXferCompleteEntry(PPDMBLKCACHE pBlkCache, PPDMBLKCACHEI
     if (fDirty)
         fCommit = pdmBlkCacheAddDirtyEntry(pBlkCache, pEntry);
 
-    RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+    pdmBlkCacheEntryUnlockWrite(pEntry);
 
     /* Dereference so that it isn't protected anymore except we issued anyother write for it. */
     pdmBlkCacheEntryRelease(pEntry);
@@ -2688,19 +2958,18 @@ VMMR3DECL(void) PDMR3BlkCacheIoXferComplete(PPDMBLKCACHE pBlkCache, PPDMBLKCACHE
 static DECLCALLBACK(int) pdmBlkCacheEntryQuiesce(PAVLRU64NODECORE pNode, void *pvUser)
 {
     PPDMBLKCACHEENTRY   pEntry    = (PPDMBLKCACHEENTRY)pNode;
-    PPDMBLKCACHE        pBlkCache = pEntry->pBlkCache;
     NOREF(pvUser);
 
     while (ASMAtomicReadU32(&pEntry->fFlags) & PDMBLKCACHE_ENTRY_IO_IN_PROGRESS)
     {
         /* Leave the locks to let the I/O thread make progress but reference the entry to prevent eviction. */
         pdmBlkCacheEntryRef(pEntry);
-        RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+        pdmBlkCacheEntryUnlockWrite(pEntry);
 
         RTThreadSleep(1);
 
         /* Re-enter all locks and drop the reference. */
-        RTSemRWRequestWrite(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
+        pdmBlkCacheEntryLockWrite(pEntry);
         pdmBlkCacheEntryRelease(pEntry);
     }
 
@@ -2722,10 +2991,15 @@ VMMR3DECL(int) PDMR3BlkCacheSuspend(PPDMBLKCACHE pBlkCache)
     ASMAtomicXchgBool(&pBlkCache->fSuspended, true);
 
     /* Wait for all I/O to complete. */
-    RTSemRWRequestWrite(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
-    rc = RTAvlrU64DoWithAll(pBlkCache->pTree, true, pdmBlkCacheEntryQuiesce, NULL);
-    AssertRC(rc);
-    RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+    for (unsigned i = 0; i < RT_ELEMENTS(pBlkCache->aShards) && RT_SUCCESS(rc); i++)
+    {
+        PPDMBLKCACHESHARD pShard = &pBlkCache->aShards[i];
+
+        pdmBlkCacheShardLockWrite(pBlkCache, pShard);
+        rc = RTAvlrU64DoWithAll(pShard->pTree, true, pdmBlkCacheEntryQuiesce, NULL);
+        AssertRC(rc);
+        pdmBlkCacheShardUnlockWrite(pShard);
+    }
 
     return rc;
 }
@@ -2756,9 +3030,7 @@ VMMR3DECL(int) PDMR3BlkCacheClear(PPDMBLKCACHE pBlkCache)
 
     /* Make sure nobody is accessing the cache while we delete the tree. */
     pdmBlkCacheLockEnter(pCache);
-    RTSemRWRequestWrite(pBlkCache->SemRWEntries, RT_INDEFINITE_WAIT);
-    RTAvlrU64Destroy(pBlkCache->pTree, pdmBlkCacheEntryDestroy, pCache);
-    RTSemRWReleaseWrite(pBlkCache->SemRWEntries);
+    pdmBlkCacheShardsDestroyEntries(pBlkCache);
 
     pdmBlkCacheLockLeave(pCache);
     return rc;
@@ -46,7 +46,9 @@
 *   Defined Constants And Macros                                                                                                 *
 *********************************************************************************************************************************/
 /** Saved state data unit version.  */
-#define PGM_SAVED_STATE_VERSION                 14
+#define PGM_SAVED_STATE_VERSION                 15
+/** Saved state data unit version before duplicate RAM page records. */
+#define PGM_SAVED_STATE_VERSION_NO_DUP_PAGES    14
 /** Saved state data unit version before the PAE PDPE registers. */
 #define PGM_SAVED_STATE_VERSION_PRE_PAE         13
 /** Saved state data unit version after this includes ballooned page flags in
@@ -87,8 +89,11 @@
 #define PGM_STATE_REC_ROM_PROT          UINT8_C(0x07)
 /** Ballooned page. No data. */
 #define PGM_STATE_REC_RAM_BALLOONED     UINT8_C(0x08)
+/** Duplicate page. The payload is the address (RTGCPHYS) of a previously
+ * saved RAM page with identical content. */
+#define PGM_STATE_REC_RAM_DUP           UINT8_C(0x09)
 /** The last record type. */
-#define PGM_STATE_REC_LAST              PGM_STATE_REC_RAM_BALLOONED
+#define PGM_STATE_REC_LAST              PGM_STATE_REC_RAM_DUP
 /** End marker. */
 #define PGM_STATE_REC_END               UINT8_C(0xff)
 /** Flag indicating that the data is preceded by the page address.
@@ -1552,6 +1557,150 @@ static void pgmR3ScanRamPages(PVM pVM, bool fFinalPass)
 }
 
 
+/**
+ * Allocates the duplicate RAM page index if not already done.
+ *
+ * Failure is not fatal, duplicate page elision is simply disabled.
+ *
+ * @param   pVM                 The cross context VM structure.
+ */
+static void pgmR3SaveDupIndexAlloc(PVM pVM)
+{
+    pVM->pgm.s.LiveSave.cDupPages = 0;
+    if (pVM->pgm.s.LiveSave.paDupIndex)
+        return;
+
+    PPGMLIVESAVEDUPENTRY paDupIndex;
+    paDupIndex = (PPGMLIVESAVEDUPENTRY)RTMemAlloc(sizeof(paDupIndex[0]) * PGMLIVESAVE_DUP_INDEX_ENTRIES);
+    if (paDupIndex)
+    {
+        for (uint32_t i = 0; i < PGMLIVESAVE_DUP_INDEX_ENTRIES; i++)
+        {
+            paDupIndex[i].uHash  = 0;
+            paDupIndex[i].GCPhys = NIL_RTGCPHYS;
+        }
+    }
+    else
+        LogRel(("PGM: Failed to allocate the duplicate page index, saving without.\n"));
+    pVM->pgm.s.LiveSave.paDupIndex = paDupIndex;
+}
+
+
+/**
+ * Frees the duplicate RAM page index.
+ *
+ * @param   pVM                 The cross context VM structure.
+ */
+static void pgmR3SaveDupIndexFree(PVM pVM)
+{
+    PPGMLIVESAVEDUPENTRY paDupIndex = pVM->pgm.s.LiveSave.paDupIndex;
+    pVM->pgm.s.LiveSave.paDupIndex = NULL;
+    RTMemFree(paDupIndex);
+}
+
+
+/**
+ * Calculates the content hash used by the duplicate RAM page index.
+ *
+ * @returns 64-bit hash of the page (FNV-1a over the qwords with a final mix
+ *          so the low bits used for indexing depend on all of the input).
+ * @param   pbPage              The page bits.
+ */
+static uint64_t pgmR3SaveDupHashPage(uint8_t const *pbPage)
+{
+    uint64_t const *pu64 = (uint64_t const *)pbPage;
+    uint64_t        uHash = UINT64_C(0xcbf29ce484222325);
+    for (uint32_t i = 0; i < PAGE_SIZE / sizeof(uint64_t); i++)
+    {
+        uHash ^= pu64[i];
+        uHash *= UINT64_C(0x100000001b3);
+    }
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xff51afd7ed558ccd);
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xc4ceb9fe1a85ec53);
+    uHash ^= uHash >> 33;
+    return uHash;
+}
+
+
+/**
+ * Looks up a previously saved RAM page with the same content as @a pbPage,
+ * registering @a GCPhys in the index if there isn't any.
+ *
+ * A candidate is only accepted if the loader is guaranteed to find the same
+ * bits at its address when processing the reference, i.e. the page must not
+ * have been modified since it was last saved in this stream.
+ *
+ * @returns true if a duplicate was found, false if not.
+ * @param   pVM                 The cross context VM structure.
+ * @param   pbPage              The page bits that are about to be saved.
+ * @param   GCPhys              The address of the page being saved.
+ * @param   uPass               The pass number.
+ * @param   pGCPhysSrc          Where to return the address of the duplicate.
+ *
+ * @remarks Caller owns the PGM lock.
+ */
+static bool pgmR3SaveDupLookup(PVM pVM, uint8_t const *pbPage, RTGCPHYS GCPhys, uint32_t uPass, PRTGCPHYS pGCPhysSrc)
+{
+    PGM_LOCK_ASSERT_OWNER(pVM);
+    PPGMLIVESAVEDUPENTRY paDupIndex = pVM->pgm.s.LiveSave.paDupIndex;
+    if (!paDupIndex)
+        return false;
+
+    uint64_t const       uHash  = pgmR3SaveDupHashPage(pbPage);
+    PPGMLIVESAVEDUPENTRY pEntry = &paDupIndex[uHash & (PGMLIVESAVE_DUP_INDEX_ENTRIES - 1)];
+    if (   pEntry->uHash == uHash
+        && pEntry->GCPhys != NIL_RTGCPHYS
+        && pEntry->GCPhys != GCPhys)
+    {
+        /*
+         * Validate the candidate.  In live passes the page must still be
+         * write monitored (or shared) so the guest hasn't touched it since it
+         * was last saved, and it must not be pending a resave.
+         */
+        PPGMPAGE     pSrcPage;
+        PPGMRAMRANGE pSrcRam;
+        int rc = pgmPhysGetPageAndRangeEx(pVM, pEntry->GCPhys, &pSrcPage, &pSrcRam);
+        if (   RT_SUCCESS(rc)
+            && PGM_PAGE_GET_TYPE(pSrcPage) == PGMPAGETYPE_RAM
+            && !PGM_RAM_RANGE_IS_AD_HOC(pSrcRam))
+        {
+            uint32_t const iSrcPage = (pEntry->GCPhys - pSrcRam->GCPhys) >> PAGE_SHIFT;
+            bool fValid = true;
+            if (pSrcRam->paLSPages)
+                fValid = !pSrcRam->paLSPages[iSrcPage].fDirty
+                      && !pSrcRam->paLSPages[iSrcPage].fIgnore;
+            if (   fValid
+                && uPass != SSM_PASS_FINAL)
+                fValid = PGM_PAGE_GET_STATE(pSrcPage) == PGM_PAGE_STATE_WRITE_MONITORED
+                      || PGM_PAGE_GET_STATE(pSrcPage) == PGM_PAGE_STATE_SHARED;
+            if (fValid)
+            {
+                PGMPAGEMAPLOCK  PgMpLck;
+                void const     *pvSrcPage;
+                rc = pgmPhysGCPhys2CCPtrInternalReadOnly(pVM, pSrcPage, pEntry->GCPhys, &pvSrcPage, &PgMpLck);
+                if (RT_SUCCESS(rc))
+                {
+                    fValid = !memcmp(pvSrcPage, pbPage, PAGE_SIZE);
+                    pgmPhysReleaseInternalPageMappingLock(pVM, &PgMpLck);
+                    if (fValid)
+                    {
+                        *pGCPhysSrc = pEntry->GCPhys;
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    /* No usable duplicate, make this page the representative for its hash. */
+    pEntry->uHash  = uHash;
+    pEntry->GCPhys = GCPhys;
+    return false;
+}
+
+
 /**
  * Save quiescent RAM pages.
  *
@@ -1658,6 +1807,9 @@ static int pgmR3SaveRamPages(PVM pVM, PSSMHANDLE pSSM, bool fLiveSave, uint32_t
                         uint8_t         abPage[PAGE_SIZE];
                         PGMPAGEMAPLOCK  PgMpLck;
                         void const     *pvPage;
+                        bool            fZeroBits = false;
+                        bool            fDup      = false;
+                        RTGCPHYS        GCPhysSrc = NIL_RTGCPHYS;
                         rc = pgmPhysGCPhys2CCPtrInternalReadOnly(pVM, pCurPage, GCPhys, &pvPage, &PgMpLck);
                         if (RT_SUCCESS(rc))
                         {
@@ -1667,12 +1819,30 @@ static int pgmR3SaveRamPages(PVM pVM, PSSMHANDLE pSSM, bool fLiveSave, uint32_t
                                 pgmR3StateVerifyCrc32ForPage(abPage, pCur, paLSPages, iPage, "save#3");
 #endif
                             pgmPhysReleaseInternalPageMappingLock(pVM, &PgMpLck);
+
+                            /* Look for an identical page we've already saved
+                               while we still own the lock. */
+                            fZeroBits = ASMMemIsZeroPage(abPage);
+                            if (!fZeroBits && !fFTMDeltaSaveActive)
+                                fDup = pgmR3SaveDupLookup(pVM, abPage, GCPhys, uPass, &GCPhysSrc);
                         }
                         pgmUnlock(pVM);
                         AssertLogRelMsgRCReturn(rc, ("rc=%Rrc GCPhys=%RGp\n", rc, GCPhys), rc);
 
                         /* Try save some memory when restoring. */
-                        if (!ASMMemIsZeroPage(pvPage))
+                        if (fDup)
+                        {
+                            if (GCPhys == GCPhysLast + PAGE_SIZE)
+                                SSMR3PutU8(pSSM, PGM_STATE_REC_RAM_DUP);
+                            else
+                            {
+                                SSMR3PutU8(pSSM, PGM_STATE_REC_RAM_DUP | PGM_STATE_REC_FLAG_ADDR);
+                                SSMR3PutGCPhys(pSSM, GCPhys);
+                            }
+                            rc = SSMR3PutGCPhys(pSSM, GCPhysSrc);
+                            pVM->pgm.s.LiveSave.cDupPages++;
+                        }
+                        else if (!fZeroBits)
                         {
                             if (fFTMDeltaSaveActive)
                             {
@@ -2041,6 +2211,7 @@ static DECLCALLBACK(int) pgmR3LivePrep(PVM pVM, PSSMHANDLE pSSM)
     pVM->pgm.s.LiveSave.cSavedPages       = 0;
     pVM->pgm.s.LiveSave.uSaveStartNS      = RTTimeNanoTS();
     pVM->pgm.s.LiveSave.cPagesPerSecond   = 8192;
+    pgmR3SaveDupIndexAlloc(pVM);
 
     /*
      * Per page type.
@@ -2100,6 +2271,7 @@ static DECLCALLBACK(int) pgmR3SaveExec(PVM pVM, PSSMHANDLE pSSM)
         }
         else
         {
+            pgmR3SaveDupIndexAlloc(pVM);
             rc = pgmR3SaveRamConfig(pVM, pSSM);
             if (RT_SUCCESS(rc))
                 rc = pgmR3SaveRomRanges(pVM, pSSM);
@@ -2136,6 +2308,7 @@ static DECLCALLBACK(int) pgmR3SaveDone(PVM pVM, PSSMHANDLE pSSM)
         pgmR3DoneMmio2Pages(pVM);
         pgmR3DoneRamPages(pVM);
     }
+    pgmR3SaveDupIndexFree(pVM);
 
     /*
      * Clear the live save indicator and disengage write monitoring.
@@ -2677,6 +2850,7 @@ static int pgmR3LoadMemory(PVM pVM, PSSMHANDLE pSSM, uint32_t uVersion, uint32_t
             case PGM_STATE_REC_RAM_ZERO:
             case PGM_STATE_REC_RAM_RAW:
             case PGM_STATE_REC_RAM_BALLOONED:
+            case PGM_STATE_REC_RAM_DUP:
             {
                 /*
                  * Get the address and resolve it into a page descriptor.
@@ -2782,6 +2956,40 @@ static int pgmR3LoadMemory(PVM pVM, PSSMHANDLE pSSM, uint32_t uVersion, uint32_t
                         break;
                     }
 
+                    case PGM_STATE_REC_RAM_DUP:
+                    {
+                        /* The source page has already been restored from an
+                           earlier record in the stream, copy its bits. */
+                        AssertLogRelMsgReturn(uVersion > PGM_SAVED_STATE_VERSION_NO_DUP_PAGES, ("%#x uVersion=%u\n", u8, uVersion),
+                                              VERR_SSM_DATA_UNIT_FORMAT_CHANGED);
+                        RTGCPHYS GCPhysSrc;
+                        rc = SSMR3GetGCPhys(pSSM, &GCPhysSrc);
+                        if (RT_FAILURE(rc))
+                            return rc;
+                        AssertLogRelMsgReturn(   !(GCPhysSrc & PAGE_OFFSET_MASK)
+                                              && GCPhysSrc != GCPhys,
+                                              ("GCPhysSrc=%RGp GCPhys=%RGp\n", GCPhysSrc, GCPhys), VERR_SSM_DATA_UNIT_FORMAT_CHANGED);
+                        PPGMPAGE pSrcPage = pgmPhysGetPage(pVM, GCPhysSrc);
+                        AssertLogRelMsgReturn(pSrcPage && PGM_PAGE_GET_TYPE(pSrcPage) == PGMPAGETYPE_RAM,
+                                              ("GCPhysSrc=%RGp GCPhys=%RGp\n", GCPhysSrc, GCPhys), VERR_PGM_LOAD_UNEXPECTED_PAGE_TYPE);
+
+                        PGMPAGEMAPLOCK PgMpLckSrc;
+                        void const    *pvSrcPage;
+                        rc = pgmPhysGCPhys2CCPtrInternalReadOnly(pVM, pSrcPage, GCPhysSrc, &pvSrcPage, &PgMpLckSrc);
+                        AssertLogRelMsgRCReturn(rc, ("GCPhysSrc=%RGp %R[pgmpage] rc=%Rrc\n", GCPhysSrc, pSrcPage, rc), rc);
+                        PGMPAGEMAPLOCK PgMpLck;
+                        void          *pvDstPage;
+                        rc = pgmPhysGCPhys2CCPtrInternal(pVM, pPage, GCPhys, &pvDstPage, &PgMpLck);
+                        if (RT_SUCCESS(rc))
+                        {
+                            memcpy(pvDstPage, pvSrcPage, PAGE_SIZE);
+                            pgmPhysReleaseInternalPageMappingLock(pVM, &PgMpLck);
+                        }
+                        pgmPhysReleaseInternalPageMappingLock(pVM, &PgMpLckSrc);
+                        AssertLogRelMsgRCReturn(rc, ("GCPhys=%RGp %R[pgmpage] rc=%Rrc\n", GCPhys, pPage, rc), rc);
+                        break;
+                    }
+
                     default:
                         AssertMsgFailedReturn(("%#x\n", u8), VERR_PGM_SAVED_REC_TYPE);
                 }
@@ -3144,11 +3352,13 @@ static DECLCALLBACK(int) pgmR3Load(PVM pVM, PSSMHANDLE pSSM, uint32_t uVersion,
      */
     if (   (   uPass != SSM_PASS_FINAL
             && uVersion != PGM_SAVED_STATE_VERSION
+            && uVersion != PGM_SAVED_STATE_VERSION_NO_DUP_PAGES
             && uVersion != PGM_SAVED_STATE_VERSION_PRE_PAE
             && uVersion != PGM_SAVED_STATE_VERSION_BALLOON_BROKEN
             && uVersion != PGM_SAVED_STATE_VERSION_PRE_BALLOON
             && uVersion != PGM_SAVED_STATE_VERSION_NO_RAM_CFG)
         || (   uVersion != PGM_SAVED_STATE_VERSION
+            && uVersion != PGM_SAVED_STATE_VERSION_NO_DUP_PAGES
             && uVersion != PGM_SAVED_STATE_VERSION_PRE_PAE
             && uVersion != PGM_SAVED_STATE_VERSION_BALLOON_BROKEN
             && uVersion != PGM_SAVED_STATE_VERSION_PRE_BALLOON
@@ -112,7 +112,12 @@
  *       - type 5: Named data - length prefixed name followed by the data. This
  *                 type is not implemented yet as we're missing the API part, so
  *                 the type assignment is tentative.
- *       - types 6 thru 15 are current undefined.
+ *       - type 6: Raw data segment compressed by LZF in independent chunks.
+ *                 The data starts with a 32-bit field containing the length
+ *                 of the uncompressed segment, followed by a table of 32-bit
+ *                 compressed chunk sizes and then the chunk data.  See
+ *                 sec_ssm_zip_multi.
+ *       - types 7 thru 15 are current undefined.
  *   - bit 4: Important (set), can be skipped (clear).
  *   - bit 5: Undefined flag, must be zero.
  *   - bit 6: Undefined flag, must be zero.
@@ -128,6 +133,24 @@
  * needed updating after the data was written.)
  *
  *
+ * @section sec_ssm_zip_multi      Multi-stream Compression
+ *
+ * The regular save code compresses the unit data one SSM_ZIP_BLOCK_SIZE block
+ * at a time on the thread doing the saving, which makes saving a VM with lots
+ * of RAM CPU bound on a single core.  When /SSM/ZipThreads is non-zero, all
+ * the unit data is instead collected into SSM_ZIP_MULTI_SEG_SIZE segments
+ * that are split into SSM_ZIP_MULTI_CHUNK_SIZE chunks.  The chunks are
+ * compressed independently of one another by a request thread pool, while the
+ * saving thread fills the next segment.  Each segment is emitted as a single
+ * type 6 record in the order it was produced, so the stream stays strictly
+ * sequential.  When loading, the chunks of a segment are decompressed in
+ * parallel in the same manner.
+ *
+ * Since older readers do not know the record type, such streams are marked by
+ * SSMFILEHDR_FLAGS_STREAM_ZIP_MULTI in the file header so they are rejected
+ * upfront rather than half way into loading the state.
+ *
+ *
  * @section sec_ssm_future          Future Changes
  *
  * There are plans to extend SSM to make it easier to be both backwards and
@@ -145,6 +168,7 @@
 *********************************************************************************************************************************/
 #define LOG_GROUP LOG_GROUP_SSM
 #include <VBox/vmm/ssm.h>
+#include <VBox/vmm/cfgm.h>
 #include <VBox/vmm/dbgf.h>
 #include <VBox/vmm/pdmapi.h>
 #include <VBox/vmm/pdmcritsect.h>
@@ -161,7 +185,9 @@
 #include <iprt/crc.h>
 #include <iprt/file.h>
 #include <iprt/mem.h>
+#include <iprt/mp.h>
 #include <iprt/param.h>
+#include <iprt/req.h>
 #include <iprt/thread.h>
 #include <iprt/semaphore.h>
 #include <iprt/string.h>
@@ -192,6 +218,8 @@
 #define SSMFILEHDR_FLAGS_STREAM_CRC32           RT_BIT_32(0)
 /** Indicates that the file was produced by a live save. */
 #define SSMFILEHDR_FLAGS_STREAM_LIVE_SAVE       RT_BIT_32(1)
+/** The unit data may contain SSM_REC_TYPE_RAW_LZF_MULTI records. */
+#define SSMFILEHDR_FLAGS_STREAM_ZIP_MULTI       RT_BIT_32(2)
 /** @} */
 
 /** The directory magic. */
@@ -227,10 +255,16 @@
 /** Named data items.
  * A length prefix zero terminated string (i.e. max 255) followed by the data.  */
 #define SSM_REC_TYPE_NAMED                      5
+/** Raw data segment compressed by LZF in independently compressed chunks.
+ * The record header is followed by a 32-bit field containing the size of the
+ * uncompressed segment, a table with the 32-bit compressed size of each chunk
+ * (SSM_ZIP_MULTI_CHUNK_STORED set if stored uncompressed), and then the
+ * chunk data.  See sec_ssm_zip_multi. */
+#define SSM_REC_TYPE_RAW_LZF_MULTI              6
 /** Macro for validating the record type.
  * This can be used with the flags+type byte, no need to mask out the type first. */
 #define SSM_REC_TYPE_IS_VALID(u8Type)           (   ((u8Type) & SSM_REC_TYPE_MASK) >  SSM_REC_TYPE_INVALID \
-                                                 && ((u8Type) & SSM_REC_TYPE_MASK) <= SSM_REC_TYPE_NAMED )
+                                                 && ((u8Type) & SSM_REC_TYPE_MASK) <= SSM_REC_TYPE_RAW_LZF_MULTI )
 /** @} */
 
 /** The flag mask. */
@@ -285,6 +319,24 @@
 #define SSM_ZIP_BLOCK_SIZE                      _4K
 AssertCompile(SSM_ZIP_BLOCK_SIZE / _1K * _1K == SSM_ZIP_BLOCK_SIZE);
 
+/** The number of bytes in a multi-stream compression chunk.
+ * Each chunk is compressed independently of the others. */
+#define SSM_ZIP_MULTI_CHUNK_SIZE                _64K
+/** The max number of chunks in a SSM_REC_TYPE_RAW_LZF_MULTI segment.
+ * This also limits the number of worker threads. */
+#define SSM_ZIP_MULTI_MAX_CHUNKS                16
+/** The max number of uncompressed bytes in a multi-stream segment. */
+#define SSM_ZIP_MULTI_SEG_SIZE                  (SSM_ZIP_MULTI_CHUNK_SIZE * SSM_ZIP_MULTI_MAX_CHUNKS)
+/** The max size of the segment and chunk table in a
+ * SSM_REC_TYPE_RAW_LZF_MULTI record. */
+#define SSM_ZIP_MULTI_HDR_MAX                   (sizeof(uint32_t) * (1 + SSM_ZIP_MULTI_MAX_CHUNKS))
+/** Chunk table flag indicating that the chunk is stored uncompressed. */
+#define SSM_ZIP_MULTI_CHUNK_STORED              RT_BIT_32(31)
+/** The number of segments in the save pipeline (one being filled, one being
+ * compressed). */
+#define SSM_ZIP_MULTI_SEGS                      2
+AssertCompile(SSM_ZIP_MULTI_SEG_SIZE + SSM_ZIP_MULTI_HDR_MAX < 0x04000000);
+
 
 /**
  * Asserts that the handle is writable and returns with VERR_SSM_INVALID_STATE
@@ -447,6 +499,53 @@ typedef struct SSMSTRM
 typedef SSMSTRM *PSSMSTRM;
 
 
+/**
+ * A multi-stream compression segment.
+ */
+typedef struct SSMZIPSEG
+{
+    /** The number of uncompressed bytes in pbData. */
+    uint32_t                cbData;
+    /** The number of chunks in the segment (valid while pending). */
+    uint32_t                cChunks;
+    /** Set if the chunks have been handed to the worker threads. */
+    bool                    fPending;
+    /** The compressed chunk sizes, SSM_ZIP_MULTI_CHUNK_STORED set if
+     *  compression didn't pay off. */
+    uint32_t                acbChunks[SSM_ZIP_MULTI_MAX_CHUNKS];
+    /** The offset of each chunk in pbCompr. */
+    uint32_t                aoffChunks[SSM_ZIP_MULTI_MAX_CHUNKS];
+    /** The outstanding worker requests, NIL_RTREQ if done inline. */
+    PRTREQ                  apReqs[SSM_ZIP_MULTI_MAX_CHUNKS];
+    /** The uncompressed data (SSM_ZIP_MULTI_SEG_SIZE bytes). */
+    uint8_t                *pbData;
+    /** The compressed data (SSM_ZIP_MULTI_SEG_SIZE + SSM_ZIP_MULTI_HDR_MAX
+     *  bytes).  When saving, chunk i is at offset i * SSM_ZIP_MULTI_CHUNK_SIZE,
+     *  when loading this holds the entire record. */
+    uint8_t                *pbCompr;
+} SSMZIPSEG;
+/** Pointer to a multi-stream compression segment. */
+typedef SSMZIPSEG *PSSMZIPSEG;
+
+
+/**
+ * Multi-stream compression state, see sec_ssm_zip_multi.
+ */
+typedef struct SSMZIPMULTI
+{
+    /** The worker thread pool. */
+    RTREQPOOL               hPool;
+    /** Save: The index of the segment being filled. */
+    uint32_t                iCurSeg;
+    /** Load: The read offset into aSegs[0].pbData. */
+    uint32_t                offRead;
+    /** The segments.  Loading only uses the first one. */
+    SSMZIPSEG               aSegs[SSM_ZIP_MULTI_SEGS];
+} SSMZIPMULTI;
+/** Pointer to the multi-stream compression state. */
+typedef SSMZIPMULTI *PSSMZIPMULTI;
+
+
 /**
  * Handle structure.
  */
@@ -500,6 +599,8 @@ typedef struct SSMHANDLE
     unsigned                uReportedLivePercent;
     /** The filename, NULL if remote stream. */
     const char             *pszFilename;
+    /** Multi-stream compression state, NULL if not used (yet). */
+    PSSMZIPMULTI            pZipMulti;
 
     union
     {
@@ -893,6 +994,7 @@ static int                  ssmR3StrmReadMore(PSSMSTRM pStrm);
 
 #ifndef SSM_STANDALONE
 static int                  ssmR3DataFlushBuffer(PSSMHANDLE pSSM);
+static int                  ssmR3ZipMultiFlush(PSSMHANDLE pSSM);
 #endif
 static int                  ssmR3DataReadRecHdrV2(PSSMHANDLE pSSM);
 
@@ -937,6 +1039,25 @@ static int ssmR3LazyInit(PVM pVM)
                                    NULL /*pfnSavePrep*/, NULL /*pfnSaveExec*/,     NULL /*pfnSaveDone*/,
                                    NULL /*pfnSavePrep*/, ssmR3LiveControlLoadExec, NULL /*pfnSaveDone*/);
 
+    /*
+     * Read the configuration.
+     */
+    if (RT_SUCCESS(rc))
+    {
+        PCFGMNODE pCfgSSM = CFGMR3GetChild(CFGMR3GetRoot(pVM), "SSM");
+
+        /** @cfgm{/SSM/ZipThreads, uint32_t, 0, SSM_ZIP_MULTI_MAX_CHUNKS, 0}
+         * The number of worker threads for compressing the saved state data
+         * in parallel, see sec_ssm_zip_multi.  Zero selects the classic single
+         * threaded compression, which older VirtualBox versions can read. */
+        rc = CFGMR3QueryU32Def(pCfgSSM, "ZipThreads", &pVM->ssm.s.cZipThreads, 0);
+        if (RT_SUCCESS(rc) && pVM->ssm.s.cZipThreads > SSM_ZIP_MULTI_MAX_CHUNKS)
+        {
+            LogRel(("SSM: ZipThreads=%u is too high, using %u\n", pVM->ssm.s.cZipThreads, SSM_ZIP_MULTI_MAX_CHUNKS));
+            pVM->ssm.s.cZipThreads = SSM_ZIP_MULTI_MAX_CHUNKS;
+        }
+    }
+
     /*
      * Initialize the cancellation critsect now.
      */
@@ -3270,6 +3391,176 @@ DECLINLINE(bool) ssmR3IsHostMsc32(PSSMHANDLE pSSM)
     return SSM_HOST_IS_MSC_32;
 }
 
+
+/**
+ * Creates the multi-stream compression state.
+ *
+ * @returns VBox status code.
+ * @param   pSSM            The saved state handle.
+ * @param   cThreads        The max number of worker threads.
+ * @param   cSegs           The number of segments to allocate buffers for.
+ */
+static int ssmR3ZipMultiCreate(PSSMHANDLE pSSM, uint32_t cThreads, uint32_t cSegs)
+{
+    Assert(!pSSM->pZipMulti);
+    Assert(cSegs > 0 && cSegs <= SSM_ZIP_MULTI_SEGS);
+
+    PSSMZIPMULTI pZip = (PSSMZIPMULTI)RTMemAllocZ(sizeof(*pZip));
+    if (!pZip)
+        return VERR_NO_MEMORY;
+    pZip->hPool = NIL_RTREQPOOL;
+
+    int rc = VINF_SUCCESS;
+    for (uint32_t iSeg = 0; iSeg < cSegs && RT_SUCCESS(rc); iSeg++)
+    {
+        pZip->aSegs[iSeg].pbData  = (uint8_t *)RTMemPageAlloc(SSM_ZIP_MULTI_SEG_SIZE);
+        pZip->aSegs[iSeg].pbCompr = (uint8_t *)RTMemPageAlloc(SSM_ZIP_MULTI_SEG_SIZE + SSM_ZIP_MULTI_HDR_MAX);
+        if (!pZip->aSegs[iSeg].pbData || !pZip->aSegs[iSeg].pbCompr)
+            rc = VERR_NO_MEMORY;
+    }
+    if (RT_SUCCESS(rc))
+        rc = RTReqPoolCreate(RT_MAX(cThreads, 1), RT_MS_1SEC /*cMsMinIdle*/,
+                             UINT32_MAX /*cThreadsPushBackThreshold*/, 0 /*cMsMaxPushBack*/,
+                             "SSMZip", &pZip->hPool);
+    pSSM->pZipMulti = pZip;
+    return rc;
+}
+
+
+/**
+ * Waits for the worker requests of a segment to complete.
+ *
+ * @returns VBox status code, the first failure reported by a worker.
+ * @param   pSeg            The segment.
+ */
+static int ssmR3ZipMultiWaitSeg(PSSMZIPSEG pSeg)
+{
+    int rc = VINF_SUCCESS;
+    if (pSeg->fPending)
+    {
+        for (uint32_t iChunk = 0; iChunk < pSeg->cChunks; iChunk++)
+        {
+            PRTREQ pReq = pSeg->apReqs[iChunk];
+            if (pReq != NIL_RTREQ)
+            {
+                int rc2 = RTReqWait(pReq, RT_INDEFINITE_WAIT);
+                if (RT_SUCCESS(rc2))
+                    rc2 = RTReqGetStatus(pReq);
+                if (RT_FAILURE(rc2) && RT_SUCCESS(rc))
+                    rc = rc2;
+                RTReqRelease(pReq);
+                pSeg->apReqs[iChunk] = NIL_RTREQ;
+            }
+        }
+        pSeg->fPending = false;
+    }
+    return rc;
+}
+
+
+/**
+ * Hands the chunks of a segment to the worker threads, doing them inline
+ * should the pool fail us.
+ *
+ * @param   pZip            The multi-stream compression state.
+ * @param   pSeg            The segment.  cbData must be set.
+ * @param   pfnWorker       The chunk worker.
+ */
+static void ssmR3ZipMultiSubmitSeg(PSSMZIPMULTI pZip, PSSMZIPSEG pSeg,
+                                   DECLCALLBACKPTR(int, pfnWorker)(PSSMZIPSEG pSeg, uintptr_t iChunk))
+{
+    Assert(!pSeg->fPending);
+    Assert(pSeg->cbData > 0 && pSeg->cbData <= SSM_ZIP_MULTI_SEG_SIZE);
+
+    pSeg->cChunks  = (pSeg->cbData + SSM_ZIP_MULTI_CHUNK_SIZE - 1) / SSM_ZIP_MULTI_CHUNK_SIZE;
+    pSeg->fPending = true;
+    for (uint32_t iChunk = 0; iChunk < pSeg->cChunks; iChunk++)
+    {
+        pSeg->apReqs[iChunk] = NIL_RTREQ;
+        int rc = VERR_NOT_SUPPORTED;
+        if (pSeg->cChunks > 1)
+            rc = RTReqPoolCallEx(pZip->hPool, 0 /*cMillies*/, &pSeg->apReqs[iChunk], RTREQFLAGS_IPRT_STATUS,
+                                 (PFNRT)pfnWorker, 2, pSeg, (uintptr_t)iChunk);
+        if (rc != VINF_SUCCESS && rc != VERR_TIMEOUT)
+        {
+            pSeg->apReqs[iChunk] = NIL_RTREQ;
+            pfnWorker(pSeg, iChunk);
+        }
+    }
+}
+
+
+/**
+ * Destroys the multi-stream compression state, if any.
+ *
+ * @param   pSSM            The saved state handle.
+ */
+static void ssmR3ZipMultiDestroy(PSSMHANDLE pSSM)
+{
+    PSSMZIPMULTI pZip = pSSM->pZipMulti;
+    if (pZip)
+    {
+        pSSM->pZipMulti = NULL;
+        for (uint32_t iSeg = 0; iSeg < RT_ELEMENTS(pZip->aSegs); iSeg++)
+        {
+            ssmR3ZipMultiWaitSeg(&pZip->aSegs[iSeg]);
+            RTMemPageFree(pZip->aSegs[iSeg].pbData, SSM_ZIP_MULTI_SEG_SIZE);
+            RTMemPageFree(pZip->aSegs[iSeg].pbCompr, SSM_ZIP_MULTI_SEG_SIZE + SSM_ZIP_MULTI_HDR_MAX);
+        }
+        RTReqPoolRelease(pZip->hPool);
+        RTMemFree(pZip);
+    }
+}
+
+
+/**
+ * Returns the number of decompressed multi-stream segment bytes not yet
+ * consumed.
+ *
+ * @returns Byte count.
+ * @param   pSSM            The saved state handle.
+ */
+DECLINLINE(uint32_t) ssmR3ZipMultiReadLeft(PSSMHANDLE pSSM)
+{
+    PSSMZIPMULTI pZip = pSSM->pZipMulti;
+    return pZip ? pZip->aSegs[0].cbData - pZip->offRead : 0;
+}
+
+
+/**
+ * Copies data out of the decompressed multi-stream segment.
+ *
+ * @returns Number of bytes copied.
+ * @param   pSSM            The saved state handle.
+ * @param   pvDst           Where to copy the data.
+ * @param   cbDst           The max number of bytes to copy.
+ */
+static uint32_t ssmR3ZipMultiRead(PSSMHANDLE pSSM, void *pvDst, size_t cbDst)
+{
+    PSSMZIPMULTI   pZip     = pSSM->pZipMulti;
+    uint32_t const cbToCopy = (uint32_t)RT_MIN(cbDst, pZip->aSegs[0].cbData - pZip->offRead);
+    memcpy(pvDst, &pZip->aSegs[0].pbData[pZip->offRead], cbToCopy);
+    pZip->offRead += cbToCopy;
+    return cbToCopy;
+}
+
+
+/**
+ * Drops whatever is left of the decompressed multi-stream segment.
+ *
+ * @param   pSSM            The saved state handle.
+ */
+DECLINLINE(void) ssmR3ZipMultiReadReset(PSSMHANDLE pSSM)
+{
+    PSSMZIPMULTI pZip = pSSM->pZipMulti;
+    if (pZip)
+    {
+        pZip->aSegs[0].cbData = 0;
+        pZip->offRead         = 0;
+    }
+}
+
+
 #ifndef SSM_STANDALONE
 
 /**
@@ -3283,6 +3574,8 @@ static int ssmR3DataWriteFinish(PSSMHANDLE pSSM)
 {
     //Log2(("ssmR3DataWriteFinish: %#010llx start\n", ssmR3StrmTell(&pSSM->Strm)));
     int rc = ssmR3DataFlushBuffer(pSSM);
+    if (RT_SUCCESS(rc) && pSSM->pZipMulti)
+        rc = ssmR3ZipMultiFlush(pSSM);
     if (RT_SUCCESS(rc))
     {
         pSSM->offUnit     = UINT64_MAX;
@@ -3416,6 +3709,150 @@ static int ssmR3DataWriteRecHdr(PSSMHANDLE pSSM, size_t cb, uint8_t u8TypeAndFla
 }
 
 
+/**
+ * Request thread pool worker that compresses one chunk of a segment.
+ *
+ * @returns VINF_SUCCESS.
+ * @param   pSeg            The segment.
+ * @param   iChunk          The chunk number.
+ */
+static DECLCALLBACK(int) ssmR3ZipMultiCompressChunk(PSSMZIPSEG pSeg, uintptr_t iChunk)
+{
+    uint32_t const off     = (uint32_t)iChunk * SSM_ZIP_MULTI_CHUNK_SIZE;
+    uint32_t const cbChunk = RT_MIN(pSeg->cbData - off, SSM_ZIP_MULTI_CHUNK_SIZE);
+    size_t         cbCompr = cbChunk - cbChunk / 16;
+    int rc = RTZipBlockCompress(RTZIPTYPE_LZF, RTZIPLEVEL_FAST, 0 /*fFlags*/,
+                                &pSeg->pbData[off], cbChunk,
+                                &pSeg->pbCompr[off], cbCompr, &cbCompr);
+    if (RT_SUCCESS(rc))
+        pSeg->acbChunks[iChunk] = (uint32_t)cbCompr;
+    else
+        pSeg->acbChunks[iChunk] = cbChunk | SSM_ZIP_MULTI_CHUNK_STORED; /* Doesn't compress, store it. */
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Waits for a pending segment to be compressed and writes it as a
+ * SSM_REC_TYPE_RAW_LZF_MULTI record.
+ *
+ * @returns VBox status code. Sets pSSM->rc on failure.
+ * @param   pSSM            The saved state handle.
+ * @param   pSeg            The segment.
+ */
+static int ssmR3ZipMultiWriteSeg(PSSMHANDLE pSSM, PSSMZIPSEG pSeg)
+{
+    int rc = ssmR3ZipMultiWaitSeg(pSeg);
+    if (RT_SUCCESS(rc))
+        rc = pSSM->rc;
+    if (RT_SUCCESS(rc))
+    {
+        /*
+         * Calc the record size and write the header and chunk table.
+         */
+        uint32_t const cChunks = pSeg->cChunks;
+        size_t         cbRec   = sizeof(uint32_t) * (1 + cChunks);
+        for (uint32_t iChunk = 0; iChunk < cChunks; iChunk++)
+            cbRec += pSeg->acbChunks[iChunk] & ~SSM_ZIP_MULTI_CHUNK_STORED;
+
+        rc = ssmR3DataWriteRecHdr(pSSM, cbRec, SSM_REC_FLAGS_FIXED | SSM_REC_FLAGS_IMPORTANT | SSM_REC_TYPE_RAW_LZF_MULTI);
+        if (RT_SUCCESS(rc))
+            rc = ssmR3DataWriteRaw(pSSM, &pSeg->cbData, sizeof(pSeg->cbData));
+        if (RT_SUCCESS(rc))
+            rc = ssmR3DataWriteRaw(pSSM, &pSeg->acbChunks[0], sizeof(pSeg->acbChunks[0]) * cChunks);
+
+        /*
+         * The chunks.
+         */
+        for (uint32_t iChunk = 0; iChunk < cChunks && RT_SUCCESS(rc); iChunk++)
+        {
+            uint32_t const off = iChunk * SSM_ZIP_MULTI_CHUNK_SIZE;
+            if (pSeg->acbChunks[iChunk] & SSM_ZIP_MULTI_CHUNK_STORED)
+                rc = ssmR3DataWriteRaw(pSSM, &pSeg->pbData[off], pSeg->acbChunks[iChunk] & ~SSM_ZIP_MULTI_CHUNK_STORED);
+            else
+                rc = ssmR3DataWriteRaw(pSSM, &pSeg->pbCompr[off], pSeg->acbChunks[iChunk]);
+        }
+        Log3(("ssmR3ZipMultiWriteSeg: %08llx|%08llx: cbData=%#x cbRec=%#zx cChunks=%u\n",
+              ssmR3StrmTell(&pSSM->Strm), pSSM->offUnit, pSeg->cbData, cbRec, cChunks));
+    }
+    pSeg->cbData = 0;
+
+    if (RT_FAILURE(rc) && RT_SUCCESS(pSSM->rc))
+        pSSM->rc = rc;
+    return rc;
+}
+
+
+/**
+ * Adds unit data to the current multi-stream compression segment, handing
+ * full segments to the worker threads and writing the previous one.
+ *
+ * @returns VBox status code. Sets pSSM->rc on failure.
+ * @param   pSSM            The saved state handle.
+ * @param   pvBuf           The bits to write.
+ * @param   cbBuf           The number of bytes to write.
+ */
+static int ssmR3ZipMultiWrite(PSSMHANDLE pSSM, const void *pvBuf, size_t cbBuf)
+{
+    PSSMZIPMULTI pZip = pSSM->pZipMulti;
+    while (cbBuf > 0)
+    {
+        PSSMZIPSEG pSeg     = &pZip->aSegs[pZip->iCurSeg];
+        uint32_t   cbToCopy = (uint32_t)RT_MIN(SSM_ZIP_MULTI_SEG_SIZE - pSeg->cbData, cbBuf);
+        memcpy(&pSeg->pbData[pSeg->cbData], pvBuf, cbToCopy);
+        pSeg->cbData += cbToCopy;
+        pvBuf  = (uint8_t const *)pvBuf + cbToCopy;
+        cbBuf -= cbToCopy;
+
+        if (pSeg->cbData == SSM_ZIP_MULTI_SEG_SIZE)
+        {
+            /* Compress it in the background while we write the previous
+               one and fill the next. */
+            ssmR3ZipMultiSubmitSeg(pZip, pSeg, ssmR3ZipMultiCompressChunk);
+            pZip->iCurSeg = (pZip->iCurSeg + 1) % RT_ELEMENTS(pZip->aSegs);
+            PSSMZIPSEG pNext = &pZip->aSegs[pZip->iCurSeg];
+            if (pNext->fPending)
+            {
+                int rc = ssmR3ZipMultiWriteSeg(pSSM, pNext);
+                if (RT_FAILURE(rc))
+                    return rc;
+            }
+        }
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Compresses and writes all the segments at the end of a data unit.
+ *
+ * @returns VBox status code. Sets pSSM->rc on failure.
+ * @param   pSSM            The saved state handle.
+ */
+static int ssmR3ZipMultiFlush(PSSMHANDLE pSSM)
+{
+    PSSMZIPMULTI pZip = pSSM->pZipMulti;
+    PSSMZIPSEG   pCur = &pZip->aSegs[pZip->iCurSeg];
+    if (pCur->cbData)
+        ssmR3ZipMultiSubmitSeg(pZip, pCur, ssmR3ZipMultiCompressChunk);
+
+    /* Write them in submission order, i.e. starting with the one after the current. */
+    int rc = VINF_SUCCESS;
+    for (uint32_t i = 1; i <= RT_ELEMENTS(pZip->aSegs); i++)
+    {
+        PSSMZIPSEG pSeg = &pZip->aSegs[(pZip->iCurSeg + i) % RT_ELEMENTS(pZip->aSegs)];
+        if (pSeg->fPending)
+        {
+            int rc2 = ssmR3ZipMultiWriteSeg(pSSM, pSeg);
+            if (RT_FAILURE(rc2) && RT_SUCCESS(rc))
+                rc = rc2;
+        }
+    }
+    pZip->iCurSeg = 0;
+    return rc;
+}
+
+
 /**
  * Worker that flushes the buffered data.
  *
@@ -3437,9 +3874,15 @@ static int ssmR3DataFlushBuffer(PSSMHANDLE pSSM)
      * (No need for fancy optimizations here any longer since the stream is
      * fully buffered.)
      */
-    int rc = ssmR3DataWriteRecHdr(pSSM, cb, SSM_REC_FLAGS_FIXED | SSM_REC_FLAGS_IMPORTANT | SSM_REC_TYPE_RAW);
-    if (RT_SUCCESS(rc))
-        rc = ssmR3DataWriteRaw(pSSM, pSSM->u.Write.abDataBuffer, cb);
+    int rc;
+    if (!pSSM->pZipMulti)
+    {
+        rc = ssmR3DataWriteRecHdr(pSSM, cb, SSM_REC_FLAGS_FIXED | SSM_REC_FLAGS_IMPORTANT | SSM_REC_TYPE_RAW);
+        if (RT_SUCCESS(rc))
+            rc = ssmR3DataWriteRaw(pSSM, pSSM->u.Write.abDataBuffer, cb);
+    }
+    else
+        rc = ssmR3ZipMultiWrite(pSSM, pSSM->u.Write.abDataBuffer, cb);
     ssmR3ProgressByByte(pSSM, cb);
     return rc;
 }
@@ -3460,6 +3903,16 @@ static int ssmR3DataWriteBig(PSSMHANDLE pSSM, const void *pvBuf, size_t cbBuf)
     {
         pSSM->offUnitUser += cbBuf;
 
+        /*
+         * Leave it to the multi-stream compressor if active.
+         */
+        if (pSSM->pZipMulti)
+        {
+            rc = ssmR3ZipMultiWrite(pSSM, pvBuf, cbBuf);
+            ssmR3ProgressByByte(pSSM, cbBuf);
+            return rc;
+        }
+
         /*
          * Split it up into compression blocks.
          */
@@ -4618,6 +5071,7 @@ static int ssmR3SaveDoClose(PVM pVM, PSSMHANDLE pSSM)
     /*
      * Trash the handle before freeing it.
      */
+    ssmR3ZipMultiDestroy(pSSM);
     ASMAtomicWriteU32(&pSSM->fCancelled, 0);
     pSSM->pVM = NULL;
     pSSM->enmAfter = SSMAFTER_INVALID;
@@ -5116,6 +5570,8 @@ static int ssmR3WriteHeaderAndClearPerUnitData(PVM pVM, PSSMHANDLE pSSM)
     FileHdr.fFlags       = SSMFILEHDR_FLAGS_STREAM_CRC32;
     if (pSSM->fLiveSave)
         FileHdr.fFlags  |= SSMFILEHDR_FLAGS_STREAM_LIVE_SAVE;
+    if (pSSM->pZipMulti)
+        FileHdr.fFlags  |= SSMFILEHDR_FLAGS_STREAM_ZIP_MULTI;
     FileHdr.cbMaxDecompr = RT_SIZEOFMEMB(SSMHANDLE, u.Read.abDataBuffer);
     FileHdr.u32CRC       = 0;
     FileHdr.u32CRC       = RTCrc32(&FileHdr, sizeof(FileHdr));
@@ -5181,6 +5637,7 @@ static int ssmR3SaveDoCreateFile(PVM pVM, const char *pszFilename, PCSSMSTRMOPS
     pSSM->uPercentDone              = 0;
     pSSM->uReportedLivePercent      = 0;
     pSSM->pszFilename               = pszFilename;
+    pSSM->pZipMulti                 = NULL;
     pSSM->u.Write.offDataBuffer     = 0;
     pSSM->u.Write.cMsMaxDowntime    = UINT32_MAX;
 
@@ -5196,6 +5653,22 @@ static int ssmR3SaveDoCreateFile(PVM pVM, const char *pszFilename, PCSSMSTRMOPS
         return rc;
     }
 
+    /*
+     * Set up multi-stream compression if configured.  Failing that, we just
+     * fall back on the single threaded compression.
+     */
+    if (pVM->ssm.s.cZipThreads)
+    {
+        rc = ssmR3ZipMultiCreate(pSSM, pVM->ssm.s.cZipThreads, SSM_ZIP_MULTI_SEGS);
+        if (RT_SUCCESS(rc))
+            LogRel(("SSM: Using %u threads for compressing the saved state\n", pVM->ssm.s.cZipThreads));
+        else
+        {
+            LogRel(("SSM: Failed to set up multi-stream compression: %Rrc\n", rc));
+            ssmR3ZipMultiDestroy(pSSM);
+        }
+    }
+
     *ppSSM = pSSM;
     return VINF_SUCCESS;
 }
@@ -5802,6 +6275,7 @@ VMMR3_INT_DECL(int) SSMR3LiveSave(PVM pVM, uint32_t cMsMaxDowntime,
     }
     /* bail out. */
     int rc2 = ssmR3StrmClose(&pSSM->Strm, pSSM->rc == VERR_SSM_CANCELLED);
+    ssmR3ZipMultiDestroy(pSSM);
     RTMemFree(pSSM);
     rc2 = RTFileDelete(pszFilename);
     AssertRC(rc2);
@@ -5943,6 +6417,7 @@ static void ssmR3DataReadBeginV2(PSSMHANDLE pSSM)
     pSSM->u.Read.offDataBuffer  = 0;
     pSSM->u.Read.fEndOfData     = false;
     pSSM->u.Read.u8TypeAndFlags = 0;
+    ssmR3ZipMultiReadReset(pSSM);
 }
 
 
@@ -5970,6 +6445,11 @@ static int ssmR3DataReadFinishV2(PSSMHANDLE pSSM)
             LogRel(("SSM: At least %#x bytes left to read\n", pSSM->u.Read.cbDataBuffer - pSSM->u.Read.offDataBuffer));
             rc = VERR_SSM_LOADED_TOO_LITTLE;
         }
+        else if (ssmR3ZipMultiReadLeft(pSSM))
+        {
+            LogRel(("SSM: At least %#x bytes left to read\n", ssmR3ZipMultiReadLeft(pSSM)));
+            rc = VERR_SSM_LOADED_TOO_LITTLE;
+        }
         else
         {
             rc = ssmR3DataReadRecHdrV2(pSSM);
@@ -6097,6 +6577,125 @@ static int ssmR3DataReadV2RawLzf(PSSMHANDLE pSSM, void *pvDst, size_t cbDecompr)
 }
 
 
+/**
+ * Request thread pool worker that decompresses one chunk of a segment.
+ *
+ * @returns VBox status code.
+ * @param   pSeg            The segment.
+ * @param   iChunk          The chunk number.
+ */
+static DECLCALLBACK(int) ssmR3ZipMultiDecompressChunk(PSSMZIPSEG pSeg, uintptr_t iChunk)
+{
+    uint32_t const  off     = (uint32_t)iChunk * SSM_ZIP_MULTI_CHUNK_SIZE;
+    uint32_t const  cbChunk = RT_MIN(pSeg->cbData - off, SSM_ZIP_MULTI_CHUNK_SIZE);
+    uint8_t const  *pbSrc   = &pSeg->pbCompr[pSeg->aoffChunks[iChunk]];
+    uint32_t const  cbSrc   = pSeg->acbChunks[iChunk] & ~SSM_ZIP_MULTI_CHUNK_STORED;
+    if (pSeg->acbChunks[iChunk] & SSM_ZIP_MULTI_CHUNK_STORED)
+    {
+        memcpy(&pSeg->pbData[off], pbSrc, cbChunk);
+        return VINF_SUCCESS;
+    }
+
+    size_t cbDstActual = 0;
+    int rc = RTZipBlockDecompress(RTZIPTYPE_LZF, 0 /*fFlags*/,
+                                  pbSrc, cbSrc, NULL /*pcbSrcActual*/,
+                                  &pSeg->pbData[off], cbChunk, &cbDstActual);
+    if (RT_SUCCESS(rc) && cbDstActual != cbChunk)
+        rc = VERR_SSM_INTEGRITY_DECOMPRESSION;
+    return rc;
+}
+
+
+/**
+ * Reads a SSM_REC_TYPE_RAW_LZF_MULTI record from the stream and decompresses
+ * it into the segment buffer.
+ *
+ * The record is consumed in full, the data is then picked up by
+ * ssmR3ZipMultiRead.
+ *
+ * @returns VBox status code. Sets pSSM->rc on error.
+ * @param   pSSM            The saved state handle.
+ */
+static int ssmR3DataReadV2RawLzfMulti(PSSMHANDLE pSSM)
+{
+    uint32_t const cbRec = pSSM->u.Read.cbRecLeft;
+    AssertLogRelMsgReturn(   cbRec > sizeof(uint32_t) * 2
+                          && cbRec <= SSM_ZIP_MULTI_SEG_SIZE + SSM_ZIP_MULTI_HDR_MAX,
+                          ("%#x\n", cbRec),
+                          pSSM->rc = VERR_SSM_INTEGRITY_DECOMPRESSION);
+
+    /*
+     * Lazily create the decompression state.
+     */
+    int rc;
+    if (!pSSM->pZipMulti)
+    {
+        rc = ssmR3ZipMultiCreate(pSSM, RT_MIN(RTMpGetOnlineCount(), SSM_ZIP_MULTI_MAX_CHUNKS), 1 /*cSegs*/);
+        if (RT_FAILURE(rc))
+        {
+            ssmR3ZipMultiDestroy(pSSM);
+            return pSSM->rc = rc;
+        }
+    }
+    PSSMZIPMULTI pZip = pSSM->pZipMulti;
+    PSSMZIPSEG   pSeg = &pZip->aSegs[0];
+    Assert(pZip->offRead == pSeg->cbData);
+
+    /*
+     * Read the whole record.
+     */
+    rc = ssmR3DataReadV2Raw(pSSM, pSeg->pbCompr, cbRec);
+    if (RT_FAILURE(rc))
+        return pSSM->rc = rc;
+    pSSM->u.Read.cbRecLeft = 0;
+
+    /*
+     * Parse and validate the segment header and chunk table.
+     */
+    uint32_t cbData;
+    memcpy(&cbData, pSeg->pbCompr, sizeof(cbData));
+    AssertLogRelMsgReturn(cbData > 0 && cbData <= SSM_ZIP_MULTI_SEG_SIZE, ("%#x\n", cbData),
+                          pSSM->rc = VERR_SSM_INTEGRITY_DECOMPRESSION);
+    uint32_t const cChunks = (cbData + SSM_ZIP_MULTI_CHUNK_SIZE - 1) / SSM_ZIP_MULTI_CHUNK_SIZE;
+    uint32_t       offChunk = sizeof(uint32_t) * (1 + cChunks);
+    AssertLogRelMsgReturn(offChunk <= cbRec, ("%#x %#x\n", offChunk, cbRec), pSSM->rc = VERR_SSM_INTEGRITY_DECOMPRESSION);
+    memcpy(&pSeg->acbChunks[0], &pSeg->pbCompr[sizeof(uint32_t)], sizeof(uint32_t) * cChunks);
+    for (uint32_t iChunk = 0; iChunk < cChunks; iChunk++)
+    {
+        uint32_t const cbChunk = RT_MIN(cbData - iChunk * SSM_ZIP_MULTI_CHUNK_SIZE, SSM_ZIP_MULTI_CHUNK_SIZE);
+        uint32_t const cbCompr = pSeg->acbChunks[iChunk] & ~SSM_ZIP_MULTI_CHUNK_STORED;
+        AssertLogRelMsgReturn(  pSeg->acbChunks[iChunk] & SSM_ZIP_MULTI_CHUNK_STORED
+                              ? cbCompr == cbChunk
+                              : cbCompr > 0 && cbCompr < cbChunk,
+                              ("iChunk=%u cbCompr=%#x cbChunk=%#x\n", iChunk, pSeg->acbChunks[iChunk], cbChunk),
+                              pSSM->rc = VERR_SSM_INTEGRITY_DECOMPRESSION);
+        AssertLogRelMsgReturn(cbCompr <= cbRec - offChunk, ("iChunk=%u cbCompr=%#x off=%#x cbRec=%#x\n", iChunk, cbCompr, offChunk, cbRec),
+                              pSSM->rc = VERR_SSM_INTEGRITY_DECOMPRESSION);
+        pSeg->aoffChunks[iChunk] = offChunk;
+        offChunk += cbCompr;
+    }
+    AssertLogRelMsgReturn(offChunk == cbRec, ("%#x %#x\n", offChunk, cbRec), pSSM->rc = VERR_SSM_INTEGRITY_DECOMPRESSION);
+
+    /*
+     * Decompress the chunks in parallel.
+     */
+    pSeg->cbData  = cbData;
+    pZip->offRead = 0;
+    ssmR3ZipMultiSubmitSeg(pZip, pSeg, ssmR3ZipMultiDecompressChunk);
+    rc = ssmR3ZipMultiWaitSeg(pSeg);
+    if (RT_FAILURE(rc))
+    {
+        pSeg->cbData = 0;
+        AssertLogRelMsgFailed(("cbRec=%#x cbData=%#x rc=%Rrc\n", cbRec, cbData, rc));
+        return pSSM->rc = VERR_SSM_INTEGRITY_DECOMPRESSION;
+    }
+
+    Log3(("ssmR3DataReadV2RawLzfMulti: %08llx|%08llx: cbData=%#x cbRec=%#x cChunks=%u\n",
+          ssmR3StrmTell(&pSSM->Strm), pSSM->offUnit, cbData, cbRec, cChunks));
+    return VINF_SUCCESS;
+}
+
+
 /**
  * Reads and checks the raw zero "header".
  *
@@ -6335,7 +6934,7 @@ static int ssmR3DataReadUnbufferedV2(PSSMHANDLE pSSM, void *pvBuf, size_t cbBuf)
         /*
          * Read the next record header if no more data.
          */
-        if (!pSSM->u.Read.cbRecLeft)
+        if (!pSSM->u.Read.cbRecLeft && !ssmR3ZipMultiReadLeft(pSSM))
         {
             int rc = ssmR3DataReadRecHdrV2(pSSM);
             if (RT_FAILURE(rc))
@@ -6401,6 +7000,18 @@ static int ssmR3DataReadUnbufferedV2(PSSMHANDLE pSSM, void *pvBuf, size_t cbBuf)
                 break;
             }
 
+            case SSM_REC_TYPE_RAW_LZF_MULTI:
+            {
+                if (pSSM->u.Read.cbRecLeft)
+                {
+                    int rc = ssmR3DataReadV2RawLzfMulti(pSSM);
+                    if (RT_FAILURE(rc))
+                        return rc;
+                }
+                cbToRead = ssmR3ZipMultiRead(pSSM, pvBuf, cbBuf);
+                break;
+            }
+
             default:
                 AssertMsgFailedReturn(("%x\n", pSSM->u.Read.u8TypeAndFlags), pSSM->rc = VERR_SSM_BAD_REC_TYPE);
         }
@@ -6456,7 +7067,7 @@ static int ssmR3DataReadBufferedV2(PSSMHANDLE pSSM, void *pvBuf, size_t cbBuf)
         /*
          * Read the next record header if no more data.
          */
-        if (!pSSM->u.Read.cbRecLeft)
+        if (!pSSM->u.Read.cbRecLeft && !ssmR3ZipMultiReadLeft(pSSM))
         {
             int rc = ssmR3DataReadRecHdrV2(pSSM);
             if (RT_FAILURE(rc))
@@ -6504,6 +7115,19 @@ static int ssmR3DataReadBufferedV2(PSSMHANDLE pSSM, void *pvBuf, size_t cbBuf)
                 break;
             }
 
+            case SSM_REC_TYPE_RAW_LZF_MULTI:
+            {
+                if (pSSM->u.Read.cbRecLeft)
+                {
+                    int rc = ssmR3DataReadV2RawLzfMulti(pSSM);
+                    if (RT_FAILURE(rc))
+                        return rc;
+                }
+                cbToRead = ssmR3ZipMultiRead(pSSM, &pSSM->u.Read.abDataBuffer[0], sizeof(pSSM->u.Read.abDataBuffer));
+                pSSM->u.Read.cbDataBuffer = cbToRead;
+                break;
+            }
+
             default:
                 AssertMsgFailedReturn(("%x\n", pSSM->u.Read.u8TypeAndFlags), pSSM->rc = VERR_SSM_BAD_REC_TYPE);
         }
@@ -7527,6 +8151,7 @@ VMMR3DECL(int) SSMR3SkipToEndOfUnit(PSSMHANDLE pSSM)
          */
         pSSM->u.Read.cbDataBuffer  = 0;
         pSSM->u.Read.offDataBuffer = 0;
+        ssmR3ZipMultiReadReset(pSSM);
         if (!pSSM->u.Read.fEndOfData)
         {
             do
@@ -7819,7 +8444,7 @@ static int ssmR3HeaderAndValidate(PSSMHANDLE pSSM, bool fChecksumIt, bool fCheck
                 LogRel(("SSM: Reserved header field isn't zero: %02x\n", uHdr.v2_0.u8Reserved));
                 return VERR_SSM_INTEGRITY;
             }
-            if (uHdr.v2_0.fFlags & ~(SSMFILEHDR_FLAGS_STREAM_CRC32 | SSMFILEHDR_FLAGS_STREAM_LIVE_SAVE))
+            if (uHdr.v2_0.fFlags & ~(SSMFILEHDR_FLAGS_STREAM_CRC32 | SSMFILEHDR_FLAGS_STREAM_LIVE_SAVE | SSMFILEHDR_FLAGS_STREAM_ZIP_MULTI))
             {
                 LogRel(("SSM: Unknown header flags: %08x\n", uHdr.v2_0.fFlags));
                 return VERR_SSM_INTEGRITY;
@@ -8047,6 +8672,7 @@ static int ssmR3OpenFile(PVM pVM, const char *pszFilename, PCSSMSTRMOPS pStreamO
     pSSM->uPercentDone          = 2;
     pSSM->uReportedLivePercent  = 0;
     pSSM->pszFilename           = pszFilename;
+    pSSM->pZipMulti             = NULL;
 
     pSSM->u.Read.pZipDecompV1   = NULL;
     pSSM->u.Read.uFmtVerMajor   = UINT32_MAX;
@@ -8201,7 +8827,7 @@ static void ssmR3StrmLogUnitContent(PSSMHANDLE pSSM, SSMFILEUNITHDRV2 const *pUn
                         {
                             if (cbInBuffer > 0)
                                 cbToRead = cbInBuffer;
-                            else if (pSSM->u.Read.cbRecLeft)
+                            else if (pSSM->u.Read.cbRecLeft || ssmR3ZipMultiReadLeft(pSSM))
                                 cbToRead = 1;
                             else
                             {
@@ -8964,6 +9590,7 @@ VMMR3DECL(int) SSMR3Load(PVM pVM, const char *pszFilename, PCSSMSTRMOPS pStreamO
 
         ssmR3SetCancellable(pVM, &Handle, false);
         ssmR3StrmClose(&Handle.Strm, Handle.rc == VERR_SSM_CANCELLED);
+        ssmR3ZipMultiDestroy(&Handle);
         rc = Handle.rc;
     }
 
@@ -9193,6 +9820,7 @@ VMMR3DECL(int) SSMR3Close(PSSMHANDLE pSSM)
         RTZipDecompDestroy(pSSM->u.Read.pZipDecompV1);
         pSSM->u.Read.pZipDecompV1 = NULL;
     }
+    ssmR3ZipMultiDestroy(pSSM);
     RTMemFree(pSSM);
     return rc;
 }
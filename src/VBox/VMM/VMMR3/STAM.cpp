@@ -36,6 +36,14 @@
  * Some types also allows STAM to reset the data, which is very convenient when
  * digging into specific operations and such.
  *
+ * For continuous monitoring there is a delta snapshot API, STAMR3DeltaCreate,
+ * STAMR3DeltaSnapshot and STAMR3DeltaDestroy.  The pattern is resolved into an
+ * array of sample descriptors once, and each snapshot only reports the samples
+ * that changed since the previous one.  The output is a line based text format
+ * ("<name> <value> [<value> ...]") that is cheap to produce and to parse.  The
+ * descriptor array is re-resolved whenever samples are registered or
+ * deregistered, in which case the next snapshot is a full one.
+ *
  * PS. The VirtualBox Debugger GUI has a viewer for inspecting the statistics
  * STAM provides.  You will also find statistics in the release and debug logs.
  * And as mentioned in the introduction, the debugger console features a couple
@@ -59,9 +67,11 @@
 
 #include <iprt/assert.h>
 #include <iprt/asm.h>
+#include <iprt/crc.h>
 #include <iprt/mem.h>
 #include <iprt/stream.h>
 #include <iprt/string.h>
+#include <iprt/time.h>
 
 
 /*********************************************************************************************************************************
@@ -70,6 +80,11 @@
 /** The maximum name length excluding the terminator. */
 #define STAM_MAX_NAME_LEN   239
 
+/** Magic value for STAMR3DELTA::u32Magic. */
+#define STAMR3DELTA_MAGIC   UINT32_C(0x19881124)
+/** Dead magic value for STAMR3DELTA::u32Magic. */
+#define STAMR3DELTA_MAGIC_DEAD UINT32_C(0x19881125)
+
 
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
@@ -119,6 +134,73 @@ typedef struct STAMR3SNAPSHOTONE
 } STAMR3SNAPSHOTONE, *PSTAMR3SNAPSHOTONE;
 
 
+/**
+ * A pre-resolved sample in a delta snapshot handle.
+ */
+typedef struct STAMR3DELTAENTRY
+{
+    /** The sample descriptor.  Only valid while STAMR3DELTA::uRegGeneration
+     * matches the current registration generation. */
+    PSTAMDESC       pDesc;
+    /** The values reported by the previous snapshot (see stamR3DeltaQueryOne). */
+    uint64_t        au64Prev[2];
+} STAMR3DELTAENTRY;
+/** Pointer to a pre-resolved sample. */
+typedef STAMR3DELTAENTRY *PSTAMR3DELTAENTRY;
+
+
+/**
+ * Delta snapshot handle, see STAMR3DeltaCreate.
+ */
+typedef struct STAMR3DELTA
+{
+    /** Magic value (STAMR3DELTA_MAGIC). */
+    uint32_t            u32Magic;
+    /** The registration generation the entries were resolved at. */
+    uint32_t            uRegGeneration;
+    /** Set if paEntries has been resolved at least once. */
+    bool                fResolved;
+    /** Whether any of the entries are GVMM statistics. */
+    bool                fUpdateGVMM;
+    /** Whether any of the entries are GMM statistics. */
+    bool                fUpdateGMM;
+    /** The number of valid entries. */
+    uint32_t            cEntries;
+    /** The number of allocated entries. */
+    uint32_t            cAllocated;
+    /** The pre-resolved samples. */
+    PSTAMR3DELTAENTRY   paEntries;
+    /** The user mode VM handle this belongs to. */
+    PUVM                pUVM;
+    /** The snapshot sequence number. */
+    uint64_t            iSeqNo;
+    /** The buffer size used by the last snapshot, used as allocation hint. */
+    size_t              cbLastOutput;
+    /** The status of the last resolve callback. */
+    int                 rcResolve;
+    /** The pattern (variable size). */
+    char                szPat[1];
+} STAMR3DELTA;
+
+
+/**
+ * Temporary storage for stamR3PerCpuFold.
+ */
+typedef struct STAMR3PERCPUFOLD
+{
+    /** The descriptor presented to the reader. */
+    STAMDESC            Desc;
+    /** The summed up sample data. */
+    union
+    {
+        STAMCOUNTER     Counter;
+        STAMPROFILE     Profile;
+    } u;
+} STAMR3PERCPUFOLD;
+/** Pointer to the temporary storage for stamR3PerCpuFold. */
+typedef STAMR3PERCPUFOLD *PSTAMR3PERCPUFOLD;
+
+
 /**
  * Init record for a ring-0 statistic sample.
  */
@@ -146,6 +228,7 @@ static void                 stamR3LookupDestroyTree(PSTAMLOOKUP pRoot);
 static int                  stamR3RegisterU(PUVM pUVM, void *pvSample, PFNSTAMR3CALLBACKRESET pfnReset, PFNSTAMR3CALLBACKPRINT pfnPrint,
                                             STAMTYPE enmType, STAMVISIBILITY enmVisibility, const char *pszName, STAMUNIT enmUnit, const char *pszDesc);
 static int                  stamR3ResetOne(PSTAMDESC pDesc, void *pvArg);
+static PSTAMDESC            stamR3PerCpuFold(PSTAMDESC pDesc, PSTAMR3PERCPUFOLD pFold);
 static DECLCALLBACK(void)   stamR3EnumLogPrintf(PSTAMR3PRINTONEARGS pvArg, const char *pszFormat, ...);
 static DECLCALLBACK(void)   stamR3EnumRelLogPrintf(PSTAMR3PRINTONEARGS pvArg, const char *pszFormat, ...);
 static DECLCALLBACK(void)   stamR3EnumPrintf(PSTAMR3PRINTONEARGS pvArg, const char *pszFormat, ...);
@@ -159,6 +242,7 @@ static int                  stamR3EnumU(PUVM pUVM, const char *pszPat, bool fUpd
 static void                 stamR3Ring0StatsRegisterU(PUVM pUVM);
 static void                 stamR3Ring0StatsUpdateU(PUVM pUVM, const char *pszPat);
 static void                 stamR3Ring0StatsUpdateMultiU(PUVM pUVM, const char * const *papszExpressions, unsigned cExpressions);
+static void                 stamR3Ring0StatsUpdateWorkerU(PUVM pUVM, bool fUpdateGVMM, bool fUpdateGMM);
 
 #ifdef VBOX_WITH_DEBUGGER
 static FNDBGCCMD            stamR3CmdStats;
@@ -1361,6 +1445,12 @@ static int stamR3RegisterU(PUVM pUVM, void *pvSample, PFNSTAMR3CALLBACKRESET pfn
             AssertMsg(!((uintptr_t)pvSample & 7), ("%p - %s\n", pvSample, pszName));
             break;
 
+            /* 64 byte / cache line, one per slot */
+        case STAMTYPE_COUNTER_PERCPU:
+        case STAMTYPE_PROFILE_PERCPU:
+            AssertMsg(RT_ALIGN_P(pvSample, 64) == pvSample, ("%p - %s\n", pvSample, pszName));
+            break;
+
             /* 4 byte / 32-bit */
         case STAMTYPE_RATIO_U32:
         case STAMTYPE_RATIO_U32_RESET:
@@ -1431,6 +1521,7 @@ static int stamR3RegisterU(PUVM pUVM, void *pvSample, PFNSTAMR3CALLBACKRESET pfn
 #endif
 
         stamR3ResetOne(pNew, pUVM->pVM);
+        ASMAtomicIncU32(&pUVM->stam.s.uRegGeneration);
         rc = VINF_SUCCESS;
     }
     else
@@ -1445,10 +1536,12 @@ static int stamR3RegisterU(PUVM pUVM, void *pvSample, PFNSTAMR3CALLBACKRESET pfn
  * Destroys the statistics descriptor, unlinking it and freeing all resources.
  *
  * @returns VINF_SUCCESS
+ * @param   pUVM        Pointer to the user mode VM structure.
  * @param   pCur        The descriptor to destroy.
  */
-static int stamR3DestroyDesc(PSTAMDESC pCur)
+static int stamR3DestroyDesc(PUVM pUVM, PSTAMDESC pCur)
 {
+    ASMAtomicIncU32(&pUVM->stam.s.uRegGeneration);
     RTListNodeRemove(&pCur->ListEntry);
 #ifdef STAM_WITH_LOOKUP_TREE
     pCur->pLookup->pDesc = NULL; /** @todo free lookup nodes once it's working. */
@@ -1491,7 +1584,7 @@ VMMR3DECL(int)  STAMR3DeregisterByAddr(PUVM pUVM, void *pvSample)
     RTListForEachSafe(&pUVM->stam.s.List, pCur, pNext, STAMDESC, ListEntry)
     {
         if (pCur->u.pv == pvSample)
-            rc = stamR3DestroyDesc(pCur);
+            rc = stamR3DestroyDesc(pUVM, pCur);
     }
 
     STAM_UNLOCK_WR(pUVM);
@@ -1524,7 +1617,7 @@ static int stamR3DeregisterByPattern(PUVM pUVM, const char *pszPat)
             PSTAMDESC pNext = RTListNodeGetNext(&pCur->ListEntry, STAMDESC, ListEntry);
 
             if (RTStrSimplePatternMatch(pszPat, pCur->pszName))
-                rc = stamR3DestroyDesc(pCur);
+                rc = stamR3DestroyDesc(pUVM, pCur);
 
             /* advance. */
             if (pCur == pLast)
@@ -1757,6 +1850,22 @@ static int stamR3ResetOne(PSTAMDESC pDesc, void *pvArg)
             ASMAtomicXchgBool(pDesc->u.pf, false);
             break;
 
+        case STAMTYPE_COUNTER_PERCPU:
+            for (unsigned i = 0; i < RT_ELEMENTS(pDesc->u.pCounterPerCpu->aSlots); i++)
+                ASMAtomicXchgU64(&pDesc->u.pCounterPerCpu->aSlots[i].c, 0);
+            break;
+
+        case STAMTYPE_PROFILE_PERCPU:
+            for (unsigned i = 0; i < RT_ELEMENTS(pDesc->u.pProfilePerCpu->aSlots); i++)
+            {
+                PSTAMPROFILE pProfile = &pDesc->u.pProfilePerCpu->aSlots[i].Profile;
+                ASMAtomicXchgU64(&pProfile->cPeriods, 0);
+                ASMAtomicXchgU64(&pProfile->cTicks, 0);
+                ASMAtomicXchgU64(&pProfile->cTicksMax, 0);
+                ASMAtomicXchgU64(&pProfile->cTicksMin, UINT64_MAX);
+            }
+            break;
+
         /* These are custom and will not be touched. */
         case STAMTYPE_U8:
         case STAMTYPE_X8:
@@ -1779,6 +1888,57 @@ static int stamR3ResetOne(PSTAMDESC pDesc, void *pvArg)
 }
 
 
+/**
+ * Sums up a per-CPU sample for presentation to readers.
+ *
+ * @returns The descriptor to present: @a pDesc for regular samples, or a
+ *          STAMTYPE_COUNTER / STAMTYPE_PROFILE descriptor in @a pFold
+ *          pointing at the sums for per-CPU samples.
+ * @param   pDesc       The sample.
+ * @param   pFold       Temporary storage for the sums and the descriptor.
+ */
+static PSTAMDESC stamR3PerCpuFold(PSTAMDESC pDesc, PSTAMR3PERCPUFOLD pFold)
+{
+    switch (pDesc->enmType)
+    {
+        case STAMTYPE_COUNTER_PERCPU:
+        {
+            uint64_t c = 0;
+            for (unsigned i = 0; i < RT_ELEMENTS(pDesc->u.pCounterPerCpu->aSlots); i++)
+                c += pDesc->u.pCounterPerCpu->aSlots[i].c;
+            pFold->u.Counter.c  = c;
+            pFold->Desc         = *pDesc;
+            pFold->Desc.enmType = STAMTYPE_COUNTER;
+            pFold->Desc.u.pCounter = &pFold->u.Counter;
+            return &pFold->Desc;
+        }
+
+        case STAMTYPE_PROFILE_PERCPU:
+        {
+            pFold->u.Profile.cPeriods  = 0;
+            pFold->u.Profile.cTicks    = 0;
+            pFold->u.Profile.cTicksMax = 0;
+            pFold->u.Profile.cTicksMin = UINT64_MAX;
+            for (unsigned i = 0; i < RT_ELEMENTS(pDesc->u.pProfilePerCpu->aSlots); i++)
+            {
+                PCSTAMPROFILE pProfile = &pDesc->u.pProfilePerCpu->aSlots[i].Profile;
+                pFold->u.Profile.cPeriods += pProfile->cPeriods;
+                pFold->u.Profile.cTicks   += pProfile->cTicks;
+                pFold->u.Profile.cTicksMax = RT_MAX(pFold->u.Profile.cTicksMax, pProfile->cTicksMax);
+                pFold->u.Profile.cTicksMin = RT_MIN(pFold->u.Profile.cTicksMin, pProfile->cTicksMin);
+            }
+            pFold->Desc         = *pDesc;
+            pFold->Desc.enmType = STAMTYPE_PROFILE;
+            pFold->Desc.u.pProfile = &pFold->u.Profile;
+            return &pFold->Desc;
+        }
+
+        default:
+            return pDesc;
+    }
+}
+
+
 /**
  * Get a snapshot of the statistics.
  * It's possible to select a subset of the samples.
@@ -1843,6 +2003,8 @@ VMMR3DECL(int) STAMR3Snapshot(PUVM pUVM, const char *pszPat, char **ppszSnapshot
 static int stamR3SnapshotOne(PSTAMDESC pDesc, void *pvArg)
 {
     PSTAMR3SNAPSHOTONE pThis = (PSTAMR3SNAPSHOTONE)pvArg;
+    STAMR3PERCPUFOLD   Fold;
+    pDesc = stamR3PerCpuFold(pDesc, &Fold);
 
     switch (pDesc->enmType)
     {
@@ -2069,22 +2231,404 @@ static int stamR3SnapshotPrintf(PSTAMR3SNAPSHOTONE pThis, const char *pszFormat,
 
 
 /**
- * Releases a statistics snapshot returned by STAMR3Snapshot().
+ * Releases a statistics snapshot returned by STAMR3Snapshot() or
+ * STAMR3DeltaSnapshot().
  *
  * @returns VBox status code.
  * @param   pUVM            The user mode VM handle.
- * @param   pszSnapshot     The snapshot data pointer returned by STAMR3Snapshot().
+ * @param   pszSnapshot     The snapshot data pointer returned by STAMR3Snapshot()
+ *                          or STAMR3DeltaSnapshot().
  *                          NULL is allowed.
  */
 VMMR3DECL(int)  STAMR3SnapshotFree(PUVM pUVM, char *pszSnapshot)
 {
-    if (!pszSnapshot)
+    if (pszSnapshot)
         RTMemFree(pszSnapshot);
     NOREF(pUVM);
     return VINF_SUCCESS;
 }
 
 
+/**
+ * Creates a delta snapshot handle for the given pattern.
+ *
+ * The pattern is resolved into an array of sample descriptors on the first
+ * snapshot and then kept until samples are registered or deregistered, so
+ * repeated snapshots neither walk the lookup tree nor do any pattern matching.
+ *
+ * @returns VBox status code.
+ * @param   pUVM            The user mode VM handle.
+ * @param   pszPat          The name matching pattern. See somewhere_where_this_is_described_in_detail.
+ *                          If NULL all samples are included.
+ * @param   phDelta         Where to return the handle.  Destroy it using
+ *                          STAMR3DeltaDestroy before the VM is destroyed.
+ */
+VMMR3DECL(int) STAMR3DeltaCreate(PUVM pUVM, const char *pszPat, PSTAMR3DELTA *phDelta)
+{
+    UVM_ASSERT_VALID_EXT_RETURN(pUVM, VERR_INVALID_VM_HANDLE);
+    VM_ASSERT_VALID_EXT_RETURN(pUVM->pVM, VERR_INVALID_VM_HANDLE);
+    AssertPtrReturn(phDelta, VERR_INVALID_POINTER);
+    AssertPtrNullReturn(pszPat, VERR_INVALID_POINTER);
+    *phDelta = NULL;
+
+    if (!pszPat)
+        pszPat = "*";
+    size_t cchPat = strlen(pszPat);
+    PSTAMR3DELTA pDelta = (PSTAMR3DELTA)RTMemAllocZ(RT_UOFFSETOF(STAMR3DELTA, szPat[cchPat + 1]));
+    if (!pDelta)
+        return VERR_NO_MEMORY;
+    pDelta->u32Magic = STAMR3DELTA_MAGIC;
+    pDelta->pUVM     = pUVM;
+    memcpy(pDelta->szPat, pszPat, cchPat + 1);
+
+    *phDelta = pDelta;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Destroys a delta snapshot handle created by STAMR3DeltaCreate.
+ *
+ * @returns VBox status code.
+ * @param   pUVM            The user mode VM handle.
+ * @param   hDelta          The handle.  NULL is ignored.
+ */
+VMMR3DECL(int) STAMR3DeltaDestroy(PUVM pUVM, PSTAMR3DELTA hDelta)
+{
+    if (!hDelta)
+        return VINF_SUCCESS;
+    AssertPtrReturn(hDelta, VERR_INVALID_HANDLE);
+    AssertReturn(hDelta->u32Magic == STAMR3DELTA_MAGIC, VERR_INVALID_HANDLE);
+    AssertReturn(hDelta->pUVM == pUVM, VERR_INVALID_VM_HANDLE);
+
+    hDelta->u32Magic = STAMR3DELTA_MAGIC_DEAD;
+    RTMemFree(hDelta->paEntries);
+    hDelta->paEntries = NULL;
+    RTMemFree(hDelta);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * stamR3EnumU callback employed by stamR3DeltaResolve.
+ *
+ * @returns VBox status code, but it's interpreted as 0 == success / !0 == failure by enmR3Enum.
+ * @param   pDesc       The sample.
+ * @param   pvArg       The delta snapshot handle.
+ */
+static int stamR3DeltaResolveOne(PSTAMDESC pDesc, void *pvArg)
+{
+    PSTAMR3DELTA pDelta = (PSTAMR3DELTA)pvArg;
+
+    if (pDelta->cEntries >= pDelta->cAllocated)
+    {
+        uint32_t cNew = pDelta->cAllocated ? pDelta->cAllocated * 2 : 64;
+        void *pvNew = RTMemRealloc(pDelta->paEntries, cNew * sizeof(pDelta->paEntries[0]));
+        if (!pvNew)
+            return pDelta->rcResolve = VERR_NO_MEMORY;
+        pDelta->paEntries  = (PSTAMR3DELTAENTRY)pvNew;
+        pDelta->cAllocated = cNew;
+    }
+
+    PSTAMR3DELTAENTRY pEntry = &pDelta->paEntries[pDelta->cEntries++];
+    pEntry->pDesc       = pDesc;
+    pEntry->au64Prev[0] = 0;
+    pEntry->au64Prev[1] = 0;
+
+    /* Note down whether we need to fetch the ring-0 statistics. */
+    PSTAMUSERPERVM pStam = &pDelta->pUVM->stam.s;
+    if (pDesc->enmType != STAMTYPE_CALLBACK)
+    {
+        if ((uintptr_t)pDesc->u.pv - (uintptr_t)&pStam->GVMMStats < sizeof(pStam->GVMMStats))
+            pDelta->fUpdateGVMM = true;
+        else if ((uintptr_t)pDesc->u.pv - (uintptr_t)&pStam->GMMStats < sizeof(pStam->GMMStats))
+            pDelta->fUpdateGMM = true;
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * (Re-)resolves the pattern of a delta snapshot handle.
+ *
+ * @returns VBox status code.
+ * @param   pUVM            The user mode VM handle.
+ * @param   pDelta          The delta snapshot handle.
+ */
+static int stamR3DeltaResolve(PUVM pUVM, PSTAMR3DELTA pDelta)
+{
+    /* Read the generation before enumerating, so that any registration racing
+       us will be caught by the check in STAMR3DeltaSnapshot. */
+    pDelta->uRegGeneration = ASMAtomicReadU32(&pUVM->stam.s.uRegGeneration);
+    pDelta->cEntries       = 0;
+    pDelta->fUpdateGVMM    = false;
+    pDelta->fUpdateGMM     = false;
+    pDelta->rcResolve      = VINF_SUCCESS;
+
+    int rc = stamR3EnumU(pUVM, pDelta->szPat, false /* fUpdateRing0 */, stamR3DeltaResolveOne, pDelta);
+    if (RT_SUCCESS(rc))
+        rc = pDelta->rcResolve;
+    pDelta->fResolved = RT_SUCCESS(rc);
+    if (RT_FAILURE(rc))
+        pDelta->cEntries = 0;
+    return rc;
+}
+
+
+/**
+ * Queries the current value of a sample in a form suitable for change
+ * detection.
+ *
+ * @param   pVM         The cross context VM structure.
+ * @param   pDesc       The sample.
+ * @param   pau64       Where to return the values.  For profiles these are
+ *                      the period and tick counts, for ratios the A and B
+ *                      values, for callbacks the CRC-32 and length of the
+ *                      text, and for everything else the value in the first
+ *                      element.
+ * @param   pszBuf      Buffer for the callback text.
+ * @param   cbBuf       The size of the buffer.
+ */
+static void stamR3DeltaQueryOne(PVM pVM, PSTAMDESC pDesc, uint64_t pau64[2], char *pszBuf, size_t cbBuf)
+{
+    pau64[1] = 0;
+    switch (pDesc->enmType)
+    {
+        case STAMTYPE_COUNTER:
+            pau64[0] = pDesc->u.pCounter->c;
+            break;
+
+        case STAMTYPE_PROFILE:
+        case STAMTYPE_PROFILE_ADV:
+            pau64[0] = pDesc->u.pProfile->cPeriods;
+            pau64[1] = pDesc->u.pProfile->cTicks;
+            break;
+
+        case STAMTYPE_RATIO_U32:
+        case STAMTYPE_RATIO_U32_RESET:
+            pau64[0] = pDesc->u.pRatioU32->u32A;
+            pau64[1] = pDesc->u.pRatioU32->u32B;
+            break;
+
+        case STAMTYPE_CALLBACK:
+        {
+            pszBuf[0] = '\0';
+            pDesc->u.Callback.pfnPrint(pVM, pDesc->u.Callback.pvSample, pszBuf, cbBuf);
+            size_t cch = RTStrNLen(pszBuf, cbBuf);
+            pau64[0] = RTCrc32(pszBuf, cch);
+            pau64[1] = cch;
+            break;
+        }
+
+        case STAMTYPE_U8:
+        case STAMTYPE_U8_RESET:
+        case STAMTYPE_X8:
+        case STAMTYPE_X8_RESET:
+            pau64[0] = *pDesc->u.pu8;
+            break;
+
+        case STAMTYPE_U16:
+        case STAMTYPE_U16_RESET:
+        case STAMTYPE_X16:
+        case STAMTYPE_X16_RESET:
+            pau64[0] = *pDesc->u.pu16;
+            break;
+
+        case STAMTYPE_U32:
+        case STAMTYPE_U32_RESET:
+        case STAMTYPE_X32:
+        case STAMTYPE_X32_RESET:
+            pau64[0] = *pDesc->u.pu32;
+            break;
+
+        case STAMTYPE_U64:
+        case STAMTYPE_U64_RESET:
+        case STAMTYPE_X64:
+        case STAMTYPE_X64_RESET:
+            pau64[0] = *pDesc->u.pu64;
+            break;
+
+        case STAMTYPE_BOOL:
+        case STAMTYPE_BOOL_RESET:
+            pau64[0] = *pDesc->u.pf;
+            break;
+
+        default:
+            AssertMsgFailed(("%d\n", pDesc->enmType));
+            pau64[0] = 0;
+            break;
+    }
+}
+
+
+/**
+ * Takes a delta snapshot of the statistics.
+ *
+ * The snapshot consists of a header line followed by one line per sample that
+ * changed since the previous snapshot using the same handle:
+ * @verbatim
+   # STAM delta seq=<n> ts=<nanoseconds> full=<0|1>
+   <name> <value>
+   <name> <periods> <ticks> <min-ticks> <max-ticks>
+   <name> <a> <b>
+   <name> <callback text>
+   @endverbatim
+ * The second line format is used for profiles, the third for ratios and the
+ * last for callback samples.  Hexadecimal types are reported as decimal.
+ *
+ * A full snapshot (full=1) is produced on the first call, when @a fFull is
+ * set and after the set of samples has changed.  Like STAMR3Snapshot, samples
+ * with STAMVISIBILITY_USED are skipped in full snapshots while they are zero.
+ *
+ * @returns VBox status code.
+ * @param   pUVM            The user mode VM handle.
+ * @param   hDelta          The delta snapshot handle.
+ * @param   fFull           Whether to report all the samples regardless of
+ *                          whether they changed or not.
+ * @param   ppszSnapshot    Where to store the pointer to the snapshot data.
+ *                          The returned pointer must be freed by calling
+ *                          STAMR3SnapshotFree().
+ * @param   pcchSnapshot    Where to store the size of the snapshot data.
+ *                          (Excluding the trailing '\0').  Optional.
+ * @param   pcChanged       Where to return the number of samples reported.
+ *                          Optional.
+ */
+VMMR3DECL(int) STAMR3DeltaSnapshot(PUVM pUVM, PSTAMR3DELTA hDelta, bool fFull, char **ppszSnapshot, size_t *pcchSnapshot,
+                                   uint32_t *pcChanged)
+{
+    UVM_ASSERT_VALID_EXT_RETURN(pUVM, VERR_INVALID_VM_HANDLE);
+    VM_ASSERT_VALID_EXT_RETURN(pUVM->pVM, VERR_INVALID_VM_HANDLE);
+    AssertPtrReturn(hDelta, VERR_INVALID_HANDLE);
+    AssertReturn(hDelta->u32Magic == STAMR3DELTA_MAGIC, VERR_INVALID_HANDLE);
+    AssertReturn(hDelta->pUVM == pUVM, VERR_INVALID_VM_HANDLE);
+    AssertPtrReturn(ppszSnapshot, VERR_INVALID_POINTER);
+    *ppszSnapshot = NULL;
+    if (pcchSnapshot)
+        *pcchSnapshot = 0;
+    if (pcChanged)
+        *pcChanged = 0;
+
+    /*
+     * Make sure the descriptor array is up to date, refresh the ring-0
+     * statistics copies and enter the read lock.  Loop in the unlikely
+     * event that samples get registered or deregistered in between.
+     */
+    for (;;)
+    {
+        if (   !hDelta->fResolved
+            || hDelta->uRegGeneration != ASMAtomicReadU32(&pUVM->stam.s.uRegGeneration))
+        {
+            int rc = stamR3DeltaResolve(pUVM, hDelta);
+            if (RT_FAILURE(rc))
+                return rc;
+            fFull = true;
+        }
+
+        if (hDelta->fUpdateGVMM || hDelta->fUpdateGMM)
+            stamR3Ring0StatsUpdateWorkerU(pUVM, hDelta->fUpdateGVMM, hDelta->fUpdateGMM);
+
+        STAM_LOCK_RD(pUVM);
+        if (hDelta->uRegGeneration == ASMAtomicReadU32(&pUVM->stam.s.uRegGeneration))
+            break;
+        STAM_UNLOCK_RD(pUVM);
+    }
+
+    /*
+     * Allocate the output buffer up front using the size of the previous
+     * snapshot as hint, so we usually get away with a single allocation.
+     */
+    STAMR3SNAPSHOTONE State = { NULL, NULL, NULL, pUVM->pVM, 0, VINF_SUCCESS, false /*fWithDesc*/ };
+    if (hDelta->cbLastOutput)
+    {
+        State.pszStart = (char *)RTMemAlloc(hDelta->cbLastOutput);
+        if (State.pszStart)
+        {
+            State.psz         = State.pszStart;
+            State.pszEnd      = State.pszStart + hDelta->cbLastOutput;
+            State.cbAllocated = hDelta->cbLastOutput;
+        }
+    }
+
+    stamR3SnapshotPrintf(&State, "# STAM delta seq=%RU64 ts=%RU64 full=%d\n", hDelta->iSeqNo, RTTimeNanoTS(), fFull);
+
+    /*
+     * Report the changed samples.
+     */
+    uint32_t          cChanged = 0;
+    PSTAMR3DELTAENTRY pEntry   = hDelta->paEntries;
+    for (uint32_t i = 0; i < hDelta->cEntries && RT_SUCCESS(State.rc); i++, pEntry++)
+    {
+        STAMR3PERCPUFOLD Fold;
+        PSTAMDESC pDesc = stamR3PerCpuFold(pEntry->pDesc, &Fold);
+        char      szBuf[512];
+        uint64_t  au64[2];
+        stamR3DeltaQueryOne(pUVM->pVM, pDesc, au64, szBuf, sizeof(szBuf));
+        if (fFull)
+        {
+            pEntry->au64Prev[0] = au64[0];
+            pEntry->au64Prev[1] = au64[1];
+            if (   pDesc->enmVisibility == STAMVISIBILITY_USED
+                && pDesc->enmType != STAMTYPE_CALLBACK
+                && au64[0] == 0
+                && au64[1] == 0)
+                continue;
+        }
+        else
+        {
+            if (   pEntry->au64Prev[0] == au64[0]
+                && pEntry->au64Prev[1] == au64[1])
+                continue;
+            pEntry->au64Prev[0] = au64[0];
+            pEntry->au64Prev[1] = au64[1];
+        }
+
+        switch (pDesc->enmType)
+        {
+            case STAMTYPE_PROFILE:
+            case STAMTYPE_PROFILE_ADV:
+                stamR3SnapshotPrintf(&State, "%s %RU64 %RU64 %RU64 %RU64\n", pDesc->pszName, au64[0], au64[1],
+                                     pDesc->u.pProfile->cTicksMin, pDesc->u.pProfile->cTicksMax);
+                break;
+
+            case STAMTYPE_RATIO_U32:
+            case STAMTYPE_RATIO_U32_RESET:
+                stamR3SnapshotPrintf(&State, "%s %RU64 %RU64\n", pDesc->pszName, au64[0], au64[1]);
+                break;
+
+            case STAMTYPE_CALLBACK:
+                stamR3SnapshotPrintf(&State, "%s %.*s\n", pDesc->pszName, (size_t)au64[1], szBuf);
+                break;
+
+            default:
+                stamR3SnapshotPrintf(&State, "%s %RU64\n", pDesc->pszName, au64[0]);
+                break;
+        }
+        cChanged++;
+    }
+
+    STAM_UNLOCK_RD(pUVM);
+
+    /*
+     * Done.
+     */
+    if (RT_FAILURE(State.rc))
+    {
+        /* The previous values were partially updated, so make the next one a full snapshot. */
+        hDelta->fResolved = false;
+        return State.rc;
+    }
+
+    hDelta->iSeqNo++;
+    hDelta->cbLastOutput = State.cbAllocated;
+    *ppszSnapshot = State.pszStart;
+    if (pcchSnapshot)
+        *pcchSnapshot = State.psz - State.pszStart;
+    if (pcChanged)
+        *pcChanged = cChanged;
+    return VINF_SUCCESS;
+}
+
+
 /**
  * Dumps the selected statistics to the log.
  *
@@ -2215,6 +2759,8 @@ static DECLCALLBACK(void) stamR3EnumPrintf(PSTAMR3PRINTONEARGS pArgs, const char
 static int stamR3PrintOne(PSTAMDESC pDesc, void *pvArg)
 {
     PSTAMR3PRINTONEARGS pArgs = (PSTAMR3PRINTONEARGS)pvArg;
+    STAMR3PERCPUFOLD    Fold;
+    pDesc = stamR3PerCpuFold(pDesc, &Fold);
 
     switch (pDesc->enmType)
     {
@@ -2360,6 +2906,8 @@ VMMR3DECL(int) STAMR3Enum(PUVM pUVM, const char *pszPat, PFNSTAMR3ENUM pfnEnum,
 static int stamR3EnumOne(PSTAMDESC pDesc, void *pvArg)
 {
     PSTAMR3ENUMONEARGS pArgs = (PSTAMR3ENUMONEARGS)pvArg;
+    STAMR3PERCPUFOLD   Fold;
+    pDesc = stamR3PerCpuFold(pDesc, &Fold);
     int rc;
     if (pDesc->enmType == STAMTYPE_CALLBACK)
     {
@@ -2652,21 +3200,48 @@ static void stamR3Ring0StatsUpdateMultiU(PUVM pUVM, const char * const *papszExp
     if (!pVM || !pVM->pSession)
         return;
 
-    /*
-     * GVMM
-     */
-    bool fUpdate = false;
+    bool fUpdateGVMM = false;
     for (unsigned i = 0; i < RT_ELEMENTS(g_aGVMMStats); i++)
         if (stamR3MultiMatch(papszExpressions, cExpressions, NULL, g_aGVMMStats[i].pszName))
         {
-            fUpdate = true;
+            fUpdateGVMM = true;
             break;
         }
-    if (!fUpdate)
+    if (!fUpdateGVMM)
     {
         /** @todo check the cpu leaves - rainy day. */
     }
-    if (fUpdate)
+
+    bool fUpdateGMM = false;
+    for (unsigned i = 0; i < RT_ELEMENTS(g_aGMMStats); i++)
+        if (stamR3MultiMatch(papszExpressions, cExpressions, NULL, g_aGMMStats[i].pszName))
+        {
+            fUpdateGMM = true;
+            break;
+        }
+
+    stamR3Ring0StatsUpdateWorkerU(pUVM, fUpdateGVMM, fUpdateGMM);
+}
+
+
+/**
+ * Worker for stamR3Ring0StatsUpdateMultiU and the delta snapshotter that does
+ * the actual ring-0 calls.
+ *
+ * @param   pUVM                Pointer to the user mode VM structure.
+ * @param   fUpdateGVMM         Whether to update the GVMM statistics.
+ * @param   fUpdateGMM          Whether to update the GMM statistics.
+ */
+static void stamR3Ring0StatsUpdateWorkerU(PUVM pUVM, bool fUpdateGVMM, bool fUpdateGMM)
+{
+    PVM pVM = pUVM->pVM;
+    if (!pVM || !pVM->pSession)
+        return;
+
+    /*
+     * GVMM
+     */
+    if (fUpdateGVMM)
     {
         GVMMQUERYSTATISTICSSREQ Req;
         Req.Hdr.cbReq = sizeof(Req);
@@ -2719,14 +3294,7 @@ static void stamR3Ring0StatsUpdateMultiU(PUVM pUVM, const char * const *papszExp
     /*
      * GMM
      */
-    fUpdate = false;
-    for (unsigned i = 0; i < RT_ELEMENTS(g_aGMMStats); i++)
-        if (stamR3MultiMatch(papszExpressions, cExpressions, NULL, g_aGMMStats[i].pszName))
-        {
-            fUpdate = true;
-            break;
-        }
-    if (fUpdate)
+    if (fUpdateGMM)
     {
         GMMQUERYSTATISTICSSREQ Req;
         Req.Hdr.cbReq    = sizeof(Req);
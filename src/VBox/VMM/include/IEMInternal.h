@@ -64,8 +64,25 @@ RT_C_DECLS_BEGIN
 #endif
 
 
+/** @def IEM_WITH_CODE_TLB
+ * Fetch opcode bytes straight from the host mapping of the page found via the
+ * code TLB (IEMCPU::pbInstrBuf and friends).  Work in progress: PGM does not
+ * yet bump the physical TLB revision on all page state changes.
+ *
+ * When not defined, IEMCPU::CodeTlb is still used to cache the guest page
+ * table lookups for opcode fetching, see IEM_WITH_DATA_TLB. */
 //#define IEM_WITH_CODE_TLB// - work in progress
 
+/** @def IEM_WITH_DATA_TLB
+ * Cache guest linear to physical address translations (guest page table
+ * walks) in IEMCPU::DataTlb for memory operands and in IEMCPU::CodeTlb for
+ * opcode fetching.  The entries are invalidated by PGM on INVLPG, CR3 loads,
+ * paging mode and A20 changes, and by HM after running guest code with nested
+ * paging as the guest can then do all of that behind PGM's back. */
+#if !defined(IEM_WITHOUT_DATA_TLB) || defined(DOXYGEN_RUNNING)
+# define IEM_WITH_DATA_TLB
+#endif
+
 
 #if !defined(IN_TSTVMSTRUCT) && !defined(DOXYGEN_RUNNING)
 /** Instruction statistics.   */
@@ -352,6 +369,18 @@ typedef IEMTLBENTRY *PIEMTLBENTRY;
 /** @} */
 
 
+/** @def IEMTLB_ENTRIES_SHIFT
+ * The log2 of the number of entries in each IEM TLB.
+ *
+ * The default of 8 (256 entries) allows obtaining the index directly from an
+ * 8-bit register without an additional AND instruction.  Raising it requires
+ * growing VMCPU::iem::padding accordingly (each step doubles the 2 x 8KB). */
+#if !defined(IEMTLB_ENTRIES_SHIFT) || defined(DOXYGEN_RUNNING)
+# define IEMTLB_ENTRIES_SHIFT   8
+#endif
+/** The number of entries in each IEM TLB. */
+#define IEMTLB_ENTRY_COUNT      RT_BIT_32(IEMTLB_ENTRIES_SHIFT)
+
 /**
  * An IEM TLB.
  *
@@ -359,10 +388,8 @@ typedef IEMTLBENTRY *PIEMTLBENTRY;
  */
 typedef struct IEMTLB
 {
-    /** The TLB entries.
-     * We've choosen 256 because that way we can obtain the result directly from a
-     * 8-bit register without an additional AND instruction. */
-    IEMTLBENTRY         aEntries[256];
+    /** The TLB entries, direct mapped, see IEMTLB_TAG_TO_ENTRY. */
+    IEMTLBENTRY         aEntries[IEMTLB_ENTRY_COUNT];
     /** The TLB revision.
      * This is actually only 28 bits wide (see IEMTLBENTRY::uTag) and is incremented
      * by adding RT_BIT_64(36) to it.  When it wraps around and becomes zero, all
@@ -389,6 +416,10 @@ typedef struct IEMTLB
     uint32_t            cTlbMisses;
     /** Slow read path.  */
     uint32_t            cTlbSlowReadPath;
+    /** Number of full TLB invalidations (IEMTlbInvalidateAll). */
+    uint32_t            cTlbFlushes;
+    /** Number of entries invalidated by IEMTlbInvalidatePage. */
+    uint32_t            cTlbPageFlushes;
 #if 0
     /** TLB misses because of tag mismatch. */
     uint32_t            cTlbMissesTag;
@@ -404,13 +435,29 @@ typedef struct IEMTLB
     uint32_t            cTlbMissesMapping;
 #endif
     /** Alignment padding. */
-    uint32_t            au32Padding[3+5];
+    uint32_t            au32Padding[3+3];
 } IEMTLB;
 AssertCompileSizeAlignment(IEMTLB, 64);
+/** Pointer to an IEM TLB. */
+typedef IEMTLB *PIEMTLB;
 /** IEMTLB::uTlbRevision increment.  */
 #define IEMTLB_REVISION_INCR    RT_BIT_64(36)
 /** IEMTLB::uTlbPhysRev increment.  */
 #define IEMTLB_PHYS_REV_INCR    RT_BIT_64(8)
+/** Calculates the TLB tag for a virtual address (sign extension stripped).
+ * @param   a_pTlb      The TLB.
+ * @param   a_GCPtr     The virtual address. */
+#define IEMTLB_CALC_TAG(a_pTlb, a_GCPtr) \
+    ( (((uint64_t)(a_GCPtr) << 16) >> (X86_PAGE_SHIFT + 16)) | (a_pTlb)->uTlbRevision )
+/** Calculates the TLB tag for a virtual address without the revision.
+ * @param   a_GCPtr     The virtual address. */
+#define IEMTLB_CALC_TAG_NO_REV(a_GCPtr) \
+    ( ((uint64_t)(a_GCPtr) << 16) >> (X86_PAGE_SHIFT + 16) )
+/** Converts a TLB tag to a pointer to the corresponding TLB entry.
+ * @param   a_pTlb      The TLB.
+ * @param   a_uTag      The tag (IEMTLB_CALC_TAG). */
+#define IEMTLB_TAG_TO_ENTRY(a_pTlb, a_uTag) \
+    ( &(a_pTlb)->aEntries[(uintptr_t)(a_uTag) & (IEMTLB_ENTRY_COUNT - 1)] )
 
 
 /**
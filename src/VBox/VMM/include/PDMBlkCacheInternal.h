@@ -80,6 +80,10 @@ typedef struct PDMBLKCACHEENTRY
 #define PDMBLKCACHE_ENTRY_LOCKED         RT_BIT(1)
 /** Entry is dirty */
 #define PDMBLKCACHE_ENTRY_IS_DIRTY       RT_BIT(2)
+/** Entry was accessed since it was last considered for eviction.
+ * Set without holding the global cache lock on hits, gives the entry a second
+ * chance instead of moving it to the head of the frequently used list. */
+#define PDMBLKCACHE_ENTRY_REFERENCED     RT_BIT(3)
 /** Entry is not evictable. */
 #define PDMBLKCACHE_NOT_EVICTABLE  (PDMBLKCACHE_ENTRY_LOCKED | PDMBLKCACHE_ENTRY_IO_IN_PROGRESS | PDMBLKCACHE_ENTRY_IS_DIRTY)
 
@@ -154,6 +158,12 @@ typedef struct PDMBLKCACHEGLOBAL
     STAMPROFILEADV      StatTreeRemove;
     /** Number of times a buffer could be reused. */
     STAMCOUNTER         StatBuffersReused;
+    /** Number of times the global cache lock was contended. */
+    STAMCOUNTER         StatLockContention;
+    /** Number of times a shard lock was contended. */
+    STAMCOUNTER         StatShardContention;
+    /** Number of second chances given to referenced entries during eviction. */
+    STAMCOUNTER         StatSecondChance;
 #endif
 } PDMBLKCACHEGLOBAL;
 #ifdef VBOX_WITH_STATISTICS
@@ -175,6 +185,28 @@ typedef enum PDMBLKCACHETYPE
     PDMBLKCACHETYPE_USB
 } PDMBLKCACHETYPE;
 
+/** Number of entry lookup shards per cache user, must be a power of two. */
+#define PDMBLKCACHE_SHARDS              8
+/** Shift of the offset stripe which maps to a single shard.
+ * Stripes are assigned round robin to the shards and cache entries never cross
+ * a stripe boundary, so an offset is always looked up in exactly one shard. */
+#define PDMBLKCACHE_SHARD_STRIPE_SHIFT  20
+
+/**
+ * Entry lookup shard.
+ */
+typedef struct PDMBLKCACHESHARD
+{
+    /** AVL tree managing the cache entries of this shard. */
+    PAVLRU64TREE                  pTree;
+    /** R/W semaphore protecting the cached entries of this shard. */
+    RTSEMRW                       SemRWEntries;
+    /** Number of threads owning or waiting for exclusive access (for statistics). */
+    volatile uint32_t             cWriters;
+} PDMBLKCACHESHARD;
+/** Pointer to an entry lookup shard. */
+typedef PDMBLKCACHESHARD *PPDMBLKCACHESHARD;
+
 /**
  * Per user cache data.
  */
@@ -182,10 +214,8 @@ typedef struct PDMBLKCACHE
 {
     /** Pointer to the id for the cache. */
     char                         *pszId;
-    /** AVL tree managing cache entries. */
-    PAVLRU64TREE                  pTree;
-    /** R/W semaphore protecting cached entries for this endpoint. */
-    RTSEMRW                       SemRWEntries;
+    /** The entry lookup shards, indexed by offset stripe. */
+    PDMBLKCACHESHARD              aShards[PDMBLKCACHE_SHARDS];
     /** Pointer to the gobal cache data */
     PPDMBLKCACHEGLOBAL            pCache;
     /** Lock protecting the dirty entries list. */
@@ -1472,6 +1472,25 @@ typedef PGMLIVESAVERAMPAGE *PPGMLIVESAVERAMPAGE;
 /** The max value of PGMLIVESAVERAMPAGE::cDirtied. */
 #define PGMLIVSAVEPAGE_MAX_DIRTIED 0x00fffff0
 
+/**
+ * Duplicate page index entry used when saving RAM pages.
+ *
+ * The index is direct mapped on the page content hash, so a hit is only a
+ * hint and the candidate page must be compared before it can be referenced.
+ */
+typedef struct PGMLIVESAVEDUPENTRY
+{
+    /** The content hash of the page. */
+    uint64_t                            uHash;
+    /** The guest physical address of the page, NIL_RTGCPHYS if unused. */
+    RTGCPHYS                            GCPhys;
+} PGMLIVESAVEDUPENTRY;
+/** Pointer to a duplicate page index entry. */
+typedef PGMLIVESAVEDUPENTRY *PPGMLIVESAVEDUPENTRY;
+
+/** The number of entries in the duplicate page index (power of two). */
+#define PGMLIVESAVE_DUP_INDEX_ENTRIES   _256K
+
 
 /**
  * RAM range for GC Phys to HC Phys conversion.
@@ -3600,7 +3619,10 @@ typedef struct PGM
         uint64_t                    uSaveStartNS;
         /** Pages per second (for statistics). */
         uint32_t                    cPagesPerSecond;
-        uint32_t                    cAlignment;
+        /** The number of RAM pages saved as references to identical pages. */
+        uint32_t                    cDupPages;
+        /** The duplicate page index, NULL if not allocated. */
+        R3PTRTYPE(PPGMLIVESAVEDUPENTRY) paDupIndex;
     } LiveSave;
 
     /** @name   Error injection.
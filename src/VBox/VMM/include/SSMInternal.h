@@ -313,7 +313,10 @@ typedef struct SSM
     bool                    fInitialized;
     /** Current pass (for STAM). */
     uint32_t                uPass;
-    uint32_t                u32Alignment;
+    /** The number of multi-stream compression threads to use when saving,
+     * zero to use the classic single threaded compression.
+     * See /SSM/ZipThreads. */
+    uint32_t                cZipThreads;
 } SSM;
 /** Pointer to SSM VM instance data. */
 typedef SSM *PSSM;
@@ -98,6 +98,10 @@ typedef struct STAMDESC
         PSTAMPROFILEADV pProfileAdv;
         /** Ratio, unsigned 32-bit. */
         PSTAMRATIOU32   pRatioU32;
+        /** Per-CPU counter. */
+        PSTAMCOUNTERPERCPU pCounterPerCpu;
+        /** Per-CPU profile. */
+        PSTAMPROFILEPERCPU pProfilePerCpu;
         /** unsigned 8-bit. */
         uint8_t        *pu8;
         /** unsigned 16-bit. */
@@ -146,8 +150,9 @@ typedef struct STAMUSERPERVM
     /** The number of registered host CPU leaves. */
     uint32_t                cRegisteredHostCpus;
 
-    /** Explicit alignment padding. */
-    uint32_t                uAlignment;
+    /** Registration generation, incremented whenever a sample is registered
+     * or deregistered.  Used by the delta snapshotter to detect stale handles. */
+    uint32_t volatile       uRegGeneration;
     /** The copy of the GMM statistics. */
     GMMSTATS                GMMStats;
 } STAMUSERPERVM;
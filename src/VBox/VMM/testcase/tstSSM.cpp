@@ -21,6 +21,7 @@
 *********************************************************************************************************************************/
 #include <VBox/vmm/ssm.h>
 #include "VMInternal.h" /* createFakeVM */
+#include "SSMInternal.h" /* cZipThreads */
 #include <VBox/vmm/vm.h>
 #include <VBox/vmm/uvm.h>
 #include <VBox/vmm/mm.h>
@@ -928,6 +929,47 @@ extern "C" DECLEXPORT(int) TrustedMain(int argc, char **argv, char **envp)
         return 1;
     }
 
+    /*
+     * Repeat the save and load using multi-stream compression.
+     */
+    pVM->ssm.s.cZipThreads = 4;
+    u64Start = RTTimeNanoTS();
+    rc = SSMR3Save(pVM, pszFilename, NULL, NULL, SSMAFTER_DESTROY, NULL, NULL);
+    if (RT_FAILURE(rc))
+    {
+        RTPrintf("SSMR3Save #2 -> %Rrc\n", rc);
+        return 1;
+    }
+    u64Elapsed = RTTimeNanoTS() - u64Start;
+    RTPrintf("tstSSM: Saved with %u zip threads in %'RI64 ns\n", pVM->ssm.s.cZipThreads, u64Elapsed);
+    pVM->ssm.s.cZipThreads = 0;
+
+    rc = RTPathQueryInfo(pszFilename, &Info, RTFSOBJATTRADD_NOTHING);
+    if (RT_FAILURE(rc))
+    {
+        RTPrintf("tstSSM: failed to query file size: %Rrc\n", rc);
+        return 1;
+    }
+    RTPrintf("tstSSM: file size %'RI64 bytes\n", Info.cbObject);
+
+    u64Start = RTTimeNanoTS();
+    rc = SSMR3Load(pVM, pszFilename, NULL /*pStreamOps*/, NULL /*pStreamOpsUser*/,
+                   SSMAFTER_RESUME, NULL /*pfnProgress*/, NULL /*pvProgressUser*/);
+    if (RT_FAILURE(rc))
+    {
+        RTPrintf("SSMR3Load #2 -> %Rrc\n", rc);
+        return 1;
+    }
+    u64Elapsed = RTTimeNanoTS() - u64Start;
+    RTPrintf("tstSSM: Loaded in %'RI64 ns\n", u64Elapsed);
+
+    rc = SSMR3ValidateFile(pszFilename, true /* fChecksumIt */);
+    if (RT_FAILURE(rc))
+    {
+        RTPrintf("SSMR3ValidateFile #2 -> %Rrc\n", rc);
+        return 1;
+    }
+
     destroyFakeVM(pVM);
 
     /* delete */